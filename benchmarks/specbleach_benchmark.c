@@ -0,0 +1,773 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Benchmarks for the STFT and the spectral processors. Each case runs a few
+ * seconds of synthetic audio and prints one JSON object per line with the
+ * throughput in samples per second and the time spent per STFT frame, so
+ * results can be compared between releases. Built with the real time audit
+ * enabled, the public processing cases abort on any allocation or lock taken
+ * while processing.
+ *
+ * The accuracy mode runs the same cases through the optimized paths and
+ * through their references, the scalar kernels, the halfcomplex transforms and
+ * the exact math, and prints the signal to error ratio of every stage instead.
+ * It fails when any of them falls below its bound, so faster paths can be
+ * validated before adopting them. Usage:
+ *   specbleach_benchmark [seconds of audio per case]
+ *   specbleach_benchmark accuracy [seconds of audio per case]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../src/processors/adaptivedenoiser/adaptive_denoiser.h"
+#include "../src/processors/denoiser/spectral_denoiser.h"
+#include "../src/shared/configurations.h"
+#include "../src/shared/noise_estimation/noise_profile.h"
+#include "../src/shared/stft/stft_processor.h"
+#include "../src/shared/utils/general_utils.h"
+#include "../src/shared/utils/spectral_kernels.h"
+#include <specbleach_denoiser.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_AUDIO_SECONDS 10.F
+#define DEFAULT_ACCURACY_SECONDS 2.F
+#define NUMBER_OF_CAPTURED_SPECTRA 64U
+#define NOISE_LEARNING_FRAMES 32U
+#define BLOCK_SIZE 512U
+
+// Lowest signal to error ratios accepted in the accuracy mode. Vectorized
+// kernels and the real to complex transforms only reorder a few operations,
+// while approximations of logarithms and powers are allowed an error of a few
+// parts per million
+#define MINIMUM_KERNELS_SNR 100.0
+#define MINIMUM_APPROXIMATE_MATH_SNR 60.0
+// Reported instead of an infinite ratio when outputs are identical
+#define MAXIMUM_REPORTED_SNR 300.0
+
+static const uint32_t sample_rates[] = {16000U, 44100U, 48000U, 96000U};
+static const float frame_sizes[] = {20.F, 46.F, 100.F};
+
+typedef struct SpectrumCapture {
+  uint32_t fft_size;
+  uint32_t captured;
+  float *spectra;
+} SpectrumCapture;
+
+static double get_time_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+// Noise with a slowly modulated tone on top so every stage has work to do
+static void generate_signal(float *signal, const uint32_t number_of_samples,
+                            const uint32_t sample_rate) {
+  uint32_t seed = 1U;
+  for (uint32_t k = 0U; k < number_of_samples; k++) {
+    seed = seed * 1664525U + 1013904223U;
+    const float noise = ((float)(seed >> 8U) / 16777216.F - 0.5F) * 0.1F;
+    const float time = (float)k / (float)sample_rate;
+    signal[k] = noise + 0.3F * sinf(2.F * M_PI * 440.F * time) *
+                            (0.5F + 0.5F * sinf(2.F * M_PI * 0.5F * time));
+  }
+}
+
+static bool passthrough(SpectralProcessorHandle instance, float *fft_spectrum) {
+  (void)instance;
+  (void)fft_spectrum;
+  return true;
+}
+
+static bool capture_spectrum(SpectralProcessorHandle instance,
+                             float *fft_spectrum) {
+  SpectrumCapture *capture = (SpectrumCapture *)instance;
+
+  if (capture->captured < NUMBER_OF_CAPTURED_SPECTRA) {
+    memcpy(&capture->spectra[(size_t)capture->captured * capture->fft_size],
+           fft_spectrum, capture->fft_size * sizeof(float));
+    capture->captured++;
+  }
+
+  return true;
+}
+
+// Denoiser STFT with the given transform type
+static StftProcessor *
+initialize_general_stft(const uint32_t sample_rate, const float frame_size,
+                        const FftTransformType transform_type) {
+  return stft_processor_initialize(
+      sample_rate, frame_size, OVERLAP_FACTOR_GENERAL,
+      PADDING_CONFIGURATION_GENERAL, ZEROPADDING_AMOUNT_GENERAL,
+      INPUT_WINDOW_TYPE_GENERAL, OUTPUT_WINDOW_TYPE_GENERAL, false,
+      transform_type, ESTIMATE_PLANNER, 1U);
+}
+
+static StftProcessor *initialize_stft(const uint32_t sample_rate,
+                                      const float frame_size,
+                                      const bool adaptive) {
+  if (adaptive) {
+    return stft_processor_initialize(
+        sample_rate, frame_size, OVERLAP_FACTOR_SPEECH,
+        PADDING_CONFIGURATION_SPEECH, ZEROPADDING_AMOUNT_SPEECH,
+        INPUT_WINDOW_TYPE_SPEECH, OUTPUT_WINDOW_TYPE_SPEECH, false,
+        FFT_TRANSFORM_TYPE_SPEECH, ESTIMATE_PLANNER, 1U);
+  }
+
+  return initialize_general_stft(sample_rate, frame_size,
+                                 FFT_TRANSFORM_TYPE_GENERAL);
+}
+
+static void print_result(const char *benchmark, const int noise_scaling_type,
+                         const uint32_t sample_rate, const float frame_size,
+                         const uint32_t fft_size, const uint32_t hop,
+                         const uint32_t frames, const double elapsed_ns) {
+  const double ns_per_frame = elapsed_ns / (double)frames;
+  const double samples_per_second =
+      (double)frames * (double)hop / (elapsed_ns / 1e9);
+
+  printf("{\"benchmark\": \"%s\", \"kernels\": \"%s\", "
+         "\"noise_scaling_type\": %d, \"sample_rate\": %u, "
+         "\"frame_size_ms\": %.1f, \"fft_size\": %u, \"hop\": %u, "
+         "\"frames\": %u, \"ns_per_frame\": %.1f, "
+         "\"samples_per_second\": %.1f}\n",
+         benchmark, get_spectral_kernels()->name, noise_scaling_type,
+         sample_rate, frame_size, fft_size, hop, frames, ns_per_frame,
+         samples_per_second);
+  fflush(stdout);
+}
+
+static double get_snr_db(const float *reference, const float *output,
+                         const size_t size) {
+  double signal_energy = 0.;
+  double error_energy = 0.;
+  for (size_t k = 0U; k < size; k++) {
+    const double error = (double)reference[k] - (double)output[k];
+    signal_energy += (double)reference[k] * (double)reference[k];
+    error_energy += error * error;
+  }
+
+  if (error_energy <= 0.) {
+    return MAXIMUM_REPORTED_SNR;
+  }
+  const double snr = 10. * log10(signal_energy / error_energy);
+
+  return snr < MAXIMUM_REPORTED_SNR ? snr : MAXIMUM_REPORTED_SNR;
+}
+
+static bool print_accuracy(const char *stage, const char *reference,
+                           const int noise_scaling_type,
+                           const uint32_t sample_rate, const float frame_size,
+                           const double snr_db, const double minimum_snr_db) {
+  const bool passed = snr_db >= minimum_snr_db;
+
+  printf("{\"stage\": \"%s\", \"kernels\": \"%s\", \"reference\": \"%s\", "
+         "\"noise_scaling_type\": %d, \"sample_rate\": %u, "
+         "\"frame_size_ms\": %.1f, \"snr_db\": %.1f, "
+         "\"minimum_snr_db\": %.1f, \"passed\": %s}\n",
+         stage, get_spectral_kernels()->name, reference, noise_scaling_type,
+         sample_rate, frame_size, snr_db, minimum_snr_db,
+         passed ? "true" : "false");
+  fflush(stdout);
+
+  return passed;
+}
+
+static DenoiserParameters
+get_denoiser_parameters(const int learn_noise, const int noise_scaling_type) {
+  return (DenoiserParameters){
+      .learn_noise = learn_noise,
+      .noise_scaling_type = noise_scaling_type,
+      .reduction_amount = from_db_to_coefficient(-20.F),
+      .noise_rescale = from_db_to_coefficient(2.F),
+      .smoothing_factor = remap_percentage_log_like_unity(0.5F),
+      .transient_protection = true,
+      .whitening_factor = 0.5F,
+      .post_filter_threshold = from_db_to_coefficient(-10.F),
+  };
+}
+
+static AdaptiveDenoiserParameters get_adaptive_denoiser_parameters(void) {
+  return (AdaptiveDenoiserParameters){
+      .reduction_amount = from_db_to_coefficient(-20.F),
+      .noise_scaling_type = 0,
+      .noise_rescale = from_db_to_coefficient(2.F),
+      .smoothing_factor = remap_percentage_log_like_unity(0.5F),
+      .whitening_factor = 0.5F,
+      .post_filter_threshold = from_db_to_coefficient(-10.F),
+  };
+}
+
+// Whole STFT analysis and synthesis with no spectral processing
+static void benchmark_stft(const uint32_t sample_rate, const float frame_size,
+                           const FftTransformType transform_type,
+                           const float *signal, float *output,
+                           const uint32_t number_of_samples) {
+  StftProcessor *stft_processor =
+      initialize_general_stft(sample_rate, frame_size, transform_type);
+  const uint32_t hop = get_stft_hop(stft_processor);
+
+  const double start = get_time_ns();
+  for (uint32_t k = 0U; k < number_of_samples; k += BLOCK_SIZE) {
+    const uint32_t block_size = number_of_samples - k < BLOCK_SIZE
+                                    ? number_of_samples - k
+                                    : BLOCK_SIZE;
+    stft_processor_run(stft_processor, block_size, &signal[k], &output[k],
+                       &passthrough, NULL);
+  }
+  const double elapsed = get_time_ns() - start;
+
+  print_result(transform_type == REAL_TO_COMPLEX_TRANSFORM
+                   ? "stft_processor_run_r2c"
+                   : "stft_processor_run",
+               -1, sample_rate, frame_size, get_stft_fft_size(stft_processor),
+               hop, number_of_samples / hop, elapsed);
+
+  stft_processor_free(stft_processor);
+}
+
+// Forward and backward transforms of the frames of every hop, without the STFT
+// around them. Real to complex transforms go through the halfcomplex layout or
+// stay over the complex spectrum, which tells what the conversion costs. The
+// first hop of every reconstructed frame goes to the output
+static double run_fft_transform(const uint32_t sample_rate,
+                                const float frame_size,
+                                const FftTransformType transform_type,
+                                const bool complex_spectrum,
+                                const float *signal, float *output,
+                                const uint32_t number_of_samples,
+                                uint32_t *fft_size, uint32_t *hop,
+                                uint32_t *frames) {
+  const uint32_t frame_samples =
+      (uint32_t)((frame_size / 1000.F) * (float)sample_rate);
+  FftTransform *fft_transform = fft_transform_initialize(
+      frame_samples, PADDING_CONFIGURATION_GENERAL, ZEROPADDING_AMOUNT_GENERAL,
+      transform_type, ESTIMATE_PLANNER, 1U);
+  const float *frame = get_fft_channel_frame(fft_transform, 0U);
+  *fft_size = get_fft_size(fft_transform);
+  *hop = frame_samples / OVERLAP_FACTOR_GENERAL;
+  *frames = 0U;
+
+  const double start = get_time_ns();
+  for (uint32_t k = 0U; k + frame_samples <= number_of_samples; k += *hop) {
+    fft_load_input_samples(fft_transform, &signal[k]);
+    if (complex_spectrum) {
+      compute_forward_fft_complex(fft_transform);
+      compute_backward_fft_complex(fft_transform);
+    } else {
+      compute_forward_fft(fft_transform);
+      compute_backward_fft(fft_transform);
+    }
+    memcpy(&output[k], frame, *hop * sizeof(float));
+    (*frames)++;
+  }
+  const double elapsed = get_time_ns() - start;
+
+  fft_transform_free(fft_transform);
+
+  return elapsed;
+}
+
+static void benchmark_fft_transform(const uint32_t sample_rate,
+                                    const float frame_size,
+                                    const FftTransformType transform_type,
+                                    const bool complex_spectrum,
+                                    const float *signal, float *output,
+                                    const uint32_t number_of_samples) {
+  uint32_t fft_size = 0U;
+  uint32_t hop = 0U;
+  uint32_t frames = 0U;
+  const double elapsed = run_fft_transform(
+      sample_rate, frame_size, transform_type, complex_spectrum, signal,
+      output, number_of_samples, &fft_size, &hop, &frames);
+
+  print_result(complex_spectrum ? "fft_transform_r2c_complex"
+               : transform_type == REAL_TO_COMPLEX_TRANSFORM
+                   ? "fft_transform_r2c"
+                   : "fft_transform",
+               -1, sample_rate, frame_size, fft_size, hop, frames, elapsed);
+}
+
+// Captures real spectra of the signal to feed the spectral processors directly
+static SpectrumCapture capture_spectra(StftProcessor *stft_processor,
+                                       const float *signal, float *output,
+                                       const uint32_t number_of_samples) {
+  SpectrumCapture capture = (SpectrumCapture){
+      .fft_size = get_stft_fft_size(stft_processor),
+      .captured = 0U,
+  };
+  capture.spectra = (float *)calloc(
+      (size_t)NUMBER_OF_CAPTURED_SPECTRA * capture.fft_size, sizeof(float));
+
+  stft_processor_run(stft_processor, number_of_samples, signal, output,
+                     &capture_spectrum, &capture);
+
+  return capture;
+}
+
+static double run_spectral_processor(spectral_processing processing,
+                                     SpectralProcessorHandle processor,
+                                     const SpectrumCapture *capture,
+                                     float *work_spectrum,
+                                     const uint32_t frames) {
+  const double start = get_time_ns();
+  for (uint32_t k = 0U; k < frames; k++) {
+    memcpy(work_spectrum,
+           &capture->spectra[(size_t)(k % capture->captured) *
+                             capture->fft_size],
+           capture->fft_size * sizeof(float));
+    processing(processor, work_spectrum);
+  }
+  return get_time_ns() - start;
+}
+
+static void benchmark_denoiser(const uint32_t sample_rate,
+                               const float frame_size,
+                               const int noise_scaling_type,
+                               const bool approximate_math,
+                               const uint32_t gain_update_interval,
+                               const float *signal, float *output,
+                               const uint32_t number_of_samples) {
+  StftProcessor *stft_processor =
+      initialize_stft(sample_rate, frame_size, false);
+  const uint32_t fft_size = get_stft_fft_size(stft_processor);
+  const uint32_t hop = get_stft_hop(stft_processor);
+  const uint32_t frames = number_of_samples / hop;
+
+  SpectrumCapture capture =
+      capture_spectra(stft_processor, signal, output, number_of_samples);
+  float *work_spectrum = (float *)calloc(fft_size, sizeof(float));
+
+  NoiseProfile *noise_profile =
+      noise_profile_initialize(get_stft_real_spectrum_size(stft_processor));
+  SpectralProcessorHandle denoiser = spectral_denoiser_initialize(
+      sample_rate, fft_size, OVERLAP_FACTOR_GENERAL, noise_profile,
+      ESTIMATE_PLANNER, 0U, 0U, approximate_math, false);
+  spectral_denoiser_set_gain_update_interval(denoiser, gain_update_interval);
+
+  DenoiserParameters parameters =
+      get_denoiser_parameters(1, noise_scaling_type);
+  load_reduction_parameters(denoiser, parameters);
+  run_spectral_processor(&spectral_denoiser_run, denoiser, &capture,
+                         work_spectrum, NOISE_LEARNING_FRAMES);
+
+  parameters.learn_noise = 0;
+  load_reduction_parameters(denoiser, parameters);
+  const double elapsed = run_spectral_processor(
+      &spectral_denoiser_run, denoiser, &capture, work_spectrum, frames);
+
+  const char *name = "spectral_denoiser_run";
+  if (approximate_math) {
+    name = "spectral_denoiser_run_approximate";
+  } else if (gain_update_interval > 1U) {
+    name = "spectral_denoiser_run_held_gains";
+  }
+  print_result(name, noise_scaling_type, sample_rate, frame_size, fft_size, hop,
+               frames, elapsed);
+
+  spectral_denoiser_free(denoiser);
+  noise_profile_free(noise_profile);
+  stft_processor_free(stft_processor);
+  free(capture.spectra);
+  free(work_spectrum);
+}
+
+static void benchmark_adaptive_denoiser(const uint32_t sample_rate,
+                                        const float frame_size,
+                                        const bool band_processing,
+                                        const float *signal, float *output,
+                                        const uint32_t number_of_samples) {
+  StftProcessor *stft_processor =
+      initialize_stft(sample_rate, frame_size, true);
+  const uint32_t fft_size = get_stft_fft_size(stft_processor);
+  const uint32_t hop = get_stft_hop(stft_processor);
+  const uint32_t frames = number_of_samples / hop;
+
+  SpectrumCapture capture =
+      capture_spectra(stft_processor, signal, output, number_of_samples);
+  float *work_spectrum = (float *)calloc(fft_size, sizeof(float));
+
+  SpectralProcessorHandle denoiser = spectral_adaptive_denoiser_initialize(
+      sample_rate, fft_size, OVERLAP_FACTOR_SPEECH, ESTIMATE_PLANNER, false,
+      CONTINUOUS_MINIMUM_TRACKER, band_processing);
+
+  load_adaptive_reduction_parameters(denoiser,
+                                     get_adaptive_denoiser_parameters());
+
+  const double elapsed =
+      run_spectral_processor(&spectral_adaptive_denoiser_run, denoiser,
+                             &capture, work_spectrum, frames);
+
+  print_result(band_processing ? "spectral_adaptive_denoiser_run_bands"
+                               : "spectral_adaptive_denoiser_run",
+               0, sample_rate, frame_size, fft_size, hop, frames, elapsed);
+
+  spectral_adaptive_denoiser_free(denoiser);
+  stft_processor_free(stft_processor);
+  free(capture.spectra);
+  free(work_spectrum);
+}
+
+// Whole public processing path in blocks, learning the noise profile with the
+// given learn mode over the first part of the signal
+static void process_signal(const uint32_t sample_rate, const float frame_size,
+                           const int learn_noise, const int noise_scaling_type,
+                           const float *signal, float *output,
+                           const uint32_t number_of_samples) {
+  SpectralBleachHandle denoiser =
+      specbleach_initialize(sample_rate, frame_size);
+
+  SpectralBleachParameters parameters = (SpectralBleachParameters){
+      .learn_noise = learn_noise,
+      .noise_scaling_type = noise_scaling_type,
+      .reduction_amount = 20.F,
+      .noise_rescale = 2.F,
+      .smoothing_factor = 50.F,
+      .transient_protection = true,
+      .whitening_factor = 50.F,
+      .post_filter_threshold = -10.F,
+  };
+  specbleach_load_parameters(denoiser, parameters);
+
+  const uint32_t learning_samples = number_of_samples / 4U;
+  for (uint32_t k = 0U; k < number_of_samples; k += BLOCK_SIZE) {
+    if (k >= learning_samples && parameters.learn_noise != 0) {
+      parameters.learn_noise = 0;
+      specbleach_load_parameters(denoiser, parameters);
+    }
+
+    const uint32_t block_size = number_of_samples - k < BLOCK_SIZE
+                                    ? number_of_samples - k
+                                    : BLOCK_SIZE;
+    specbleach_process(denoiser, block_size, &signal[k], &output[k]);
+  }
+
+  specbleach_free(denoiser);
+}
+
+static void benchmark_process(const uint32_t sample_rate,
+                              const float frame_size, const int learn_noise,
+                              const int noise_scaling_type,
+                              const float *signal, float *output,
+                              const uint32_t number_of_samples) {
+  const double start = get_time_ns();
+  process_signal(sample_rate, frame_size, learn_noise, noise_scaling_type,
+                 signal, output, number_of_samples);
+  const double elapsed = get_time_ns() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "specbleach_process_learn_%d", learn_noise);
+  print_result(name, noise_scaling_type, sample_rate, frame_size, 0U,
+               BLOCK_SIZE, number_of_samples / BLOCK_SIZE, elapsed);
+}
+
+// Every captured spectrum processed once, after learning from the first ones
+// for the denoiser. Output spectra are stored one after the other
+static void process_captured_spectra(const SpectrumCapture *capture,
+                                     const uint32_t sample_rate,
+                                     const bool adaptive,
+                                     const int noise_scaling_type,
+                                     const bool option, float *outputs) {
+  const uint32_t fft_size = capture->fft_size;
+  NoiseProfile *noise_profile = NULL;
+  SpectralProcessorHandle processor = NULL;
+  spectral_processing processing = NULL;
+
+  // The option is approximate math for the denoiser and band processing for
+  // the adaptive denoiser
+  if (adaptive) {
+    processor = spectral_adaptive_denoiser_initialize(
+        sample_rate, fft_size, OVERLAP_FACTOR_SPEECH, ESTIMATE_PLANNER, false,
+        CONTINUOUS_MINIMUM_TRACKER, option);
+    load_adaptive_reduction_parameters(processor,
+                                       get_adaptive_denoiser_parameters());
+    processing = &spectral_adaptive_denoiser_run;
+  } else {
+    noise_profile = noise_profile_initialize(fft_size / 2U + 1U);
+    processor = spectral_denoiser_initialize(
+        sample_rate, fft_size, OVERLAP_FACTOR_GENERAL, noise_profile,
+        ESTIMATE_PLANNER, 0U, 0U, option, false);
+    processing = &spectral_denoiser_run;
+
+    load_reduction_parameters(processor,
+                              get_denoiser_parameters(1, noise_scaling_type));
+    for (uint32_t k = 0U; k < NOISE_LEARNING_FRAMES; k++) {
+      memcpy(outputs, &capture->spectra[(size_t)(k % capture->captured) *
+                                        fft_size],
+             fft_size * sizeof(float));
+      processing(processor, outputs);
+    }
+    load_reduction_parameters(processor,
+                              get_denoiser_parameters(0, noise_scaling_type));
+  }
+
+  for (uint32_t k = 0U; k < capture->captured; k++) {
+    float *output = &outputs[(size_t)k * fft_size];
+    memcpy(output, &capture->spectra[(size_t)k * fft_size],
+           fft_size * sizeof(float));
+    processing(processor, output);
+  }
+
+  if (adaptive) {
+    spectral_adaptive_denoiser_free(processor);
+  } else {
+    spectral_denoiser_free(processor);
+    noise_profile_free(noise_profile);
+  }
+}
+
+// Compares the selected kernels against the scalar ones, and approximate math
+// against exact math, for every stage of a sample rate and frame size
+static bool check_accuracy(const uint32_t sample_rate, const float frame_size,
+                           const float *signal, float *output,
+                           float *reference_output,
+                           const uint32_t number_of_samples) {
+  const SpectralKernels *scalar_kernels = get_scalar_spectral_kernels();
+  bool passed = true;
+
+  // STFT analysis and synthesis alone
+  StftProcessor *stft_processor =
+      initialize_stft(sample_rate, frame_size, false);
+  stft_processor_run(stft_processor, number_of_samples, signal, output,
+                     &passthrough, NULL);
+  stft_processor_free(stft_processor);
+
+  set_spectral_kernels(scalar_kernels);
+  stft_processor = initialize_stft(sample_rate, frame_size, false);
+  stft_processor_run(stft_processor, number_of_samples, signal,
+                     reference_output, &passthrough, NULL);
+  stft_processor_free(stft_processor);
+  set_spectral_kernels(NULL);
+
+  passed &= print_accuracy(
+      "stft_processor_run", "scalar", -1, sample_rate, frame_size,
+      get_snr_db(reference_output, output, number_of_samples),
+      MINIMUM_KERNELS_SNR);
+
+  // Real to complex transforms against the halfcomplex ones, both for the
+  // spectra analyzed and for the reconstructed signal
+  SpectrumCapture captures[2];
+  for (uint32_t k = 0U; k < 2U; k++) {
+    stft_processor = initialize_general_stft(
+        sample_rate, frame_size,
+        k == 0U ? HALFCOMPLEX_TRANSFORM : REAL_TO_COMPLEX_TRANSFORM);
+    captures[k] = capture_spectra(stft_processor, signal,
+                                  k == 0U ? reference_output : output,
+                                  number_of_samples);
+    stft_processor_free(stft_processor);
+  }
+  passed &= print_accuracy(
+      "stft_processor_run_r2c", "halfcomplex", -1, sample_rate, frame_size,
+      get_snr_db(reference_output, output, number_of_samples),
+      MINIMUM_KERNELS_SNR);
+  passed &= print_accuracy(
+      "stft_processor_analysis_r2c", "halfcomplex", -1, sample_rate,
+      frame_size,
+      get_snr_db(captures[0].spectra, captures[1].spectra,
+                 (size_t)captures[0].captured * captures[0].fft_size),
+      MINIMUM_KERNELS_SNR);
+  free(captures[0].spectra);
+  free(captures[1].spectra);
+
+  // Transforms over the complex spectrum against the halfcomplex ones
+  uint32_t fft_size = 0U;
+  uint32_t hop = 0U;
+  uint32_t frames = 0U;
+  memset(reference_output, 0, number_of_samples * sizeof(float));
+  memset(output, 0, number_of_samples * sizeof(float));
+  run_fft_transform(sample_rate, frame_size, HALFCOMPLEX_TRANSFORM, false,
+                    signal, reference_output, number_of_samples, &fft_size,
+                    &hop, &frames);
+  run_fft_transform(sample_rate, frame_size, REAL_TO_COMPLEX_TRANSFORM, true,
+                    signal, output, number_of_samples, &fft_size, &hop,
+                    &frames);
+  passed &= print_accuracy(
+      "fft_transform_r2c_complex", "halfcomplex", -1, sample_rate, frame_size,
+      get_snr_db(reference_output, output, number_of_samples),
+      MINIMUM_KERNELS_SNR);
+
+  // Spectral processors over the same captured spectra
+  for (uint32_t adaptive = 0U; adaptive <= 1U; adaptive++) {
+    stft_processor = initialize_stft(sample_rate, frame_size, adaptive);
+    SpectrumCapture capture =
+        capture_spectra(stft_processor, signal, output, number_of_samples);
+    stft_processor_free(stft_processor);
+
+    const size_t spectra_size = (size_t)capture.captured * capture.fft_size;
+    float *spectra = (float *)calloc(spectra_size, sizeof(float));
+    float *reference_spectra = (float *)calloc(spectra_size, sizeof(float));
+
+    const int last_scaling_type = adaptive ? 0 : 2;
+    for (int noise_scaling_type = 0; noise_scaling_type <= last_scaling_type;
+         noise_scaling_type++) {
+      for (uint32_t option = 0U; option <= 1U; option++) {
+        const char *stage =
+            adaptive ? (option ? "spectral_adaptive_denoiser_run_bands"
+                               : "spectral_adaptive_denoiser_run")
+                     : (option ? "spectral_denoiser_run_approximate"
+                               : "spectral_denoiser_run");
+
+        process_captured_spectra(&capture, sample_rate, adaptive,
+                                 noise_scaling_type, option, spectra);
+
+        set_spectral_kernels(scalar_kernels);
+        process_captured_spectra(&capture, sample_rate, adaptive,
+                                 noise_scaling_type, option,
+                                 reference_spectra);
+        set_spectral_kernels(NULL);
+
+        passed &= print_accuracy(
+            stage, "scalar", noise_scaling_type, sample_rate, frame_size,
+            get_snr_db(reference_spectra, spectra, spectra_size),
+            MINIMUM_KERNELS_SNR);
+
+        // Approximate math against the exact math with the same kernels
+        if (!adaptive && option) {
+          process_captured_spectra(&capture, sample_rate, false,
+                                   noise_scaling_type, false,
+                                   reference_spectra);
+
+          passed &= print_accuracy(
+              stage, "exact_math", noise_scaling_type, sample_rate,
+              frame_size, get_snr_db(reference_spectra, spectra, spectra_size),
+              MINIMUM_APPROXIMATE_MATH_SNR);
+        }
+      }
+    }
+
+    free(capture.spectra);
+    free(spectra);
+    free(reference_spectra);
+  }
+
+  // Every learn mode and noise scaling type through the public API
+  for (int learn_noise = 1; learn_noise <= 5; learn_noise++) {
+    for (int noise_scaling_type = 0; noise_scaling_type <= 2;
+         noise_scaling_type++) {
+      process_signal(sample_rate, frame_size, learn_noise, noise_scaling_type,
+                     signal, output, number_of_samples);
+
+      set_spectral_kernels(scalar_kernels);
+      process_signal(sample_rate, frame_size, learn_noise, noise_scaling_type,
+                     signal, reference_output, number_of_samples);
+      set_spectral_kernels(NULL);
+
+      char stage[64];
+      snprintf(stage, sizeof(stage), "specbleach_process_learn_%d",
+               learn_noise);
+      passed &= print_accuracy(
+          stage, "scalar", noise_scaling_type, sample_rate, frame_size,
+          get_snr_db(reference_output, output, number_of_samples),
+          MINIMUM_KERNELS_SNR);
+    }
+  }
+
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  const bool accuracy = argc > 1 && strcmp(argv[1], "accuracy") == 0;
+  const int seconds_argument = accuracy ? 2 : 1;
+  const float audio_seconds =
+      argc > seconds_argument ? (float)atof(argv[seconds_argument])
+      : accuracy              ? DEFAULT_ACCURACY_SECONDS
+                              : DEFAULT_AUDIO_SECONDS;
+
+  if (audio_seconds <= 0.F) {
+    fprintf(stderr,
+            "usage: %s [seconds of audio per case]\n"
+            "       %s accuracy [seconds of audio per case]\n",
+            argv[0], argv[0]);
+    return 1;
+  }
+
+  bool passed = true;
+
+  for (size_t i = 0U; i < sizeof(sample_rates) / sizeof(sample_rates[0]);
+       i++) {
+    const uint32_t sample_rate = sample_rates[i];
+    const uint32_t number_of_samples =
+        (uint32_t)(audio_seconds * (float)sample_rate);
+
+    float *signal = (float *)calloc(number_of_samples, sizeof(float));
+    float *output = (float *)calloc(number_of_samples, sizeof(float));
+    float *reference_output =
+        (float *)calloc(number_of_samples, sizeof(float));
+    generate_signal(signal, number_of_samples, sample_rate);
+
+    for (size_t j = 0U; j < sizeof(frame_sizes) / sizeof(frame_sizes[0]);
+         j++) {
+      const float frame_size = frame_sizes[j];
+
+      if (accuracy) {
+        passed &= check_accuracy(sample_rate, frame_size, signal, output,
+                                 reference_output, number_of_samples);
+        continue;
+      }
+
+      benchmark_fft_transform(sample_rate, frame_size, HALFCOMPLEX_TRANSFORM,
+                              false, signal, output, number_of_samples);
+      benchmark_fft_transform(sample_rate, frame_size,
+                              REAL_TO_COMPLEX_TRANSFORM, false, signal, output,
+                              number_of_samples);
+      benchmark_fft_transform(sample_rate, frame_size,
+                              REAL_TO_COMPLEX_TRANSFORM, true, signal, output,
+                              number_of_samples);
+      benchmark_stft(sample_rate, frame_size, HALFCOMPLEX_TRANSFORM, signal,
+                     output, number_of_samples);
+      benchmark_stft(sample_rate, frame_size, REAL_TO_COMPLEX_TRANSFORM,
+                     signal, output, number_of_samples);
+      for (int noise_scaling_type = 0; noise_scaling_type <= 2;
+           noise_scaling_type++) {
+        benchmark_denoiser(sample_rate, frame_size, noise_scaling_type, false,
+                           1U, signal, output, number_of_samples);
+      }
+      // Masking thresholds are where approximate math is used the most, and
+      // what holding the gains over a few hops saves the most of
+      benchmark_denoiser(sample_rate, frame_size, 2, true, 1U, signal, output,
+                         number_of_samples);
+      benchmark_denoiser(sample_rate, frame_size, 2, false, 4U, signal, output,
+                         number_of_samples);
+      benchmark_adaptive_denoiser(sample_rate, frame_size, false, signal,
+                                  output, number_of_samples);
+      benchmark_adaptive_denoiser(sample_rate, frame_size, true, signal,
+                                  output, number_of_samples);
+      // Every learn mode and noise scaling type through the public API
+      for (int learn_noise = 1; learn_noise <= 5; learn_noise++) {
+        for (int noise_scaling_type = 0; noise_scaling_type <= 2;
+             noise_scaling_type++) {
+          benchmark_process(sample_rate, frame_size, learn_noise,
+                            noise_scaling_type, signal, output,
+                            number_of_samples);
+        }
+      }
+    }
+
+    free(signal);
+    free(output);
+    free(reference_output);
+  }
+
+  return passed ? 0 : 1;
+}
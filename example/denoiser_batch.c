@@ -0,0 +1,532 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Console tool to denoise many files with the denoiser processor. Files are
+ * streamed in large blocks through the interleaved processing, so memory
+ * doesn't grow with their length, and several files are processed
+ * concurrently by a pool of workers. The noise profile is either learned from
+ * the beginning of each file, learned once from a noise file or loaded from a
+ * serialized profile, which can also be saved. Throughput is reported for
+ * every file and for the whole batch
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <libgen.h>
+#include <pthread.h>
+#include <sndfile.h>
+#include <specbleach_denoiser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Frames read or written by each call to libsndfile
+#define IO_BLOCK_FRAMES 65536
+#define DEFAULT_FRAME_SIZE 46.F
+#define DEFAULT_REDUCTION 10.F
+#define DEFAULT_LEARN_MODE 1
+#define DEFAULT_LEARN_SECONDS 0.5F
+
+typedef struct BatchOptions {
+  const char *output_directory;
+  const char *noise_file_name;
+  const char *load_profile_file_name;
+  const char *save_profile_file_name;
+  uint32_t number_of_workers;
+  float frame_size;
+  float reduction_amount;
+  int learn_mode;
+  float learn_seconds;
+} BatchOptions;
+
+// A profile shared by every file, as the serialized record of the library
+typedef struct SharedProfile {
+  void *record;
+  size_t record_size;
+} SharedProfile;
+
+typedef struct Batch {
+  const BatchOptions *options;
+  const SharedProfile *profile;
+  char **input_file_names;
+  uint32_t number_of_files;
+  uint32_t next_file;
+  uint32_t failed_files;
+  double audio_seconds;
+  pthread_mutex_t report_mutex;
+} Batch;
+
+// An open file with the blocks it is streamed through
+typedef struct Stream {
+  SNDFILE *file;
+  SF_INFO info;
+  float *input;
+  float *output;
+} Stream;
+
+static double get_time_seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void stream_close(Stream *stream) {
+  if (stream->file) {
+    sf_close(stream->file);
+  }
+  free(stream->input);
+  free(stream->output);
+  memset(stream, 0, sizeof(Stream));
+}
+
+static bool stream_open(const char *file_name, Stream *stream) {
+  memset(stream, 0, sizeof(Stream));
+
+  stream->file = sf_open(file_name, SFM_READ, &stream->info);
+  if (!stream->file) {
+    return false;
+  }
+
+  const size_t block_size =
+      (size_t)IO_BLOCK_FRAMES * (size_t)stream->info.channels;
+  stream->input = (float *)calloc(block_size, sizeof(float));
+  stream->output = (float *)calloc(block_size, sizeof(float));
+
+  if (!stream->input || !stream->output || stream->info.frames <= 0) {
+    stream_close(stream);
+    return false;
+  }
+
+  return true;
+}
+
+static SpectralBleachParameters get_parameters(const BatchOptions *options,
+                                               const int learn_noise) {
+  // Parameters are hardcoded except for the reduction, as in the demos
+  return (SpectralBleachParameters){
+      .residual_listen = false,
+      .learn_noise = learn_noise,
+      .reduction_amount = options->reduction_amount,
+      .smoothing_factor = 0.F,
+      .noise_rescale = 2.F,
+      .noise_scaling_type = 0,
+      .whitening_factor = 0.F,
+      .post_filter_threshold = -10.F};
+}
+
+// Channels of a file share a single profile, as they do when it is loaded
+static SpectralBleachHandle initialize_denoiser(const BatchOptions *options,
+                                                const Stream *stream) {
+  const SpectralBleachInitOptions init_options = {
+      .sample_rate = (uint32_t)stream->info.samplerate,
+      .frame_size = options->frame_size,
+      .number_of_channels = (uint32_t)stream->info.channels,
+      .link_channels = true,
+  };
+  SpectralBleachHandle denoiser = specbleach_initialize_ex(&init_options);
+  if (!denoiser) {
+    return NULL;
+  }
+
+  specbleach_load_parameters(denoiser, get_parameters(options, 0));
+
+  return denoiser;
+}
+
+// Processes one block read into the input of the stream and writes the output
+// past the frames of latency still to be dropped, if there is an output file
+static bool process_block(SpectralBleachHandle denoiser, Stream *stream,
+                          SNDFILE *output_file, const uint32_t frames,
+                          uint32_t *latency_frames) {
+  const uint32_t number_of_channels = (uint32_t)stream->info.channels;
+  if (!specbleach_process_interleaved(denoiser, number_of_channels, frames,
+                                      stream->input, stream->output)) {
+    return false;
+  }
+  if (!output_file) {
+    return true;
+  }
+
+  const uint32_t dropped = *latency_frames < frames ? *latency_frames : frames;
+  *latency_frames -= dropped;
+
+  return sf_writef_float(output_file,
+                         &stream->output[(size_t)dropped * number_of_channels],
+                         frames - dropped) == (sf_count_t)(frames - dropped);
+}
+
+// Streams the file from its start through the denoiser, up to max_frames or
+// the whole of it when max_frames is zero. With an output file the output is
+// latency compensated by dropping its first frames and flushing as many with
+// silence at the end. Returns the frames read, or -1 on failure
+static sf_count_t stream_file(SpectralBleachHandle denoiser, Stream *stream,
+                              SNDFILE *output_file,
+                              const sf_count_t max_frames) {
+  if (sf_seek(stream->file, 0, SEEK_SET) != 0) {
+    return -1;
+  }
+
+  uint32_t latency_frames = specbleach_get_latency(denoiser);
+  sf_count_t position = 0;
+  bool processed = true;
+  while (processed && (max_frames == 0 || position < max_frames)) {
+    sf_count_t frames = IO_BLOCK_FRAMES;
+    if (max_frames > 0 && max_frames - position < frames) {
+      frames = max_frames - position;
+    }
+    frames = sf_readf_float(stream->file, stream->input, frames);
+    if (frames <= 0) {
+      break;
+    }
+
+    processed = process_block(denoiser, stream, output_file,
+                              (uint32_t)frames, &latency_frames);
+    position += frames;
+  }
+
+  if (output_file) {
+    const size_t block_size =
+        (size_t)IO_BLOCK_FRAMES * (size_t)stream->info.channels;
+    memset(stream->input, 0, block_size * sizeof(float));
+
+    uint32_t flushed_frames = specbleach_get_latency(denoiser);
+    while (processed && flushed_frames > 0U) {
+      const uint32_t frames = flushed_frames < IO_BLOCK_FRAMES
+                                  ? flushed_frames
+                                  : IO_BLOCK_FRAMES;
+      processed = process_block(denoiser, stream, output_file, frames,
+                                &latency_frames);
+      flushed_frames -= frames;
+    }
+  }
+
+  return processed ? position : -1;
+}
+
+// Learns the profile from the first max_frames of the file, or from all of
+// it when max_frames is zero, by streaming them with learning enabled. The
+// instance is reset afterwards keeping the profile, so the file can be
+// streamed again from its start
+static bool learn_profile(SpectralBleachHandle denoiser,
+                          const BatchOptions *options, Stream *stream,
+                          const sf_count_t max_frames) {
+  const bool learned =
+      specbleach_load_parameters(
+          denoiser, get_parameters(options, options->learn_mode)) &&
+      stream_file(denoiser, stream, NULL, max_frames) > 0;
+
+  return specbleach_load_parameters(denoiser, get_parameters(options, 0)) &&
+         specbleach_reset(denoiser, true) && learned &&
+         specbleach_noise_profile_available(denoiser);
+}
+
+static bool read_file(const char *file_name, SharedProfile *profile) {
+  FILE *file = fopen(file_name, "rb");
+  if (!file) {
+    return false;
+  }
+
+  fseek(file, 0L, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0L, SEEK_SET);
+
+  profile->record = size > 0L ? malloc((size_t)size) : NULL;
+  profile->record_size = (size_t)size;
+
+  const bool read = profile->record &&
+                    fread(profile->record, 1U, profile->record_size, file) ==
+                        profile->record_size;
+  fclose(file);
+
+  return read;
+}
+
+static bool write_file(const char *file_name, const SharedProfile *profile) {
+  FILE *file = fopen(file_name, "wb");
+  if (!file) {
+    return false;
+  }
+
+  const bool written = fwrite(profile->record, 1U, profile->record_size,
+                              file) == profile->record_size;
+
+  return fclose(file) == 0 && written;
+}
+
+// Learns the profile once from the noise file and keeps it as a record, which
+// every file loads onto its own sample rate
+static bool learn_shared_profile(const BatchOptions *options,
+                                 SharedProfile *profile) {
+  Stream stream;
+  if (!stream_open(options->noise_file_name, &stream)) {
+    return false;
+  }
+
+  SpectralBleachHandle denoiser = initialize_denoiser(options, &stream);
+  bool learned = denoiser && learn_profile(denoiser, options, &stream, 0);
+
+  if (learned) {
+    profile->record_size = specbleach_get_serialized_noise_profile_size(
+        denoiser, SPECBLEACH_PROFILE_FLOAT32);
+    profile->record = malloc(profile->record_size);
+    learned = profile->record &&
+              specbleach_serialize_noise_profile(
+                  denoiser, SPECBLEACH_PROFILE_FLOAT32, profile->record,
+                  profile->record_size) == profile->record_size;
+  }
+
+  if (denoiser) {
+    specbleach_free(denoiser);
+  }
+  stream_close(&stream);
+
+  return learned;
+}
+
+static bool denoise_file(const Batch *batch, const char *input_file_name,
+                         const char *output_file_name, double *audio_seconds) {
+  const BatchOptions *options = batch->options;
+
+  Stream stream;
+  if (!stream_open(input_file_name, &stream)) {
+    return false;
+  }
+
+  SpectralBleachHandle denoiser = initialize_denoiser(options, &stream);
+
+  bool denoised = denoiser != NULL;
+  if (denoised && batch->profile->record) {
+    denoised = specbleach_deserialize_noise_profile(
+        denoiser, batch->profile->record, batch->profile->record_size);
+  } else if (denoised) {
+    // At least a frame, since zero frames would learn from the whole file
+    const sf_count_t learn_frames =
+        (sf_count_t)(options->learn_seconds * (float)stream.info.samplerate);
+    denoised = learn_profile(denoiser, options, &stream,
+                             learn_frames > 0 ? learn_frames : 1);
+  }
+
+  SNDFILE *output_file = NULL;
+  if (denoised) {
+    SF_INFO output_info = stream.info;
+    output_file = sf_open(output_file_name, SFM_WRITE, &output_info);
+    denoised = output_file != NULL;
+  }
+
+  sf_count_t frames = 0;
+  if (denoised) {
+    frames = stream_file(denoiser, &stream, output_file, 0);
+    denoised = sf_close(output_file) == 0 && frames > 0;
+  }
+  *audio_seconds =
+      denoised ? (double)frames / (double)stream.info.samplerate : 0.;
+
+  if (denoiser) {
+    specbleach_free(denoiser);
+  }
+  stream_close(&stream);
+
+  return denoised;
+}
+
+static void *batch_worker(void *instance) {
+  Batch *batch = (Batch *)instance;
+
+  while (true) {
+    const uint32_t file_index =
+        __atomic_fetch_add(&batch->next_file, 1U, __ATOMIC_RELAXED);
+    if (file_index >= batch->number_of_files) {
+      break;
+    }
+
+    const char *input_file_name = batch->input_file_names[file_index];
+    char *name_copy = strdup(input_file_name);
+    const size_t output_size = strlen(batch->options->output_directory) +
+                               strlen(input_file_name) + 2U;
+    char *output_file_name = (char *)malloc(output_size);
+
+    double audio_seconds = 0.;
+    const double start = get_time_seconds();
+    const bool denoised =
+        name_copy && output_file_name &&
+        snprintf(output_file_name, output_size, "%s/%s",
+                 batch->options->output_directory, basename(name_copy)) > 0 &&
+        denoise_file(batch, input_file_name, output_file_name, &audio_seconds);
+    const double elapsed = get_time_seconds() - start;
+
+    pthread_mutex_lock(&batch->report_mutex);
+    if (denoised) {
+      printf("%s: %.1f s of audio in %.2f s (%.1fx real time)\n",
+             input_file_name, audio_seconds, elapsed,
+             audio_seconds / elapsed);
+      batch->audio_seconds += audio_seconds;
+    } else {
+      fprintf(stderr, "%s: could not be denoised\n", input_file_name);
+      batch->failed_files++;
+    }
+    pthread_mutex_unlock(&batch->report_mutex);
+
+    free(name_copy);
+    free(output_file_name);
+  }
+
+  return NULL;
+}
+
+static void print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options] -o <output directory> <noisy input>...\n"
+          "  -j <workers>   files processed concurrently (default: cpus)\n"
+          "  -f <ms>        frame size (default: %.0f)\n"
+          "  -r <dB>        reduction amount (default: %.0f)\n"
+          "  -l <mode>      learn mode, 1 average, 2 median, 3 max, "
+          "4 decaying average,\n"
+          "                 5 windowed average (default: %d)\n"
+          "  -t <seconds>   audio learned from the start of each file "
+          "(default: %.1f)\n"
+          "  -n <file>      learns a single profile from a noise file\n"
+          "  -p <file>      loads a single serialized profile\n"
+          "  -s <file>      saves the single profile used\n",
+          program, DEFAULT_FRAME_SIZE, DEFAULT_REDUCTION, DEFAULT_LEARN_MODE,
+          DEFAULT_LEARN_SECONDS);
+}
+
+int main(int argc, char **argv) {
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  BatchOptions options = (BatchOptions){
+      .number_of_workers = cpus > 0L ? (uint32_t)cpus : 1U,
+      .frame_size = DEFAULT_FRAME_SIZE,
+      .reduction_amount = DEFAULT_REDUCTION,
+      .learn_mode = DEFAULT_LEARN_MODE,
+      .learn_seconds = DEFAULT_LEARN_SECONDS,
+  };
+
+  int option = 0;
+  while ((option = getopt(argc, argv, "o:j:f:r:l:t:n:p:s:")) != -1) {
+    switch (option) {
+    case 'o':
+      options.output_directory = optarg;
+      break;
+    case 'j':
+      options.number_of_workers = (uint32_t)atoi(optarg);
+      break;
+    case 'f':
+      options.frame_size = (float)atof(optarg);
+      break;
+    case 'r':
+      options.reduction_amount = (float)atof(optarg);
+      break;
+    case 'l':
+      options.learn_mode = atoi(optarg);
+      break;
+    case 't':
+      options.learn_seconds = (float)atof(optarg);
+      break;
+    case 'n':
+      options.noise_file_name = optarg;
+      break;
+    case 'p':
+      options.load_profile_file_name = optarg;
+      break;
+    case 's':
+      options.save_profile_file_name = optarg;
+      break;
+    default:
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  const bool single_profile =
+      options.noise_file_name || options.load_profile_file_name;
+  if (!options.output_directory || optind >= argc ||
+      options.number_of_workers == 0U || options.learn_seconds <= 0.F ||
+      (options.noise_file_name && options.load_profile_file_name) ||
+      (options.save_profile_file_name && !single_profile)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  SharedProfile profile = (SharedProfile){.record = NULL};
+  if (options.noise_file_name && !learn_shared_profile(&options, &profile)) {
+    fprintf(stderr, "%s: could not learn a profile\n",
+            options.noise_file_name);
+    return 1;
+  }
+  if (options.load_profile_file_name &&
+      !read_file(options.load_profile_file_name, &profile)) {
+    fprintf(stderr, "%s: could not be read\n", options.load_profile_file_name);
+    return 1;
+  }
+  if (options.save_profile_file_name &&
+      !write_file(options.save_profile_file_name, &profile)) {
+    fprintf(stderr, "%s: could not be written\n",
+            options.save_profile_file_name);
+    free(profile.record);
+    return 1;
+  }
+
+  Batch batch = (Batch){
+      .options = &options,
+      .profile = &profile,
+      .input_file_names = &argv[optind],
+      .number_of_files = (uint32_t)(argc - optind),
+  };
+  pthread_mutex_init(&batch.report_mutex, NULL);
+
+  const uint32_t number_of_workers =
+      options.number_of_workers < batch.number_of_files
+          ? options.number_of_workers
+          : batch.number_of_files;
+  pthread_t *workers =
+      (pthread_t *)calloc(number_of_workers, sizeof(pthread_t));
+
+  const double start = get_time_seconds();
+  uint32_t started_workers = 0U;
+  for (; workers && started_workers < number_of_workers; started_workers++) {
+    if (pthread_create(&workers[started_workers], NULL, batch_worker,
+                       &batch) != 0) {
+      break;
+    }
+  }
+  // Without any worker the files are processed here
+  if (started_workers == 0U) {
+    batch_worker(&batch);
+  }
+  for (uint32_t k = 0U; k < started_workers; k++) {
+    pthread_join(workers[k], NULL);
+  }
+  const double elapsed = get_time_seconds() - start;
+
+  printf("%u files, %.1f s of audio in %.2f s (%.1fx real time) with %u "
+         "workers, %u failed\n",
+         batch.number_of_files, batch.audio_seconds, elapsed,
+         batch.audio_seconds / elapsed,
+         started_workers > 0U ? started_workers : 1U, batch.failed_files);
+
+  pthread_mutex_destroy(&batch.report_mutex);
+  free(workers);
+  free(profile.record);
+
+  return batch.failed_files > 0U ? 1 : 0;
+}
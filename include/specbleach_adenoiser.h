@@ -25,7 +25,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 extern "C" {
 #endif
 
+#include "specbleach_common.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef void *SpectralBleachHandle;
@@ -78,11 +80,44 @@ typedef struct SpectralBleachParameters {
  */
 SpectralBleachHandle specbleach_adaptive_initialize(uint32_t sample_rate,
                                                     float frame_size);
+/**
+ * Same as specbleach_adaptive_initialize but taking extended initialization
+ * options
+ */
+SpectralBleachHandle
+specbleach_adaptive_initialize_ex(const SpectralBleachInitOptions *options);
+/**
+ * Bytes of memory needed to build an instance with the given options. Every
+ * buffer of the instance is carved from a single block of this size. FFT plans,
+ * internal threads and the windows table are still allocated on their own.
+ * Plans and tables are shared by every instance with the same layout while any
+ * of them lives, so keeping one instance alive makes building more of them
+ * cheap. The size of each layout is measured once and remembered, so asking
+ * again costs nothing
+ */
+size_t specbleach_adaptive_get_required_memory(
+    const SpectralBleachInitOptions *options);
+/**
+ * Same as specbleach_adaptive_initialize_ex but building the instance inside
+ * the memory passed. It has to be at least the size returned by
+ * specbleach_adaptive_get_required_memory for the same options and stay valid
+ * until the instance is freed. It doesn't need any particular alignment and the
+ * library never releases it. Returns NULL if it is too small
+ */
+SpectralBleachHandle specbleach_adaptive_initialize_with_memory(
+    const SpectralBleachInitOptions *options, void *memory, size_t memory_size);
 
 /**
  * Free instance associated to the handle passed
  */
 void specbleach_adaptive_free(SpectralBleachHandle instance);
+/**
+ * Clears every sample and noise estimate carried between blocks so the next
+ * block starts a new stream, processed exactly as by a newly initialized
+ * instance. Nothing is allocated and parameters stay loaded. It must not run
+ * while the instance is processing
+ */
+bool specbleach_adaptive_reset(SpectralBleachHandle instance);
 /**
  * Loads the parameters for the reduction.
  * This has to be called before processing
@@ -99,6 +134,72 @@ uint32_t specbleach_adaptive_get_latency(SpectralBleachHandle instance);
 bool specbleach_adaptive_process(SpectralBleachHandle instance,
                                  uint32_t number_of_samples, const float *input,
                                  float *output);
+/**
+ * Process a number of frames of every channel at once. Input and output hold
+ * one buffer per channel. The number of channels must match the one the
+ * instance was initialized with
+ */
+bool specbleach_adaptive_process_multichannel(SpectralBleachHandle instance,
+                                              uint32_t number_of_channels,
+                                              uint32_t number_of_frames,
+                                              const float *const *input,
+                                              float **output);
+/**
+ * Same as specbleach_adaptive_process_multichannel with interleaved buffers
+ */
+bool specbleach_adaptive_process_interleaved(SpectralBleachHandle instance,
+                                             uint32_t number_of_channels,
+                                             uint32_t number_of_frames,
+                                             const float *input, float *output);
+/**
+ * Same as specbleach_adaptive_process with 16 bit, 32 bit integer or double
+ * samples. Integer samples span [-1, 1) of the float ones and the output is
+ * rounded and clipped to their range. Samples are converted a block at a time
+ * while being processed, without buffers of the caller's size. Input and
+ * output can be the same buffer
+ */
+bool specbleach_adaptive_process_s16(SpectralBleachHandle instance,
+                                     uint32_t number_of_samples,
+                                     const int16_t *input, int16_t *output);
+bool specbleach_adaptive_process_s32(SpectralBleachHandle instance,
+                                     uint32_t number_of_samples,
+                                     const int32_t *input, int32_t *output);
+bool specbleach_adaptive_process_f64(SpectralBleachHandle instance,
+                                     uint32_t number_of_samples,
+                                     const double *input, double *output);
+/**
+ * Same as specbleach_adaptive_process_interleaved with the sample formats
+ * above
+ */
+bool specbleach_adaptive_process_interleaved_s16(
+    SpectralBleachHandle instance, uint32_t number_of_channels,
+    uint32_t number_of_frames, const int16_t *input, int16_t *output);
+bool specbleach_adaptive_process_interleaved_s32(
+    SpectralBleachHandle instance, uint32_t number_of_channels,
+    uint32_t number_of_frames, const int32_t *input, int32_t *output);
+bool specbleach_adaptive_process_interleaved_f64(
+    SpectralBleachHandle instance, uint32_t number_of_channels,
+    uint32_t number_of_frames, const double *input, double *output);
+/**
+ * Copies the time spent in each processing stage since initialization or the
+ * last reset. Returns false if the library was built without profiling
+ */
+bool specbleach_adaptive_get_profile_stats(SpectralBleachHandle instance,
+                                           SpectralBleachStats *stats);
+/**
+ * Clears the profiling statistics of the instance
+ */
+bool specbleach_adaptive_reset_profile_stats(SpectralBleachHandle instance);
+/**
+ * Copies the noise reduction measured by the processing. It never waits on
+ * the processing, so it can be called from any thread while audio runs
+ */
+bool specbleach_adaptive_get_telemetry(SpectralBleachHandle instance,
+                                       SpectralBleachTelemetry *telemetry);
+/**
+ * Clears the telemetry of the instance. Safe from any thread as well
+ */
+bool specbleach_adaptive_reset_telemetry(SpectralBleachHandle instance);
 
 #ifdef __cplusplus
 }
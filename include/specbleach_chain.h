@@ -0,0 +1,96 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPECBLEACH_CHAIN_H_INCLUDED
+#define SPECBLEACH_CHAIN_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "specbleach_common.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Runs the spectral processing of several instances one after the other on
+ * the same frames, so each frame is transformed and reconstructed once for all
+ * of them and latency is the one of a single instance. For example the
+ * adaptive denoiser followed by the denoiser. Instances keep their parameters,
+ * noise profiles and processing state, which the chain uses instead of their
+ * own transforms */
+typedef void *SpectralBleachChainHandle;
+
+typedef enum SpectralBleachProcessorType {
+  SPECBLEACH_PROCESSOR_DENOISER = 0,
+  SPECBLEACH_PROCESSOR_ADAPTIVE_DENOISER = 1,
+} SpectralBleachProcessorType;
+
+/* Instance handle along with the kind of instance it is */
+typedef struct SpectralBleachChainStage {
+  SpectralBleachProcessorType type;
+  void *instance;
+} SpectralBleachChainStage;
+
+/**
+ * Chains the instances in the order given. The chain transforms frames with
+ * the layout of the first instance and every other has to use the same sample
+ * rate, number of channels, transform size and overlap. Multiresolution
+ * instances can't be chained. Returns NULL otherwise. Instances must outlive
+ * the chain and shouldn't process on their own while chained
+ */
+SpectralBleachChainHandle
+specbleach_chain_initialize(const SpectralBleachChainStage *stages,
+                            uint32_t number_of_stages);
+/**
+ * Free the chain. The chained instances are left as they are
+ */
+void specbleach_chain_free(SpectralBleachChainHandle chain);
+/**
+ * Returns the latency of the chain in samples
+ */
+uint32_t specbleach_chain_get_latency(SpectralBleachChainHandle chain);
+/**
+ * Processes a mono block through every instance of the chain. Parameters and
+ * noise profiles loaded into the instances are taken before each block, and
+ * instances that would leave the signal as it is are skipped
+ */
+bool specbleach_chain_process(SpectralBleachChainHandle chain,
+                              uint32_t number_of_samples, const float *input,
+                              float *output);
+/**
+ * Same as specbleach_chain_process for planar buffers of every channel
+ */
+bool specbleach_chain_process_multichannel(SpectralBleachChainHandle chain,
+                                           uint32_t number_of_channels,
+                                           uint32_t number_of_frames,
+                                           const float *const *input,
+                                           float **output);
+/**
+ * Same as specbleach_chain_process for interleaved buffers
+ */
+bool specbleach_chain_process_interleaved(SpectralBleachChainHandle chain,
+                                          uint32_t number_of_channels,
+                                          uint32_t number_of_frames,
+                                          const float *input, float *output);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,325 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPECBLEACH_COMMON_H_INCLUDED
+#define SPECBLEACH_COMMON_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Effort spent by FFTW planning the transforms at initialization. Estimate is
+ * the fastest to initialize. Measure, patient and exhaustive take longer to
+ * initialize (from milliseconds to seconds) but can result in faster
+ * processing afterwards. Planning time can be avoided by importing previously
+ * exported wisdom before initializing any instance */
+typedef enum SpectralBleachPlannerRigor {
+  SPECBLEACH_PLANNER_ESTIMATE = 0,
+  SPECBLEACH_PLANNER_MEASURE = 1,
+  SPECBLEACH_PLANNER_PATIENT = 2,
+  SPECBLEACH_PLANNER_EXHAUSTIVE = 3,
+} SpectralBleachPlannerRigor;
+
+/* Windows applied before the forward transform and after the backward one.
+ * Default keeps the windows each denoiser was tuned with. The product of both
+ * windows should add up to a constant at the chosen overlap to avoid an
+ * amplitude ripple: Hann on both sides needs four times overlap while Vorbis
+ * already does with two */
+typedef enum SpectralBleachWindowType {
+  SPECBLEACH_WINDOW_DEFAULT = 0,
+  SPECBLEACH_WINDOW_HANN = 1,
+  SPECBLEACH_WINDOW_HAMMING = 2,
+  SPECBLEACH_WINDOW_BLACKMAN = 3,
+  SPECBLEACH_WINDOW_VORBIS = 4,
+} SpectralBleachWindowType;
+
+/* Zeros appended to each frame before transforming it. Padding interpolates
+ * the spectrum, which costs bigger transforms but gives finer bins */
+typedef enum SpectralBleachPaddingType {
+  SPECBLEACH_PADDING_DEFAULT = 0,
+  SPECBLEACH_PADDING_NONE = 1,
+  SPECBLEACH_PADDING_NEXT_POWER_OF_TWO = 2,
+  SPECBLEACH_PADDING_FIXED_AMOUNT = 3,
+} SpectralBleachPaddingType;
+
+/* Noise tracker of the adaptive denoiser. Default is the continuous minimum
+ * tracking, which follows the noise smoothly but takes a few seconds after
+ * its level changes. Minimum statistics takes the minimum over the last second
+ * and a half so it catches up within that time */
+typedef enum SpectralBleachNoiseTracker {
+  SPECBLEACH_NOISE_TRACKER_DEFAULT = 0,
+  SPECBLEACH_NOISE_TRACKER_CONTINUOUS_MINIMUM = 1,
+  SPECBLEACH_NOISE_TRACKER_MINIMUM_STATISTICS = 2,
+} SpectralBleachNoiseTracker;
+
+/* A job processes the work of a single channel. It receives the job data and
+ * the index of the job to run */
+typedef void (*SpectralBleachJob)(void *job_data, uint32_t job_index);
+
+/* Host provided scheduler. It has to run job(job_data, index) for every index
+ * from 0 to number_of_jobs - 1, in any thread and order, and return only after
+ * all of them finished. It is called from the processing thread for every STFT
+ * frame so it shouldn't allocate or block for long */
+typedef void (*SpectralBleachJobRunner)(void *runner_data,
+                                        uint32_t number_of_jobs,
+                                        SpectralBleachJob job, void *job_data);
+
+typedef struct SpectralBleachInitOptions {
+  /* Sample rate of the audio to process. It could be anything from 4000hz to
+   * 192khz */
+  uint32_t sample_rate;
+
+  /* Frame size in milliseconds. Recommended range is between 20ms and 100ms */
+  float frame_size;
+
+  /* Planner rigor used for the FFT transforms. Zero is estimate */
+  SpectralBleachPlannerRigor planner_rigor;
+
+  /* Number of audio channels processed by the instance. Zero is one channel.
+   * Instances with more than one channel must be processed with the
+   * multichannel or interleaved process functions */
+  uint32_t number_of_channels;
+
+  /* Shares a single noise profile between all channels so it is learned from
+   * every one of them and applied equally. Only used by the denoiser since the
+   * adaptive denoiser always estimates noise on each channel */
+  bool link_channels;
+
+  /* Number of threads used to process the channels of a multichannel instance
+   * in parallel, including the calling thread. Zero or one processes channels
+   * one after the other. Ignored when a job runner is provided */
+  uint32_t number_of_threads;
+
+  /* Optional host scheduler used instead of the internal threads to process
+   * channels in parallel, and the data passed to it */
+  SpectralBleachJobRunner job_runner;
+  void *job_runner_data;
+
+  /* Number of spectra the median learn mode takes the median of. Longer
+   * windows ignore longer noise bursts while learning and their cost per frame
+   * only grows logarithmically. Zero is five spectra. Only used by the
+   * denoiser */
+  uint32_t median_window_length;
+
+  /* Number of spectra the decaying and windowed average learn modes follow.
+   * Shorter windows track changes of the noise faster and longer ones give
+   * steadier profiles. Zero is 500 spectra. Only used by the denoiser */
+  uint32_t profile_window_length;
+
+  /* Replaces the logarithms and powers computed per bin by the masking
+   * thresholds and the generalized spectral subtraction with polynomial
+   * approximations. Their relative error is a few parts per million, far below
+   * what can be heard, and the processing becomes cheaper */
+  bool approximate_math;
+
+  /* Uses a long analysis window with a short synthesis window covering only
+   * the end of each frame. Latency drops to a quarter of the frame size, from
+   * three quarters in the denoiser and a half in the adaptive denoiser, while
+   * keeping the frequency resolution of the frame size. Frames overlap four
+   * times in this mode, so the adaptive denoiser processes twice as many */
+  bool low_latency;
+
+  /* Number of times frames overlap, from 2 to 16. Zero uses four times in the
+   * denoiser and twice in the adaptive denoiser, or four times for both in low
+   * latency mode. Every halving of the overlap halves the transforms and the
+   * spectral processing done per second */
+  uint32_t overlap_factor;
+
+  /* Spreads the work of every frame over the callbacks of the next hop
+   * instead of doing all of it in the callback that completes the frame.
+   * Hosts calling with blocks much smaller than the hop get an even load per
+   * callback in exchange for one more hop of latency. Ignored by
+   * multiresolution instances */
+  bool spread_processing;
+
+  /* Analysis and synthesis windows. Only pairs whose product overlaps into a
+   * constant are accepted, so frames left untouched come back exactly: Hann
+   * and Hamming with each other from an overlap of 3, Blackman with either
+   * from 4, Blackman with Blackman from 5 and Vorbis with Vorbis at even
+   * overlaps. A default window takes the type of the other one when that
+   * one is given, and when both are default the instance defaults are kept
+   * if they reconstruct, else Vorbis windows are used at even overlaps and
+   * Hann windows at odd ones. Ignored in low latency mode, which uses its own
+   * asymmetric pair */
+  SpectralBleachWindowType input_window;
+  SpectralBleachWindowType output_window;
+
+  /* Padding of each frame before the transforms and the zeros added with the
+   * fixed amount type. A zero amount uses 50 zeros */
+  SpectralBleachPaddingType padding_type;
+  uint32_t zeropadding_amount;
+
+  /* Splits the signal at a crossover frequency and processes the band below
+   * it with frames of frame_size at a reduced sample rate and the band above
+   * it with frames four times shorter. Low frequencies keep the resolution of
+   * long frames with much smaller transforms while the rest gets the time
+   * resolution of short ones. Latency is the one of the long frames plus the
+   * crossover filter. Only used by mono instances. The denoiser keeps a noise
+   * profile the size a single resolution would have and maps it onto both
+   * bands. The adaptive denoiser tracks the noise of each band on its own and
+   * by default splits where speech ends, so 48khz speech is processed at
+   * 16khz with transforms a third of the size and the band above with short
+   * frames */
+  bool multiresolution;
+
+  /* Frequency dividing both resolutions, up to a quarter of the sample rate.
+   * Zero is 1000hz for the denoiser and 4000hz, or a quarter of the sample
+   * rate if lower, for the adaptive denoiser */
+  float crossover_frequency;
+
+  /* Frames whose power doesn't exceed the power of the noise profile by more
+   * than 1dB, such as silence or pauses with only noise, are attenuated by
+   * the reduction amount without estimating their gains. It saves most of the
+   * processing of those frames. Ignored while whitening the residual. Only
+   * used by the denoiser */
+  bool skip_noise_frames;
+
+  /* Algorithm estimating the noise of every frame. Only used by the adaptive
+   * denoiser */
+  SpectralBleachNoiseTracker noise_tracker;
+
+  /* Estimates noise and gains on about twenty critical bands instead of on
+   * every bin, interpolating the band gains back to the bins. Estimation costs
+   * a small fraction of what it does per bin, which suits speech where fine
+   * frequency detail in the gains isn't needed. Only used by the adaptive
+   * denoiser */
+  bool band_processing;
+
+  /* Splits the signal as multiresolution does but only processes the band
+   * below the crossover frequency, at its reduced sample rate. The band above
+   * passes through unprocessed, delayed to stay aligned. With the default
+   * crossover 48khz speech is processed at 16khz, taking a fraction of the
+   * work of the whole spectrum. Only used by mono adaptive denoisers */
+  bool speech_band_only;
+
+  /* Milliseconds transient detection may look ahead of the frames being
+   * reduced, rounded down to whole hops and up to eight of them. Smoothing
+   * relaxes over the frames leading to an onset instead of smearing it, so
+   * stronger smoothing can be used. Latency grows by the hops looked ahead and
+   * instances keep processing while they would otherwise be bypassed. Zero
+   * disables it. Only used by the denoiser and ignored by multiresolution
+   * instances */
+  float transient_look_ahead;
+
+  /* Hops between two estimations of the reduction gains, up to eight. The
+   * noise scaling and the gains, the costliest part of each frame, are held in
+   * between, which barely changes the reduction of stationary noise and cuts
+   * its cost per channel. Frames with a detected transient, a new noise
+   * profile or new scaling parameters are always estimated, so transient
+   * protection should stay enabled. Zero or one estimates every hop. Only
+   * used by the denoiser */
+  uint32_t gain_update_interval;
+} SpectralBleachInitOptions;
+
+/* Processing stages timed by the profiling statistics */
+typedef enum SpectralBleachStage {
+  SPECBLEACH_STAGE_STFT_ANALYSIS = 0,
+  SPECBLEACH_STAGE_FORWARD_FFT = 1,
+  SPECBLEACH_STAGE_SPECTRAL_PROCESSING = 2,
+  SPECBLEACH_STAGE_BACKWARD_FFT = 3,
+  SPECBLEACH_STAGE_STFT_SYNTHESIS = 4,
+  SPECBLEACH_STAGE_SPECTRAL_FEATURES = 5,
+  SPECBLEACH_STAGE_NOISE_ESTIMATION = 6,
+  SPECBLEACH_STAGE_NOISE_SCALING = 7,
+  SPECBLEACH_STAGE_SPECTRAL_SMOOTHING = 8,
+  SPECBLEACH_STAGE_GAIN_ESTIMATION = 9,
+  SPECBLEACH_STAGE_POSTFILTER = 10,
+  SPECBLEACH_STAGE_DENOISE_MIXER = 11,
+  SPECBLEACH_NUMBER_OF_STAGES = 12,
+} SpectralBleachStage;
+
+typedef struct SpectralBleachStageStats {
+  uint64_t calls;
+  uint64_t nanoseconds;
+  /* Time stamp counter cycles. Zero on architectures without one */
+  uint64_t cycles;
+} SpectralBleachStageStats;
+
+/* Accumulated per stage counters. Spectral processing contains every stage
+ * after it, added over all channels. Only available when the library is built
+ * with profiling enabled */
+typedef struct SpectralBleachStats {
+  SpectralBleachStageStats stages[SPECBLEACH_NUMBER_OF_STAGES];
+} SpectralBleachStats;
+
+/* Measurements of the noise reduction applied, updated by the processing on
+ * every frame it reduces. Frames are counted over every channel since
+ * initialization or the last reset. Levels follow the last half second and are
+ * averaged over channels */
+typedef struct SpectralBleachTelemetry {
+  uint64_t frames;
+  /* Fraction of the frames taken as transients. Only transient protection
+   * looks for them */
+  float transient_rate;
+  /* Fraction of the frames whose gains were smoothed by the post filter */
+  float postfilter_rate;
+  /* Energy of the frames over the noise estimate in db */
+  float input_snr;
+  /* Energy removed from the frames in db */
+  float attenuation;
+  /* Signals given to offline processing and how many of them had their
+   * spectra reduced on an OpenCL device, the rest going through the threads.
+   * Only the denoiser processes offline and only libraries built with the
+   * enable_opencl option use a device */
+  uint64_t offline_signals;
+  uint64_t accelerated_signals;
+} SpectralBleachTelemetry;
+
+/**
+ * FFT wisdom stores the plans measured by the planner so they can be reused by
+ * other instances or processes without measuring again. Wisdom is shared by
+ * every instance in the process. These should not be called while instances
+ * are being initialized from other threads
+ */
+
+/**
+ * Imports wisdom from a file previously written by
+ * specbleach_export_fft_wisdom_to_file
+ */
+bool specbleach_import_fft_wisdom_from_file(const char *file_name);
+/**
+ * Writes all the wisdom accumulated in the process to a file
+ */
+bool specbleach_export_fft_wisdom_to_file(const char *file_name);
+/**
+ * Imports wisdom from a null terminated string
+ */
+bool specbleach_import_fft_wisdom_from_string(const char *wisdom);
+/**
+ * Returns a null terminated string with all the wisdom accumulated in the
+ * process. It has to be released with specbleach_free_fft_wisdom_string
+ */
+char *specbleach_export_fft_wisdom_to_string(void);
+/**
+ * Frees a string returned by specbleach_export_fft_wisdom_to_string
+ */
+void specbleach_free_fft_wisdom_string(char *wisdom);
+/**
+ * Discards all the wisdom accumulated in the process
+ */
+void specbleach_forget_fft_wisdom(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
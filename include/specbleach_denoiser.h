@@ -25,7 +25,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 extern "C" {
 #endif
 
+#include "specbleach_common.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef void *SpectralBleachHandle;
@@ -35,7 +37,10 @@ typedef struct SpectralBleachParameters {
   /* Sets the processor in listening mode to capture the noise profile. 0 is
    * disabled, 1 will learn the average profile, 2 will learn the maximun median
    * profile and 3 will learn the max profile. For the average and median
-   * profile you need at least 5 frames of audio */
+   * profile you need at least 5 frames of audio. The average stops adapting
+   * as it grows, so streams that keep learning can use 4, a decaying average
+   * weighting older frames exponentially less, or 5, the average of the last
+   * frames only. Both follow about profile_window_length frames */
   int learn_noise;
 
   /* Enables outputting the residue of the reduction processing. It's either
@@ -83,6 +88,48 @@ typedef struct SpectralBleachParameters {
   float post_filter_threshold;
 } SpectralBleachParameters;
 
+/* Encoding of the spectrum in serialized noise profiles. Float16 records are
+ * half the size of float32 ones and log8 records a quarter. Log8 splits the
+ * range in between the weakest and the strongest non empty bins into 254
+ * steps, which stay below half a dB for profiles spanning up to 120 dB and
+ * grow in proportion for wider ones */
+typedef enum SpectralBleachProfileEncoding {
+  SPECBLEACH_PROFILE_FLOAT32 = 0,
+  SPECBLEACH_PROFILE_FLOAT16 = 1,
+  SPECBLEACH_PROFILE_LOG8 = 2,
+} SpectralBleachProfileEncoding;
+
+/* Changes a control thread can queue for the processing thread. Loading
+ * parameters and setting the learn mode take the same values as
+ * specbleach_load_parameters. Resetting the noise profile forgets what was
+ * learned and resetting the instance clears the estimates carried between
+ * frames too, as specbleach_reset does, while keeping the buffered samples so
+ * the output goes on without a gap */
+typedef enum SpectralBleachCommandType {
+  SPECBLEACH_COMMAND_LOAD_PARAMETERS = 0,
+  SPECBLEACH_COMMAND_SET_LEARN_MODE = 1,
+  SPECBLEACH_COMMAND_RESET_NOISE_PROFILE = 2,
+  SPECBLEACH_COMMAND_RESET = 3,
+} SpectralBleachCommandType;
+
+/* Called by the processing thread right after a command is applied, with the
+ * ticket returned when it was posted. It must not block */
+typedef void (*SpectralBleachCommandCallback)(void *user_data,
+                                              uint64_t ticket);
+
+typedef struct SpectralBleachCommand {
+  SpectralBleachCommandType type;
+  /* Only the member of the type of the command is read */
+  union {
+    SpectralBleachParameters parameters;
+    int learn_noise;
+    bool keep_noise_profile;
+  } payload;
+  /* Optional, can be NULL */
+  SpectralBleachCommandCallback callback;
+  void *user_data;
+} SpectralBleachCommand;
+
 /**
  * Returns a handle to an instance of the library for the adaptive based
  * noise reduction. Sample rate could be anything from 4000hz to 192khz.
@@ -90,47 +137,237 @@ typedef struct SpectralBleachParameters {
  */
 SpectralBleachHandle specbleach_initialize(uint32_t sample_rate,
                                            float frame_size);
+/**
+ * Same as specbleach_initialize but taking extended initialization options
+ */
+SpectralBleachHandle
+specbleach_initialize_ex(const SpectralBleachInitOptions *options);
+/**
+ * Bytes of memory needed to build an instance with the given options. Every
+ * buffer of the instance is carved from a single block of this size. FFT plans,
+ * internal threads and the windows and hearing thresholds tables are still
+ * allocated on their own. Plans and tables are shared by every instance with
+ * the same layout while any of them lives, so keeping one instance alive makes
+ * building more of them cheap. The size of each layout is measured once and
+ * remembered, so asking again costs nothing
+ */
+size_t specbleach_get_required_memory(const SpectralBleachInitOptions *options);
+/**
+ * Same as specbleach_initialize_ex but building the instance inside the memory
+ * passed. It has to be at least the size returned by
+ * specbleach_get_required_memory for the same options and stay valid until the
+ * instance is freed. It doesn't need any particular alignment and the library
+ * never releases it. Returns NULL if it is too small
+ */
+SpectralBleachHandle
+specbleach_initialize_with_memory(const SpectralBleachInitOptions *options,
+                                  void *memory, size_t memory_size);
 /**
  * Free instance associated to the handle passed
  */
 void specbleach_free(SpectralBleachHandle instance);
+/**
+ * Clears every sample and estimate carried between blocks so the next block
+ * starts a new stream, processed exactly as by a newly initialized instance.
+ * Nothing is allocated, so hosts can keep instances around and reset them
+ * instead of building new ones. The learned noise profiles are kept when
+ * keep_noise_profile is true and reset otherwise. Parameters stay loaded. It
+ * must not run while the instance is processing
+ */
+bool specbleach_reset(SpectralBleachHandle instance, bool keep_noise_profile);
 /**
  * Loads the parameters for the reduction.
  * This has to be called before processing
  */
 bool specbleach_load_parameters(SpectralBleachHandle instance,
                                 SpectralBleachParameters parameters);
+/**
+ * Queues a command for the processing thread without waiting for it. Commands
+ * are applied whole and in order at the next hop boundary, or before the next
+ * block while nothing is processed, so a frame never sees part of them. Only
+ * one thread may post commands. Returns the ticket of the command, which grows
+ * by one with each of them, or zero if the queue is full
+ */
+uint64_t specbleach_post_command(SpectralBleachHandle instance,
+                                 const SpectralBleachCommand *command);
+/**
+ * Returns the ticket of the last command applied, or zero if none was. It
+ * never waits on the processing, so it can be called from any thread
+ */
+uint64_t specbleach_get_applied_command(SpectralBleachHandle instance);
 /**
  * Process buffer of a number of samples
  */
 bool specbleach_process(SpectralBleachHandle instance,
                         uint32_t number_of_samples, const float *input,
                         float *output);
+/**
+ * Process a number of frames of every channel at once. Input and output hold
+ * one buffer per channel. The number of channels must match the one the
+ * instance was initialized with
+ */
+bool specbleach_process_multichannel(SpectralBleachHandle instance,
+                                     uint32_t number_of_channels,
+                                     uint32_t number_of_frames,
+                                     const float *const *input, float **output);
+/**
+ * Same as specbleach_process_multichannel with interleaved buffers
+ */
+bool specbleach_process_interleaved(SpectralBleachHandle instance,
+                                    uint32_t number_of_channels,
+                                    uint32_t number_of_frames,
+                                    const float *input, float *output);
+/**
+ * Same as specbleach_process with 16 bit, 32 bit integer or double samples.
+ * Integer samples span [-1, 1) of the float ones and the output is rounded and
+ * clipped to their range. Samples are converted a block at a time while being
+ * processed, without buffers of the caller's size. Input and output can be the
+ * same buffer
+ */
+bool specbleach_process_s16(SpectralBleachHandle instance,
+                            uint32_t number_of_samples, const int16_t *input,
+                            int16_t *output);
+bool specbleach_process_s32(SpectralBleachHandle instance,
+                            uint32_t number_of_samples, const int32_t *input,
+                            int32_t *output);
+bool specbleach_process_f64(SpectralBleachHandle instance,
+                            uint32_t number_of_samples, const double *input,
+                            double *output);
+/**
+ * Same as specbleach_process_interleaved with the sample formats above
+ */
+bool specbleach_process_interleaved_s16(SpectralBleachHandle instance,
+                                        uint32_t number_of_channels,
+                                        uint32_t number_of_frames,
+                                        const int16_t *input, int16_t *output);
+bool specbleach_process_interleaved_s32(SpectralBleachHandle instance,
+                                        uint32_t number_of_channels,
+                                        uint32_t number_of_frames,
+                                        const int32_t *input, int32_t *output);
+bool specbleach_process_interleaved_f64(SpectralBleachHandle instance,
+                                        uint32_t number_of_channels,
+                                        uint32_t number_of_frames,
+                                        const double *input, double *output);
+/**
+ * Process a whole mono signal at once splitting it in segments that are
+ * processed in parallel with a number of threads (or the job runner of the
+ * instance if it has one). A noise profile has to be available and learning
+ * has to be disabled. Output is latency compensated and it doesn't modify the
+ * state used by specbleach_process. Input and output can't be the same buffer.
+ * This allocates so it is not meant for real time use
+ */
+bool specbleach_process_offline(SpectralBleachHandle instance,
+                                uint32_t number_of_samples, const float *input,
+                                float *output, uint32_t number_of_threads);
+/**
+ * Same as specbleach_process_offline for a number of independent mono signals
+ * at once, as when reprocessing a batch of files with the same noise profile
+ * and parameters. Input, output and number_of_samples hold one entry per
+ * signal. Every signal and segment of them is a job of a single dispatch to
+ * the threads, so short signals keep every thread busy. Signals are only
+ * split in segments when there are fewer of them than threads.
+ *
+ * Libraries built with the enable_opencl option reduce the spectra of many
+ * signals at once on an OpenCL device instead, while the threads compute their
+ * transforms. Each signal then goes through in a single pass, which matches
+ * processing it unsplit up to float rounding. A batch reaches the device when
+ * one is found and
+ * - the instance was initialized with transient_look_ahead under a hop,
+ *   skip_noise_frames off and gain_update_interval at zero or one
+ * - noise_scaling_type is 0, the a posteriori snr over the whole spectrum
+ * - transient_protection is off
+ * Any other batch, or one the device fails on, goes through the threads from
+ * the start. The offline_signals and accelerated_signals counters of the
+ * telemetry tell which one processed the signals
+ */
+bool specbleach_process_offline_batch(SpectralBleachHandle instance,
+                                      uint32_t number_of_streams,
+                                      const uint32_t *number_of_samples,
+                                      const float *const *input,
+                                      float **output,
+                                      uint32_t number_of_threads);
 /**
  * Returns the latency in samples associated with the library instance
  */
 uint32_t specbleach_get_latency(SpectralBleachHandle instance);
+/**
+ * Learns the noise profile from a whole mono signal at once, as processing it
+ * with learn_noise set to learn_mode would, without synthesizing any output.
+ * Only the whole frames of the signal are analyzed. Learning continues from
+ * the current profile and the result is loaded into every channel, so it can
+ * be called while processing runs in another thread. Average and max profiles
+ * split the signal in segments learned in parallel with a number of threads
+ * (or the job runner of the instance if it has one). Median profiles are
+ * learned in a single pass
+ */
+bool specbleach_learn_noise_profile(SpectralBleachHandle instance,
+                                    int learn_mode, uint32_t number_of_samples,
+                                    const float *input,
+                                    uint32_t number_of_threads);
+/**
+ * Merges other_profile into noise_profile, weighting each one by the blocks
+ * averaged to learn it as if a single average had been learned from the audio
+ * of both, and adds the blocks up into profile_blocks. Profiles learned on
+ * separate workers or segments are combined without processing the audio
+ * again. Both must have profile_size bins. Without blocks behind either, as
+ * with median and max profiles, every bin keeps the largest value
+ */
+bool specbleach_merge_noise_profiles(float *noise_profile,
+                                     uint32_t *profile_blocks,
+                                     const float *other_profile,
+                                     uint32_t other_blocks,
+                                     uint32_t profile_size);
 /**
  * Returns the size of the noise profile spectrum
  */
 uint32_t specbleach_get_noise_profile_size(SpectralBleachHandle instance);
 /**
- * Returns a pointer to the noise profile calculated inside the instance
+ * Returns a pointer to a copy of the noise profile calculated inside the
+ * instance. With more than one unlinked channel this is the profile of the
+ * first one. The copy is consistent even while processing runs in another
+ * thread and it only changes on the next call
  */
 float *specbleach_get_noise_profile(SpectralBleachHandle instance);
 /**
- * Allows to load a custom noise profile
+ * Copies the noise profile and the number of blocks used to calculate it, both
+ * from the same moment, into the memory passed. Any thread can call it while
+ * processing runs. While learning the copy can lag a few blocks behind, and it
+ * catches up once learning is turned off. The averaged blocks output can be
+ * NULL
+ */
+bool specbleach_copy_noise_profile(SpectralBleachHandle instance,
+                                   float *noise_profile, uint32_t profile_size,
+                                   uint32_t *profile_blocks);
+/**
+ * Allows to load a custom noise profile. It is loaded in every channel. It can
+ * be called from any thread while processing runs, which takes the new profile
+ * as a whole before its next block without waiting. A profile of a different
+ * size, learned with another frame size at the same sample rate, is resampled
+ * onto the bins of the instance
  */
 bool specbleach_load_noise_profile(SpectralBleachHandle instance,
                                    const float *restored_profile,
                                    uint32_t profile_size,
                                    uint32_t profile_blocks);
 /**
- * Resets the internal noise profile of the library instance
+ * Same as specbleach_load_noise_profile for a profile learned at any sample
+ * rate and frame size. Its power is interpolated or averaged onto the bins of
+ * the instance so a single learned profile serves instances of any
+ * configuration without learning again
+ */
+bool specbleach_load_resampled_noise_profile(SpectralBleachHandle instance,
+                                             const float *restored_profile,
+                                             uint32_t profile_size,
+                                             uint32_t profile_sample_rate,
+                                             uint32_t profile_blocks);
+/**
+ * Resets the internal noise profiles of the library instance. Like loading a
+ * profile it takes effect before the next processed block
  */
 bool specbleach_reset_noise_profile(SpectralBleachHandle instance);
 /**
- * Returns if the instance has a noise profile calculated internally
+ * Returns if the instance has a noise profile calculated internally for every
+ * channel
  */
 bool specbleach_noise_profile_available(SpectralBleachHandle instance);
 /**
@@ -138,6 +375,52 @@ bool specbleach_noise_profile_available(SpectralBleachHandle instance);
  */
 uint32_t
 specbleach_get_noise_profile_blocks_averaged(SpectralBleachHandle instance);
+/**
+ * Returns the size in bytes of the noise profile serialized with the given
+ * encoding or zero if the encoding is unknown
+ */
+size_t specbleach_get_serialized_noise_profile_size(
+    SpectralBleachHandle instance, SpectralBleachProfileEncoding encoding);
+/**
+ * Writes the noise profile as a versioned binary record. Besides the spectrum
+ * it stores the sample rate, frame size, spectrum type, learn mode and
+ * averaged blocks, and a checksum. The record is the same on every platform.
+ * Returns the bytes written or zero if the buffer is too small
+ */
+size_t
+specbleach_serialize_noise_profile(SpectralBleachHandle instance,
+                                   SpectralBleachProfileEncoding encoding,
+                                   void *buffer, size_t buffer_size);
+/**
+ * Loads a noise profile from a record written by
+ * specbleach_serialize_noise_profile in every channel. Records made with a
+ * different sample rate or frame size are resampled onto the bins of the
+ * instance. Returns false, keeping the current profile, if the record is
+ * truncated or corrupted, or has a different spectrum type
+ */
+bool specbleach_deserialize_noise_profile(SpectralBleachHandle instance,
+                                          const void *buffer,
+                                          size_t buffer_size);
+/**
+ * Copies the time spent in each processing stage since initialization or the
+ * last reset. Returns false if the library was built without profiling
+ */
+bool specbleach_get_profile_stats(SpectralBleachHandle instance,
+                                  SpectralBleachStats *stats);
+/**
+ * Clears the profiling statistics of the instance
+ */
+bool specbleach_reset_profile_stats(SpectralBleachHandle instance);
+/**
+ * Copies the noise reduction measured by the processing. It never waits on
+ * the processing, so it can be called from any thread while audio runs
+ */
+bool specbleach_get_telemetry(SpectralBleachHandle instance,
+                              SpectralBleachTelemetry *telemetry);
+/**
+ * Clears the telemetry of the instance. Safe from any thread as well
+ */
+bool specbleach_reset_telemetry(SpectralBleachHandle instance);
 
 #ifdef __cplusplus
 }
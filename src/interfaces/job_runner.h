@@ -18,22 +18,19 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#ifndef SPECTRAL_TRAILING_BUFFER_H
-#define SPECTRAL_TRAILING_BUFFER_H
+#ifndef JOB_RUNNER_H
+#define JOB_RUNNER_H
 
-#include <stdbool.h>
 #include <stdint.h>
 
-typedef struct SpectralTrailingBuffer SpectralTrailingBuffer;
+// Unit of work that can be run in parallel. Receives the data shared by every
+// job and the index of the job to run
+typedef void (*parallel_job)(void *job_data, uint32_t job_index);
 
-SpectralTrailingBuffer *
-spectral_trailing_buffer_initialize(uint32_t real_spectrum_size,
-                                    uint32_t buffer_size);
-void spectral_trailing_buffer_free(SpectralTrailingBuffer *self);
-bool spectral_trailing_buffer_push_back(SpectralTrailingBuffer *self,
-                                        const float *input_spectrum);
-float *get_trailing_spectral_buffer(SpectralTrailingBuffer *self);
-uint32_t get_spectrum_buffer_size(SpectralTrailingBuffer *self);
-uint32_t get_spectrum_size(SpectralTrailingBuffer *self);
+// Runs number_of_jobs jobs, possibly in parallel, and returns only after all of
+// them finished. Receives any runner handle (void *), like a thread pool or a
+// host scheduler, so parallel work can be injected into the processors
+typedef void (*job_runner)(void *runner_data, uint32_t number_of_jobs,
+                           parallel_job job, void *job_data);
 
-#endif
\ No newline at end of file
+#endif
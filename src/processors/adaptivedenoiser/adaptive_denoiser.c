@@ -22,11 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../../shared/configurations.h"
 #include "../../shared/gain_estimation/gain_estimators.h"
 #include "../../shared/noise_estimation/adaptive_noise_estimator.h"
+#include "../../shared/noise_estimation/minimum_statistics_estimator.h"
 #include "../../shared/post_estimation/postfilter.h"
 #include "../../shared/pre_estimation/critical_bands.h"
 #include "../../shared/pre_estimation/noise_scaling_criterias.h"
 #include "../../shared/pre_estimation/spectral_smoother.h"
 #include "../../shared/utils/denoise_mixer.h"
+#include "../../shared/utils/memory_arena.h"
+#include "../../shared/utils/parameter_ramp.h"
 #include "../../shared/utils/spectral_features.h"
 #include "../../shared/utils/spectral_utils.h"
 #include <float.h>
@@ -41,6 +44,20 @@ typedef struct SpectralAdaptiveDenoiser {
   uint32_t hop;
   float default_oversubtraction;
   float default_undersubtraction;
+  bool approximate_math;
+  bool band_processing;
+  // Band spectra hold band j at element j + 1 so, as with bins, the first
+  // element is left out of the estimation
+  uint32_t band_spectrum_size;
+
+  // Continuous parameters move to newly loaded values over a few frames
+  ParameterRamp reduction_amount_ramp;
+  ParameterRamp noise_rescale_ramp;
+  ParameterRamp smoothing_factor_ramp;
+  ParameterRamp whitening_factor_ramp;
+  ParameterRamp post_filter_threshold_ramp;
+  uint32_t parameter_ramp_frames;
+  bool parameters_loaded;
 
   AdaptiveDenoiserParameters parameters;
 
@@ -50,60 +67,97 @@ typedef struct SpectralAdaptiveDenoiser {
   float *residual_spectrum;
   float *denoised_spectrum;
   float *noise_profile;
+  float *reference_spectrum;
+  float *band_reference_spectrum;
+  float *band_noise_profile;
+  float *band_gain_spectrum;
+  float *band_alpha;
+  float *band_beta;
 
-  SpectrumType spectrum_type;
   CriticalBandType band_type;
-  GainEstimationType gain_estimation_type;
-  TimeSmoothingType time_smoothing_type;
+  NoiseTrackerType noise_tracker;
 
   DenoiseMixer *mixer;
   NoiseScalingCriterias *noise_scaling_criteria;
   SpectralSmoother *spectrum_smoothing;
   PostFilter *postfiltering;
   AdaptiveNoiseEstimator *adaptive_estimator;
+  MinimumStatisticsEstimator *minimum_statistics;
   SpectralFeatures *spectral_features;
+  CriticalBands *critical_bands;
+  StageProfiler *profiler;
+  ReductionTelemetry *telemetry;
 } SpectralAdaptiveDenoiser;
 
+static void advance_parameters(SpectralAdaptiveDenoiser *self, bool new_frame);
+static void initialize_noise_tracker(SpectralAdaptiveDenoiser *self,
+                                     uint32_t noise_spectrum_size,
+                                     const uint32_t *first_bins);
+static void initialize_band_processing(SpectralAdaptiveDenoiser *self);
+static void run_noise_tracker(SpectralAdaptiveDenoiser *self,
+                              const float *spectrum, float *noise_spectrum);
+static void estimate_bin_gains(SpectralAdaptiveDenoiser *self,
+                               const float *reference_spectrum);
+static void estimate_band_gains(SpectralAdaptiveDenoiser *self,
+                                const float *reference_spectrum);
+
 SpectralProcessorHandle
 spectral_adaptive_denoiser_initialize(const uint32_t sample_rate,
                                       const uint32_t fft_size,
-                                      const uint32_t overlap_factor) {
+                                      const uint32_t overlap_factor,
+                                      const FftPlannerRigor planner_rigor,
+                                      const bool approximate_math,
+                                      const NoiseTrackerType noise_tracker,
+                                      const bool band_processing) {
 
-  SpectralAdaptiveDenoiser *self =
-      (SpectralAdaptiveDenoiser *)calloc(1U, sizeof(SpectralAdaptiveDenoiser));
+  SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)spectral_calloc(
+      1U, sizeof(SpectralAdaptiveDenoiser));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
   self->sample_rate = sample_rate;
   self->hop = self->fft_size / overlap_factor;
+  self->parameter_ramp_frames =
+      get_parameter_ramp_frames(self->sample_rate, self->hop);
   self->default_oversubtraction = DEFAULT_OVERSUBTRACTION;
   self->default_undersubtraction = DEFAULT_UNDERSUBTRACTION;
-  self->spectrum_type = SPECTRAL_TYPE_SPEECH;
   self->band_type = CRITICAL_BANDS_TYPE_SPEECH;
-  self->gain_estimation_type = GAIN_ESTIMATION_TYPE_SPEECH;
-  self->time_smoothing_type = TIME_SMOOTHING_TYPE_SPEECH;
-
-  self->gain_spectrum = (float *)calloc(self->fft_size, sizeof(float));
-  initialize_spectrum_with_value(self->gain_spectrum, self->fft_size, 1.F);
-  self->alpha = (float *)calloc(self->real_spectrum_size, sizeof(float));
+  self->approximate_math = approximate_math;
+  self->noise_tracker = noise_tracker;
+  self->band_processing = band_processing;
+
+  self->gain_spectrum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  initialize_spectrum_with_value(self->gain_spectrum, self->real_spectrum_size,
+                                 1.F);
+  self->alpha =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   initialize_spectrum_with_value(self->alpha, self->real_spectrum_size, 1.F);
-  self->beta = (float *)calloc(self->real_spectrum_size, sizeof(float));
+  self->beta =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->noise_profile =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
-
-  self->adaptive_estimator = louizou_estimator_initialize(
-      self->real_spectrum_size, sample_rate, fft_size);
-
-  self->residual_spectrum = (float *)calloc((self->fft_size), sizeof(float));
-  self->denoised_spectrum = (float *)calloc((self->fft_size), sizeof(float));
-
-  self->postfiltering = postfilter_initialize(self->fft_size);
-
-  self->spectrum_smoothing =
-      spectral_smoothing_initialize(self->fft_size, self->time_smoothing_type);
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  self->reference_spectrum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+
+  self->residual_spectrum =
+      (float *)spectral_calloc((self->fft_size), sizeof(float));
+  self->denoised_spectrum =
+      (float *)spectral_calloc((self->fft_size), sizeof(float));
+
+  self->postfiltering = postfilter_initialize(self->fft_size, planner_rigor);
+
+  if (self->band_processing) {
+    initialize_band_processing(self);
+  } else {
+    initialize_noise_tracker(self, self->real_spectrum_size, NULL);
+    self->spectrum_smoothing = spectral_smoothing_initialize(
+        self->fft_size, TIME_SMOOTHING_TYPE_SPEECH);
+  }
 
   self->noise_scaling_criteria = noise_scaling_criterias_initialize(
-      self->fft_size, self->band_type, self->sample_rate, self->spectrum_type);
+      self->fft_size, self->band_type, self->sample_rate, SPECTRAL_TYPE_SPEECH,
+      self->approximate_math);
 
   self->spectral_features =
       spectral_features_initialize(self->real_spectrum_size);
@@ -114,24 +168,127 @@ spectral_adaptive_denoiser_initialize(const uint32_t sample_rate,
   return self;
 }
 
+// Only the selected tracker is built
+static void initialize_noise_tracker(SpectralAdaptiveDenoiser *self,
+                                     const uint32_t noise_spectrum_size,
+                                     const uint32_t *first_bins) {
+  if (self->noise_tracker == MINIMUM_STATISTICS_TRACKER) {
+    self->minimum_statistics = minimum_statistics_estimator_initialize(
+        noise_spectrum_size, self->sample_rate, self->hop);
+  } else {
+    self->adaptive_estimator = louizou_estimator_initialize_bands(
+        noise_spectrum_size, first_bins, self->sample_rate, self->fft_size);
+  }
+}
+
+// Noise, scaling, smoothing and gains work on the critical bands and only the
+// final gains are brought back to bins
+static void initialize_band_processing(SpectralAdaptiveDenoiser *self) {
+  self->critical_bands = critical_bands_initialize(
+      self->sample_rate, self->fft_size, self->band_type);
+  const uint32_t number_of_bands =
+      get_number_of_critical_bands(self->critical_bands);
+  const uint32_t *band_offsets =
+      get_critical_band_offsets(self->critical_bands);
+  self->band_spectrum_size = number_of_bands + 1U;
+
+  self->band_reference_spectrum =
+      (float *)spectral_calloc(self->band_spectrum_size, sizeof(float));
+  self->band_noise_profile =
+      (float *)spectral_calloc(self->band_spectrum_size, sizeof(float));
+  self->band_gain_spectrum =
+      (float *)spectral_calloc(self->band_spectrum_size, sizeof(float));
+  initialize_spectrum_with_value(self->band_gain_spectrum,
+                                 self->band_spectrum_size, 1.F);
+  self->band_alpha =
+      (float *)spectral_calloc(self->band_spectrum_size, sizeof(float));
+  initialize_spectrum_with_value(self->band_alpha, self->band_spectrum_size,
+                                 1.F);
+  self->band_beta =
+      (float *)spectral_calloc(self->band_spectrum_size, sizeof(float));
+
+  // The skipped first element stands for the DC bin
+  uint32_t *first_bins =
+      (uint32_t *)spectral_calloc(self->band_spectrum_size, sizeof(uint32_t));
+  memcpy(&first_bins[1], band_offsets, sizeof(uint32_t) * number_of_bands);
+  initialize_noise_tracker(self, self->band_spectrum_size, first_bins);
+  spectral_free(first_bins);
+
+  // Its real half covers the band spectra
+  self->spectrum_smoothing = spectral_smoothing_initialize(
+      2U * number_of_bands, TIME_SMOOTHING_TYPE_SPEECH);
+}
+
 void spectral_adaptive_denoiser_free(SpectralProcessorHandle instance) {
   SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
 
-  louizou_estimator_free(self->adaptive_estimator);
+  if (self->adaptive_estimator) {
+    louizou_estimator_free(self->adaptive_estimator);
+  }
+  if (self->minimum_statistics) {
+    minimum_statistics_estimator_free(self->minimum_statistics);
+  }
+  if (self->critical_bands) {
+    critical_bands_free(self->critical_bands);
+  }
   spectral_features_free(self->spectral_features);
   noise_scaling_criterias_free(self->noise_scaling_criteria);
   spectral_smoothing_free(self->spectrum_smoothing);
   postfilter_free(self->postfiltering);
   denoise_mixer_free(self->mixer);
 
-  free(self->residual_spectrum);
-  free(self->denoised_spectrum);
-  free(self->noise_profile);
-  free(self->gain_spectrum);
-  free(self->alpha);
-  free(self->beta);
+  spectral_free(self->residual_spectrum);
+  spectral_free(self->denoised_spectrum);
+  spectral_free(self->noise_profile);
+  spectral_free(self->reference_spectrum);
+  spectral_free(self->gain_spectrum);
+  spectral_free(self->alpha);
+  spectral_free(self->beta);
+  spectral_free(self->band_reference_spectrum);
+  spectral_free(self->band_noise_profile);
+  spectral_free(self->band_gain_spectrum);
+  spectral_free(self->band_alpha);
+  spectral_free(self->band_beta);
+
+  spectral_free(self);
+}
+
+void spectral_adaptive_denoiser_reset(SpectralProcessorHandle instance) {
+  SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
+
+  if (self->adaptive_estimator) {
+    louizou_estimator_reset(self->adaptive_estimator);
+  }
+  if (self->minimum_statistics) {
+    minimum_statistics_estimator_reset(self->minimum_statistics);
+  }
+  spectral_smoothing_reset(self->spectrum_smoothing);
+  denoise_mixer_reset(self->mixer);
+
+  initialize_spectrum_with_value(self->gain_spectrum, self->real_spectrum_size,
+                                 1.F);
+  initialize_spectrum_with_value(self->alpha, self->real_spectrum_size, 1.F);
+  memset(self->beta, 0, self->real_spectrum_size * sizeof(float));
+  memset(self->noise_profile, 0, self->real_spectrum_size * sizeof(float));
+  if (self->band_processing) {
+    initialize_spectrum_with_value(self->band_gain_spectrum,
+                                   self->band_spectrum_size, 1.F);
+    initialize_spectrum_with_value(self->band_alpha, self->band_spectrum_size,
+                                   1.F);
+    memset(self->band_beta, 0, self->band_spectrum_size * sizeof(float));
+    memset(self->band_noise_profile, 0,
+           self->band_spectrum_size * sizeof(float));
+  }
 
-  free(self);
+  // Ramps in progress jump to their targets
+  ParameterRamp *ramps[] = {
+      &self->reduction_amount_ramp, &self->noise_rescale_ramp,
+      &self->smoothing_factor_ramp, &self->whitening_factor_ramp,
+      &self->post_filter_threshold_ramp};
+  for (uint32_t k = 0U; k < sizeof(ramps) / sizeof(ramps[0]); k++) {
+    parameter_ramp_reset(ramps[k], ramps[k]->target);
+  }
+  advance_parameters(self, false);
 }
 
 bool load_adaptive_reduction_parameters(SpectralProcessorHandle instance,
@@ -141,11 +298,48 @@ bool load_adaptive_reduction_parameters(SpectralProcessorHandle instance,
   }
 
   SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
+
+  // The first parameters are taken as they are and later ones are ramped to
+  const uint32_t ramp_frames =
+      self->parameters_loaded ? self->parameter_ramp_frames : 0U;
+  parameter_ramp_set_target(&self->reduction_amount_ramp,
+                            parameters.reduction_amount, ramp_frames);
+  parameter_ramp_set_target(&self->noise_rescale_ramp, parameters.noise_rescale,
+                            ramp_frames);
+  parameter_ramp_set_target(&self->smoothing_factor_ramp,
+                            parameters.smoothing_factor, ramp_frames);
+  parameter_ramp_set_target(&self->whitening_factor_ramp,
+                            parameters.whitening_factor, ramp_frames);
+  parameter_ramp_set_target(&self->post_filter_threshold_ramp,
+                            parameters.post_filter_threshold, ramp_frames);
+  self->parameters_loaded = true;
+
+  // Discrete parameters switch right away
   self->parameters = parameters;
+  advance_parameters(self, false);
 
   return true;
 }
 
+// Sets the continuous parameters of the frame from their ramps, moving them a
+// step further when a new frame starts
+static void advance_parameters(SpectralAdaptiveDenoiser *self,
+                               const bool new_frame) {
+  ParameterRamp *ramps[] = {
+      &self->reduction_amount_ramp, &self->noise_rescale_ramp,
+      &self->smoothing_factor_ramp, &self->whitening_factor_ramp,
+      &self->post_filter_threshold_ramp};
+  float *values[] = {&self->parameters.reduction_amount,
+                     &self->parameters.noise_rescale,
+                     &self->parameters.smoothing_factor,
+                     &self->parameters.whitening_factor,
+                     &self->parameters.post_filter_threshold};
+
+  for (uint32_t k = 0U; k < sizeof(ramps) / sizeof(ramps[0]); k++) {
+    *values[k] = new_frame ? parameter_ramp_advance(ramps[k]) : ramps[k]->value;
+  }
+}
+
 bool spectral_adaptive_denoiser_run(SpectralProcessorHandle instance,
                                     float *fft_spectrum) {
   if (!fft_spectrum || !instance) {
@@ -154,13 +348,99 @@ bool spectral_adaptive_denoiser_run(SpectralProcessorHandle instance,
 
   SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
 
-  float *reference_spectrum =
+  advance_parameters(self, true);
+
+  PROFILE_STAGE_BEGIN(features);
+  spectral_features_invalidate(self->spectral_features);
+  const float *reference_spectrum =
       get_spectral_feature(self->spectral_features, fft_spectrum,
-                           self->fft_size, self->spectrum_type);
+                           self->fft_size, SPECTRAL_TYPE_SPEECH);
+  PROFILE_STAGE_END(self->profiler, SPECTRAL_FEATURES_STAGE, features);
+
+  // Measured before the frame is modified
+  const float input_energy =
+      self->telemetry
+          ? sum_spectrum(get_spectral_feature(self->spectral_features,
+                                              fft_spectrum, self->fft_size,
+                                              POWER_SPECTRUM),
+                         self->real_spectrum_size)
+          : 0.F;
+
+  if (self->band_processing) {
+    estimate_band_gains(self, reference_spectrum);
+  } else {
+    estimate_bin_gains(self, reference_spectrum);
+  }
+
+  // Apply post filtering to reduce residual noise on low SNR frames
+  PostFiltersParameters post_filter_parameters = (PostFiltersParameters){
+      .snr_threshold = self->parameters.post_filter_threshold,
+  };
+  PROFILE_STAGE_BEGIN(postfilter);
+  postfilter_apply(self->postfiltering,
+                   get_spectral_feature(self->spectral_features, fft_spectrum,
+                                        self->fft_size, POWER_SPECTRUM),
+                   self->gain_spectrum, post_filter_parameters);
+  PROFILE_STAGE_END(self->profiler, POSTFILTER_STAGE, postfilter);
+
+  // Mix results
+  DenoiseMixerParameters mixer_parameters = (DenoiseMixerParameters){
+      .noise_level = self->parameters.reduction_amount,
+      .residual_listen = self->parameters.residual_listen,
+      .whitening_amount = self->parameters.whitening_factor,
+  };
+
+  PROFILE_STAGE_BEGIN(mixer);
+  denoise_mixer_run(self->mixer, fft_spectrum, self->gain_spectrum,
+                    mixer_parameters);
+  PROFILE_STAGE_END(self->profiler, DENOISE_MIXER_STAGE, mixer);
+
+  if (self->telemetry) {
+    // Band estimates add up the same bins as the spectrum
+    const float noise_energy =
+        self->band_processing
+            ? sum_spectrum(self->band_noise_profile, self->band_spectrum_size)
+            : sum_spectrum(self->noise_profile, self->real_spectrum_size);
+
+    reduction_telemetry_update(
+        self->telemetry,
+        (ReductionTelemetryFrame){
+            .input_energy = input_energy,
+            .noise_energy = noise_energy,
+            .output_energy = sum_squared_spectrum(fft_spectrum, self->fft_size),
+            .transient = is_transient_detected(self->spectrum_smoothing),
+            .postfiltered = is_postfilter_active(self->postfiltering),
+        });
+  }
+
+  return true;
+}
+
+static void run_noise_tracker(SpectralAdaptiveDenoiser *self,
+                              const float *spectrum, float *noise_spectrum) {
+  switch (self->noise_tracker) {
+  case MINIMUM_STATISTICS_TRACKER:
+    minimum_statistics_estimator_run(self->minimum_statistics, spectrum,
+                                     noise_spectrum);
+    break;
+  case CONTINUOUS_MINIMUM_TRACKER:
+  default:
+    louizou_estimator_run(self->adaptive_estimator, spectrum, noise_spectrum);
+    break;
+  }
+}
+
+static void estimate_bin_gains(SpectralAdaptiveDenoiser *self,
+                               const float *spectrum) {
+  // Smoothing works in place, so the shared features are left untouched
+  float *reference_spectrum = self->reference_spectrum;
+  memcpy(reference_spectrum, spectrum,
+         self->real_spectrum_size * sizeof(float));
 
   // Estimate noise
-  louizou_estimator_run(self->adaptive_estimator, reference_spectrum,
-                        self->noise_profile);
+  PROFILE_STAGE_BEGIN(estimation);
+  run_noise_tracker(self, reference_spectrum, self->noise_profile);
+  PROFILE_STAGE_END(self->profiler, NOISE_ESTIMATION_STAGE, estimation);
 
   // Scale estimated noise profile for oversubtraction
   NoiseScalingParameters oversubtraction_parameters = (NoiseScalingParameters){
@@ -168,39 +448,99 @@ bool spectral_adaptive_denoiser_run(SpectralProcessorHandle instance,
           self->default_oversubtraction + self->parameters.noise_rescale,
       .undersubtraction = self->default_undersubtraction,
       .scaling_type = self->parameters.noise_scaling_type,
+      // The noise estimate changes on every frame so nothing is cached
+      .noise_profile_generation = 0U,
   };
+  PROFILE_STAGE_BEGIN(scaling);
   apply_noise_scaling_criteria(self->noise_scaling_criteria, reference_spectrum,
                                self->noise_profile, self->alpha, self->beta,
                                oversubtraction_parameters);
+  PROFILE_STAGE_END(self->profiler, NOISE_SCALING_STAGE, scaling);
 
   TimeSmoothingParameters spectral_smoothing_parameters =
       (TimeSmoothingParameters){
           .smoothing = self->parameters.smoothing_factor,
       };
+  PROFILE_STAGE_BEGIN(smoothing);
   spectral_smoothing_run(self->spectrum_smoothing,
                          spectral_smoothing_parameters, reference_spectrum);
+  PROFILE_STAGE_END(self->profiler, SPECTRAL_SMOOTHING_STAGE, smoothing);
 
   // Get reduction gain weights
-  estimate_gains(self->real_spectrum_size, self->fft_size, reference_spectrum,
+  PROFILE_STAGE_BEGIN(gains);
+  estimate_gains(self->real_spectrum_size, reference_spectrum,
                  self->noise_profile, self->gain_spectrum, self->alpha,
-                 self->beta, self->gain_estimation_type);
+                 self->beta, GAIN_ESTIMATION_TYPE_SPEECH,
+                 self->approximate_math);
+  PROFILE_STAGE_END(self->profiler, GAIN_ESTIMATION_STAGE, gains);
+}
 
-  // Apply post filtering to reduce residual noise on low SNR frames
-  PostFiltersParameters post_filter_parameters = (PostFiltersParameters){
-      .snr_threshold = self->parameters.post_filter_threshold,
-  };
-  postfilter_apply(self->postfiltering, fft_spectrum, self->gain_spectrum,
-                   post_filter_parameters);
+// Same steps as for bins on a few tens of bands. Band gains are interpolated
+// back to bins at the end
+static void estimate_band_gains(SpectralAdaptiveDenoiser *self,
+                                const float *reference_spectrum) {
+  PROFILE_STAGE_BEGIN(estimation);
+  compute_critical_bands_spectrum(self->critical_bands, reference_spectrum,
+                                  &self->band_reference_spectrum[1]);
+  run_noise_tracker(self, self->band_reference_spectrum,
+                    self->band_noise_profile);
+  PROFILE_STAGE_END(self->profiler, NOISE_ESTIMATION_STAGE, estimation);
 
-  // Mix results
-  DenoiseMixerParameters mixer_parameters = (DenoiseMixerParameters){
-      .noise_level = self->parameters.reduction_amount,
-      .residual_listen = self->parameters.residual_listen,
-      .whitening_amount = self->parameters.whitening_factor,
+  NoiseScalingParameters oversubtraction_parameters = (NoiseScalingParameters){
+      .oversubtraction =
+          self->default_oversubtraction + self->parameters.noise_rescale,
+      .undersubtraction = self->default_undersubtraction,
+      .scaling_type = self->parameters.noise_scaling_type,
+      .noise_profile_generation = 0U,
   };
+  PROFILE_STAGE_BEGIN(scaling);
+  apply_noise_scaling_criteria_to_bands(
+      self->noise_scaling_criteria, self->band_reference_spectrum,
+      self->band_noise_profile, self->band_alpha, self->band_spectrum_size,
+      oversubtraction_parameters);
+  PROFILE_STAGE_END(self->profiler, NOISE_SCALING_STAGE, scaling);
 
-  denoise_mixer_run(self->mixer, fft_spectrum, self->gain_spectrum,
-                    mixer_parameters);
+  TimeSmoothingParameters spectral_smoothing_parameters =
+      (TimeSmoothingParameters){
+          .smoothing = self->parameters.smoothing_factor,
+      };
+  PROFILE_STAGE_BEGIN(smoothing);
+  spectral_smoothing_run(self->spectrum_smoothing,
+                         spectral_smoothing_parameters,
+                         self->band_reference_spectrum);
+  PROFILE_STAGE_END(self->profiler, SPECTRAL_SMOOTHING_STAGE, smoothing);
+
+  PROFILE_STAGE_BEGIN(gains);
+  estimate_gains(self->band_spectrum_size, self->band_reference_spectrum,
+                 self->band_noise_profile, self->band_gain_spectrum,
+                 self->band_alpha, self->band_beta, GAIN_ESTIMATION_TYPE_SPEECH,
+                 self->approximate_math);
+  interpolate_critical_bands_spectrum(self->critical_bands,
+                                      &self->band_gain_spectrum[1],
+                                      self->gain_spectrum);
+  PROFILE_STAGE_END(self->profiler, GAIN_ESTIMATION_STAGE, gains);
+}
+
+bool spectral_adaptive_denoiser_set_profiler(SpectralProcessorHandle instance,
+                                             StageProfiler *profiler) {
+  if (!instance) {
+    return false;
+  }
+
+  SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
+  self->profiler = profiler;
 
   return true;
-}
\ No newline at end of file
+}
+
+bool spectral_adaptive_denoiser_set_telemetry(SpectralProcessorHandle instance,
+                                              ReductionTelemetry *telemetry) {
+  if (!instance) {
+    return false;
+  }
+
+  SpectralAdaptiveDenoiser *self = (SpectralAdaptiveDenoiser *)instance;
+  self->telemetry = telemetry;
+
+  return true;
+}
@@ -22,9 +22,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define SPECTRAL_ADAPTIVE_DENOISER_H
 
 #include "../../interfaces/spectral_processor.h"
+#include "../../shared/stft/fft_transform.h"
+#include "../../shared/utils/reduction_telemetry.h"
+#include "../../shared/utils/stage_profiler.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef enum NoiseTrackerType {
+  CONTINUOUS_MINIMUM_TRACKER = 0,
+  MINIMUM_STATISTICS_TRACKER = 1,
+} NoiseTrackerType;
+
 typedef struct AdaptiveDenoiserParameters {
   float reduction_amount;
   int noise_scaling_type;
@@ -37,11 +45,22 @@ typedef struct AdaptiveDenoiserParameters {
 
 SpectralProcessorHandle
 spectral_adaptive_denoiser_initialize(uint32_t sample_rate, uint32_t fft_size,
-                                      uint32_t overlap_factor);
+                                      uint32_t overlap_factor,
+                                      FftPlannerRigor planner_rigor,
+                                      bool approximate_math,
+                                      NoiseTrackerType noise_tracker,
+                                      bool band_processing);
 void spectral_adaptive_denoiser_free(SpectralProcessorHandle instance);
+// Clears the state carried between frames, noise estimates included
+void spectral_adaptive_denoiser_reset(SpectralProcessorHandle instance);
 bool load_adaptive_reduction_parameters(SpectralProcessorHandle instance,
                                         AdaptiveDenoiserParameters parameters);
 bool spectral_adaptive_denoiser_run(SpectralProcessorHandle instance,
                                     float *fft_spectrum);
+bool spectral_adaptive_denoiser_set_profiler(SpectralProcessorHandle instance,
+                                             StageProfiler *profiler);
+// Frames reduced are measured into the telemetry given, if any
+bool spectral_adaptive_denoiser_set_telemetry(SpectralProcessorHandle instance,
+                                              ReductionTelemetry *telemetry);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,704 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define CL_TARGET_OPENCL_VERSION 120
+
+#include "accelerated_denoiser.h"
+#include "../../shared/configurations.h"
+#include "../../shared/gain_estimation/gain_estimators.h"
+#include "../../shared/pre_estimation/noise_scaling_criterias.h"
+#include "../../shared/pre_estimation/spectral_smoother.h"
+#include "../../shared/utils/memory_arena.h"
+#include "../../shared/utils/spectral_features.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+// Each kernel mirrors the scalar code of its stage in the reference, in the
+// same order of operations. Contraction is disabled so products aren't fused
+// into multiply adds the reference doesn't do. Spectra use the halfcomplex
+// layout and every other buffer holds real_size bins for each frame. Sources
+// are split in a string per function
+static const char *const kernel_sources[] = {
+    "#pragma OPENCL FP_CONTRACT OFF\n",
+    "float get_mirrored_gain(__global const float *gains, const uint k,\n"
+    "                        const uint fft_size, const uint real_size) {\n"
+    "  return k < real_size ? gains[k] : gains[fft_size - k];\n"
+    "}\n",
+    "float smooth_gain(__global const float *gains, const uint k,\n"
+    "                  const uint length, const uint fft_size,\n"
+    "                  const uint real_size) {\n"
+    "  const uint half_width = length - 1U;\n"
+    "  float window_sum = 0.f;\n"
+    "  for (uint j = 0U; j <= 2U * half_width; j++) {\n"
+    "    window_sum += get_mirrored_gain(\n"
+    "        gains, (fft_size + k + j - half_width) % fft_size, fft_size,\n"
+    "        real_size);\n"
+    "  }\n"
+    "  return (gains[k] + window_sum) * (1.f / (2.f * (float)length));\n"
+    "}\n",
+    "__kernel void power_spectra(__global const float *spectra,\n"
+    "                            __global const uint *frames,\n"
+    "                            __global float *power, const uint fft_size,\n"
+    "                            const uint real_size, const uint hops) {\n"
+    "  const uint k = get_global_id(0);\n"
+    "  const uint row = get_global_id(1);\n"
+    "  if (row % hops >= frames[row / hops]) {\n"
+    "    return;\n"
+    "  }\n"
+    "  __global const float *spectrum = &spectra[row * fft_size];\n"
+    "  const float real_bin = spectrum[k];\n"
+    "  const float imag_bin = k > 0U ? spectrum[fft_size - k] : 0.f;\n"
+    "  power[row * real_size + k] = real_bin * real_bin + imag_bin * "
+    "imag_bin;\n"
+    "}\n",
+    "__kernel void scale_noise(__global const float *power,\n"
+    "                          __global const uint *frames,\n"
+    "                          __global float *frame_power,\n"
+    "                          __global float *alpha, const uint real_size,\n"
+    "                          const uint hops, const float noise_sum,\n"
+    "                          const float oversubtraction) {\n"
+    "  const uint row = get_global_id(0);\n"
+    "  if (row % hops >= frames[row / hops]) {\n"
+    "    return;\n"
+    "  }\n"
+    "  float noisy_sum = 0.f;\n"
+    "  for (uint k = 1U; k < real_size; k++) {\n"
+    "    noisy_sum += power[row * real_size + k];\n"
+    "  }\n"
+    "  frame_power[row] = noisy_sum;\n"
+    "  const float snr = 10.f * log10(noisy_sum / noise_sum);\n"
+    "  float factor = 1.f;\n"
+    "  if (snr >= LOWER_SNR && snr <= HIGHER_SNR) {\n"
+    "    factor = -0.05f * snr + oversubtraction;\n"
+    "  } else if (snr < 0.f) {\n"
+    "    factor = oversubtraction;\n"
+    "  }\n"
+    "  alpha[row] = factor;\n"
+    "}\n",
+    "__kernel void smooth_spectra(__global const float *power,\n"
+    "                             __global const uint *frames,\n"
+    "                             __global float *smoothed,\n"
+    "                             __global float *previous_spectra,\n"
+    "                             const uint real_size, const uint hops,\n"
+    "                             const float smoothing) {\n"
+    "  const uint k = get_global_id(0);\n"
+    "  const uint stream = get_global_id(1);\n"
+    "  float previous = previous_spectra[stream * real_size + k];\n"
+    "  for (uint frame = 0U; frame < frames[stream]; frame++) {\n"
+    "    const uint bin = (stream * hops + frame) * real_size + k;\n"
+    "    float value = power[bin];\n"
+    "    if (k > 0U && value > previous) {\n"
+    "      value = smoothing * previous + (1.f - smoothing) * value;\n"
+    "    }\n"
+    "    smoothed[bin] = value;\n"
+    "    previous = value;\n"
+    "  }\n"
+    "  previous_spectra[stream * real_size + k] = previous;\n"
+    "}\n",
+    "__kernel void estimate_gains(__global const float *smoothed,\n"
+    "                             __global const uint *frames,\n"
+    "                             __global const float *alpha,\n"
+    "                             __global const float *noise,\n"
+    "                             __global float *gains,\n"
+    "                             const uint real_size, const uint hops) {\n"
+    "  const uint k = get_global_id(0);\n"
+    "  const uint row = get_global_id(1);\n"
+    "  if (k == 0U || row % hops >= frames[row / hops]) {\n"
+    "    return;\n"
+    "  }\n"
+    "  const float spectrum = smoothed[row * real_size + k];\n"
+    "  const float noise_bin = noise[k] * alpha[row];\n"
+    "  float gain = 1.f;\n"
+    "  if (noise_bin > FLT_MIN) {\n"
+    "    gain = spectrum > noise_bin ? (spectrum - noise_bin) / spectrum "
+    ": 0.f;\n"
+    "  }\n"
+    "  gains[row * real_size + k] = gain;\n"
+    "}\n",
+    "__kernel void postfilter_sums(__global const float *power,\n"
+    "                              __global const float *gains,\n"
+    "                              __global const uint *frames,\n"
+    "                              __global float *clean_power,\n"
+    "                              const uint real_size, const uint hops) {\n"
+    "  const uint row = get_global_id(0);\n"
+    "  if (row % hops >= frames[row / hops]) {\n"
+    "    return;\n"
+    "  }\n"
+    "  float clean_sum = 0.f;\n"
+    "  for (uint k = 1U; k < real_size; k++) {\n"
+    "    const uint bin = row * real_size + k;\n"
+    "    clean_sum += power[bin] * gains[bin] * gains[bin];\n"
+    "  }\n"
+    "  clean_power[row] = clean_sum;\n"
+    "}\n",
+    "__kernel void postfilter_lengths(\n"
+    "    __global const float *power, __global float *gains,\n"
+    "    __global const uint *frames, __global const float *frame_power,\n"
+    "    __global const float *clean_power, __global uint *lengths,\n"
+    "    __global float *dc_gains, const uint fft_size, const uint real_size,\n"
+    "    const uint hops, const float snr_threshold) {\n"
+    "  const uint stream = get_global_id(0);\n"
+    "  float dc_gain = dc_gains[stream];\n"
+    "  for (uint frame = 0U; frame < frames[stream]; frame++) {\n"
+    "    const uint row = stream * hops + frame;\n"
+    "    __global float *frame_gains = &gains[row * real_size];\n"
+    "    const float dc_power = power[row * real_size];\n"
+    "    frame_gains[0] = dc_gain;\n"
+    "    const float clean_sum = dc_power * dc_gain * dc_gain + "
+    "clean_power[row];\n"
+    "    const float noisy_sum = dc_power + frame_power[row];\n"
+    "    uint length = 1U;\n"
+    "    if (noisy_sum > 0.f && clean_sum / noisy_sum < snr_threshold) {\n"
+    "      const float a_priori_snr = clean_sum / noisy_sum;\n"
+    "      const float scale = 1.f - a_priori_snr / snr_threshold;\n"
+    "      length = (uint)(2.f * round(POSTFILTER_SCALE * scale) + 1.f);\n"
+    "    }\n"
+    "    lengths[row] = length;\n"
+    "    if (length > 1U) {\n"
+    "      const float smoothed_gain =\n"
+    "          smooth_gain(frame_gains, 0U, length, fft_size, real_size);\n"
+    "      dc_gain = PRESERVE_MINIMUM_GAIN ? fmin(dc_gain, smoothed_gain)\n"
+    "                                      : smoothed_gain;\n"
+    "    }\n"
+    "  }\n"
+    "  dc_gains[stream] = dc_gain;\n"
+    "}\n",
+    "__kernel void postfilter_gains(__global const float *gains,\n"
+    "                               __global const uint *frames,\n"
+    "                               __global const uint *lengths,\n"
+    "                               __global float *filtered_gains,\n"
+    "                               const uint fft_size, const uint "
+    "real_size,\n"
+    "                               const uint hops) {\n"
+    "  const uint k = get_global_id(0);\n"
+    "  const uint row = get_global_id(1);\n"
+    "  if (row % hops >= frames[row / hops]) {\n"
+    "    return;\n"
+    "  }\n"
+    "  __global const float *frame_gains = &gains[row * real_size];\n"
+    "  float gain = frame_gains[k];\n"
+    "  if (lengths[row] > 1U) {\n"
+    "    const float smoothed_gain =\n"
+    "        smooth_gain(frame_gains, k, lengths[row], fft_size, real_size);\n"
+    "    gain = PRESERVE_MINIMUM_GAIN ? fmin(gain, smoothed_gain)\n"
+    "                                 : smoothed_gain;\n"
+    "  }\n"
+    "  filtered_gains[row * real_size + k] = gain;\n"
+    "}\n",
+    "__kernel void mix_spectra(__global float *spectra,\n"
+    "                          __global const float *gains,\n"
+    "                          __global const uint *frames,\n"
+    "                          __global float *residual_max_spectra,\n"
+    "                          const uint fft_size, const uint real_size,\n"
+    "                          const uint hops, const float noise_level,\n"
+    "                          const int residual_listen,\n"
+    "                          const float whitening_factor,\n"
+    "                          const float max_decay_rate) {\n"
+    "  const uint k = get_global_id(0);\n"
+    "  const uint stream = get_global_id(1);\n"
+    "  if (k == 0U) {\n"
+    "    return;\n"
+    "  }\n"
+    "  const uint gain_bin = k < real_size ? k : fft_size - k;\n"
+    "  const float denoised_level = residual_listen ? 0.f : 1.f;\n"
+    "  const float residual_level = residual_listen ? 1.f : noise_level;\n"
+    "  float residual_max = residual_max_spectra[stream * fft_size + k];\n"
+    "  for (uint frame = 0U; frame < frames[stream]; frame++) {\n"
+    "    const uint row = stream * hops + frame;\n"
+    "    const float gain = gains[row * real_size + gain_bin];\n"
+    "    const float bin = spectra[row * fft_size + k];\n"
+    "    if (whitening_factor <= 0.f) {\n"
+    "      spectra[row * fft_size + k] =\n"
+    "          bin * (residual_level +\n"
+    "                 gain * (denoised_level - residual_level));\n"
+    "      continue;\n"
+    "    }\n"
+    "    float residual = bin - bin * gain;\n"
+    "    residual_max = fmax(fmax(residual, WHITENING_FLOOR),\n"
+    "                        residual_max * max_decay_rate);\n"
+    "    if (residual > FLT_MIN) {\n"
+    "      residual = (1.f - whitening_factor) * residual +\n"
+    "                 whitening_factor * (residual / residual_max);\n"
+    "    }\n"
+    "    spectra[row * fft_size + k] =\n"
+    "        residual_listen ? residual : bin * gain + residual * "
+    "noise_level;\n"
+    "  }\n"
+    "  residual_max_spectra[stream * fft_size + k] = residual_max;\n"
+    "}\n",
+};
+
+typedef enum AcceleratedKernel {
+  POWER_SPECTRA_KERNEL = 0,
+  SCALE_NOISE_KERNEL = 1,
+  SMOOTH_SPECTRA_KERNEL = 2,
+  ESTIMATE_GAINS_KERNEL = 3,
+  POSTFILTER_SUMS_KERNEL = 4,
+  POSTFILTER_LENGTHS_KERNEL = 5,
+  POSTFILTER_GAINS_KERNEL = 6,
+  MIX_SPECTRA_KERNEL = 7,
+  NUMBER_OF_KERNELS = 8,
+} AcceleratedKernel;
+
+static const char *const kernel_names[NUMBER_OF_KERNELS] = {
+    "power_spectra",   "scale_noise",        "smooth_spectra",
+    "estimate_gains",  "postfilter_sums",    "postfilter_lengths",
+    "postfilter_gains", "mix_spectra",
+};
+
+// Device buffers. Per frame ones hold hops rows for every stream and the state
+// carried between dispatches one row for every stream
+typedef enum AcceleratedBuffer {
+  SPECTRA_BUFFER = 0,
+  FRAMES_BUFFER = 1,
+  NOISE_BUFFER = 2,
+  POWER_BUFFER = 3,
+  SMOOTHED_BUFFER = 4,
+  FRAME_POWER_BUFFER = 5,
+  ALPHA_BUFFER = 6,
+  GAINS_BUFFER = 7,
+  CLEAN_POWER_BUFFER = 8,
+  LENGTHS_BUFFER = 9,
+  FILTERED_GAINS_BUFFER = 10,
+  PREVIOUS_SPECTRA_BUFFER = 11,
+  DC_GAINS_BUFFER = 12,
+  RESIDUAL_MAX_BUFFER = 13,
+  NUMBER_OF_BUFFERS = 14,
+} AcceleratedBuffer;
+
+typedef struct KernelArgument {
+  size_t size;
+  const void *value;
+} KernelArgument;
+
+struct AcceleratedDenoiser {
+  uint32_t fft_size;
+  uint32_t real_spectrum_size;
+  uint32_t streams;
+  uint32_t hops;
+  float max_decay_rate;
+  // Sum of the profile bins the scaling compares every frame against
+  float noise_sum;
+
+  cl_context context;
+  cl_command_queue queue;
+  cl_program program;
+  cl_kernel kernels[NUMBER_OF_KERNELS];
+  cl_mem buffers[NUMBER_OF_BUFFERS];
+};
+
+static bool select_device(cl_device_id *device);
+static bool build_program(AcceleratedDenoiser *self, cl_device_id device);
+static bool create_buffers(AcceleratedDenoiser *self);
+static bool clear_buffer(AcceleratedDenoiser *self, AcceleratedBuffer buffer,
+                         size_t size);
+static bool run_kernel(AcceleratedDenoiser *self, AcceleratedKernel kernel,
+                       const KernelArgument *arguments,
+                       uint32_t number_of_arguments, size_t width,
+                       size_t height);
+
+AcceleratedDenoiser *accelerated_denoiser_initialize(const uint32_t sample_rate,
+                                                     const uint32_t fft_size,
+                                                     const uint32_t hop,
+                                                     const uint32_t streams,
+                                                     const uint32_t hops) {
+  if (fft_size == 0U || hop == 0U || streams == 0U || hops == 0U) {
+    return NULL;
+  }
+
+  cl_device_id device = NULL;
+  if (!select_device(&device)) {
+    return NULL;
+  }
+
+  AcceleratedDenoiser *self =
+      (AcceleratedDenoiser *)spectral_calloc(1U, sizeof(AcceleratedDenoiser));
+  if (!self) {
+    return NULL;
+  }
+
+  self->fft_size = fft_size;
+  self->real_spectrum_size = self->fft_size / 2U + 1U;
+  self->streams = streams;
+  self->hops = hops;
+  // Same decay the whitening of the mixer uses
+  self->max_decay_rate =
+      expf(-1000.F / (((WHITENING_DECAY_RATE) * (float)sample_rate) /
+                      (float)hop));
+
+  cl_int error = CL_SUCCESS;
+  self->context = clCreateContext(NULL, 1U, &device, NULL, NULL, &error);
+  if (error != CL_SUCCESS) {
+    self->context = NULL;
+    accelerated_denoiser_free(self);
+    return NULL;
+  }
+
+  self->queue = clCreateCommandQueue(self->context, device, 0, &error);
+  if (error != CL_SUCCESS) {
+    self->queue = NULL;
+    accelerated_denoiser_free(self);
+    return NULL;
+  }
+
+  if (!build_program(self, device) || !create_buffers(self)) {
+    accelerated_denoiser_free(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+void accelerated_denoiser_free(AcceleratedDenoiser *self) {
+  for (uint32_t k = 0U; k < NUMBER_OF_BUFFERS; k++) {
+    if (self->buffers[k]) {
+      clReleaseMemObject(self->buffers[k]);
+    }
+  }
+  for (uint32_t k = 0U; k < NUMBER_OF_KERNELS; k++) {
+    if (self->kernels[k]) {
+      clReleaseKernel(self->kernels[k]);
+    }
+  }
+  if (self->program) {
+    clReleaseProgram(self->program);
+  }
+  if (self->queue) {
+    clReleaseCommandQueue(self->queue);
+  }
+  if (self->context) {
+    clReleaseContext(self->context);
+  }
+
+  spectral_free(self);
+}
+
+bool is_accelerated_reduction_supported(const DenoiserParameters parameters,
+                                        const uint32_t fft_size) {
+  // Longest kernel of the postfilter has to fit in the spectrum, as it does
+  // when the reference smooths the gains without transforms
+  const uint32_t longest_kernel = 2U * (uint32_t)roundf(POSTFILTER_SCALE) + 1U;
+
+  return SPECTRAL_TYPE_GENERAL == POWER_SPECTRUM &&
+         GAIN_ESTIMATION_TYPE == WIENER &&
+         (TIME_SMOOTHING_TYPE == FIXED ||
+          !parameters.transient_protection) &&
+         (NoiseScalingType)parameters.noise_scaling_type == A_POSTERIORI_SNR &&
+         2U * longest_kernel - 1U <= fft_size;
+}
+
+bool accelerated_denoiser_start(AcceleratedDenoiser *self,
+                                const float *noise_profile) {
+  if (!self || !noise_profile) {
+    return false;
+  }
+
+  // Summed in the same order as the scaling of the reference
+  self->noise_sum = 0.F;
+  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
+    self->noise_sum += noise_profile[k];
+  }
+
+  const float dc_gain = 1.F;
+  cl_int error = clEnqueueWriteBuffer(
+      self->queue, self->buffers[NOISE_BUFFER], CL_TRUE, 0U,
+      self->real_spectrum_size * sizeof(float), noise_profile, 0U, NULL, NULL);
+  error |= clEnqueueFillBuffer(self->queue, self->buffers[DC_GAINS_BUFFER],
+                               &dc_gain, sizeof(float), 0U,
+                               self->streams * sizeof(float), 0U, NULL, NULL);
+
+  return error == CL_SUCCESS &&
+         clear_buffer(self, PREVIOUS_SPECTRA_BUFFER,
+                      (size_t)self->streams * self->real_spectrum_size *
+                          sizeof(float)) &&
+         clear_buffer(self, RESIDUAL_MAX_BUFFER,
+                      (size_t)self->streams * self->fft_size * sizeof(float));
+}
+
+bool accelerated_denoiser_run(AcceleratedDenoiser *self,
+                              const DenoiserParameters parameters,
+                              float *spectra, const uint32_t *frames) {
+  if (!self || !spectra || !frames) {
+    return false;
+  }
+
+  const size_t rows = (size_t)self->streams * self->hops;
+  const size_t spectra_size = rows * self->fft_size * sizeof(float);
+  cl_mem *buffers = self->buffers;
+  const cl_uint fft_size = self->fft_size;
+  const cl_uint real_size = self->real_spectrum_size;
+  const cl_uint hops = self->hops;
+  const float oversubtraction =
+      DEFAULT_OVERSUBTRACTION + parameters.noise_rescale;
+  const cl_int residual_listen = parameters.residual_listen ? 1 : 0;
+
+  cl_int error = clEnqueueWriteBuffer(self->queue, buffers[SPECTRA_BUFFER],
+                                      CL_FALSE, 0U, spectra_size, spectra, 0U,
+                                      NULL, NULL);
+  error |= clEnqueueWriteBuffer(self->queue, buffers[FRAMES_BUFFER], CL_FALSE,
+                                0U, self->streams * sizeof(uint32_t), frames,
+                                0U, NULL, NULL);
+  if (error != CL_SUCCESS) {
+    // Nothing may still read from the buffers of the caller once it returns
+    clFinish(self->queue);
+    return false;
+  }
+
+#define BUFFER_ARGUMENT(buffer) {sizeof(cl_mem), &buffers[buffer]}
+#define VALUE_ARGUMENT(value) {sizeof(value), &(value)}
+  const KernelArgument power_arguments[] = {
+      BUFFER_ARGUMENT(SPECTRA_BUFFER), BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(POWER_BUFFER),   VALUE_ARGUMENT(fft_size),
+      VALUE_ARGUMENT(real_size),       VALUE_ARGUMENT(hops),
+  };
+  const KernelArgument scaling_arguments[] = {
+      BUFFER_ARGUMENT(POWER_BUFFER),       BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(FRAME_POWER_BUFFER), BUFFER_ARGUMENT(ALPHA_BUFFER),
+      VALUE_ARGUMENT(real_size),           VALUE_ARGUMENT(hops),
+      VALUE_ARGUMENT(self->noise_sum),     VALUE_ARGUMENT(oversubtraction),
+  };
+  const KernelArgument smoothing_arguments[] = {
+      BUFFER_ARGUMENT(POWER_BUFFER),
+      BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(SMOOTHED_BUFFER),
+      BUFFER_ARGUMENT(PREVIOUS_SPECTRA_BUFFER),
+      VALUE_ARGUMENT(real_size),
+      VALUE_ARGUMENT(hops),
+      VALUE_ARGUMENT(parameters.smoothing_factor),
+  };
+  const KernelArgument gains_arguments[] = {
+      BUFFER_ARGUMENT(SMOOTHED_BUFFER), BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(ALPHA_BUFFER),    BUFFER_ARGUMENT(NOISE_BUFFER),
+      BUFFER_ARGUMENT(GAINS_BUFFER),    VALUE_ARGUMENT(real_size),
+      VALUE_ARGUMENT(hops),
+  };
+  const KernelArgument sums_arguments[] = {
+      BUFFER_ARGUMENT(POWER_BUFFER),       BUFFER_ARGUMENT(GAINS_BUFFER),
+      BUFFER_ARGUMENT(FRAMES_BUFFER),      BUFFER_ARGUMENT(CLEAN_POWER_BUFFER),
+      VALUE_ARGUMENT(real_size),           VALUE_ARGUMENT(hops),
+  };
+  const KernelArgument lengths_arguments[] = {
+      BUFFER_ARGUMENT(POWER_BUFFER),
+      BUFFER_ARGUMENT(GAINS_BUFFER),
+      BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(FRAME_POWER_BUFFER),
+      BUFFER_ARGUMENT(CLEAN_POWER_BUFFER),
+      BUFFER_ARGUMENT(LENGTHS_BUFFER),
+      BUFFER_ARGUMENT(DC_GAINS_BUFFER),
+      VALUE_ARGUMENT(fft_size),
+      VALUE_ARGUMENT(real_size),
+      VALUE_ARGUMENT(hops),
+      VALUE_ARGUMENT(parameters.post_filter_threshold),
+  };
+  const KernelArgument postfilter_arguments[] = {
+      BUFFER_ARGUMENT(GAINS_BUFFER),   BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(LENGTHS_BUFFER), BUFFER_ARGUMENT(FILTERED_GAINS_BUFFER),
+      VALUE_ARGUMENT(fft_size),        VALUE_ARGUMENT(real_size),
+      VALUE_ARGUMENT(hops),
+  };
+  const KernelArgument mixer_arguments[] = {
+      BUFFER_ARGUMENT(SPECTRA_BUFFER),
+      BUFFER_ARGUMENT(FILTERED_GAINS_BUFFER),
+      BUFFER_ARGUMENT(FRAMES_BUFFER),
+      BUFFER_ARGUMENT(RESIDUAL_MAX_BUFFER),
+      VALUE_ARGUMENT(fft_size),
+      VALUE_ARGUMENT(real_size),
+      VALUE_ARGUMENT(hops),
+      VALUE_ARGUMENT(parameters.reduction_amount),
+      VALUE_ARGUMENT(residual_listen),
+      VALUE_ARGUMENT(parameters.whitening_factor),
+      VALUE_ARGUMENT(self->max_decay_rate),
+  };
+#undef BUFFER_ARGUMENT
+#undef VALUE_ARGUMENT
+#define NUMBER_OF_ARGUMENTS(arguments)                                         \
+  (sizeof(arguments) / sizeof(arguments[0]))
+
+  // The in order queue runs each stage after the previous one finished
+  const bool enqueued =
+      run_kernel(self, POWER_SPECTRA_KERNEL, power_arguments,
+                 NUMBER_OF_ARGUMENTS(power_arguments), real_size, rows) &&
+      run_kernel(self, SCALE_NOISE_KERNEL, scaling_arguments,
+                 NUMBER_OF_ARGUMENTS(scaling_arguments), rows, 1U) &&
+      run_kernel(self, SMOOTH_SPECTRA_KERNEL, smoothing_arguments,
+                 NUMBER_OF_ARGUMENTS(smoothing_arguments), real_size,
+                 self->streams) &&
+      run_kernel(self, ESTIMATE_GAINS_KERNEL, gains_arguments,
+                 NUMBER_OF_ARGUMENTS(gains_arguments), real_size, rows) &&
+      run_kernel(self, POSTFILTER_SUMS_KERNEL, sums_arguments,
+                 NUMBER_OF_ARGUMENTS(sums_arguments), rows, 1U) &&
+      run_kernel(self, POSTFILTER_LENGTHS_KERNEL, lengths_arguments,
+                 NUMBER_OF_ARGUMENTS(lengths_arguments), self->streams, 1U) &&
+      run_kernel(self, POSTFILTER_GAINS_KERNEL, postfilter_arguments,
+                 NUMBER_OF_ARGUMENTS(postfilter_arguments), real_size, rows) &&
+      run_kernel(self, MIX_SPECTRA_KERNEL, mixer_arguments,
+                 NUMBER_OF_ARGUMENTS(mixer_arguments), fft_size,
+                 self->streams);
+#undef NUMBER_OF_ARGUMENTS
+
+  // Reading back blocking also waits for every stage
+  if (!enqueued ||
+      clEnqueueReadBuffer(self->queue, buffers[SPECTRA_BUFFER], CL_TRUE, 0U,
+                          spectra_size, spectra, 0U, NULL,
+                          NULL) != CL_SUCCESS) {
+    clFinish(self->queue);
+    return false;
+  }
+
+  return true;
+}
+
+// Takes a gpu of the first platform that has one, or else any device
+static bool select_device(cl_device_id *device) {
+  cl_platform_id platforms[8];
+  cl_uint number_of_platforms = 0U;
+  if (clGetPlatformIDs(8U, platforms, &number_of_platforms) != CL_SUCCESS ||
+      number_of_platforms == 0U) {
+    return false;
+  }
+  if (number_of_platforms > 8U) {
+    number_of_platforms = 8U;
+  }
+
+  const cl_device_type types[] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+  for (uint32_t t = 0U; t < sizeof(types) / sizeof(types[0]); t++) {
+    for (cl_uint p = 0U; p < number_of_platforms; p++) {
+      if (clGetDeviceIDs(platforms[p], types[t], 1U, device, NULL) ==
+          CL_SUCCESS) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Constants of the configuration are passed as definitions, in hexadecimal so
+// the device gets the exact same values
+static bool build_program(AcceleratedDenoiser *self, cl_device_id device) {
+  char options[512];
+  const int written = snprintf(
+      options, sizeof(options),
+      "-cl-std=CL1.2 -DLOWER_SNR=%af -DHIGHER_SNR=%af -DPOSTFILTER_SCALE=%af "
+      "-DWHITENING_FLOOR=%af -DPRESERVE_MINIMUM_GAIN=%d",
+      (double)LOWER_SNR, (double)HIGHER_SNR, (double)POSTFILTER_SCALE,
+      (double)WHITENING_FLOOR, PRESERVE_MINIMUN_GAIN ? 1 : 0);
+  if (written < 0 || (size_t)written >= sizeof(options)) {
+    return false;
+  }
+
+  cl_int error = CL_SUCCESS;
+  const cl_uint number_of_sources =
+      sizeof(kernel_sources) / sizeof(kernel_sources[0]);
+  const char *sources[sizeof(kernel_sources) / sizeof(kernel_sources[0])];
+  for (cl_uint k = 0U; k < number_of_sources; k++) {
+    sources[k] = kernel_sources[k];
+  }
+  self->program = clCreateProgramWithSource(self->context, number_of_sources,
+                                            sources, NULL, &error);
+  if (error != CL_SUCCESS) {
+    self->program = NULL;
+    return false;
+  }
+
+  if (clBuildProgram(self->program, 1U, &device, options, NULL, NULL) !=
+      CL_SUCCESS) {
+    return false;
+  }
+
+  for (uint32_t k = 0U; k < NUMBER_OF_KERNELS; k++) {
+    self->kernels[k] = clCreateKernel(self->program, kernel_names[k], &error);
+    if (error != CL_SUCCESS) {
+      self->kernels[k] = NULL;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool create_buffers(AcceleratedDenoiser *self) {
+  const size_t rows = (size_t)self->streams * self->hops;
+  const size_t sizes[NUMBER_OF_BUFFERS] = {
+      [SPECTRA_BUFFER] = rows * self->fft_size * sizeof(float),
+      [FRAMES_BUFFER] = self->streams * sizeof(uint32_t),
+      [NOISE_BUFFER] = self->real_spectrum_size * sizeof(float),
+      [POWER_BUFFER] = rows * self->real_spectrum_size * sizeof(float),
+      [SMOOTHED_BUFFER] = rows * self->real_spectrum_size * sizeof(float),
+      [FRAME_POWER_BUFFER] = rows * sizeof(float),
+      [ALPHA_BUFFER] = rows * sizeof(float),
+      [GAINS_BUFFER] = rows * self->real_spectrum_size * sizeof(float),
+      [CLEAN_POWER_BUFFER] = rows * sizeof(float),
+      [LENGTHS_BUFFER] = rows * sizeof(uint32_t),
+      [FILTERED_GAINS_BUFFER] = rows * self->real_spectrum_size * sizeof(float),
+      [PREVIOUS_SPECTRA_BUFFER] =
+          (size_t)self->streams * self->real_spectrum_size * sizeof(float),
+      [DC_GAINS_BUFFER] = self->streams * sizeof(float),
+      [RESIDUAL_MAX_BUFFER] =
+          (size_t)self->streams * self->fft_size * sizeof(float),
+  };
+
+  for (uint32_t k = 0U; k < NUMBER_OF_BUFFERS; k++) {
+    cl_int error = CL_SUCCESS;
+    self->buffers[k] = clCreateBuffer(self->context, CL_MEM_READ_WRITE,
+                                      sizes[k], NULL, &error);
+    if (error != CL_SUCCESS) {
+      self->buffers[k] = NULL;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool clear_buffer(AcceleratedDenoiser *self,
+                         const AcceleratedBuffer buffer, const size_t size) {
+  const float zero = 0.F;
+
+  return clEnqueueFillBuffer(self->queue, self->buffers[buffer], &zero,
+                             sizeof(float), 0U, size, 0U, NULL,
+                             NULL) == CL_SUCCESS;
+}
+
+static bool run_kernel(AcceleratedDenoiser *self,
+                       const AcceleratedKernel kernel,
+                       const KernelArgument *arguments,
+                       const uint32_t number_of_arguments, const size_t width,
+                       const size_t height) {
+  for (uint32_t k = 0U; k < number_of_arguments; k++) {
+    if (clSetKernelArg(self->kernels[kernel], k, arguments[k].size,
+                       arguments[k].value) != CL_SUCCESS) {
+      return false;
+    }
+  }
+
+  const size_t global_size[2] = {width, height};
+
+  return clEnqueueNDRangeKernel(self->queue, self->kernels[kernel], 2U, NULL,
+                                global_size, NULL, 0U, NULL,
+                                NULL) == CL_SUCCESS;
+}
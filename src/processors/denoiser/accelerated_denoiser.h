@@ -0,0 +1,61 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ACCELERATED_DENOISER_H
+#define ACCELERATED_DENOISER_H
+
+#include "spectral_denoiser.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Reduction of the spectral denoiser for many streams at once on an OpenCL
+// device, only built with the enable_opencl option. Every dispatch takes a
+// number of hops of every stream, laid out stream after stream, and processes
+// them in place. Per frame stages run a work item per bin of every frame and
+// the recursive ones (time smoothing, the gain of the DC bin left by the
+// postfilter and whitening) run a work item per bin of every stream that scans
+// the frames of the dispatch in order, carrying their state to the next one.
+// spectral_denoiser_run is the reference it is validated against
+typedef struct AcceleratedDenoiser AcceleratedDenoiser;
+
+// Returns NULL when there is no OpenCL device or the kernels don't build on it
+AcceleratedDenoiser *accelerated_denoiser_initialize(uint32_t sample_rate,
+                                                     uint32_t fft_size,
+                                                     uint32_t hop,
+                                                     uint32_t streams,
+                                                     uint32_t hops);
+void accelerated_denoiser_free(AcceleratedDenoiser *self);
+// Whether the reduction with these parameters only uses the stages the device
+// runs, which are the a posteriori snr scaling over the whole spectrum, time
+// smoothing without transient protection, wiener gains, the postfilter while
+// its kernel fits in the spectrum and the mixer
+bool is_accelerated_reduction_supported(DenoiserParameters parameters,
+                                        uint32_t fft_size);
+// Takes the profile every stream is reduced with and clears the state carried
+// between dispatches, so the next one starts new streams
+bool accelerated_denoiser_start(AcceleratedDenoiser *self,
+                                const float *noise_profile);
+// Reduces the first frames[stream] spectra of each stream in place. Spectra
+// hold hops spectra of fft_size bins for every stream
+bool accelerated_denoiser_run(AcceleratedDenoiser *self,
+                              DenoiserParameters parameters, float *spectra,
+                              const uint32_t *frames);
+
+#endif
@@ -27,6 +27,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../../shared/pre_estimation/noise_scaling_criterias.h"
 #include "../../shared/pre_estimation/spectral_smoother.h"
 #include "../../shared/utils/denoise_mixer.h"
+#include "../../shared/utils/general_utils.h"
+#include "../../shared/utils/memory_arena.h"
+#include "../../shared/utils/parameter_ramp.h"
 #include "../../shared/utils/spectral_features.h"
 #include "../../shared/utils/spectral_utils.h"
 #include <float.h>
@@ -41,17 +44,46 @@ typedef struct SbSpectralDenoiser {
   uint32_t hop;
   float default_oversubtraction;
   float default_undersubtraction;
+  bool approximate_math;
+
+  // Power of the noise profile, kept until the profile changes
+  bool skip_noise_frames;
+  float noise_frame_threshold;
+  float noise_power;
+  uint32_t noise_power_generation;
+
+  // Continuous parameters move to newly loaded values over a few frames
+  ParameterRamp reduction_amount_ramp;
+  ParameterRamp noise_rescale_ramp;
+  ParameterRamp smoothing_factor_ramp;
+  ParameterRamp whitening_factor_ramp;
+  ParameterRamp post_filter_threshold_ramp;
+  uint32_t parameter_ramp_frames;
+  bool parameters_loaded;
+
+  // Hops the gains are held for and the scaling they were estimated with
+  uint32_t gain_update_interval;
+  uint32_t hops_since_gain_update;
+  NoiseScalingParameters gain_scaling_parameters;
+
+  uint32_t look_ahead_hops;
+  uint32_t look_ahead_position;
+  // Hops left until the spectra delayed stop being the zeros the ring starts
+  // with, which must not be learned from
+  uint32_t look_ahead_priming;
 
   float *gain_spectrum;
   float *alpha;
   float *beta;
   float *noise_spectrum;
+  float *reference_spectrum;
+  // Gains held between estimations, when they aren't estimated every hop
+  float *held_gain_spectrum;
+  // Spectra waiting to be processed while transients are looked ahead for
+  float *look_ahead_spectra;
 
-  SpectrumType spectrum_type;
   CriticalBandType band_type;
   DenoiserParameters denoise_parameters;
-  GainEstimationType gain_estimation_type;
-  TimeSmoothingType time_smoothing_type;
   NoiseEstimatorType noise_estimator_type;
 
   NoiseEstimator *noise_estimator;
@@ -61,49 +93,81 @@ typedef struct SbSpectralDenoiser {
   DenoiseMixer *mixer;
   NoiseScalingCriterias *noise_scaling_criteria;
   SpectralSmoother *spectrum_smoothing;
+  StageProfiler *profiler;
+  ReductionTelemetry *telemetry;
 } SbSpectralDenoiser;
 
+static void advance_parameters(SbSpectralDenoiser *self, bool new_frame);
+static bool is_gain_estimation_due(SbSpectralDenoiser *self,
+                                   NoiseScalingParameters parameters);
+static void scale_noise(SbSpectralDenoiser *self,
+                        const float *reference_spectrum,
+                        NoiseScalingParameters parameters);
+static void look_ahead(SbSpectralDenoiser *self, float *fft_spectrum);
+static float get_noise_power(SbSpectralDenoiser *self);
+static bool is_noise_frame(SbSpectralDenoiser *self,
+                           const float *reference_spectrum);
+static void attenuate_noise_frame(SbSpectralDenoiser *self,
+                                  float *fft_spectrum);
+static void update_telemetry(SbSpectralDenoiser *self,
+                             const float *fft_spectrum, float input_energy,
+                             bool transient, bool postfiltered);
+
 SpectralProcessorHandle spectral_denoiser_initialize(
     const uint32_t sample_rate, const uint32_t fft_size,
-    const uint32_t overlap_factor, NoiseProfile *noise_profile) {
+    const uint32_t overlap_factor, NoiseProfile *noise_profile,
+    const FftPlannerRigor planner_rigor, const uint32_t median_window_length,
+    const uint32_t profile_window_length, const bool approximate_math,
+    const bool skip_noise_frames) {
 
   SbSpectralDenoiser *self =
-      (SbSpectralDenoiser *)calloc(1U, sizeof(SbSpectralDenoiser));
+      (SbSpectralDenoiser *)spectral_calloc(1U, sizeof(SbSpectralDenoiser));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
   self->hop = self->fft_size / overlap_factor;
   self->sample_rate = sample_rate;
-  self->spectrum_type = SPECTRAL_TYPE_GENERAL;
+  self->parameter_ramp_frames =
+      get_parameter_ramp_frames(self->sample_rate, self->hop);
   self->band_type = CRITICAL_BANDS_TYPE;
+  self->approximate_math = approximate_math;
+  self->skip_noise_frames = skip_noise_frames;
+  self->noise_frame_threshold = from_db_to_coefficient(NOISE_FRAME_THRESHOLD);
   self->default_oversubtraction = DEFAULT_OVERSUBTRACTION;
   self->default_undersubtraction = DEFAULT_UNDERSUBTRACTION;
-  self->gain_estimation_type = GAIN_ESTIMATION_TYPE;
-  self->time_smoothing_type = TIME_SMOOTHING_TYPE;
-
-  self->gain_spectrum = (float *)calloc(self->fft_size, sizeof(float));
-  initialize_spectrum_with_value(self->gain_spectrum, self->fft_size, 1.F);
-  self->alpha = (float *)calloc(self->real_spectrum_size, sizeof(float));
+  self->gain_update_interval = 1U;
+
+  self->gain_spectrum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  initialize_spectrum_with_value(self->gain_spectrum, self->real_spectrum_size,
+                                 1.F);
+  self->alpha =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   initialize_spectrum_with_value(self->alpha, self->real_spectrum_size, 1.F);
-  self->beta = (float *)calloc(self->real_spectrum_size, sizeof(float));
+  self->beta =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
   self->noise_profile = noise_profile;
   self->noise_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  self->reference_spectrum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
-  self->noise_estimator =
-      noise_estimation_initialize(self->fft_size, noise_profile);
+  self->noise_estimator = noise_estimation_initialize(
+      self->fft_size, median_window_length, profile_window_length,
+      noise_profile);
 
   self->spectral_features =
       spectral_features_initialize(self->real_spectrum_size);
 
-  self->postfiltering = postfilter_initialize(self->fft_size);
+  self->postfiltering = postfilter_initialize(self->fft_size, planner_rigor);
 
   self->spectrum_smoothing =
-      spectral_smoothing_initialize(self->fft_size, self->time_smoothing_type);
+      spectral_smoothing_initialize(self->fft_size, TIME_SMOOTHING_TYPE);
 
   self->noise_scaling_criteria = noise_scaling_criterias_initialize(
-      self->fft_size, self->band_type, self->sample_rate, self->spectrum_type);
+      self->fft_size, self->band_type, self->sample_rate, SPECTRAL_TYPE_GENERAL,
+      self->approximate_math);
 
   self->mixer =
       denoise_mixer_initialize(self->fft_size, self->sample_rate, self->hop);
@@ -123,12 +187,94 @@ void spectral_denoiser_free(SpectralProcessorHandle instance) {
   postfilter_free(self->postfiltering);
   denoise_mixer_free(self->mixer);
 
-  free(self->gain_spectrum);
-  free(self->alpha);
-  free(self->beta);
-  free(self->noise_spectrum);
+  spectral_free(self->gain_spectrum);
+  spectral_free(self->held_gain_spectrum);
+  spectral_free(self->alpha);
+  spectral_free(self->beta);
+  spectral_free(self->noise_spectrum);
+  spectral_free(self->reference_spectrum);
+  spectral_free(self->look_ahead_spectra);
+
+  spectral_free(self);
+}
+
+void spectral_denoiser_reset(SpectralProcessorHandle instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  noise_estimation_reset(self->noise_estimator);
+  spectral_smoothing_reset(self->spectrum_smoothing);
+  denoise_mixer_reset(self->mixer);
+
+  initialize_spectrum_with_value(self->gain_spectrum, self->real_spectrum_size,
+                                 1.F);
+  initialize_spectrum_with_value(self->alpha, self->real_spectrum_size, 1.F);
+  memset(self->beta, 0, self->real_spectrum_size * sizeof(float));
+  if (self->held_gain_spectrum) {
+    initialize_spectrum_with_value(self->held_gain_spectrum,
+                                   self->real_spectrum_size, 1.F);
+    self->hops_since_gain_update = self->gain_update_interval;
+  }
+  if (self->look_ahead_spectra) {
+    memset(self->look_ahead_spectra, 0,
+           (size_t)self->look_ahead_hops * self->fft_size * sizeof(float));
+    self->look_ahead_position = 0U;
+    self->look_ahead_priming = self->look_ahead_hops;
+  }
+
+  // Ramps in progress jump to their targets
+  ParameterRamp *ramps[] = {
+      &self->reduction_amount_ramp, &self->noise_rescale_ramp,
+      &self->smoothing_factor_ramp, &self->whitening_factor_ramp,
+      &self->post_filter_threshold_ramp};
+  for (uint32_t k = 0U; k < sizeof(ramps) / sizeof(ramps[0]); k++) {
+    parameter_ramp_reset(ramps[k], ramps[k]->target);
+  }
+  advance_parameters(self, false);
+}
+
+bool spectral_denoiser_enable_look_ahead(SpectralProcessorHandle instance,
+                                         const uint32_t look_ahead_hops) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  if (!self || self->look_ahead_spectra || look_ahead_hops == 0U) {
+    return false;
+  }
+
+  self->look_ahead_spectra = (float *)spectral_calloc(
+      (size_t)look_ahead_hops * self->fft_size, sizeof(float));
+  if (!self->look_ahead_spectra) {
+    return false;
+  }
+  self->look_ahead_hops = look_ahead_hops;
+  self->look_ahead_position = 0U;
+  self->look_ahead_priming = look_ahead_hops;
+
+  return spectral_smoothing_enable_look_ahead(self->spectrum_smoothing,
+                                              look_ahead_hops);
+}
+
+bool spectral_denoiser_set_gain_update_interval(
+    SpectralProcessorHandle instance, const uint32_t hops) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  if (!self || self->held_gain_spectrum || hops == 0U) {
+    return false;
+  }
+
+  if (hops == 1U) {
+    return true;
+  }
+
+  self->held_gain_spectrum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  if (!self->held_gain_spectrum) {
+    return false;
+  }
+  initialize_spectrum_with_value(self->held_gain_spectrum,
+                                 self->real_spectrum_size, 1.F);
+  self->gain_update_interval = hops;
+  // The first frame is always estimated
+  self->hops_since_gain_update = hops;
 
-  free(self);
+  return true;
 }
 
 bool load_reduction_parameters(SpectralProcessorHandle instance,
@@ -138,11 +284,47 @@ bool load_reduction_parameters(SpectralProcessorHandle instance,
   }
 
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  // The first parameters are taken as they are and later ones are ramped to
+  const uint32_t ramp_frames =
+      self->parameters_loaded ? self->parameter_ramp_frames : 0U;
+  parameter_ramp_set_target(&self->reduction_amount_ramp,
+                            parameters.reduction_amount, ramp_frames);
+  parameter_ramp_set_target(&self->noise_rescale_ramp, parameters.noise_rescale,
+                            ramp_frames);
+  parameter_ramp_set_target(&self->smoothing_factor_ramp,
+                            parameters.smoothing_factor, ramp_frames);
+  parameter_ramp_set_target(&self->whitening_factor_ramp,
+                            parameters.whitening_factor, ramp_frames);
+  parameter_ramp_set_target(&self->post_filter_threshold_ramp,
+                            parameters.post_filter_threshold, ramp_frames);
+  self->parameters_loaded = true;
+
+  // Discrete parameters switch right away
   self->denoise_parameters = parameters;
+  advance_parameters(self, false);
 
   return true;
 }
 
+// Sets the continuous parameters of the frame from their ramps, moving them a
+// step further when a new frame starts
+static void advance_parameters(SbSpectralDenoiser *self, const bool new_frame) {
+  ParameterRamp *ramps[] = {
+      &self->reduction_amount_ramp, &self->noise_rescale_ramp,
+      &self->smoothing_factor_ramp, &self->whitening_factor_ramp,
+      &self->post_filter_threshold_ramp};
+  float *values[] = {&self->denoise_parameters.reduction_amount,
+                     &self->denoise_parameters.noise_rescale,
+                     &self->denoise_parameters.smoothing_factor,
+                     &self->denoise_parameters.whitening_factor,
+                     &self->denoise_parameters.post_filter_threshold};
+
+  for (uint32_t k = 0U; k < sizeof(ramps) / sizeof(ramps[0]); k++) {
+    *values[k] = new_frame ? parameter_ramp_advance(ramps[k]) : ramps[k]->value;
+  }
+}
+
 bool spectral_denoiser_run(SpectralProcessorHandle instance,
                            float *fft_spectrum) {
   if (!fft_spectrum || !instance) {
@@ -151,16 +333,50 @@ bool spectral_denoiser_run(SpectralProcessorHandle instance,
 
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
 
-  float *reference_spectrum =
-      get_spectral_feature(self->spectral_features, fft_spectrum,
-                           self->fft_size, self->spectrum_type);
+  advance_parameters(self, true);
+
+  if (self->look_ahead_spectra) {
+    look_ahead(self, fft_spectrum);
+
+    if (self->look_ahead_priming > 0U) {
+      self->look_ahead_priming--;
+      return true;
+    }
+  }
+
+  // Smoothing works in place, so the shared features are left untouched
+  PROFILE_STAGE_BEGIN(features);
+  spectral_features_invalidate(self->spectral_features);
+  float *reference_spectrum = self->reference_spectrum;
+  memcpy(reference_spectrum,
+         get_spectral_feature(self->spectral_features, fft_spectrum,
+                              self->fft_size, SPECTRAL_TYPE_GENERAL),
+         self->real_spectrum_size * sizeof(float));
+  PROFILE_STAGE_END(self->profiler, SPECTRAL_FEATURES_STAGE, features);
 
   if ((NoiseEstimatorType)self->denoise_parameters.learn_noise != OFF) {
+    PROFILE_STAGE_BEGIN(estimation);
     noise_estimation_run(
         self->noise_estimator,
         (NoiseEstimatorType)self->denoise_parameters.learn_noise,
         reference_spectrum);
+    PROFILE_STAGE_END(self->profiler, NOISE_ESTIMATION_STAGE, estimation);
   } else if (is_noise_estimation_available(self->noise_profile)) {
+    // Measured before the frame is modified
+    const float input_energy =
+        self->telemetry
+            ? sum_spectrum(get_spectral_feature(self->spectral_features,
+                                                fft_spectrum, self->fft_size,
+                                                POWER_SPECTRUM),
+                           self->real_spectrum_size)
+            : 0.F;
+
+    if (self->skip_noise_frames && is_noise_frame(self, reference_spectrum)) {
+      attenuate_noise_frame(self, fft_spectrum);
+      update_telemetry(self, fft_spectrum, input_energy, false, false);
+      return true;
+    }
+
     memcpy(self->noise_spectrum, get_noise_profile(self->noise_profile),
            self->real_spectrum_size * sizeof(float));
 
@@ -170,10 +386,14 @@ bool spectral_denoiser_run(SpectralProcessorHandle instance,
                                self->denoise_parameters.noise_rescale,
             .undersubtraction = self->default_undersubtraction,
             .scaling_type = self->denoise_parameters.noise_scaling_type,
+            .noise_profile_generation =
+                get_noise_profile_generation(self->noise_profile),
         };
-    apply_noise_scaling_criteria(
-        self->noise_scaling_criteria, reference_spectrum, self->noise_spectrum,
-        self->alpha, self->beta, oversubtraction_parameters);
+    const bool gains_due =
+        is_gain_estimation_due(self, oversubtraction_parameters);
+    if (gains_due) {
+      scale_noise(self, reference_spectrum, oversubtraction_parameters);
+    }
 
     TimeSmoothingParameters spectral_smoothing_parameters =
         (TimeSmoothingParameters){
@@ -181,20 +401,48 @@ bool spectral_denoiser_run(SpectralProcessorHandle instance,
             .transient_protection_enabled =
                 self->denoise_parameters.transient_protection,
         };
+    PROFILE_STAGE_BEGIN(smoothing);
     spectral_smoothing_run(self->spectrum_smoothing,
                            spectral_smoothing_parameters, reference_spectrum);
+    PROFILE_STAGE_END(self->profiler, SPECTRAL_SMOOTHING_STAGE, smoothing);
+
+    // Frames with a transient aren't smoothed, so their noise is scaled the
+    // same after smoothing as before it
+    const bool transient = is_transient_detected(self->spectrum_smoothing);
+    if (!gains_due && transient) {
+      scale_noise(self, reference_spectrum, oversubtraction_parameters);
+    }
 
     // Get reduction gain weights
-    estimate_gains(self->real_spectrum_size, self->fft_size, reference_spectrum,
-                   self->noise_spectrum, self->gain_spectrum, self->alpha,
-                   self->beta, self->gain_estimation_type);
+    if (gains_due || transient) {
+      PROFILE_STAGE_BEGIN(gains);
+      estimate_gains(self->real_spectrum_size, reference_spectrum,
+                     self->noise_spectrum,
+                     self->held_gain_spectrum ? self->held_gain_spectrum
+                                              : self->gain_spectrum,
+                     self->alpha, self->beta, GAIN_ESTIMATION_TYPE,
+                     self->approximate_math);
+      PROFILE_STAGE_END(self->profiler, GAIN_ESTIMATION_STAGE, gains);
+      self->hops_since_gain_update = 0U;
+      self->gain_scaling_parameters = oversubtraction_parameters;
+    }
+    // Post filtering modifies the gains of the frame, not the ones held
+    if (self->held_gain_spectrum) {
+      memcpy(self->gain_spectrum, self->held_gain_spectrum,
+             self->real_spectrum_size * sizeof(float));
+    }
 
     // Apply post filtering to reduce residual noise on low SNR frames
     PostFiltersParameters post_filter_parameters = (PostFiltersParameters){
         .snr_threshold = self->denoise_parameters.post_filter_threshold,
     };
-    postfilter_apply(self->postfiltering, fft_spectrum, self->gain_spectrum,
-                     post_filter_parameters);
+    PROFILE_STAGE_BEGIN(postfilter);
+    postfilter_apply(self->postfiltering,
+                     get_spectral_feature(self->spectral_features,
+                                          fft_spectrum, self->fft_size,
+                                          POWER_SPECTRUM),
+                     self->gain_spectrum, post_filter_parameters);
+    PROFILE_STAGE_END(self->profiler, POSTFILTER_STAGE, postfilter);
 
     DenoiseMixerParameters mixer_parameters = (DenoiseMixerParameters){
         .noise_level = self->denoise_parameters.reduction_amount,
@@ -202,9 +450,158 @@ bool spectral_denoiser_run(SpectralProcessorHandle instance,
         .whitening_amount = self->denoise_parameters.whitening_factor,
     };
 
+    PROFILE_STAGE_BEGIN(mixer);
     denoise_mixer_run(self->mixer, fft_spectrum, self->gain_spectrum,
                       mixer_parameters);
+    PROFILE_STAGE_END(self->profiler, DENOISE_MIXER_STAGE, mixer);
+
+    update_telemetry(self, fft_spectrum, input_energy, transient,
+                     is_postfilter_active(self->postfiltering));
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+// Gains held are estimated again once they are as old as the interval or when
+// the noise they were estimated with is scaled differently now
+static bool is_gain_estimation_due(SbSpectralDenoiser *self,
+                                   const NoiseScalingParameters parameters) {
+  if (!self->held_gain_spectrum) {
+    return true;
+  }
+
+  self->hops_since_gain_update++;
+
+  const NoiseScalingParameters *held = &self->gain_scaling_parameters;
+  return self->hops_since_gain_update >= self->gain_update_interval ||
+         parameters.noise_profile_generation !=
+             held->noise_profile_generation ||
+         parameters.scaling_type != held->scaling_type ||
+         parameters.oversubtraction != held->oversubtraction;
+}
+
+static void scale_noise(SbSpectralDenoiser *self,
+                        const float *reference_spectrum,
+                        const NoiseScalingParameters parameters) {
+  PROFILE_STAGE_BEGIN(scaling);
+  apply_noise_scaling_criteria(self->noise_scaling_criteria,
+                               reference_spectrum, self->noise_spectrum,
+                               self->alpha, self->beta, parameters);
+  PROFILE_STAGE_END(self->profiler, NOISE_SCALING_STAGE, scaling);
+}
+
+// Detects transients on the spectrum arriving and swaps it for the one that
+// arrived the look ahead hops before, which is processed instead
+static void look_ahead(SbSpectralDenoiser *self, float *fft_spectrum) {
+  spectral_features_invalidate(self->spectral_features);
+  const TimeSmoothingParameters spectral_smoothing_parameters =
+      (TimeSmoothingParameters){
+          .smoothing = self->denoise_parameters.smoothing_factor,
+          .transient_protection_enabled =
+              self->denoise_parameters.transient_protection,
+      };
+  spectral_smoothing_look_ahead(
+      self->spectrum_smoothing, spectral_smoothing_parameters,
+      get_spectral_feature(self->spectral_features, fft_spectrum,
+                           self->fft_size, SPECTRAL_TYPE_GENERAL));
+
+  float *delayed_spectrum =
+      &self->look_ahead_spectra[(size_t)self->look_ahead_position *
+                                self->fft_size];
+  for (uint32_t k = 0U; k < self->fft_size; k++) {
+    const float arriving = fft_spectrum[k];
+    fft_spectrum[k] = delayed_spectrum[k];
+    delayed_spectrum[k] = arriving;
+  }
+  self->look_ahead_position =
+      (self->look_ahead_position + 1U) % self->look_ahead_hops;
+}
+
+// Frames barely above the power of the noise profile would get gains close to
+// zero. Whitening keeps its own state from every residual so it needs the
+// whole processing
+static bool is_noise_frame(SbSpectralDenoiser *self,
+                           const float *reference_spectrum) {
+  if (self->denoise_parameters.whitening_factor > 0.F) {
+    return false;
+  }
+
+  float frame_power = 0.F;
+  for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
+    frame_power += reference_spectrum[k];
+  }
+
+  return frame_power < get_noise_power(self) * self->noise_frame_threshold;
+}
+
+// Power of the noise profile, only added up again when the profile changes
+static float get_noise_power(SbSpectralDenoiser *self) {
+  const uint32_t generation = get_noise_profile_generation(self->noise_profile);
+  if (generation != self->noise_power_generation) {
+    const float *noise_profile = get_noise_profile(self->noise_profile);
+    float noise_power = 0.F;
+    for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
+      noise_power += noise_profile[k];
+    }
+    self->noise_power = noise_power;
+    self->noise_power_generation = generation;
+  }
+
+  return self->noise_power;
+}
+
+// Same output the mixer gives with null gains. The residual is the whole frame
+static void attenuate_noise_frame(SbSpectralDenoiser *self,
+                                  float *fft_spectrum) {
+  if (self->denoise_parameters.residual_listen) {
+    return;
+  }
+
+  const float noise_level = self->denoise_parameters.reduction_amount;
+  for (uint32_t k = 1U; k < self->fft_size; k++) {
+    fft_spectrum[k] *= noise_level;
+  }
+}
+
+bool spectral_denoiser_set_profiler(SpectralProcessorHandle instance,
+                                    StageProfiler *profiler) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  self->profiler = profiler;
+
+  return true;
+}
+
+static void update_telemetry(SbSpectralDenoiser *self,
+                             const float *fft_spectrum,
+                             const float input_energy, const bool transient,
+                             const bool postfiltered) {
+  if (!self->telemetry) {
+    return;
+  }
+
+  reduction_telemetry_update(
+      self->telemetry,
+      (ReductionTelemetryFrame){
+          .input_energy = input_energy,
+          .noise_energy = get_noise_power(self),
+          .output_energy = sum_squared_spectrum(fft_spectrum, self->fft_size),
+          .transient = transient,
+          .postfiltered = postfiltered,
+      });
+}
+
+bool spectral_denoiser_set_telemetry(SpectralProcessorHandle instance,
+                                     ReductionTelemetry *telemetry) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  self->telemetry = telemetry;
+
+  return true;
+}
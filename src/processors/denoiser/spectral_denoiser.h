@@ -23,6 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../../interfaces/spectral_processor.h"
 #include "../../shared/noise_estimation/noise_profile.h"
+#include "../../shared/stft/fft_transform.h"
+#include "../../shared/utils/reduction_telemetry.h"
+#include "../../shared/utils/stage_profiler.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -38,14 +41,34 @@ typedef struct DenoiserParameters {
   float post_filter_threshold;
 } DenoiserParameters;
 
-SpectralProcessorHandle
-spectral_denoiser_initialize(uint32_t sample_rate, uint32_t fft_size,
-                             uint32_t overlap_factor,
-                             NoiseProfile *noise_profile);
+// Skipping noise frames fully attenuates frames that are only noise without
+// estimating their gains
+SpectralProcessorHandle spectral_denoiser_initialize(
+    uint32_t sample_rate, uint32_t fft_size, uint32_t overlap_factor,
+    NoiseProfile *noise_profile, FftPlannerRigor planner_rigor,
+    uint32_t median_window_length, uint32_t profile_window_length,
+    bool approximate_math, bool skip_noise_frames);
 void spectral_denoiser_free(SpectralProcessorHandle instance);
+// Clears the state carried between frames. The noise profile is left as it is
+void spectral_denoiser_reset(SpectralProcessorHandle instance);
 bool load_reduction_parameters(SpectralProcessorHandle instance,
                                DenoiserParameters parameters);
 bool spectral_denoiser_run(SpectralProcessorHandle instance,
                            float *fft_spectrum);
+// Spectra are processed the given number of hops after they arrive, so
+// transients are detected ahead of the frames their gains are estimated for.
+// The output gets delayed by as many hops
+bool spectral_denoiser_enable_look_ahead(SpectralProcessorHandle instance,
+                                         uint32_t look_ahead_hops);
+// Scales the noise and estimates the gains only every given number of hops and
+// holds the gains in between. Frames with a transient, a new noise profile or
+// a different noise scaling are always estimated. One estimates every hop
+bool spectral_denoiser_set_gain_update_interval(
+    SpectralProcessorHandle instance, uint32_t hops);
+bool spectral_denoiser_set_profiler(SpectralProcessorHandle instance,
+                                    StageProfiler *profiler);
+// Frames reduced are measured into the telemetry given, if any
+bool spectral_denoiser_set_telemetry(SpectralProcessorHandle instance,
+                                     ReductionTelemetry *telemetry);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PROCESSOR_STAGE_H
+#define PROCESSOR_STAGE_H
+
+#include "../interfaces/spectral_processor.h"
+#include "../shared/stft/fft_transform.h"
+#include "stft_settings.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Spectral processing of an instance as a stage of a chain, which runs it on
+// an STFT of its own laid out as the one of the instance
+typedef struct ProcessorStage {
+  uint32_t sample_rate;
+  float frame_size;
+  uint32_t number_of_channels;
+  uint32_t fft_size;
+  FftPlannerRigor planner_rigor;
+  FftTransformType transform_type;
+  StftSettings stft_settings;
+
+  // One processor per channel
+  spectral_processing spectral_processing;
+  SpectralProcessorHandle *spectral_processors;
+  // Samples the processors delay their frames by on top of the STFT
+  uint32_t delay;
+
+  // Takes the changes loaded from other threads before every block. Returns
+  // false while the instance would leave its frames as they are
+  bool (*prepare)(void *instance);
+  void *instance;
+} ProcessorStage;
+
+// Both return false for multiresolution instances, which have no single STFT
+bool get_denoiser_stage(void *instance, ProcessorStage *stage);
+bool get_adaptive_denoiser_stage(void *instance, ProcessorStage *stage);
+
+#endif
@@ -20,44 +20,382 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../../include/specbleach_adenoiser.h"
 #include "../shared/configurations.h"
+#include "../shared/stft/multiresolution_stft.h"
 #include "../shared/stft/stft_processor.h"
 #include "../shared/utils/general_utils.h"
+#include "../shared/utils/memory_arena.h"
+#include "../shared/utils/parameter_exchange.h"
+#include "../shared/utils/realtime_audit.h"
+#include "../shared/utils/reduction_telemetry.h"
+#include "../shared/utils/sample_converter.h"
+#include "../shared/utils/spectral_kernels.h"
+#include "../shared/utils/stage_profiler.h"
+#include "../shared/utils/table_cache.h"
+#include "../shared/utils/thread_pool.h"
 #include "adaptivedenoiser/adaptive_denoiser.h"
+#include "processor_stage.h"
+#include "stft_settings.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Every channel has its own adaptive denoiser and noise estimation.
+// Multiresolution instances have a single channel and a denoiser for each band,
+// or only for the low band when the high one passes through
 typedef struct SbAdaptiveDenoiser {
   uint32_t sample_rate;
+  float frame_size;
+  FftPlannerRigor planner_rigor;
+  StftSettings stft_settings;
+  uint32_t number_of_channels;
+  uint32_t number_of_processors;
   AdaptiveDenoiserParameters denoise_parameters;
+  // Parameters loaded from control threads, taken when processing starts
+  ParameterExchange *parameter_exchange;
 
-  SpectralProcessorHandle adaptive_spectral_denoiser;
+  SpectralProcessorHandle *adaptive_spectral_denoisers;
   StftProcessor *stft_processor;
+  MultiresolutionStft *multiresolution;
+  // Converts samples of the integer and double process variants
+  SampleConverter *sample_converter;
+
+  job_runner runner;
+  void *runner_data;
+  ThreadPool *thread_pool;
+
+  // First profiler belongs to the STFT and the rest to each channel
+  StageProfiler **profilers;
+  // One for each processor
+  ReductionTelemetry **telemetries;
+
+  // Memory every buffer of the instance is carved from
+  MemoryArena *arena;
 } SbAdaptiveDenoiser;
 
+static void apply_pending_parameters(SbAdaptiveDenoiser *self);
+static bool prepare_stage(void *instance);
+static bool process_converted(SpectralBleachHandle instance,
+                              uint32_t number_of_channels,
+                              uint32_t number_of_frames, SampleFormat format,
+                              const void *input, void *output);
+static bool process_planar_block(void *instance, uint32_t number_of_frames,
+                                 const float *const *input, float **output);
+static SbAdaptiveDenoiser *
+measure_instance(const SpectralBleachInitOptions *options, size_t *memory_size);
+static bool find_memory_size(const SpectralBleachInitOptions *options,
+                             size_t *memory_size);
+static SbAdaptiveDenoiser *
+initialize_in_arena(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena);
+static SbAdaptiveDenoiser *
+initialize_adaptive_denoiser(const SpectralBleachInitOptions *options,
+                             MemoryArena *arena);
+static bool resolve_noise_tracker(NoiseTrackerType *noise_tracker,
+                                  SpectralBleachNoiseTracker option);
+static StftProcessor *get_processor_stft(SbAdaptiveDenoiser *self,
+                                         uint32_t processor);
+static uint32_t get_processor_sample_rate(SbAdaptiveDenoiser *self,
+                                          uint32_t processor);
+
 SpectralBleachHandle specbleach_adaptive_initialize(const uint32_t sample_rate,
                                                     float frame_size) {
+  SpectralBleachInitOptions options = {0};
+  options.sample_rate = sample_rate;
+  options.frame_size = frame_size;
+
+  return specbleach_adaptive_initialize_ex(&options);
+}
+
+SpectralBleachHandle
+specbleach_adaptive_initialize_ex(const SpectralBleachInitOptions *options) {
+  if (!options) {
+    return NULL;
+  }
+
+  // Layouts measured before skip the throwaway instance. Otherwise it holds
+  // the shared tables of the layout, so the instance built next finds them
+  // already computed
+  size_t memory_size = 0U;
+  SbAdaptiveDenoiser *measured = NULL;
+  if (!find_memory_size(options, &memory_size)) {
+    measured = measure_instance(options, &memory_size);
+    if (!measured) {
+      return NULL;
+    }
+  }
+
+  MemoryArena *arena = memory_arena_initialize_owned(memory_size);
   SbAdaptiveDenoiser *self =
-      (SbAdaptiveDenoiser *)calloc(1U, sizeof(SbAdaptiveDenoiser));
+      arena ? initialize_in_arena(options, arena) : NULL;
+  if (measured) {
+    specbleach_adaptive_free(measured);
+  }
+
+  return self;
+}
+
+size_t specbleach_adaptive_get_required_memory(
+    const SpectralBleachInitOptions *options) {
+  if (!options) {
+    return 0U;
+  }
+
+  size_t memory_size = 0U;
+  if (find_memory_size(options, &memory_size)) {
+    return memory_size;
+  }
+
+  SbAdaptiveDenoiser *measured = measure_instance(options, &memory_size);
+  if (!measured) {
+    return 0U;
+  }
+  specbleach_adaptive_free(measured);
+
+  return memory_size;
+}
+
+// Builds a throwaway instance from the heap adding up what it takes
+static SbAdaptiveDenoiser *
+measure_instance(const SpectralBleachInitOptions *options,
+                 size_t *memory_size) {
+  if (!options) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize_measuring();
+  if (!arena) {
+    return NULL;
+  }
+
+  SbAdaptiveDenoiser *self = initialize_in_arena(options, arena);
+  if (self) {
+    *memory_size = get_memory_arena_required_size(arena);
+
+    SpectralBleachInitOptions layout;
+    get_layout_options(&layout, options);
+    table_cache_store_size(ADAPTIVE_DENOISER_INSTANCE, &layout, sizeof(layout),
+                           *memory_size);
+  }
+
+  return self;
+}
+
+static bool find_memory_size(const SpectralBleachInitOptions *options,
+                             size_t *memory_size) {
+  SpectralBleachInitOptions layout;
+  get_layout_options(&layout, options);
+
+  return table_cache_find_size(ADAPTIVE_DENOISER_INSTANCE, &layout,
+                               sizeof(layout), memory_size);
+}
+
+SpectralBleachHandle specbleach_adaptive_initialize_with_memory(
+    const SpectralBleachInitOptions *options, void *memory,
+    const size_t memory_size) {
+  if (!options || !memory) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize(memory, memory_size);
+  if (!arena) {
+    return NULL;
+  }
+
+  return initialize_in_arena(options, arena);
+}
+
+static bool resolve_noise_tracker(NoiseTrackerType *noise_tracker,
+                                  const SpectralBleachNoiseTracker option) {
+  switch (option) {
+  case SPECBLEACH_NOISE_TRACKER_DEFAULT:
+  case SPECBLEACH_NOISE_TRACKER_CONTINUOUS_MINIMUM:
+    *noise_tracker = CONTINUOUS_MINIMUM_TRACKER;
+    return true;
+  case SPECBLEACH_NOISE_TRACKER_MINIMUM_STATISTICS:
+    *noise_tracker = MINIMUM_STATISTICS_TRACKER;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Every module allocates from the arena bound to the thread while it is built
+static SbAdaptiveDenoiser *
+initialize_in_arena(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena) {
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+  SbAdaptiveDenoiser *self = initialize_adaptive_denoiser(options, arena);
+  memory_arena_bind(previous_arena);
+
+  return self;
+}
+
+// Takes ownership of the arena, which gets released with the instance or
+// right away if building it fails
+static SbAdaptiveDenoiser *
+initialize_adaptive_denoiser(const SpectralBleachInitOptions *options,
+                             MemoryArena *arena) {
+  // Pick the vectorized kernels for this cpu once before processing
+  spectral_kernels_initialize();
+
+  SbAdaptiveDenoiser *self =
+      (SbAdaptiveDenoiser *)spectral_calloc(1U, sizeof(SbAdaptiveDenoiser));
+  if (!self) {
+    memory_arena_free(arena);
+    return NULL;
+  }
+
+  self->arena = arena;
+
+  const uint32_t sample_rate = options->sample_rate;
+  const float frame_size = options->frame_size;
+  const FftPlannerRigor planner_rigor =
+      (FftPlannerRigor)options->planner_rigor;
 
   self->sample_rate = sample_rate;
+  self->frame_size = frame_size;
+  self->planner_rigor = planner_rigor;
+  self->number_of_channels =
+      options->number_of_channels > 0U ? options->number_of_channels : 1U;
+  self->number_of_processors = self->number_of_channels;
+
+  // Bands of a multiresolution instance are only split from a single channel
+  const bool split_requested =
+      options->multiresolution || options->speech_band_only;
+  const bool multiresolution =
+      split_requested && self->number_of_channels == 1U;
+  if (multiresolution) {
+    self->number_of_processors = options->speech_band_only ? 1U : 2U;
+  }
+
+  self->parameter_exchange =
+      parameter_exchange_initialize(sizeof(AdaptiveDenoiserParameters));
+  self->adaptive_spectral_denoisers =
+      (SpectralProcessorHandle *)spectral_calloc(
+          self->number_of_processors, sizeof(SpectralProcessorHandle));
 
-  self->stft_processor = stft_processor_initialize(
-      sample_rate, frame_size, OVERLAP_FACTOR_SPEECH,
-      PADDING_CONFIGURATION_SPEECH, ZEROPADDING_AMOUNT_SPEECH,
-      INPUT_WINDOW_TYPE_SPEECH, OUTPUT_WINDOW_TYPE_SPEECH);
+  // In low latency mode the speech overlap is replaced since it is too small
+  // to fit a shorter synthesis window
+  self->stft_settings = (StftSettings){
+      .overlap_factor = OVERLAP_FACTOR_SPEECH,
+      .padding_type = PADDING_CONFIGURATION_SPEECH,
+      .zeropadding_amount = ZEROPADDING_AMOUNT_SPEECH,
+      .input_window = INPUT_WINDOW_TYPE_SPEECH,
+      .output_window = OUTPUT_WINDOW_TYPE_SPEECH,
+  };
+  NoiseTrackerType noise_tracker = CONTINUOUS_MINIMUM_TRACKER;
+  if (!resolve_stft_settings(&self->stft_settings, options) ||
+      !resolve_noise_tracker(&noise_tracker, options->noise_tracker) ||
+      multiresolution != split_requested) {
+    specbleach_adaptive_free(self);
+    return NULL;
+  }
+
+  const StftSettings *stft_settings = &self->stft_settings;
+
+  // Speech is processed at the reduced sample rate of the band below the
+  // crossover. The band above it gets short frames or passes through
+  if (multiresolution) {
+    self->multiresolution = multiresolution_stft_initialize(
+        sample_rate, frame_size,
+        options->crossover_frequency > 0.F
+            ? options->crossover_frequency
+            : fminf(MULTIRESOLUTION_CROSSOVER_SPEECH,
+                    (float)sample_rate / 4.F),
+        stft_settings->overlap_factor, stft_settings->padding_type,
+        stft_settings->zeropadding_amount, stft_settings->input_window,
+        stft_settings->output_window, stft_settings->low_latency,
+        FFT_TRANSFORM_TYPE_SPEECH, planner_rigor, !options->speech_band_only);
+  } else {
+    self->stft_processor = stft_processor_initialize(
+        sample_rate, frame_size, stft_settings->overlap_factor,
+        stft_settings->padding_type, stft_settings->zeropadding_amount,
+        stft_settings->input_window, stft_settings->output_window,
+        stft_settings->low_latency, FFT_TRANSFORM_TYPE_SPEECH, planner_rigor,
+        self->number_of_channels);
+  }
+
+  if (!self->stft_processor && !self->multiresolution) {
+    specbleach_adaptive_free(self);
+    return NULL;
+  }
 
-  if (!self->stft_processor) {
+  if (self->stft_processor && stft_settings->spread_processing &&
+      !stft_processor_enable_spread_processing(self->stft_processor)) {
     specbleach_adaptive_free(self);
     return NULL;
   }
 
-  const uint32_t fft_size = get_stft_fft_size(self->stft_processor);
+  if (options->job_runner) {
+    self->runner = options->job_runner;
+    self->runner_data = options->job_runner_data;
+  } else if (options->number_of_threads > 1U &&
+             self->number_of_channels > 1U &&
+             !is_bound_memory_arena_measuring()) {
+    // The pool lives outside the arena and a measured instance never runs
+    self->thread_pool = thread_pool_initialize(options->number_of_threads);
 
-  self->adaptive_spectral_denoiser = spectral_adaptive_denoiser_initialize(
-      self->sample_rate, fft_size, OVERLAP_FACTOR_SPEECH);
+    if (!self->thread_pool) {
+      specbleach_adaptive_free(self);
+      return NULL;
+    }
 
-  if (!self->adaptive_spectral_denoiser) {
+    self->runner = &thread_pool_run;
+    self->runner_data = self->thread_pool;
+  }
+  if (self->stft_processor) {
+    stft_processor_set_job_runner(self->stft_processor, self->runner,
+                                  self->runner_data);
+  }
+
+  self->sample_converter =
+      sample_converter_initialize(self->number_of_channels);
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    self->adaptive_spectral_denoisers[k] =
+        spectral_adaptive_denoiser_initialize(
+            get_processor_sample_rate(self, k),
+            get_stft_fft_size(get_processor_stft(self, k)),
+            stft_settings->overlap_factor, planner_rigor,
+            options->approximate_math, noise_tracker,
+            options->band_processing);
+
+    if (!self->adaptive_spectral_denoisers[k]) {
+      specbleach_adaptive_free(self);
+      return NULL;
+    }
+  }
+
+  self->telemetries = (ReductionTelemetry **)spectral_calloc(
+      self->number_of_processors, sizeof(ReductionTelemetry *));
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    self->telemetries[k] = reduction_telemetry_initialize(
+        get_processor_sample_rate(self, k),
+        get_stft_hop(get_processor_stft(self, k)));
+    spectral_adaptive_denoiser_set_telemetry(
+        self->adaptive_spectral_denoisers[k], self->telemetries[k]);
+  }
+
+#ifdef SPECBLEACH_PROFILING
+  self->profilers = (StageProfiler **)spectral_calloc(
+      self->number_of_processors + 1U, sizeof(StageProfiler *));
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    self->profilers[k] = stage_profiler_initialize();
+  }
+  if (self->multiresolution) {
+    multiresolution_stft_set_profiler(self->multiresolution,
+                                      self->profilers[0]);
+  } else {
+    stft_processor_set_profiler(self->stft_processor, self->profilers[0]);
+  }
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    spectral_adaptive_denoiser_set_profiler(
+        self->adaptive_spectral_denoisers[k], self->profilers[k + 1U]);
+  }
+#endif
+
+  // Whatever didn't fit in caller memory came from the heap
+  if (is_memory_arena_exhausted(arena)) {
     specbleach_adaptive_free(self);
     return NULL;
   }
@@ -67,19 +405,131 @@ SpectralBleachHandle specbleach_adaptive_initialize(const uint32_t sample_rate,
 
 void specbleach_adaptive_free(SpectralBleachHandle instance) {
   SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  MemoryArena *arena = self->arena;
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    if (self->adaptive_spectral_denoisers[k]) {
+      spectral_adaptive_denoiser_free(self->adaptive_spectral_denoisers[k]);
+    }
+  }
+  if (self->profilers) {
+    for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+      stage_profiler_free(self->profilers[k]);
+    }
+    spectral_free(self->profilers);
+  }
+  if (self->telemetries) {
+    for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+      reduction_telemetry_free(self->telemetries[k]);
+    }
+    spectral_free(self->telemetries);
+  }
+  if (self->thread_pool) {
+    thread_pool_free(self->thread_pool);
+  }
+  if (self->stft_processor) {
+    stft_processor_free(self->stft_processor);
+  }
+  if (self->multiresolution) {
+    multiresolution_stft_free(self->multiresolution);
+  }
+  if (self->sample_converter) {
+    sample_converter_free(self->sample_converter);
+  }
+
+  if (self->parameter_exchange) {
+    parameter_exchange_free(self->parameter_exchange);
+  }
+
+  spectral_free(self->adaptive_spectral_denoisers);
+  spectral_free(self);
+
+  memory_arena_bind(previous_arena);
+  memory_arena_free(arena);
+}
+
+bool specbleach_adaptive_reset(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    spectral_adaptive_denoiser_reset(self->adaptive_spectral_denoisers[k]);
+  }
 
-  spectral_adaptive_denoiser_free(self->adaptive_spectral_denoiser);
-  stft_processor_free(self->stft_processor);
+  if (self->multiresolution) {
+    return multiresolution_stft_reset(self->multiresolution);
+  }
 
-  free(self);
+  return stft_processor_reset(self->stft_processor);
+}
+
+static StftProcessor *get_processor_stft(SbAdaptiveDenoiser *self,
+                                         const uint32_t processor) {
+  if (self->multiresolution) {
+    return get_multiresolution_band(self->multiresolution,
+                                    (MultiresolutionBand)processor);
+  }
+
+  return self->stft_processor;
+}
+
+static uint32_t get_processor_sample_rate(SbAdaptiveDenoiser *self,
+                                          const uint32_t processor) {
+  if (self->multiresolution) {
+    return get_multiresolution_band_sample_rate(
+        self->multiresolution, (MultiresolutionBand)processor);
+  }
+
+  return self->sample_rate;
 }
 
 uint32_t specbleach_adaptive_get_latency(SpectralBleachHandle instance) {
   SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
 
+  if (self->multiresolution) {
+    return get_multiresolution_latency(self->multiresolution);
+  }
+
   return get_stft_latency(self->stft_processor);
 }
 
+bool get_adaptive_denoiser_stage(void *instance, ProcessorStage *stage) {
+  if (!instance || !stage) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  if (self->multiresolution) {
+    return false;
+  }
+
+  *stage = (ProcessorStage){
+      .sample_rate = self->sample_rate,
+      .frame_size = self->frame_size,
+      .number_of_channels = self->number_of_channels,
+      .fft_size = get_stft_fft_size(self->stft_processor),
+      .planner_rigor = self->planner_rigor,
+      .transform_type = FFT_TRANSFORM_TYPE_SPEECH,
+      .stft_settings = self->stft_settings,
+      .spectral_processing = &spectral_adaptive_denoiser_run,
+      .spectral_processors = self->adaptive_spectral_denoisers,
+      .prepare = &prepare_stage,
+      .instance = self,
+  };
+
+  return true;
+}
+
+static bool prepare_stage(void *instance) {
+  apply_pending_parameters((SbAdaptiveDenoiser *)instance);
+
+  return true;
+}
+
 bool specbleach_adaptive_process(SpectralBleachHandle instance,
                                  const uint32_t number_of_samples,
                                  const float *input, float *output) {
@@ -88,12 +538,158 @@ bool specbleach_adaptive_process(SpectralBleachHandle instance,
   }
 
   SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_parameters(self);
 
-  stft_processor_run(self->stft_processor, number_of_samples, input, output,
-                     &spectral_adaptive_denoiser_run,
-                     self->adaptive_spectral_denoiser);
+  bool processed = false;
+  if (self->multiresolution) {
+    processed = multiresolution_stft_run(
+        self->multiresolution, number_of_samples, input, output,
+        &spectral_adaptive_denoiser_run,
+        self->adaptive_spectral_denoisers[LOW_BAND],
+        self->number_of_processors > HIGH_BAND
+            ? self->adaptive_spectral_denoisers[HIGH_BAND]
+            : NULL);
+  } else {
+    processed = stft_processor_run(self->stft_processor, number_of_samples,
+                                   input, output,
+                                   &spectral_adaptive_denoiser_run,
+                                   self->adaptive_spectral_denoisers[0]);
+  }
+  REALTIME_SECTION_END();
 
-  return true;
+  return processed;
+}
+
+bool specbleach_adaptive_process_multichannel(SpectralBleachHandle instance,
+                                              const uint32_t number_of_channels,
+                                              const uint32_t number_of_frames,
+                                              const float *const *input,
+                                              float **output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_parameters(self);
+
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = self->multiresolution
+                    ? specbleach_adaptive_process(instance, number_of_frames,
+                                                  input[0], output[0])
+                    : stft_processor_run_multichannel(
+                          self->stft_processor, number_of_frames, input,
+                          output, &spectral_adaptive_denoiser_run,
+                          self->adaptive_spectral_denoisers);
+  }
+  REALTIME_SECTION_END();
+
+  return processed;
+}
+
+bool specbleach_adaptive_process_interleaved(SpectralBleachHandle instance,
+                                             const uint32_t number_of_channels,
+                                             const uint32_t number_of_frames,
+                                             const float *input,
+                                             float *output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_parameters(self);
+
+  // A single channel is already interleaved
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = self->multiresolution
+                    ? specbleach_adaptive_process(instance, number_of_frames,
+                                                  input, output)
+                    : stft_processor_run_interleaved(
+                          self->stft_processor, number_of_frames, input,
+                          output, &spectral_adaptive_denoiser_run,
+                          self->adaptive_spectral_denoisers);
+  }
+  REALTIME_SECTION_END();
+
+  return processed;
+}
+
+bool specbleach_adaptive_process_s16(SpectralBleachHandle instance,
+                                     const uint32_t number_of_samples,
+                                     const int16_t *input, int16_t *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_S16,
+                           input, output);
+}
+
+bool specbleach_adaptive_process_s32(SpectralBleachHandle instance,
+                                     const uint32_t number_of_samples,
+                                     const int32_t *input, int32_t *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_S32,
+                           input, output);
+}
+
+bool specbleach_adaptive_process_f64(SpectralBleachHandle instance,
+                                     const uint32_t number_of_samples,
+                                     const double *input, double *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_F64,
+                           input, output);
+}
+
+bool specbleach_adaptive_process_interleaved_s16(
+    SpectralBleachHandle instance, const uint32_t number_of_channels,
+    const uint32_t number_of_frames, const int16_t *input, int16_t *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_S16, input, output);
+}
+
+bool specbleach_adaptive_process_interleaved_s32(
+    SpectralBleachHandle instance, const uint32_t number_of_channels,
+    const uint32_t number_of_frames, const int32_t *input, int32_t *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_S32, input, output);
+}
+
+bool specbleach_adaptive_process_interleaved_f64(
+    SpectralBleachHandle instance, const uint32_t number_of_channels,
+    const uint32_t number_of_frames, const double *input, double *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_F64, input, output);
+}
+
+static bool process_converted(SpectralBleachHandle instance,
+                              const uint32_t number_of_channels,
+                              const uint32_t number_of_frames,
+                              const SampleFormat format, const void *input,
+                              void *output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+  if (number_of_channels != self->number_of_channels) {
+    return false;
+  }
+
+  REALTIME_SECTION_BEGIN();
+  const bool processed =
+      sample_converter_run(self->sample_converter, number_of_frames, format,
+                           input, output, &process_planar_block, self);
+  REALTIME_SECTION_END();
+
+  return processed;
+}
+
+static bool process_planar_block(void *instance,
+                                 const uint32_t number_of_frames,
+                                 const float *const *input, float **output) {
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  return specbleach_adaptive_process_multichannel(
+      instance, self->number_of_channels, number_of_frames, input, output);
 }
 
 bool specbleach_adaptive_load_parameters(SpectralBleachHandle instance,
@@ -104,21 +700,128 @@ bool specbleach_adaptive_load_parameters(SpectralBleachHandle instance,
 
   SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
 
-  // clang-format off
-  self->denoise_parameters = (AdaptiveDenoiserParameters){
-      .residual_listen = parameters.residual_listen,
-      .reduction_amount =
-          from_db_to_coefficient(parameters.reduction_amount * -1.F),
-      .noise_rescale = from_db_to_coefficient(parameters.noise_rescale),
-      .noise_scaling_type = parameters.noise_scaling_type,
-      .smoothing_factor = remap_percentage_log_like_unity(parameters.smoothing_factor / 100.F),
-      .whitening_factor = parameters.whitening_factor / 100.F,
-      .post_filter_threshold = from_db_to_coefficient(parameters.post_filter_threshold),
+  const AdaptiveDenoiserParameters denoise_parameters =
+      (AdaptiveDenoiserParameters){
+          .residual_listen = parameters.residual_listen,
+          .reduction_amount =
+              from_db_to_coefficient(parameters.reduction_amount * -1.F),
+          .noise_rescale = from_db_to_coefficient(parameters.noise_rescale),
+          .noise_scaling_type = parameters.noise_scaling_type,
+          .smoothing_factor = remap_percentage_log_like_unity(
+              parameters.smoothing_factor / 100.F),
+          .whitening_factor = parameters.whitening_factor / 100.F,
+          .post_filter_threshold =
+              from_db_to_coefficient(parameters.post_filter_threshold),
+      };
+
+  // Processing may be running in another thread, so the parameters are only
+  // handed over and the processing thread takes them before its next block
+  return parameter_exchange_publish(self->parameter_exchange,
+                                    &denoise_parameters);
+}
+
+// Runs in the processing thread before any processing. Processors ramp the
+// continuous parameters so automation doesn't step the gains
+static void apply_pending_parameters(SbAdaptiveDenoiser *self) {
+  const AdaptiveDenoiserParameters *parameters =
+      (const AdaptiveDenoiserParameters *)parameter_exchange_consume(
+          self->parameter_exchange);
+  if (!parameters) {
+    return;
+  }
+
+  self->denoise_parameters = *parameters;
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    load_adaptive_reduction_parameters(self->adaptive_spectral_denoisers[k],
+                                       self->denoise_parameters);
+  }
+}
+
+bool specbleach_adaptive_get_profile_stats(SpectralBleachHandle instance,
+                                           SpectralBleachStats *stats) {
+  if (!instance || !stats) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  memset(stats, 0, sizeof(SpectralBleachStats));
+
+  if (!self->profilers) {
+    return false;
+  }
+
+  StageCounter counters[NUMBER_OF_PROFILED_STAGES] = {{0}};
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    stage_profiler_accumulate(self->profilers[k], counters);
+  }
+
+  for (uint32_t k = 0U; k < NUMBER_OF_PROFILED_STAGES; k++) {
+    stats->stages[k] = (SpectralBleachStageStats){
+        .calls = counters[k].calls,
+        .nanoseconds = counters[k].nanoseconds,
+        .cycles = counters[k].cycles,
+    };
+  }
+
+  return true;
+}
+
+bool specbleach_adaptive_reset_profile_stats(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  if (!self->profilers) {
+    return false;
+  }
+
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    stage_profiler_reset(self->profilers[k]);
+  }
+
+  return true;
+}
+
+bool specbleach_adaptive_get_telemetry(SpectralBleachHandle instance,
+                                       SpectralBleachTelemetry *telemetry) {
+  if (!instance || !telemetry) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  ReductionTelemetryCounters counters;
+  if (!reduction_telemetry_merge(self->telemetries, self->number_of_processors,
+                                 &counters)) {
+    return false;
+  }
+
+  const float frames = counters.frames > 0U ? (float)counters.frames : 1.F;
+  *telemetry = (SpectralBleachTelemetry){
+      .frames = counters.frames,
+      .transient_rate = (float)counters.transient_frames / frames,
+      .postfilter_rate = (float)counters.postfilter_frames / frames,
+      .input_snr = counters.input_snr,
+      .attenuation = counters.attenuation,
   };
-  // clang-format on
 
-  load_adaptive_reduction_parameters(self->adaptive_spectral_denoiser,
-                                     self->denoise_parameters);
+  return true;
+}
+
+bool specbleach_adaptive_reset_telemetry(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbAdaptiveDenoiser *self = (SbAdaptiveDenoiser *)instance;
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    reduction_telemetry_reset(self->telemetries[k]);
+  }
 
   return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,323 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "../../include/specbleach_chain.h"
+#include "../shared/stft/spectral_processor_chain.h"
+#include "../shared/stft/stft_processor.h"
+#include "../shared/utils/memory_arena.h"
+#include "../shared/utils/realtime_audit.h"
+#include "processor_stage.h"
+#include <stdlib.h>
+
+// A single STFT runs the processors of every stage. Each channel has a chain
+// holding the processors of that channel in the order of the stages
+typedef struct SbSpectralChain {
+  uint32_t number_of_channels;
+  uint32_t number_of_stages;
+  ProcessorStage *stages;
+  StftProcessor *stft_processor;
+  SpectralProcessorHandle *channel_chains;
+
+  // Memory every buffer of the chain is carved from
+  MemoryArena *arena;
+} SbSpectralChain;
+
+static SbSpectralChain *measure_chain(const SpectralBleachChainStage *stages,
+                                      uint32_t number_of_stages,
+                                      size_t *memory_size);
+static SbSpectralChain *
+initialize_in_arena(const SpectralBleachChainStage *stages,
+                    uint32_t number_of_stages, MemoryArena *arena);
+static SbSpectralChain *initialize_chain(const SpectralBleachChainStage *stages,
+                                         uint32_t number_of_stages,
+                                         MemoryArena *arena);
+static bool get_processor_stage(const SpectralBleachChainStage *stage,
+                                ProcessorStage *processor_stage);
+static bool is_compatible_stage(const ProcessorStage *first,
+                                const ProcessorStage *stage);
+static void prepare_stages(SbSpectralChain *self);
+
+SpectralBleachChainHandle
+specbleach_chain_initialize(const SpectralBleachChainStage *stages,
+                            const uint32_t number_of_stages) {
+  size_t memory_size = 0U;
+  SbSpectralChain *measured =
+      measure_chain(stages, number_of_stages, &memory_size);
+  if (!measured) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize_owned(memory_size);
+  SbSpectralChain *self =
+      arena ? initialize_in_arena(stages, number_of_stages, arena) : NULL;
+  specbleach_chain_free(measured);
+
+  return self;
+}
+
+// Builds a throwaway chain from the heap adding up what it takes
+static SbSpectralChain *measure_chain(const SpectralBleachChainStage *stages,
+                                      const uint32_t number_of_stages,
+                                      size_t *memory_size) {
+  if (!stages || number_of_stages == 0U) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize_measuring();
+  if (!arena) {
+    return NULL;
+  }
+
+  SbSpectralChain *self = initialize_in_arena(stages, number_of_stages, arena);
+  if (self) {
+    *memory_size = get_memory_arena_required_size(arena);
+  }
+
+  return self;
+}
+
+static SbSpectralChain *
+initialize_in_arena(const SpectralBleachChainStage *stages,
+                    const uint32_t number_of_stages, MemoryArena *arena) {
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+  SbSpectralChain *self = initialize_chain(stages, number_of_stages, arena);
+  memory_arena_bind(previous_arena);
+
+  return self;
+}
+
+// Takes ownership of the arena, which gets released with the chain or right
+// away if building it fails
+static SbSpectralChain *initialize_chain(const SpectralBleachChainStage *stages,
+                                         const uint32_t number_of_stages,
+                                         MemoryArena *arena) {
+  SbSpectralChain *self =
+      (SbSpectralChain *)spectral_calloc(1U, sizeof(SbSpectralChain));
+  if (!self) {
+    memory_arena_free(arena);
+    return NULL;
+  }
+
+  self->arena = arena;
+  self->number_of_stages = number_of_stages;
+  self->stages = (ProcessorStage *)spectral_calloc(number_of_stages,
+                                                   sizeof(ProcessorStage));
+  if (!self->stages) {
+    specbleach_chain_free(self);
+    return NULL;
+  }
+
+  for (uint32_t k = 0U; k < number_of_stages; k++) {
+    if (!get_processor_stage(&stages[k], &self->stages[k]) ||
+        !is_compatible_stage(&self->stages[0], &self->stages[k])) {
+      specbleach_chain_free(self);
+      return NULL;
+    }
+  }
+
+  // Frames are laid out as the ones of the first stage
+  const ProcessorStage *first = &self->stages[0];
+  self->number_of_channels = first->number_of_channels;
+  self->stft_processor = stft_processor_initialize(
+      first->sample_rate, first->frame_size,
+      first->stft_settings.overlap_factor, first->stft_settings.padding_type,
+      first->stft_settings.zeropadding_amount,
+      first->stft_settings.input_window, first->stft_settings.output_window,
+      first->stft_settings.low_latency, first->transform_type,
+      first->planner_rigor, self->number_of_channels);
+
+  if (!self->stft_processor ||
+      get_stft_fft_size(self->stft_processor) != first->fft_size ||
+      (first->stft_settings.spread_processing &&
+       !stft_processor_enable_spread_processing(self->stft_processor))) {
+    specbleach_chain_free(self);
+    return NULL;
+  }
+
+  self->channel_chains = (SpectralProcessorHandle *)spectral_calloc(
+      self->number_of_channels, sizeof(SpectralProcessorHandle));
+  if (!self->channel_chains) {
+    specbleach_chain_free(self);
+    return NULL;
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    SpectralProcessorChain *channel_chain =
+        spectral_processor_chain_initialize(number_of_stages);
+    self->channel_chains[k] = channel_chain;
+    if (!channel_chain) {
+      specbleach_chain_free(self);
+      return NULL;
+    }
+
+    for (uint32_t j = 0U; j < number_of_stages; j++) {
+      spectral_processor_chain_append(
+          channel_chain, self->stages[j].spectral_processing,
+          self->stages[j].spectral_processors[k]);
+    }
+  }
+
+  // Whatever didn't fit in caller memory came from the heap
+  if (is_memory_arena_exhausted(arena)) {
+    specbleach_chain_free(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+static bool get_processor_stage(const SpectralBleachChainStage *stage,
+                                ProcessorStage *processor_stage) {
+  switch (stage->type) {
+  case SPECBLEACH_PROCESSOR_DENOISER:
+    return get_denoiser_stage(stage->instance, processor_stage);
+  case SPECBLEACH_PROCESSOR_ADAPTIVE_DENOISER:
+    return get_adaptive_denoiser_stage(stage->instance, processor_stage);
+  default:
+    return false;
+  }
+}
+
+// Processors of a stage expect spectra of the size and hop they were built for
+static bool is_compatible_stage(const ProcessorStage *first,
+                                const ProcessorStage *stage) {
+  return stage->sample_rate == first->sample_rate &&
+         stage->number_of_channels == first->number_of_channels &&
+         stage->fft_size == first->fft_size &&
+         stage->transform_type == first->transform_type &&
+         stage->stft_settings.overlap_factor ==
+             first->stft_settings.overlap_factor;
+}
+
+void specbleach_chain_free(SpectralBleachChainHandle chain) {
+  SbSpectralChain *self = (SbSpectralChain *)chain;
+  MemoryArena *arena = self->arena;
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+
+  if (self->channel_chains) {
+    for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+      if (self->channel_chains[k]) {
+        spectral_processor_chain_free(
+            (SpectralProcessorChain *)self->channel_chains[k]);
+      }
+    }
+  }
+  if (self->stft_processor) {
+    stft_processor_free(self->stft_processor);
+  }
+
+  spectral_free(self->channel_chains);
+  spectral_free(self->stages);
+  spectral_free(self);
+
+  memory_arena_bind(previous_arena);
+  memory_arena_free(arena);
+}
+
+uint32_t specbleach_chain_get_latency(SpectralBleachChainHandle chain) {
+  SbSpectralChain *self = (SbSpectralChain *)chain;
+
+  uint32_t latency = get_stft_latency(self->stft_processor);
+  for (uint32_t k = 0U; k < self->number_of_stages; k++) {
+    latency += self->stages[k].delay;
+  }
+
+  return latency;
+}
+
+// Runs in the processing thread before any processing, so each instance takes
+// what was loaded from other threads and stages with nothing to do are skipped
+static void prepare_stages(SbSpectralChain *self) {
+  for (uint32_t k = 0U; k < self->number_of_stages; k++) {
+    const ProcessorStage *stage = &self->stages[k];
+    const bool enabled = stage->prepare(stage->instance);
+
+    for (uint32_t j = 0U; j < self->number_of_channels; j++) {
+      spectral_processor_chain_set_enabled(
+          (SpectralProcessorChain *)self->channel_chains[j], k, enabled);
+    }
+  }
+}
+
+bool specbleach_chain_process(SpectralBleachChainHandle chain,
+                              const uint32_t number_of_samples,
+                              const float *input, float *output) {
+  if (!chain || number_of_samples == 0 || !input || !output) {
+    return false;
+  }
+
+  SbSpectralChain *self = (SbSpectralChain *)chain;
+  REALTIME_SECTION_BEGIN();
+  prepare_stages(self);
+
+  const bool processed = stft_processor_run(
+      self->stft_processor, number_of_samples, input, output,
+      &spectral_processor_chain_run, self->channel_chains[0]);
+  REALTIME_SECTION_END();
+
+  return processed;
+}
+
+bool specbleach_chain_process_multichannel(SpectralBleachChainHandle chain,
+                                           const uint32_t number_of_channels,
+                                           const uint32_t number_of_frames,
+                                           const float *const *input,
+                                           float **output) {
+  if (!chain || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
+  SbSpectralChain *self = (SbSpectralChain *)chain;
+  REALTIME_SECTION_BEGIN();
+  prepare_stages(self);
+
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = stft_processor_run_multichannel(
+        self->stft_processor, number_of_frames, input, output,
+        &spectral_processor_chain_run, self->channel_chains);
+  }
+  REALTIME_SECTION_END();
+
+  return processed;
+}
+
+bool specbleach_chain_process_interleaved(SpectralBleachChainHandle chain,
+                                          const uint32_t number_of_channels,
+                                          const uint32_t number_of_frames,
+                                          const float *input, float *output) {
+  if (!chain || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
+  SbSpectralChain *self = (SbSpectralChain *)chain;
+  REALTIME_SECTION_BEGIN();
+  prepare_stages(self);
+
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = stft_processor_run_interleaved(
+        self->stft_processor, number_of_frames, input, output,
+        &spectral_processor_chain_run, self->channel_chains);
+  }
+  REALTIME_SECTION_END();
+
+  return processed;
+}
@@ -0,0 +1,44 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "../../include/specbleach_common.h"
+#include "../shared/stft/fft_plan_cache.h"
+
+bool specbleach_import_fft_wisdom_from_file(const char *file_name) {
+  return fft_import_wisdom_from_file(file_name);
+}
+
+bool specbleach_export_fft_wisdom_to_file(const char *file_name) {
+  return fft_export_wisdom_to_file(file_name);
+}
+
+bool specbleach_import_fft_wisdom_from_string(const char *wisdom) {
+  return fft_import_wisdom_from_string(wisdom);
+}
+
+char *specbleach_export_fft_wisdom_to_string(void) {
+  return fft_export_wisdom_to_string();
+}
+
+void specbleach_free_fft_wisdom_string(char *wisdom) {
+  fft_free_wisdom_string(wisdom);
+}
+
+void specbleach_forget_fft_wisdom(void) { fft_forget_wisdom(); }
@@ -20,55 +20,579 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../../include/specbleach_denoiser.h"
 #include "../shared/configurations.h"
+#include "../shared/noise_estimation/noise_estimator.h"
 #include "../shared/noise_estimation/noise_profile.h"
+#include "../shared/noise_estimation/noise_profile_record.h"
+#include "../shared/noise_estimation/noise_profile_resampler.h"
+#include "../shared/stft/multiresolution_stft.h"
 #include "../shared/stft/stft_processor.h"
+#include "../shared/utils/command_queue.h"
 #include "../shared/utils/general_utils.h"
+#include "../shared/utils/memory_arena.h"
+#include "../shared/utils/parameter_exchange.h"
+#include "../shared/utils/realtime_audit.h"
+#include "../shared/utils/reduction_telemetry.h"
+#include "../shared/utils/sample_converter.h"
+#include "../shared/utils/spectral_features.h"
+#include "../shared/utils/spectral_kernels.h"
+#include "../shared/utils/spectral_utils.h"
+#include "../shared/utils/stage_profiler.h"
+#include "../shared/utils/table_cache.h"
+#include "../shared/utils/thread_pool.h"
 #include "denoiser/spectral_denoiser.h"
+#ifdef SPECBLEACH_OPENCL
+#include "denoiser/accelerated_denoiser.h"
+#endif
+#include "processor_stage.h"
+#include "stft_settings.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Every channel has its own spectral denoiser. Linked channels share a single
+// noise profile, otherwise each channel learns its own. Multiresolution
+// instances have a single channel and a denoiser and profile for each band
 typedef struct SbSpectralDenoiser {
   uint32_t sample_rate;
+  float frame_size;
+  FftPlannerRigor planner_rigor;
+  uint32_t median_window_length;
+  uint32_t profile_window_length;
+  bool approximate_math;
+  bool skip_noise_frames;
+  StftSettings stft_settings;
+  // Hops transients are detected ahead of the frames reduced
+  uint32_t look_ahead_hops;
+  // Hops between estimations of the gains
+  uint32_t gain_update_interval;
+  uint32_t number_of_channels;
+  uint32_t number_of_profiles;
+  uint32_t number_of_processors;
   DenoiserParameters denoise_parameters;
+  // Parameters loaded from control threads, taken when processing starts
+  ParameterExchange *parameter_exchange;
+  // Commands posted from the control thread, applied at hop boundaries. The
+  // posted count belongs to the control thread and the applied ticket is
+  // written by the processing thread and read from any other
+  CommandQueue *command_queue;
+  uint64_t posted_commands;
+  uint64_t applied_command;
 
-  NoiseProfile *noise_profile;
-  SpectralProcessorHandle spectral_denoiser;
+  NoiseProfile **noise_profiles;
+  // Bins of the profile seen by the user, which multiresolution instances map
+  // onto the profile of each band
+  uint32_t profile_size;
+  // Copy of the first profile returned to the user
+  float *exported_noise_profile;
+  // Last learn mode used, or the one of the last loaded record, saved along
+  // the profile when serialized. Written and read from different threads
+  uint32_t profile_learn_mode;
+  SpectralProcessorHandle *spectral_denoisers;
   StftProcessor *stft_processor;
+  MultiresolutionStft *multiresolution;
+  // Converts samples of the integer and double process variants
+  SampleConverter *sample_converter;
+
+  job_runner runner;
+  void *runner_data;
+  ThreadPool *thread_pool;
+
+  // First profiler belongs to the STFT and the rest to each channel
+  StageProfiler **profilers;
+  // One for each processor
+  ReductionTelemetry **telemetries;
+  // Signals of the offline batches processed and how many of them were reduced
+  // on the device. Written by the caller of the batch and read from any thread
+  uint64_t offline_signals;
+  uint64_t accelerated_signals;
+
+  // Memory every buffer of the instance is carved from
+  MemoryArena *arena;
 } SbSpectralDenoiser;
 
+// Command as queued, along with the ticket returned when it was posted
+typedef struct SbQueuedCommand {
+  SpectralBleachCommand command;
+  uint64_t ticket;
+} SbQueuedCommand;
+
+// Offline processing splits every signal in the same number of segments and
+// runs one segment per job. Every job uses its own processing chain so
+// segments don't depend on each other
+typedef struct SbOfflineJob {
+  SbSpectralDenoiser *denoiser;
+  uint32_t segments_per_stream;
+  const uint32_t *number_of_samples;
+  const float *const *input;
+  float **output;
+  // Set by any job that couldn't build its processing chain
+  bool failed;
+} SbOfflineJob;
+
+// Batch learning splits the whole frames of the signal in one run of frames
+// per job. Every job learns a profile of its own, which are merged once all of
+// them finish
+typedef struct SbLearningJob {
+  SbSpectralDenoiser *denoiser;
+  NoiseEstimatorType learn_mode;
+  uint32_t number_of_samples;
+  uint32_t number_of_frames;
+  uint32_t segment_frames;
+  const float *input;
+  uint32_t profile_size;
+  float *profiles;
+  uint32_t *averaged_blocks;
+  // Set by any job that couldn't build its analysis
+  bool failed;
+} SbLearningJob;
+
+// Reference spectrum and noise estimation of a batch learning job
+typedef struct SbProfileLearner {
+  uint32_t fft_size;
+  NoiseEstimatorType learn_mode;
+  SpectralFeatures *spectral_features;
+  NoiseEstimator *noise_estimator;
+} SbProfileLearner;
+
+#ifdef SPECBLEACH_OPENCL
+// Accelerated batches analyze the frames of a dispatch of every stream, the
+// device reduces them and they are synthesized, each frame going through one
+// forward and one backward transform. Frames are laid out as in a single pass
+// of the STFT, starting as many samples before the signal as the frame
+// overlaps a hop. The transforms stay on the threads: FFT sizes follow the
+// frame time at any sample rate so they have any factors, which the planned
+// transforms handle and a device would need an FFT library for
+typedef struct SbAcceleratedStream {
+  StftProcessor *stft_processor;
+  // Padded input of the frames of the dispatch
+  float *input_block;
+  // Overlap-add of the frames of the dispatch. Its tail carries into the next
+  // one, whose frames start a block of hops later
+  float *output_block;
+  // Sample of the overlap-add where the block starts
+  uint64_t position;
+  uint64_t number_of_frames;
+  bool finished;
+  // Spectra of the stream in the dispatch, taken by the analysis and reduced
+  // in place by the device
+  float *spectra;
+  uint32_t fft_size;
+  uint32_t capacity;
+  uint32_t frames;
+  bool overflowed;
+} SbAcceleratedStream;
+
+// Streams go to the device in groups, each one a stream of every dispatch
+typedef struct SbAcceleratedBatch {
+  SbSpectralDenoiser *denoiser;
+  AcceleratedDenoiser *accelerator;
+  ThreadPool *thread_pool;
+  SbAcceleratedStream *streams;
+  float *spectra;
+  uint32_t *frames;
+  uint32_t fft_size;
+  uint32_t frame_size;
+  uint32_t hop;
+  uint32_t latency;
+  uint32_t group_size;
+  uint32_t first_stream;
+  uint32_t streams_in_group;
+  const uint32_t *number_of_samples;
+  const float *const *input;
+  float **output;
+} SbAcceleratedBatch;
+#endif
+
+static bool run_offline_jobs(SbSpectralDenoiser *self, uint32_t number_of_jobs,
+                             parallel_job job, void *job_data,
+                             uint32_t number_of_threads);
+static void process_offline_segment(void *instance, uint32_t job_index);
+#ifdef SPECBLEACH_OPENCL
+static bool process_offline_batch_accelerated(
+    SbSpectralDenoiser *self, uint32_t number_of_streams,
+    const uint32_t *number_of_samples, const float *const *input,
+    float **output, uint32_t number_of_threads);
+static bool initialize_accelerated_batch(SbAcceleratedBatch *batch,
+                                         uint32_t number_of_threads);
+static void free_accelerated_batch(SbAcceleratedBatch *batch);
+static bool run_accelerated_group(SbAcceleratedBatch *batch);
+static void run_accelerated_jobs(SbAcceleratedBatch *batch, parallel_job job);
+static void analyze_accelerated_stream(void *instance, uint32_t stream);
+static void synthesize_accelerated_stream(void *instance, uint32_t stream);
+static bool capture_spectrum(SpectralProcessorHandle instance,
+                             float *fft_spectrum);
+#endif
+static void learn_segment(void *instance, uint32_t segment);
+static bool learn_frame(SpectralProcessorHandle instance, float *fft_spectrum);
+static void merge_learned_profiles(const SbLearningJob *job,
+                                   uint32_t number_of_segments, float *profile,
+                                   uint32_t *averaged_blocks);
+static uint32_t get_look_ahead_hops(SbSpectralDenoiser *self,
+                                    const SpectralBleachInitOptions *options);
+static uint32_t get_look_ahead_delay(SbSpectralDenoiser *self);
+static StftProcessor *get_processor_stft(SbSpectralDenoiser *self,
+                                         uint32_t processor);
+static uint32_t get_processor_sample_rate(SbSpectralDenoiser *self,
+                                          uint32_t processor);
+static bool copy_user_noise_profile(SbSpectralDenoiser *self,
+                                    float *noise_profile,
+                                    uint32_t *averaged_blocks);
+static uint32_t get_user_frame_length(SbSpectralDenoiser *self);
+static uint32_t get_loaded_frame_length(SbSpectralDenoiser *self,
+                                        uint32_t profile_size);
+static bool load_noise_profile(SbSpectralDenoiser *self,
+                               const float *restored_profile,
+                               uint32_t profile_size,
+                               uint32_t profile_sample_rate,
+                               uint32_t profile_frame_length,
+                               uint32_t averaged_blocks);
+static void apply_pending_changes(SbSpectralDenoiser *self);
+static bool apply_queued_commands(SbSpectralDenoiser *self);
+static void apply_commands_at_hop(void *instance);
+static void apply_command(SbSpectralDenoiser *self,
+                          const SpectralBleachCommand *command);
+static void clear_noise_profiles(SbSpectralDenoiser *self);
+static DenoiserParameters
+convert_parameters(const SpectralBleachParameters *parameters);
+static void apply_parameters(SbSpectralDenoiser *self,
+                             const DenoiserParameters *parameters);
+static bool is_bypassed(SbSpectralDenoiser *self);
+static void update_bypass(SbSpectralDenoiser *self);
+static bool prepare_stage(void *instance);
+static bool process_converted(SpectralBleachHandle instance,
+                              uint32_t number_of_channels,
+                              uint32_t number_of_frames, SampleFormat format,
+                              const void *input, void *output);
+static bool process_planar_block(void *instance, uint32_t number_of_frames,
+                                 const float *const *input, float **output);
+static SbSpectralDenoiser *
+measure_instance(const SpectralBleachInitOptions *options, size_t *memory_size);
+static bool find_memory_size(const SpectralBleachInitOptions *options,
+                             size_t *memory_size);
+static SbSpectralDenoiser *
+initialize_in_arena(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena);
+static SbSpectralDenoiser *
+initialize_denoiser(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena);
+
 SpectralBleachHandle specbleach_initialize(const uint32_t sample_rate,
                                            float frame_size) {
+  SpectralBleachInitOptions options = {0};
+  options.sample_rate = sample_rate;
+  options.frame_size = frame_size;
+
+  return specbleach_initialize_ex(&options);
+}
+
+SpectralBleachHandle
+specbleach_initialize_ex(const SpectralBleachInitOptions *options) {
+  if (!options) {
+    return NULL;
+  }
+
+  // Layouts measured before skip the throwaway instance. Otherwise it holds
+  // the shared tables of the layout, so the instance built next finds them
+  // already computed
+  size_t memory_size = 0U;
+  SbSpectralDenoiser *measured = NULL;
+  if (!find_memory_size(options, &memory_size)) {
+    measured = measure_instance(options, &memory_size);
+    if (!measured) {
+      return NULL;
+    }
+  }
+
+  MemoryArena *arena = memory_arena_initialize_owned(memory_size);
+  SbSpectralDenoiser *self =
+      arena ? initialize_in_arena(options, arena) : NULL;
+  if (measured) {
+    specbleach_free(measured);
+  }
+
+  return self;
+}
+
+size_t
+specbleach_get_required_memory(const SpectralBleachInitOptions *options) {
+  if (!options) {
+    return 0U;
+  }
+
+  size_t memory_size = 0U;
+  if (find_memory_size(options, &memory_size)) {
+    return memory_size;
+  }
+
+  SbSpectralDenoiser *measured = measure_instance(options, &memory_size);
+  if (!measured) {
+    return 0U;
+  }
+  specbleach_free(measured);
+
+  return memory_size;
+}
+
+// Builds a throwaway instance from the heap adding up what it takes
+static SbSpectralDenoiser *
+measure_instance(const SpectralBleachInitOptions *options,
+                 size_t *memory_size) {
+  if (!options) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize_measuring();
+  if (!arena) {
+    return NULL;
+  }
+
+  SbSpectralDenoiser *self = initialize_in_arena(options, arena);
+  if (self) {
+    *memory_size = get_memory_arena_required_size(arena);
+
+    SpectralBleachInitOptions layout;
+    get_layout_options(&layout, options);
+    table_cache_store_size(DENOISER_INSTANCE, &layout, sizeof(layout),
+                           *memory_size);
+  }
+
+  return self;
+}
+
+static bool find_memory_size(const SpectralBleachInitOptions *options,
+                             size_t *memory_size) {
+  SpectralBleachInitOptions layout;
+  get_layout_options(&layout, options);
+
+  return table_cache_find_size(DENOISER_INSTANCE, &layout, sizeof(layout),
+                               memory_size);
+}
+
+SpectralBleachHandle
+specbleach_initialize_with_memory(const SpectralBleachInitOptions *options,
+                                  void *memory, const size_t memory_size) {
+  if (!options || !memory) {
+    return NULL;
+  }
+
+  MemoryArena *arena = memory_arena_initialize(memory, memory_size);
+  if (!arena) {
+    return NULL;
+  }
+
+  return initialize_in_arena(options, arena);
+}
+
+// Every module allocates from the arena bound to the thread while it is built
+static SbSpectralDenoiser *
+initialize_in_arena(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena) {
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+  SbSpectralDenoiser *self = initialize_denoiser(options, arena);
+  memory_arena_bind(previous_arena);
+
+  return self;
+}
+
+// Takes ownership of the arena, which gets released with the instance or
+// right away if building it fails
+static SbSpectralDenoiser *
+initialize_denoiser(const SpectralBleachInitOptions *options,
+                    MemoryArena *arena) {
+  // Pick the vectorized kernels for this cpu once before processing
+  spectral_kernels_initialize();
+
   SbSpectralDenoiser *self =
-      (SbSpectralDenoiser *)calloc(1U, sizeof(SbSpectralDenoiser));
+      (SbSpectralDenoiser *)spectral_calloc(1U, sizeof(SbSpectralDenoiser));
+  if (!self) {
+    memory_arena_free(arena);
+    return NULL;
+  }
+
+  self->arena = arena;
+
+  const uint32_t sample_rate = options->sample_rate;
+  const float frame_size = options->frame_size;
+  const FftPlannerRigor planner_rigor =
+      (FftPlannerRigor)options->planner_rigor;
 
   self->sample_rate = sample_rate;
+  self->frame_size = frame_size;
+  self->planner_rigor = planner_rigor;
+  self->median_window_length = options->median_window_length;
+  self->profile_window_length = options->profile_window_length > 0U
+                                    ? options->profile_window_length
+                                    : NOISE_PROFILE_WINDOW_LENGTH;
+  self->approximate_math = options->approximate_math;
+  self->skip_noise_frames = options->skip_noise_frames;
+  self->gain_update_interval =
+      options->gain_update_interval > 1U ? options->gain_update_interval : 1U;
+  if (self->gain_update_interval > MAXIMUM_GAIN_UPDATE_INTERVAL) {
+    self->gain_update_interval = MAXIMUM_GAIN_UPDATE_INTERVAL;
+  }
+  self->stft_settings = (StftSettings){
+      .overlap_factor = OVERLAP_FACTOR_GENERAL,
+      .padding_type = PADDING_CONFIGURATION_GENERAL,
+      .zeropadding_amount = ZEROPADDING_AMOUNT_GENERAL,
+      .input_window = INPUT_WINDOW_TYPE_GENERAL,
+      .output_window = OUTPUT_WINDOW_TYPE_GENERAL,
+  };
+  self->number_of_channels =
+      options->number_of_channels > 0U ? options->number_of_channels : 1U;
+  self->number_of_profiles =
+      options->link_channels ? 1U : self->number_of_channels;
+  self->number_of_processors = self->number_of_channels;
+
+  // Bands of a multiresolution instance are only split from a single channel
+  const bool multiresolution =
+      options->multiresolution && self->number_of_channels == 1U;
+  if (multiresolution) {
+    self->number_of_profiles = 2U;
+    self->number_of_processors = 2U;
+  }
 
-  self->stft_processor = stft_processor_initialize(
-      sample_rate, frame_size, OVERLAP_FACTOR_GENERAL,
-      PADDING_CONFIGURATION_GENERAL, ZEROPADDING_AMOUNT_GENERAL,
-      INPUT_WINDOW_TYPE_GENERAL, OUTPUT_WINDOW_TYPE_GENERAL);
+  self->parameter_exchange =
+      parameter_exchange_initialize(sizeof(DenoiserParameters));
+  self->command_queue = command_queue_initialize(sizeof(SbQueuedCommand),
+                                                 COMMAND_QUEUE_CAPACITY);
+  self->noise_profiles = (NoiseProfile **)spectral_calloc(
+      self->number_of_profiles, sizeof(NoiseProfile *));
+  self->spectral_denoisers = (SpectralProcessorHandle *)spectral_calloc(
+      self->number_of_processors, sizeof(SpectralProcessorHandle));
 
-  if (!self->stft_processor) {
+  if (!resolve_stft_settings(&self->stft_settings, options) ||
+      multiresolution != options->multiresolution) {
     specbleach_free(self);
     return NULL;
   }
 
-  const uint32_t fft_size = get_stft_fft_size(self->stft_processor);
-  const uint32_t real_spectrum_size =
-      get_stft_real_spectrum_size(self->stft_processor);
+  const StftSettings *stft_settings = &self->stft_settings;
+  if (multiresolution) {
+    self->multiresolution = multiresolution_stft_initialize(
+        sample_rate, frame_size,
+        options->crossover_frequency > 0.F ? options->crossover_frequency
+                                           : MULTIRESOLUTION_CROSSOVER,
+        stft_settings->overlap_factor, stft_settings->padding_type,
+        stft_settings->zeropadding_amount, stft_settings->input_window,
+        stft_settings->output_window, stft_settings->low_latency,
+        FFT_TRANSFORM_TYPE_GENERAL, planner_rigor, true);
+  } else {
+    self->stft_processor = stft_processor_initialize(
+        sample_rate, frame_size, stft_settings->overlap_factor,
+        stft_settings->padding_type, stft_settings->zeropadding_amount,
+        stft_settings->input_window, stft_settings->output_window,
+        stft_settings->low_latency, FFT_TRANSFORM_TYPE_GENERAL, planner_rigor,
+        self->number_of_channels);
+  }
 
-  self->noise_profile = noise_profile_initialize(real_spectrum_size);
+  if (!self->stft_processor && !self->multiresolution) {
+    specbleach_free(self);
+    return NULL;
+  }
 
-  if (!self->noise_profile) {
+  if (self->stft_processor && stft_settings->spread_processing &&
+      !stft_processor_enable_spread_processing(self->stft_processor)) {
     specbleach_free(self);
     return NULL;
   }
 
-  self->spectral_denoiser = spectral_denoiser_initialize(
-      self->sample_rate, fft_size, OVERLAP_FACTOR_GENERAL, self->noise_profile);
+  if (self->stft_processor) {
+    self->look_ahead_hops = get_look_ahead_hops(self, options);
+  }
+
+  if (options->job_runner) {
+    self->runner = options->job_runner;
+    self->runner_data = options->job_runner_data;
+  } else if (options->number_of_threads > 1U &&
+             self->number_of_channels > 1U &&
+             !is_bound_memory_arena_measuring()) {
+    // The pool lives outside the arena and a measured instance never runs
+    self->thread_pool = thread_pool_initialize(options->number_of_threads);
+
+    if (!self->thread_pool) {
+      specbleach_free(self);
+      return NULL;
+    }
+
+    self->runner = &thread_pool_run;
+    self->runner_data = self->thread_pool;
+  }
+  if (self->stft_processor) {
+    stft_processor_set_job_runner(self->stft_processor, self->runner,
+                                  self->runner_data);
+    stft_processor_set_hop_callback(self->stft_processor,
+                                    &apply_commands_at_hop, self);
+  }
+
+  self->sample_converter =
+      sample_converter_initialize(self->number_of_channels);
+
+  self->profile_size =
+      self->multiresolution
+          ? get_multiresolution_reference_spectrum_size(self->multiresolution)
+          : get_stft_real_spectrum_size(self->stft_processor);
+  self->exported_noise_profile =
+      (float *)spectral_calloc(self->profile_size, sizeof(float));
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    self->noise_profiles[k] = noise_profile_initialize(
+        get_stft_real_spectrum_size(get_processor_stft(self, k)));
+
+    if (!self->noise_profiles[k]) {
+      specbleach_free(self);
+      return NULL;
+    }
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    self->spectral_denoisers[k] = spectral_denoiser_initialize(
+        get_processor_sample_rate(self, k),
+        get_stft_fft_size(get_processor_stft(self, k)),
+        stft_settings->overlap_factor,
+        self->noise_profiles[k % self->number_of_profiles], planner_rigor,
+        self->median_window_length, self->profile_window_length,
+        self->approximate_math, self->skip_noise_frames);
+
+    if (!self->spectral_denoisers[k] ||
+        (self->look_ahead_hops > 0U &&
+         !spectral_denoiser_enable_look_ahead(self->spectral_denoisers[k],
+                                              self->look_ahead_hops)) ||
+        !spectral_denoiser_set_gain_update_interval(
+            self->spectral_denoisers[k], self->gain_update_interval)) {
+      specbleach_free(self);
+      return NULL;
+    }
+  }
+
+  self->telemetries = (ReductionTelemetry **)spectral_calloc(
+      self->number_of_processors, sizeof(ReductionTelemetry *));
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    self->telemetries[k] = reduction_telemetry_initialize(
+        get_processor_sample_rate(self, k),
+        get_stft_hop(get_processor_stft(self, k)));
+    spectral_denoiser_set_telemetry(self->spectral_denoisers[k],
+                                    self->telemetries[k]);
+  }
+
+#ifdef SPECBLEACH_PROFILING
+  self->profilers = (StageProfiler **)spectral_calloc(
+      self->number_of_processors + 1U, sizeof(StageProfiler *));
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    self->profilers[k] = stage_profiler_initialize();
+  }
+  if (self->multiresolution) {
+    multiresolution_stft_set_profiler(self->multiresolution,
+                                      self->profilers[0]);
+  } else {
+    stft_processor_set_profiler(self->stft_processor, self->profilers[0]);
+  }
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    spectral_denoiser_set_profiler(self->spectral_denoisers[k],
+                                   self->profilers[k + 1U]);
+  }
+#endif
 
-  if (!self->spectral_denoiser) {
+  // Whatever didn't fit in caller memory came from the heap
+  if (is_memory_arena_exhausted(arena)) {
     specbleach_free(self);
     return NULL;
   }
@@ -76,118 +600,1755 @@ SpectralBleachHandle specbleach_initialize(const uint32_t sample_rate,
   return self;
 }
 
+static uint32_t get_look_ahead_hops(SbSpectralDenoiser *self,
+                                    const SpectralBleachInitOptions *options) {
+  if (!(options->transient_look_ahead > 0.F)) {
+    return 0U;
+  }
+
+  const float look_ahead_samples =
+      (options->transient_look_ahead / 1000.F) * (float)self->sample_rate;
+  const float hops =
+      floorf(look_ahead_samples / (float)get_stft_hop(self->stft_processor));
+
+  return hops < (float)MAXIMUM_LOOK_AHEAD_HOPS ? (uint32_t)hops
+                                               : MAXIMUM_LOOK_AHEAD_HOPS;
+}
+
+static StftProcessor *get_processor_stft(SbSpectralDenoiser *self,
+                                         const uint32_t processor) {
+  if (self->multiresolution) {
+    return get_multiresolution_band(self->multiresolution,
+                                    (MultiresolutionBand)processor);
+  }
+
+  return self->stft_processor;
+}
+
+static uint32_t get_processor_sample_rate(SbSpectralDenoiser *self,
+                                          const uint32_t processor) {
+  if (self->multiresolution) {
+    return get_multiresolution_band_sample_rate(
+        self->multiresolution, (MultiresolutionBand)processor);
+  }
+
+  return self->sample_rate;
+}
+
 void specbleach_free(SpectralBleachHandle instance) {
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  MemoryArena *arena = self->arena;
+  MemoryArena *previous_arena = memory_arena_bind(arena);
+
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    if (self->noise_profiles[k]) {
+      noise_profile_free(self->noise_profiles[k]);
+    }
+  }
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    if (self->spectral_denoisers[k]) {
+      spectral_denoiser_free(self->spectral_denoisers[k]);
+    }
+  }
+  if (self->profilers) {
+    for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+      stage_profiler_free(self->profilers[k]);
+    }
+    spectral_free(self->profilers);
+  }
+  if (self->telemetries) {
+    for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+      reduction_telemetry_free(self->telemetries[k]);
+    }
+    spectral_free(self->telemetries);
+  }
+  if (self->thread_pool) {
+    thread_pool_free(self->thread_pool);
+  }
+  if (self->stft_processor) {
+    stft_processor_free(self->stft_processor);
+  }
+  if (self->multiresolution) {
+    multiresolution_stft_free(self->multiresolution);
+  }
+  if (self->sample_converter) {
+    sample_converter_free(self->sample_converter);
+  }
+
+  if (self->parameter_exchange) {
+    parameter_exchange_free(self->parameter_exchange);
+  }
+  if (self->command_queue) {
+    command_queue_free(self->command_queue);
+  }
+
+  spectral_free(self->noise_profiles);
+  spectral_free(self->exported_noise_profile);
+  spectral_free(self->spectral_denoisers);
+  spectral_free(self);
+
+  memory_arena_bind(previous_arena);
+  memory_arena_free(arena);
+}
+
+bool specbleach_reset(SpectralBleachHandle instance,
+                      const bool keep_noise_profile) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  if (!keep_noise_profile) {
+    specbleach_reset_noise_profile(instance);
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    spectral_denoiser_reset(self->spectral_denoisers[k]);
+  }
 
-  noise_profile_free(self->noise_profile);
-  spectral_denoiser_free(self->spectral_denoiser);
-  stft_processor_free(self->stft_processor);
+  if (self->multiresolution) {
+    return multiresolution_stft_reset(self->multiresolution);
+  }
 
-  free(self);
+  return stft_processor_reset(self->stft_processor);
 }
 
 uint32_t specbleach_get_latency(SpectralBleachHandle instance) {
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
 
-  return get_stft_latency(self->stft_processor);
+  if (self->multiresolution) {
+    return get_multiresolution_latency(self->multiresolution);
+  }
+
+  return get_stft_latency(self->stft_processor) + get_look_ahead_delay(self);
 }
 
-bool specbleach_process(SpectralBleachHandle instance,
-                        const uint32_t number_of_samples, const float *input,
-                        float *output) {
-  if (!instance || number_of_samples == 0 || !input || !output) {
+// Samples the spectral denoisers delay their frames by on top of the STFT
+static uint32_t get_look_ahead_delay(SbSpectralDenoiser *self) {
+  if (self->look_ahead_hops == 0U) {
+    return 0U;
+  }
+
+  return self->look_ahead_hops * get_stft_hop(self->stft_processor);
+}
+
+bool get_denoiser_stage(void *instance, ProcessorStage *stage) {
+  if (!instance || !stage) {
     return false;
   }
 
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  if (self->multiresolution) {
+    return false;
+  }
 
-  stft_processor_run(self->stft_processor, number_of_samples, input, output,
-                     &spectral_denoiser_run, self->spectral_denoiser);
+  *stage = (ProcessorStage){
+      .sample_rate = self->sample_rate,
+      .frame_size = self->frame_size,
+      .number_of_channels = self->number_of_channels,
+      .fft_size = get_stft_fft_size(self->stft_processor),
+      .planner_rigor = self->planner_rigor,
+      .transform_type = FFT_TRANSFORM_TYPE_GENERAL,
+      .stft_settings = self->stft_settings,
+      .spectral_processing = &spectral_denoiser_run,
+      .spectral_processors = self->spectral_denoisers,
+      .delay = get_look_ahead_delay(self),
+      .prepare = &prepare_stage,
+      .instance = self,
+  };
 
   return true;
 }
 
-uint32_t specbleach_get_noise_profile_size(SpectralBleachHandle instance) {
+static bool prepare_stage(void *instance) {
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
 
-  return get_noise_profile_size(self->noise_profile);
+  apply_pending_changes(self);
+
+  return !is_bypassed(self);
 }
 
-uint32_t
-specbleach_get_noise_profile_blocks_averaged(SpectralBleachHandle instance) {
+bool specbleach_process(SpectralBleachHandle instance,
+                        const uint32_t number_of_samples, const float *input,
+                        float *output) {
+  if (!instance || number_of_samples == 0 || !input || !output) {
+    return false;
+  }
+
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_changes(self);
+
+  bool processed = false;
+  if (self->multiresolution) {
+    processed = multiresolution_stft_run(
+        self->multiresolution, number_of_samples, input, output,
+        &spectral_denoiser_run, self->spectral_denoisers[LOW_BAND],
+        self->spectral_denoisers[HIGH_BAND]);
+  } else {
+    processed = stft_processor_run(self->stft_processor, number_of_samples,
+                                   input, output, &spectral_denoiser_run,
+                                   self->spectral_denoisers[0]);
+  }
+  REALTIME_SECTION_END();
 
-  return get_noise_profile_blocks_averaged(self->noise_profile);
+  return processed;
 }
 
-float *specbleach_get_noise_profile(SpectralBleachHandle instance) {
+bool specbleach_process_multichannel(SpectralBleachHandle instance,
+                                     const uint32_t number_of_channels,
+                                     const uint32_t number_of_frames,
+                                     const float *const *input,
+                                     float **output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
+    return false;
+  }
+
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_changes(self);
 
-  return get_noise_profile(self->noise_profile);
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = self->multiresolution
+                    ? specbleach_process(instance, number_of_frames, input[0],
+                                         output[0])
+                    : stft_processor_run_multichannel(
+                          self->stft_processor, number_of_frames, input,
+                          output, &spectral_denoiser_run,
+                          self->spectral_denoisers);
+  }
+  REALTIME_SECTION_END();
+
+  return processed;
 }
 
-bool specbleach_load_noise_profile(SpectralBleachHandle instance,
-                                   const float *restored_profile,
-                                   const uint32_t profile_size,
-                                   const uint32_t averaged_blocks) {
-  if (!instance || !restored_profile) {
+bool specbleach_process_interleaved(SpectralBleachHandle instance,
+                                    const uint32_t number_of_channels,
+                                    const uint32_t number_of_frames,
+                                    const float *input, float *output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
     return false;
   }
 
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  REALTIME_SECTION_BEGIN();
+  apply_pending_changes(self);
 
-  if (profile_size != get_noise_profile_size(self->noise_profile)) {
-    return false;
+  // A single channel is already interleaved
+  bool processed = false;
+  if (number_of_channels == self->number_of_channels) {
+    processed = self->multiresolution
+                    ? specbleach_process(instance, number_of_frames, input,
+                                         output)
+                    : stft_processor_run_interleaved(
+                          self->stft_processor, number_of_frames, input,
+                          output, &spectral_denoiser_run,
+                          self->spectral_denoisers);
   }
+  REALTIME_SECTION_END();
 
-  set_noise_profile(self->noise_profile, restored_profile, profile_size,
-                    averaged_blocks);
+  return processed;
+}
 
-  return true;
+bool specbleach_process_s16(SpectralBleachHandle instance,
+                            const uint32_t number_of_samples,
+                            const int16_t *input, int16_t *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_S16,
+                           input, output);
 }
 
-bool specbleach_reset_noise_profile(SpectralBleachHandle instance) {
-  if (!instance) {
+bool specbleach_process_s32(SpectralBleachHandle instance,
+                            const uint32_t number_of_samples,
+                            const int32_t *input, int32_t *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_S32,
+                           input, output);
+}
+
+bool specbleach_process_f64(SpectralBleachHandle instance,
+                            const uint32_t number_of_samples,
+                            const double *input, double *output) {
+  return process_converted(instance, 1U, number_of_samples, SAMPLE_FORMAT_F64,
+                           input, output);
+}
+
+bool specbleach_process_interleaved_s16(SpectralBleachHandle instance,
+                                        const uint32_t number_of_channels,
+                                        const uint32_t number_of_frames,
+                                        const int16_t *input, int16_t *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_S16, input, output);
+}
+
+bool specbleach_process_interleaved_s32(SpectralBleachHandle instance,
+                                        const uint32_t number_of_channels,
+                                        const uint32_t number_of_frames,
+                                        const int32_t *input, int32_t *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_S32, input, output);
+}
+
+bool specbleach_process_interleaved_f64(SpectralBleachHandle instance,
+                                        const uint32_t number_of_channels,
+                                        const uint32_t number_of_frames,
+                                        const double *input, double *output) {
+  return process_converted(instance, number_of_channels, number_of_frames,
+                           SAMPLE_FORMAT_F64, input, output);
+}
+
+static bool process_converted(SpectralBleachHandle instance,
+                              const uint32_t number_of_channels,
+                              const uint32_t number_of_frames,
+                              const SampleFormat format, const void *input,
+                              void *output) {
+  if (!instance || number_of_frames == 0 || !input || !output) {
     return false;
   }
 
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  if (number_of_channels != self->number_of_channels) {
+    return false;
+  }
 
-  reset_noise_profile(self->noise_profile);
+  REALTIME_SECTION_BEGIN();
+  const bool processed =
+      sample_converter_run(self->sample_converter, number_of_frames, format,
+                           input, output, &process_planar_block, self);
+  REALTIME_SECTION_END();
 
-  return true;
+  return processed;
 }
 
-bool specbleach_noise_profile_available(SpectralBleachHandle instance) {
+// Blocks are converted a few hundred frames at a time, each going through the
+// float path as if the host had called with it
+static bool process_planar_block(void *instance,
+                                 const uint32_t number_of_frames,
+                                 const float *const *input, float **output) {
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
 
-  return is_noise_estimation_available(self->noise_profile);
+  return specbleach_process_multichannel(instance, self->number_of_channels,
+                                         number_of_frames, input, output);
 }
 
-bool specbleach_load_parameters(SpectralBleachHandle instance,
-                                SpectralBleachParameters parameters) {
-  if (!instance) {
+bool specbleach_process_offline(SpectralBleachHandle instance,
+                                const uint32_t number_of_samples,
+                                const float *input, float *output,
+                                const uint32_t number_of_threads) {
+  return specbleach_process_offline_batch(instance, 1U, &number_of_samples,
+                                          &input, &output, number_of_threads);
+}
+
+bool specbleach_process_offline_batch(SpectralBleachHandle instance,
+                                      const uint32_t number_of_streams,
+                                      const uint32_t *number_of_samples,
+                                      const float *const *input,
+                                      float **output,
+                                      const uint32_t number_of_threads) {
+  if (!instance || number_of_streams == 0U || !number_of_samples || !input ||
+      !output) {
     return false;
   }
 
+  for (uint32_t stream = 0U; stream < number_of_streams; stream++) {
+    if (number_of_samples[stream] == 0U || !input[stream] || !output[stream] ||
+        input[stream] == output[stream]) {
+      return false;
+    }
+  }
+
   SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  apply_pending_changes(self);
 
-  // clang-format off
-  self->denoise_parameters = (DenoiserParameters){
-      .learn_noise = parameters.learn_noise,
-      .residual_listen = parameters.residual_listen,
-      .transient_protection = parameters.transient_protection,
-      .noise_scaling_type = parameters.noise_scaling_type,
-      .reduction_amount =
-          from_db_to_coefficient(parameters.reduction_amount * -1.F),
-      .noise_rescale = from_db_to_coefficient(parameters.noise_rescale),
-      .smoothing_factor = remap_percentage_log_like_unity(parameters.smoothing_factor / 100.F),
-      .whitening_factor = parameters.whitening_factor / 100.F,
-      .post_filter_threshold = from_db_to_coefficient(parameters.post_filter_threshold),
+  // Gains only depend on the current frame with a fixed profile
+  if (self->number_of_channels != 1U || self->multiresolution ||
+      self->denoise_parameters.learn_noise != 0 ||
+      !is_noise_estimation_available(self->noise_profiles[0])) {
+    return false;
+  }
+
+#ifdef SPECBLEACH_OPENCL
+  // Batches the device can't reduce go to the threads instead
+  if (process_offline_batch_accelerated(self, number_of_streams,
+                                        number_of_samples, input, output,
+                                        number_of_threads)) {
+    __atomic_fetch_add(&self->offline_signals, number_of_streams,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&self->accelerated_signals, number_of_streams,
+                       __ATOMIC_RELAXED);
+    return true;
+  }
+#endif
+
+  // Streams are only split when there are fewer of them than threads, since
+  // every segment pays for a warm up
+  const uint32_t threads = number_of_threads > 1U ? number_of_threads : 1U;
+  const uint32_t segments_per_stream =
+      threads > number_of_streams
+          ? (threads + number_of_streams - 1U) / number_of_streams
+          : 1U;
+
+  SbOfflineJob job = (SbOfflineJob){
+      .denoiser = self,
+      .segments_per_stream = segments_per_stream,
+      .number_of_samples = number_of_samples,
+      .input = input,
+      .output = output,
+      .failed = false,
   };
-  // clang-format on
 
-  load_reduction_parameters(self->spectral_denoiser, self->denoise_parameters);
+  // Jobs have all finished once the runner returns
+  if (!run_offline_jobs(self, number_of_streams * segments_per_stream,
+                        &process_offline_segment, &job, number_of_threads) ||
+      __atomic_load_n(&job.failed, __ATOMIC_RELAXED)) {
+    return false;
+  }
+
+  __atomic_fetch_add(&self->offline_signals, number_of_streams,
+                     __ATOMIC_RELAXED);
+
+  return true;
+}
+
+// Runs jobs on the job runner of the instance or on a thread pool that lives
+// as long as the call
+static bool run_offline_jobs(SbSpectralDenoiser *self,
+                             const uint32_t number_of_jobs, parallel_job job,
+                             void *job_data, const uint32_t number_of_threads) {
+  if (number_of_jobs == 1U) {
+    job(job_data, 0U);
+  } else if (self->runner) {
+    self->runner(self->runner_data, number_of_jobs, job, job_data);
+  } else {
+    ThreadPool *thread_pool = thread_pool_initialize(number_of_threads);
+
+    if (!thread_pool) {
+      return false;
+    }
+
+    thread_pool_run(thread_pool, number_of_jobs, job, job_data);
+    thread_pool_free(thread_pool);
+  }
 
   return true;
-}
\ No newline at end of file
+}
+
+// Each segment starts processing some time earlier, on a hop boundary so the
+// frames match the ones of a single pass, and continues until the latency is
+// flushed. Output is latency compensated
+static void process_offline_segment(void *instance, const uint32_t job_index) {
+  SbOfflineJob *job = (SbOfflineJob *)instance;
+  SbSpectralDenoiser *self = job->denoiser;
+
+  const uint32_t stream = job_index / job->segments_per_stream;
+  const uint32_t segment = job_index % job->segments_per_stream;
+  const uint32_t number_of_samples = job->number_of_samples[stream];
+  const float *input = job->input[stream];
+  float *output = job->output[stream];
+
+  const uint32_t segment_size =
+      (number_of_samples + job->segments_per_stream - 1U) /
+      job->segments_per_stream;
+  const uint32_t segment_start = segment * segment_size;
+  if (segment_start >= number_of_samples) {
+    return;
+  }
+  const uint32_t segment_end = number_of_samples - segment_start < segment_size
+                                   ? number_of_samples
+                                   : segment_start + segment_size;
+
+  const StftSettings *stft_settings = &self->stft_settings;
+  StftProcessor *stft_processor = stft_processor_initialize(
+      self->sample_rate, self->frame_size, stft_settings->overlap_factor,
+      stft_settings->padding_type, stft_settings->zeropadding_amount,
+      stft_settings->input_window, stft_settings->output_window,
+      stft_settings->low_latency, FFT_TRANSFORM_TYPE_GENERAL,
+      self->planner_rigor, 1U);
+  if (!stft_processor) {
+    __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    return;
+  }
+  SpectralProcessorHandle spectral_denoiser = spectral_denoiser_initialize(
+      self->sample_rate, get_stft_fft_size(stft_processor),
+      stft_settings->overlap_factor, self->noise_profiles[0],
+      self->planner_rigor, self->median_window_length,
+      self->profile_window_length, self->approximate_math,
+      self->skip_noise_frames);
+
+  const uint32_t latency =
+      get_stft_latency(stft_processor) + get_look_ahead_delay(self);
+  const uint32_t hop = get_stft_hop(stft_processor);
+  const uint32_t block_size = latency + hop;
+  float *input_block = (float *)calloc(block_size, sizeof(float));
+  float *output_block = (float *)calloc(block_size, sizeof(float));
+
+  if (!spectral_denoiser || !input_block || !output_block ||
+      (self->look_ahead_hops > 0U &&
+       !spectral_denoiser_enable_look_ahead(spectral_denoiser,
+                                            self->look_ahead_hops)) ||
+      !spectral_denoiser_set_gain_update_interval(
+          spectral_denoiser, self->gain_update_interval)) {
+    __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    free(input_block);
+    free(output_block);
+    if (spectral_denoiser) {
+      spectral_denoiser_free(spectral_denoiser);
+    }
+    stft_processor_free(stft_processor);
+    return;
+  }
+  load_reduction_parameters(spectral_denoiser, self->denoise_parameters);
+
+  const uint32_t warmup =
+      (uint32_t)((OFFLINE_WARMUP_TIME / 1000.F) * (float)self->sample_rate);
+  uint32_t position =
+      segment_start > warmup ? ((segment_start - warmup) / hop) * hop : 0U;
+  const uint32_t end_position = segment_end + latency;
+
+  while (position < end_position) {
+    const uint32_t samples = end_position - position < block_size
+                                 ? end_position - position
+                                 : block_size;
+
+    for (uint32_t k = 0U; k < samples; k++) {
+      input_block[k] =
+          position + k < number_of_samples ? input[position + k] : 0.F;
+    }
+
+    stft_processor_run(stft_processor, samples, input_block, output_block,
+                       &spectral_denoiser_run, spectral_denoiser);
+
+    for (uint32_t k = 0U; k < samples; k++) {
+      const uint32_t output_position = position + k;
+      if (output_position >= segment_start + latency &&
+          output_position < end_position) {
+        output[output_position - latency] = output_block[k];
+      }
+    }
+
+    position += samples;
+  }
+
+  free(input_block);
+  free(output_block);
+  spectral_denoiser_free(spectral_denoiser);
+  stft_processor_free(stft_processor);
+}
+
+#ifdef SPECBLEACH_OPENCL
+// Returns false when the device can't run the batch, or fails while running
+// it, so the threads process it from the start
+static bool process_offline_batch_accelerated(
+    SbSpectralDenoiser *self, const uint32_t number_of_streams,
+    const uint32_t *number_of_samples, const float *const *input,
+    float **output, const uint32_t number_of_threads) {
+  const uint32_t fft_size = get_stft_fft_size(self->stft_processor);
+  if (self->look_ahead_hops > 0U || self->gain_update_interval != 1U ||
+      self->skip_noise_frames ||
+      !is_accelerated_reduction_supported(self->denoise_parameters,
+                                          fft_size)) {
+    return false;
+  }
+
+  const uint32_t streams_per_dispatch =
+      ACCELERATOR_DISPATCH_SPECTRA / ACCELERATOR_DISPATCH_HOPS;
+  SbAcceleratedBatch batch = (SbAcceleratedBatch){
+      .denoiser = self,
+      .fft_size = fft_size,
+      .frame_size = get_stft_frame_size(self->stft_processor),
+      .hop = get_stft_hop(self->stft_processor),
+      .latency = get_stft_latency(self->stft_processor),
+      .group_size = number_of_streams < streams_per_dispatch
+                        ? number_of_streams
+                        : streams_per_dispatch,
+      .number_of_samples = number_of_samples,
+      .input = input,
+      .output = output,
+  };
+
+  bool processed = initialize_accelerated_batch(&batch, number_of_threads);
+  for (uint32_t first_stream = 0U;
+       processed && first_stream < number_of_streams;
+       first_stream += batch.group_size) {
+    batch.first_stream = first_stream;
+    batch.streams_in_group = number_of_streams - first_stream < batch.group_size
+                                 ? number_of_streams - first_stream
+                                 : batch.group_size;
+    processed = run_accelerated_group(&batch);
+  }
+
+  free_accelerated_batch(&batch);
+
+  return processed;
+}
+
+static bool initialize_accelerated_batch(SbAcceleratedBatch *batch,
+                                         const uint32_t number_of_threads) {
+  SbSpectralDenoiser *self = batch->denoiser;
+  const uint32_t hops = ACCELERATOR_DISPATCH_HOPS;
+
+  // Without a device nothing else is worth building
+  batch->accelerator = accelerated_denoiser_initialize(
+      self->sample_rate, batch->fft_size, batch->hop, batch->group_size, hops);
+  if (!batch->accelerator) {
+    return false;
+  }
+
+  batch->streams = (SbAcceleratedStream *)calloc(batch->group_size,
+                                                 sizeof(SbAcceleratedStream));
+  batch->spectra = (float *)calloc(
+      (size_t)batch->group_size * hops * batch->fft_size, sizeof(float));
+  batch->frames = (uint32_t *)calloc(batch->group_size, sizeof(uint32_t));
+  if (!batch->streams || !batch->spectra || !batch->frames) {
+    return false;
+  }
+
+  if (!self->runner && number_of_threads > 1U) {
+    batch->thread_pool = thread_pool_initialize(number_of_threads);
+    if (!batch->thread_pool) {
+      return false;
+    }
+  }
+
+  // Frames of a dispatch span its hops and the overlap of the last one
+  const StftSettings *stft_settings = &self->stft_settings;
+  const uint32_t block_size = (hops - 1U) * batch->hop + batch->frame_size;
+  for (uint32_t k = 0U; k < batch->group_size; k++) {
+    SbAcceleratedStream *stream = &batch->streams[k];
+    stream->stft_processor = stft_processor_initialize(
+        self->sample_rate, self->frame_size, stft_settings->overlap_factor,
+        stft_settings->padding_type, stft_settings->zeropadding_amount,
+        stft_settings->input_window, stft_settings->output_window,
+        stft_settings->low_latency, FFT_TRANSFORM_TYPE_GENERAL,
+        self->planner_rigor, 1U);
+    stream->input_block = (float *)calloc(block_size, sizeof(float));
+    stream->output_block = (float *)calloc(block_size, sizeof(float));
+    stream->spectra = &batch->spectra[(size_t)k * hops * batch->fft_size];
+    stream->fft_size = batch->fft_size;
+    stream->capacity = hops;
+
+    if (!stream->stft_processor || !stream->input_block ||
+        !stream->output_block) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void free_accelerated_batch(SbAcceleratedBatch *batch) {
+  if (batch->streams) {
+    for (uint32_t k = 0U; k < batch->group_size; k++) {
+      SbAcceleratedStream *stream = &batch->streams[k];
+      if (stream->stft_processor) {
+        stft_processor_free(stream->stft_processor);
+      }
+      free(stream->input_block);
+      free(stream->output_block);
+    }
+  }
+
+  if (batch->thread_pool) {
+    thread_pool_free(batch->thread_pool);
+  }
+  if (batch->accelerator) {
+    accelerated_denoiser_free(batch->accelerator);
+  }
+  free(batch->streams);
+  free(batch->spectra);
+  free(batch->frames);
+}
+
+// Every stream of the group takes a block of hops, the device reduces the
+// spectra of all of them and the blocks are synthesized, until every stream
+// output its last sample. The frames of a stream are the ones a single pass
+// of the STFT computes while it flushes its latency, so the output is the same
+// latency compensated output
+static bool run_accelerated_group(SbAcceleratedBatch *batch) {
+  SbSpectralDenoiser *self = batch->denoiser;
+  const size_t block_size =
+      (size_t)(ACCELERATOR_DISPATCH_HOPS - 1U) * batch->hop + batch->frame_size;
+
+  for (uint32_t k = 0U; k < batch->streams_in_group; k++) {
+    SbAcceleratedStream *stream = &batch->streams[k];
+    const uint64_t number_of_samples =
+        batch->number_of_samples[batch->first_stream + k];
+    memset(stream->output_block, 0, block_size * sizeof(float));
+    stream->position = 0U;
+    stream->number_of_frames =
+        (number_of_samples + batch->latency) / batch->hop;
+    stream->finished = false;
+    stream->frames = 0U;
+    stream->overflowed = false;
+  }
+
+  if (!accelerated_denoiser_start(batch->accelerator,
+                                  get_noise_profile(self->noise_profiles[0]))) {
+    return false;
+  }
+
+  bool pending = true;
+  while (pending) {
+    run_accelerated_jobs(batch, &analyze_accelerated_stream);
+
+    pending = false;
+    bool reduced = false;
+    for (uint32_t k = 0U; k < batch->group_size; k++) {
+      const SbAcceleratedStream *stream = &batch->streams[k];
+      const bool in_group = k < batch->streams_in_group;
+      if (in_group && stream->overflowed) {
+        return false;
+      }
+      batch->frames[k] = in_group ? stream->frames : 0U;
+      pending = pending || (in_group && !stream->finished);
+      reduced = reduced || batch->frames[k] > 0U;
+    }
+    if (!pending) {
+      break;
+    }
+
+    // The last blocks may only flush the tail of frames already synthesized
+    if (reduced &&
+        !accelerated_denoiser_run(batch->accelerator, self->denoise_parameters,
+                                  batch->spectra, batch->frames)) {
+      return false;
+    }
+
+    run_accelerated_jobs(batch, &synthesize_accelerated_stream);
+  }
+
+  return true;
+}
+
+// One job per stream of the group, on the job runner of the instance or the
+// threads of the batch
+static void run_accelerated_jobs(SbAcceleratedBatch *batch,
+                                 parallel_job job) {
+  SbSpectralDenoiser *self = batch->denoiser;
+
+  if (self->runner) {
+    self->runner(self->runner_data, batch->streams_in_group, job, batch);
+  } else if (batch->thread_pool) {
+    thread_pool_run(batch->thread_pool, batch->streams_in_group, job, batch);
+  } else {
+    for (uint32_t k = 0U; k < batch->streams_in_group; k++) {
+      job(batch, k);
+    }
+  }
+}
+
+// Frame f of a stream starts frame_size - hop samples before sample f * hop
+// of the signal, as the first frame of a single pass only holds its first hop
+static void analyze_accelerated_stream(void *instance, const uint32_t stream) {
+  SbAcceleratedBatch *batch = (SbAcceleratedBatch *)instance;
+  SbAcceleratedStream *accelerated = &batch->streams[stream];
+  const int64_t number_of_samples =
+      (int64_t)batch->number_of_samples[batch->first_stream + stream];
+  const float *input = batch->input[batch->first_stream + stream];
+  const uint32_t hop = batch->hop;
+
+  // Sample k of the overlap-add block is output sample position + k + 2 * hop
+  // - frame_size, which is done once that is past the signal
+  accelerated->finished = (int64_t)accelerated->position + 2 * (int64_t)hop >=
+                          number_of_samples + (int64_t)batch->frame_size;
+  accelerated->frames = 0U;
+  const uint64_t first_frame = accelerated->position / hop;
+  if (accelerated->finished ||
+      first_frame >= accelerated->number_of_frames) {
+    return;
+  }
+
+  // Frames are counted as their spectra are captured
+  const uint32_t frames =
+      accelerated->number_of_frames - first_frame < accelerated->capacity
+          ? (uint32_t)(accelerated->number_of_frames - first_frame)
+          : accelerated->capacity;
+  const uint32_t frame_samples = (frames - 1U) * hop + batch->frame_size;
+  const int64_t first_sample = (int64_t)accelerated->position -
+                               (int64_t)(batch->frame_size - hop);
+  for (uint32_t k = 0U; k < frame_samples; k++) {
+    const int64_t position = first_sample + (int64_t)k;
+    accelerated->input_block[k] =
+        position >= 0 && position < number_of_samples ? input[position] : 0.F;
+  }
+
+  stft_processor_analyze(accelerated->stft_processor, frame_samples,
+                         accelerated->input_block, &capture_spectrum,
+                         accelerated);
+}
+
+static void synthesize_accelerated_stream(void *instance,
+                                          const uint32_t stream) {
+  SbAcceleratedBatch *batch = (SbAcceleratedBatch *)instance;
+  SbAcceleratedStream *accelerated = &batch->streams[stream];
+  const int64_t number_of_samples =
+      (int64_t)batch->number_of_samples[batch->first_stream + stream];
+  float *output = batch->output[batch->first_stream + stream];
+  const uint32_t block_hops = accelerated->capacity * batch->hop;
+  const uint32_t tail = batch->frame_size - batch->hop;
+
+  if (accelerated->finished) {
+    return;
+  }
+
+  stft_processor_synthesize(accelerated->stft_processor, accelerated->frames,
+                            accelerated->spectra, accelerated->output_block);
+
+  // Later frames start past the block of hops so those samples are complete
+  const int64_t first_sample = (int64_t)accelerated->position -
+                               (int64_t)batch->frame_size +
+                               2 * (int64_t)batch->hop;
+  for (uint32_t k = 0U; k < block_hops; k++) {
+    const int64_t position = first_sample + (int64_t)k;
+    if (position >= 0 && position < number_of_samples) {
+      output[position] = accelerated->output_block[k];
+    }
+  }
+
+  memmove(accelerated->output_block, &accelerated->output_block[block_hops],
+          tail * sizeof(float));
+  memset(&accelerated->output_block[tail], 0, block_hops * sizeof(float));
+
+  accelerated->position += block_hops;
+}
+
+static bool capture_spectrum(SpectralProcessorHandle instance,
+                             float *fft_spectrum) {
+  SbAcceleratedStream *stream = (SbAcceleratedStream *)instance;
+
+  if (stream->frames >= stream->capacity) {
+    stream->overflowed = true;
+    return false;
+  }
+
+  memcpy(&stream->spectra[(size_t)stream->frames * stream->fft_size],
+         fft_spectrum, stream->fft_size * sizeof(float));
+  stream->frames++;
+
+  return true;
+}
+#endif
+
+bool specbleach_learn_noise_profile(SpectralBleachHandle instance,
+                                    const int learn_mode,
+                                    const uint32_t number_of_samples,
+                                    const float *input,
+                                    const uint32_t number_of_threads) {
+  if (!instance || !input || learn_mode < (int)ROLLING_MEAN ||
+      learn_mode > (int)WINDOWED_MEAN) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  // Frames are laid out as in an instance of a single resolution, where the
+  // profile seen by the user lives
+  const StftSettings *stft_settings = &self->stft_settings;
+  StftProcessor *stft_processor = stft_processor_initialize(
+      self->sample_rate, self->frame_size, stft_settings->overlap_factor,
+      stft_settings->padding_type, stft_settings->zeropadding_amount,
+      stft_settings->input_window, stft_settings->output_window,
+      stft_settings->low_latency, FFT_TRANSFORM_TYPE_GENERAL,
+      self->planner_rigor, 1U);
+  if (!stft_processor) {
+    return false;
+  }
+  const uint32_t frame_size = get_stft_frame_size(stft_processor);
+  const uint32_t hop = get_stft_hop(stft_processor);
+  const uint32_t profile_size = get_stft_real_spectrum_size(stft_processor);
+  stft_processor_free(stft_processor);
+
+  if (number_of_samples < frame_size || profile_size != self->profile_size) {
+    return false;
+  }
+
+  // Averages and maxima of segments merge into the ones of the whole signal.
+  // Medians and the decaying and windowed means depend on the frames before
+  // them so they are learned in one pass
+  const uint32_t number_of_frames = (number_of_samples - frame_size) / hop + 1U;
+  const bool mergeable = (NoiseEstimatorType)learn_mode == ROLLING_MEAN ||
+                         (NoiseEstimatorType)learn_mode == MAX;
+  uint32_t number_of_segments =
+      number_of_threads > 1U && mergeable ? number_of_threads : 1U;
+  if (number_of_segments > number_of_frames) {
+    number_of_segments = number_of_frames;
+  }
+
+  SbLearningJob job = (SbLearningJob){
+      .denoiser = self,
+      .learn_mode = (NoiseEstimatorType)learn_mode,
+      .number_of_samples = number_of_samples,
+      .number_of_frames = number_of_frames,
+      .segment_frames =
+          (number_of_frames + number_of_segments - 1U) / number_of_segments,
+      .input = input,
+      .profile_size = profile_size,
+      .profiles = (float *)calloc((size_t)number_of_segments * profile_size,
+                                  sizeof(float)),
+      .averaged_blocks =
+          (uint32_t *)calloc(number_of_segments, sizeof(uint32_t)),
+      .failed = false,
+  };
+  float *profile = (float *)calloc(profile_size, sizeof(float));
+
+  bool learned = job.profiles && job.averaged_blocks && profile &&
+                 run_offline_jobs(self, number_of_segments, &learn_segment,
+                                  &job, number_of_threads) &&
+                 !__atomic_load_n(&job.failed, __ATOMIC_RELAXED);
+  if (learned) {
+    // Learning continues from the current profile as it does while processing
+    uint32_t averaged_blocks = 0U;
+    if (specbleach_noise_profile_available(instance)) {
+      copy_user_noise_profile(self, profile, &averaged_blocks);
+    }
+    merge_learned_profiles(&job, number_of_segments, profile,
+                           &averaged_blocks);
+
+    learned = load_noise_profile(self, profile, profile_size,
+                                 self->sample_rate, frame_size,
+                                 averaged_blocks);
+    __atomic_store_n(&self->profile_learn_mode, (uint32_t)learn_mode,
+                     __ATOMIC_RELAXED);
+  }
+
+  free(profile);
+  free(job.profiles);
+  free(job.averaged_blocks);
+
+  return learned;
+}
+
+static void learn_segment(void *instance, const uint32_t segment) {
+  SbLearningJob *job = (SbLearningJob *)instance;
+  SbSpectralDenoiser *self = job->denoiser;
+
+  const uint32_t first_frame = segment * job->segment_frames;
+  if (first_frame >= job->number_of_frames) {
+    return;
+  }
+  const uint32_t segment_frames =
+      job->number_of_frames - first_frame < job->segment_frames
+          ? job->number_of_frames - first_frame
+          : job->segment_frames;
+
+  const StftSettings *stft_settings = &self->stft_settings;
+  StftProcessor *stft_processor = stft_processor_initialize(
+      self->sample_rate, self->frame_size, stft_settings->overlap_factor,
+      stft_settings->padding_type, stft_settings->zeropadding_amount,
+      stft_settings->input_window, stft_settings->output_window,
+      stft_settings->low_latency, FFT_TRANSFORM_TYPE_GENERAL,
+      self->planner_rigor, 1U);
+  if (!stft_processor) {
+    __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    return;
+  }
+  const uint32_t hop = get_stft_hop(stft_processor);
+  NoiseProfile *noise_profile = noise_profile_initialize(job->profile_size);
+
+  SbProfileLearner learner = (SbProfileLearner){
+      .fft_size = get_stft_fft_size(stft_processor),
+      .learn_mode = job->learn_mode,
+      .spectral_features = spectral_features_initialize(job->profile_size),
+      .noise_estimator =
+          noise_profile ? noise_estimation_initialize(
+                              get_stft_fft_size(stft_processor),
+                              self->median_window_length,
+                              self->profile_window_length, noise_profile)
+                        : NULL,
+  };
+
+  if (!learner.spectral_features || !learner.noise_estimator) {
+    __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    if (learner.noise_estimator) {
+      noise_estimation_free(learner.noise_estimator);
+    }
+    if (learner.spectral_features) {
+      spectral_features_free(learner.spectral_features);
+    }
+    if (noise_profile) {
+      noise_profile_free(noise_profile);
+    }
+    stft_processor_free(stft_processor);
+    return;
+  }
+
+  stft_processor_analyze(
+      stft_processor,
+      (segment_frames - 1U) * hop + get_stft_frame_size(stft_processor),
+      &job->input[(size_t)first_frame * hop], &learn_frame, &learner);
+
+  memcpy(&job->profiles[(size_t)segment * job->profile_size],
+         get_noise_profile(noise_profile), job->profile_size * sizeof(float));
+  job->averaged_blocks[segment] =
+      get_noise_profile_blocks_averaged(noise_profile);
+
+  noise_estimation_free(learner.noise_estimator);
+  spectral_features_free(learner.spectral_features);
+  noise_profile_free(noise_profile);
+  stft_processor_free(stft_processor);
+}
+
+static bool learn_frame(SpectralProcessorHandle instance,
+                        float *fft_spectrum) {
+  SbProfileLearner *self = (SbProfileLearner *)instance;
+
+  spectral_features_invalidate(self->spectral_features);
+  const float *reference_spectrum =
+      get_spectral_feature(self->spectral_features, fft_spectrum,
+                           self->fft_size, SPECTRAL_TYPE_GENERAL);
+
+  return noise_estimation_run(self->noise_estimator, self->learn_mode,
+                              reference_spectrum);
+}
+
+// Averages are weighted by the blocks behind each of them. Median and max
+// profiles keep the largest value of every bin, as each frame does with them.
+// Decaying and windowed means only remember the window length of blocks, so
+// the profile learned before fills what the new blocks leave of the window
+static void merge_learned_profiles(const SbLearningJob *job,
+                                   const uint32_t number_of_segments,
+                                   float *profile, uint32_t *averaged_blocks) {
+  const uint32_t window_length = job->denoiser->profile_window_length;
+
+  for (uint32_t s = 0U; s < number_of_segments; s++) {
+    const float *segment_profile =
+        &job->profiles[(size_t)s * job->profile_size];
+    const uint32_t segment_blocks = job->averaged_blocks[s];
+
+    switch (job->learn_mode) {
+    case ROLLING_MEAN:
+      merge_averaged_spectra(profile, averaged_blocks, segment_profile,
+                             segment_blocks, job->profile_size);
+      break;
+    case DECAYING_MEAN:
+    case WINDOWED_MEAN: {
+      const uint32_t new_blocks =
+          segment_blocks < window_length ? segment_blocks : window_length;
+      const uint32_t remaining_blocks = window_length - new_blocks;
+      uint32_t old_blocks = *averaged_blocks < remaining_blocks
+                                ? *averaged_blocks
+                                : remaining_blocks;
+      // Some blocks on both sides so an empty window doesn't take the maximum
+      if (old_blocks == 0U && new_blocks == 0U) {
+        break;
+      }
+      merge_averaged_spectra(profile, &old_blocks, segment_profile,
+                             new_blocks, job->profile_size);
+      *averaged_blocks += segment_blocks;
+      break;
+    }
+    default:
+      max_spectrum(profile, segment_profile, job->profile_size);
+      break;
+    }
+  }
+}
+
+bool specbleach_merge_noise_profiles(float *noise_profile,
+                                     uint32_t *profile_blocks,
+                                     const float *other_profile,
+                                     const uint32_t other_blocks,
+                                     const uint32_t profile_size) {
+  if (!noise_profile || !profile_blocks || !other_profile ||
+      profile_size == 0U) {
+    return false;
+  }
+
+  return merge_averaged_spectra(noise_profile, profile_blocks, other_profile,
+                                other_blocks, profile_size);
+}
+
+uint32_t specbleach_get_noise_profile_size(SpectralBleachHandle instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  return self->profile_size;
+}
+
+uint32_t
+specbleach_get_noise_profile_blocks_averaged(SpectralBleachHandle instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  uint32_t averaged_blocks = 0U;
+  copy_noise_profile_snapshot(self->noise_profiles[0], NULL, &averaged_blocks,
+                              NULL);
+
+  return averaged_blocks;
+}
+
+// Decimating keeps the value of the samples, so the low band spreads the same
+// power over a spectrum the decimation factor times narrower. Its bins hold
+// that factor less power than the resampler expects from the frame lengths
+static float get_band_power_scale(SbSpectralDenoiser *self,
+                                  const uint32_t processor) {
+  return (float)self->sample_rate /
+         (float)get_processor_sample_rate(self, processor);
+}
+
+static float get_bin_frequency(const uint32_t bin, const uint32_t spectrum_size,
+                               const uint32_t sample_rate) {
+  return (float)bin * (float)sample_rate / (float)(2U * (spectrum_size - 1U));
+}
+
+// Length in samples of the frames the profile seen by the user is measured
+// with, the long ones at full rate for multiresolution instances
+static uint32_t get_user_frame_length(SbSpectralDenoiser *self) {
+  return (uint32_t)((self->frame_size / 1000.F) * (float)self->sample_rate);
+}
+
+// Profiles loaded without a record don't tell their frame length, so they are
+// taken as padded the same way as the ones of the instance
+static uint32_t get_loaded_frame_length(SbSpectralDenoiser *self,
+                                        const uint32_t profile_size) {
+  const uint64_t frame_length =
+      ((uint64_t)get_user_frame_length(self) * (profile_size - 1U) +
+       (self->profile_size - 1U) / 2U) /
+      (self->profile_size - 1U);
+
+  return frame_length > 0U ? (uint32_t)frame_length : 1U;
+}
+
+// Multiresolution instances present a single profile with the bins of a
+// full rate STFT using the long frames. Both band profiles are mapped onto
+// those bins and added, undoing the power the crossover took from each
+static bool copy_user_noise_profile(SbSpectralDenoiser *self,
+                                    float *noise_profile,
+                                    uint32_t *averaged_blocks) {
+  if (!self->multiresolution) {
+    return copy_noise_profile_snapshot(self->noise_profiles[0], noise_profile,
+                                       averaged_blocks, NULL);
+  }
+
+  float *band_profile = (float *)calloc(self->profile_size, sizeof(float));
+  float *high_profile = (float *)calloc(self->profile_size, sizeof(float));
+  if (!band_profile || !high_profile) {
+    free(band_profile);
+    free(high_profile);
+    return false;
+  }
+
+  bool copied = true;
+  for (uint32_t k = 0U; k < self->number_of_profiles && copied; k++) {
+    const uint32_t band_size = get_noise_profile_size(self->noise_profiles[k]);
+    copied = copy_noise_profile_snapshot(self->noise_profiles[k], band_profile,
+                                         k == LOW_BAND ? averaged_blocks : NULL,
+                                         NULL) &&
+             resample_noise_profile(
+                 band_profile, band_size, get_processor_sample_rate(self, k),
+                 get_stft_frame_size(get_processor_stft(self, k)),
+                 k == LOW_BAND ? noise_profile : high_profile,
+                 self->profile_size, self->sample_rate,
+                 get_user_frame_length(self));
+  }
+
+  if (copied) {
+    const float low_scale = get_band_power_scale(self, LOW_BAND);
+    const float low_band_nyquist =
+        (float)get_processor_sample_rate(self, LOW_BAND) / 2.F;
+    for (uint32_t k = 0U; k < self->profile_size; k++) {
+      const float frequency =
+          get_bin_frequency(k, self->profile_size, self->sample_rate);
+      // The resampler holds the last low band bin above its Nyquist frequency
+      const float low_band_power =
+          frequency < low_band_nyquist ? noise_profile[k] * low_scale : 0.F;
+      const float crossover_gain =
+          get_multiresolution_band_gain(self->multiresolution, LOW_BAND,
+                                        frequency) +
+          get_multiresolution_band_gain(self->multiresolution, HIGH_BAND,
+                                        frequency);
+
+      noise_profile[k] = (low_band_power + high_profile[k]) / crossover_gain;
+    }
+  }
+
+  free(band_profile);
+  free(high_profile);
+
+  return copied;
+}
+
+float *specbleach_get_noise_profile(SpectralBleachHandle instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  copy_user_noise_profile(self, self->exported_noise_profile, NULL);
+
+  return self->exported_noise_profile;
+}
+
+bool specbleach_copy_noise_profile(SpectralBleachHandle instance,
+                                   float *noise_profile,
+                                   const uint32_t profile_size,
+                                   uint32_t *profile_blocks) {
+  if (!instance || !noise_profile) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  if (profile_size != self->profile_size) {
+    return false;
+  }
+
+  return copy_user_noise_profile(self, noise_profile, profile_blocks);
+}
+
+// Maps a profile onto the bins of every band, keeping the power the crossover
+// leaves in each. Profiles are only set once both are resampled so a failure
+// leaves the previous ones in place
+static bool load_band_noise_profiles(SbSpectralDenoiser *self,
+                                     const float *restored_profile,
+                                     const uint32_t profile_size,
+                                     const uint32_t profile_sample_rate,
+                                     const uint32_t profile_frame_length,
+                                     const uint32_t averaged_blocks) {
+  const uint32_t low_size =
+      get_noise_profile_size(self->noise_profiles[LOW_BAND]);
+  const uint32_t high_size =
+      get_noise_profile_size(self->noise_profiles[HIGH_BAND]);
+  float *low_profile = (float *)calloc(low_size, sizeof(float));
+  float *high_profile = (float *)calloc(high_size, sizeof(float));
+
+  const bool resampled =
+      low_profile && high_profile &&
+      resample_noise_profile(
+          restored_profile, profile_size, profile_sample_rate,
+          profile_frame_length, low_profile, low_size,
+          get_processor_sample_rate(self, LOW_BAND),
+          get_stft_frame_size(get_processor_stft(self, LOW_BAND))) &&
+      resample_noise_profile(
+          restored_profile, profile_size, profile_sample_rate,
+          profile_frame_length, high_profile, high_size, self->sample_rate,
+          get_stft_frame_size(get_processor_stft(self, HIGH_BAND)));
+
+  if (resampled) {
+    const uint32_t low_sample_rate = get_processor_sample_rate(self, LOW_BAND);
+    const float low_scale = get_band_power_scale(self, LOW_BAND);
+    for (uint32_t k = 0U; k < low_size; k++) {
+      low_profile[k] *=
+          get_multiresolution_band_gain(
+              self->multiresolution, LOW_BAND,
+              get_bin_frequency(k, low_size, low_sample_rate)) /
+          low_scale;
+    }
+    for (uint32_t k = 0U; k < high_size; k++) {
+      high_profile[k] *= get_multiresolution_band_gain(
+          self->multiresolution, HIGH_BAND,
+          get_bin_frequency(k, high_size, self->sample_rate));
+    }
+    set_noise_profile(self->noise_profiles[LOW_BAND], low_profile, low_size,
+                      averaged_blocks);
+    set_noise_profile(self->noise_profiles[HIGH_BAND], high_profile, high_size,
+                      averaged_blocks);
+  }
+
+  free(low_profile);
+  free(high_profile);
+
+  return resampled;
+}
+
+// Loads a profile learned with any frame length, transform size and sample
+// rate, mapping it onto the bins of the instance when they differ
+static bool load_noise_profile(SbSpectralDenoiser *self,
+                               const float *restored_profile,
+                               const uint32_t profile_size,
+                               const uint32_t profile_sample_rate,
+                               const uint32_t profile_frame_length,
+                               const uint32_t averaged_blocks) {
+  if (self->multiresolution) {
+    return load_band_noise_profiles(self, restored_profile, profile_size,
+                                    profile_sample_rate, profile_frame_length,
+                                    averaged_blocks);
+  }
+
+  const uint32_t real_spectrum_size =
+      get_noise_profile_size(self->noise_profiles[0]);
+  const uint32_t frame_length = get_stft_frame_size(self->stft_processor);
+
+  float *resampled_profile = NULL;
+  if (profile_size != real_spectrum_size ||
+      profile_sample_rate != self->sample_rate ||
+      profile_frame_length != frame_length) {
+    resampled_profile = (float *)calloc(real_spectrum_size, sizeof(float));
+    if (!resampled_profile ||
+        !resample_noise_profile(restored_profile, profile_size,
+                                profile_sample_rate, profile_frame_length,
+                                resampled_profile, real_spectrum_size,
+                                self->sample_rate, frame_length)) {
+      free(resampled_profile);
+      return false;
+    }
+    restored_profile = resampled_profile;
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    set_noise_profile(self->noise_profiles[k], restored_profile,
+                      real_spectrum_size, averaged_blocks);
+  }
+
+  free(resampled_profile);
+
+  return true;
+}
+
+bool specbleach_load_noise_profile(SpectralBleachHandle instance,
+                                   const float *restored_profile,
+                                   const uint32_t profile_size,
+                                   const uint32_t averaged_blocks) {
+  if (!instance || !restored_profile) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  return load_noise_profile(self, restored_profile, profile_size,
+                            self->sample_rate,
+                            get_loaded_frame_length(self, profile_size),
+                            averaged_blocks);
+}
+
+bool specbleach_load_resampled_noise_profile(
+    SpectralBleachHandle instance, const float *restored_profile,
+    const uint32_t profile_size, const uint32_t profile_sample_rate,
+    const uint32_t averaged_blocks) {
+  if (!instance || !restored_profile) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  return load_noise_profile(
+      self, restored_profile, profile_size, profile_sample_rate,
+      get_loaded_frame_length(self, profile_size), averaged_blocks);
+}
+
+bool specbleach_reset_noise_profile(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    reset_noise_profile(self->noise_profiles[k]);
+  }
+  __atomic_store_n(&self->profile_learn_mode, 0U, __ATOMIC_RELAXED);
+
+  return true;
+}
+
+bool specbleach_noise_profile_available(SpectralBleachHandle instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    bool available = false;
+    copy_noise_profile_snapshot(self->noise_profiles[k], NULL, NULL,
+                                &available);
+    if (!available) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+size_t specbleach_get_serialized_noise_profile_size(
+    SpectralBleachHandle instance, SpectralBleachProfileEncoding encoding) {
+  if (!instance) {
+    return 0U;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  return get_noise_profile_record_size(self->profile_size,
+                                       (NoiseProfileEncoding)encoding);
+}
+
+size_t
+specbleach_serialize_noise_profile(SpectralBleachHandle instance,
+                                   SpectralBleachProfileEncoding encoding,
+                                   void *buffer, const size_t buffer_size) {
+  if (!instance || !buffer) {
+    return 0U;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  NoiseProfileRecordInfo info = (NoiseProfileRecordInfo){
+      .encoding = (NoiseProfileEncoding)encoding,
+      .spectrum_type = (uint32_t)SPECTRAL_TYPE_GENERAL,
+      .learn_mode =
+          __atomic_load_n(&self->profile_learn_mode, __ATOMIC_RELAXED),
+      .sample_rate = self->sample_rate,
+      .frame_size = self->frame_size,
+      .profile_size = self->profile_size,
+  };
+
+  float *noise_profile = (float *)calloc(info.profile_size, sizeof(float));
+  if (!noise_profile) {
+    return 0U;
+  }
+
+  const size_t written =
+      copy_user_noise_profile(self, noise_profile, &info.blocks_averaged)
+          ? write_noise_profile_record(&info, noise_profile, buffer,
+                                       buffer_size)
+          : 0U;
+
+  free(noise_profile);
+
+  return written;
+}
+
+bool specbleach_deserialize_noise_profile(SpectralBleachHandle instance,
+                                          const void *buffer,
+                                          const size_t buffer_size) {
+  if (!instance || !buffer) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  NoiseProfileRecordInfo info;
+  if (!read_noise_profile_record_info(buffer, buffer_size, &info)) {
+    return false;
+  }
+
+  if (info.spectrum_type != (uint32_t)SPECTRAL_TYPE_GENERAL) {
+    return false;
+  }
+
+  float *noise_profile = (float *)calloc(info.profile_size, sizeof(float));
+  if (!noise_profile) {
+    return false;
+  }
+
+  read_noise_profile_record_spectrum(buffer, &info, noise_profile);
+  // Records carry the frame size the profile was learned with, which sets
+  // the energy of its window
+  const uint32_t frame_length =
+      (uint32_t)((info.frame_size / 1000.F) * (float)info.sample_rate);
+  const bool loaded =
+      frame_length > 0U &&
+      load_noise_profile(self, noise_profile, info.profile_size,
+                         info.sample_rate, frame_length, info.blocks_averaged);
+  if (loaded) {
+    __atomic_store_n(&self->profile_learn_mode, info.learn_mode,
+                     __ATOMIC_RELAXED);
+  }
+
+  free(noise_profile);
+
+  return loaded;
+}
+
+bool specbleach_load_parameters(SpectralBleachHandle instance,
+                                SpectralBleachParameters parameters) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+  const DenoiserParameters denoise_parameters = convert_parameters(&parameters);
+
+  // Processing may be running in another thread, so the parameters are only
+  // handed over and the processing thread takes them before its next block
+  return parameter_exchange_publish(self->parameter_exchange,
+                                    &denoise_parameters);
+}
+
+static DenoiserParameters
+convert_parameters(const SpectralBleachParameters *parameters) {
+  return (DenoiserParameters){
+      .learn_noise = parameters->learn_noise,
+      .residual_listen = parameters->residual_listen,
+      .transient_protection = parameters->transient_protection,
+      .noise_scaling_type = parameters->noise_scaling_type,
+      .reduction_amount =
+          from_db_to_coefficient(parameters->reduction_amount * -1.F),
+      .noise_rescale = from_db_to_coefficient(parameters->noise_rescale),
+      .smoothing_factor = remap_percentage_log_like_unity(
+          parameters->smoothing_factor / 100.F),
+      .whitening_factor = parameters->whitening_factor / 100.F,
+      .post_filter_threshold =
+          from_db_to_coefficient(parameters->post_filter_threshold),
+  };
+}
+
+uint64_t specbleach_post_command(SpectralBleachHandle instance,
+                                 const SpectralBleachCommand *command) {
+  if (!instance || !command ||
+      (uint32_t)command->type > (uint32_t)SPECBLEACH_COMMAND_RESET) {
+    return 0U;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  const SbQueuedCommand queued = (SbQueuedCommand){
+      .command = *command,
+      .ticket = self->posted_commands + 1U,
+  };
+  if (!command_queue_push(self->command_queue, &queued)) {
+    return 0U;
+  }
+  self->posted_commands = queued.ticket;
+
+  return queued.ticket;
+}
+
+uint64_t specbleach_get_applied_command(SpectralBleachHandle instance) {
+  if (!instance) {
+    return 0U;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  return __atomic_load_n(&self->applied_command, __ATOMIC_ACQUIRE);
+}
+
+// Runs in the processing thread before any processing. It takes the noise
+// profiles and parameters loaded from other threads. Processors ramp the
+// continuous parameters so automation doesn't step the gains
+static void apply_pending_changes(SbSpectralDenoiser *self) {
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    update_noise_profile(self->noise_profiles[k]);
+  }
+
+  const DenoiserParameters *parameters =
+      (const DenoiserParameters *)parameter_exchange_consume(
+          self->parameter_exchange);
+  if (parameters) {
+    apply_parameters(self, parameters);
+  }
+  apply_queued_commands(self);
+
+  update_bypass(self);
+}
+
+// Runs in the processing thread. Returns true if any command was applied
+static bool apply_queued_commands(SbSpectralDenoiser *self) {
+  SbQueuedCommand queued;
+  bool applied = false;
+
+  while (command_queue_pop(self->command_queue, &queued)) {
+    apply_command(self, &queued.command);
+    applied = true;
+
+    // Release makes the changes of the command visible along with its ticket
+    __atomic_store_n(&self->applied_command, queued.ticket, __ATOMIC_RELEASE);
+    if (queued.command.callback) {
+      queued.command.callback(queued.command.user_data, queued.ticket);
+    }
+  }
+
+  return applied;
+}
+
+// The STFT calls it before the frame of each hop. Parameters and profiles
+// loaded synchronously keep waiting for the next block
+static void apply_commands_at_hop(void *instance) {
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  if (apply_queued_commands(self)) {
+    update_bypass(self);
+  }
+}
+
+static void apply_command(SbSpectralDenoiser *self,
+                          const SpectralBleachCommand *command) {
+  DenoiserParameters parameters = self->denoise_parameters;
+
+  switch (command->type) {
+  case SPECBLEACH_COMMAND_LOAD_PARAMETERS:
+    parameters = convert_parameters(&command->payload.parameters);
+    apply_parameters(self, &parameters);
+    break;
+  case SPECBLEACH_COMMAND_SET_LEARN_MODE:
+    parameters.learn_noise = command->payload.learn_noise;
+    apply_parameters(self, &parameters);
+    break;
+  case SPECBLEACH_COMMAND_RESET_NOISE_PROFILE:
+    clear_noise_profiles(self);
+    break;
+  case SPECBLEACH_COMMAND_RESET:
+    if (!command->payload.keep_noise_profile) {
+      clear_noise_profiles(self);
+    }
+    for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+      spectral_denoiser_reset(self->spectral_denoisers[k]);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+// Same as specbleach_reset_noise_profile from the processing thread, which
+// owns the profiles in use and empties them in place
+static void clear_noise_profiles(SbSpectralDenoiser *self) {
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    clear_noise_profile(self->noise_profiles[k]);
+  }
+  __atomic_store_n(&self->profile_learn_mode, 0U, __ATOMIC_RELAXED);
+}
+
+static void apply_parameters(SbSpectralDenoiser *self,
+                             const DenoiserParameters *parameters) {
+  self->denoise_parameters = *parameters;
+  if (self->denoise_parameters.learn_noise != 0) {
+    __atomic_store_n(&self->profile_learn_mode,
+                     (uint32_t)self->denoise_parameters.learn_noise,
+                     __ATOMIC_RELAXED);
+  } else {
+    // Learning only refreshes the snapshots every few frames, so the last
+    // frames learned are published once it stops
+    for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+      publish_noise_profile_snapshot(self->noise_profiles[k]);
+    }
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    load_reduction_parameters(self->spectral_denoisers[k],
+                              self->denoise_parameters);
+  }
+
+  if (!self->stft_processor) {
+    return;
+  }
+
+  // Linked channels learn into the same profile so they can't run in parallel
+  // while learning
+  const bool shared_learning = self->number_of_profiles <
+                                   self->number_of_channels &&
+                               self->denoise_parameters.learn_noise != 0;
+  stft_processor_set_job_runner(self->stft_processor,
+                                shared_learning ? NULL : self->runner,
+                                self->runner_data);
+}
+
+// Frames are left as they are while there is no profile to reduce, or when
+// nothing is reduced and the residual isn't whitened nor listened to
+// Instances looking ahead keep processing so their frames stay delayed by the
+// same amount
+static bool is_bypassed(SbSpectralDenoiser *self) {
+  if (self->look_ahead_hops > 0U) {
+    return false;
+  }
+
+  bool profiles_available = true;
+  for (uint32_t k = 0U; k < self->number_of_profiles; k++) {
+    profiles_available = profiles_available &&
+                         is_noise_estimation_available(self->noise_profiles[k]);
+  }
+
+  const DenoiserParameters *parameters = &self->denoise_parameters;
+  const bool reduction_disabled = parameters->reduction_amount >= 1.F &&
+                                  parameters->whitening_factor <= 0.F &&
+                                  !parameters->residual_listen;
+  return parameters->learn_noise == 0 &&
+         (!profiles_available || reduction_disabled);
+}
+
+// The STFT is bypassed while frames are left as they are, keeping its latency
+static void update_bypass(SbSpectralDenoiser *self) {
+  const bool bypass = is_bypassed(self);
+
+  if (self->multiresolution) {
+    multiresolution_stft_set_bypass(self->multiresolution, bypass);
+  } else {
+    stft_processor_set_bypass(self->stft_processor, bypass);
+  }
+}
+
+bool specbleach_get_profile_stats(SpectralBleachHandle instance,
+                                  SpectralBleachStats *stats) {
+  if (!instance || !stats) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  memset(stats, 0, sizeof(SpectralBleachStats));
+
+  if (!self->profilers) {
+    return false;
+  }
+
+  StageCounter counters[NUMBER_OF_PROFILED_STAGES] = {{0}};
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    stage_profiler_accumulate(self->profilers[k], counters);
+  }
+
+  for (uint32_t k = 0U; k < NUMBER_OF_PROFILED_STAGES; k++) {
+    stats->stages[k] = (SpectralBleachStageStats){
+        .calls = counters[k].calls,
+        .nanoseconds = counters[k].nanoseconds,
+        .cycles = counters[k].cycles,
+    };
+  }
+
+  return true;
+}
+
+bool specbleach_reset_profile_stats(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  if (!self->profilers) {
+    return false;
+  }
+
+  for (uint32_t k = 0U; k <= self->number_of_processors; k++) {
+    stage_profiler_reset(self->profilers[k]);
+  }
+
+  return true;
+}
+
+bool specbleach_get_telemetry(SpectralBleachHandle instance,
+                              SpectralBleachTelemetry *telemetry) {
+  if (!instance || !telemetry) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  ReductionTelemetryCounters counters;
+  if (!reduction_telemetry_merge(self->telemetries, self->number_of_processors,
+                                 &counters)) {
+    return false;
+  }
+
+  const float frames = counters.frames > 0U ? (float)counters.frames : 1.F;
+  *telemetry = (SpectralBleachTelemetry){
+      .frames = counters.frames,
+      .transient_rate = (float)counters.transient_frames / frames,
+      .postfilter_rate = (float)counters.postfilter_frames / frames,
+      .input_snr = counters.input_snr,
+      .attenuation = counters.attenuation,
+      .offline_signals =
+          __atomic_load_n(&self->offline_signals, __ATOMIC_RELAXED),
+      .accelerated_signals =
+          __atomic_load_n(&self->accelerated_signals, __ATOMIC_RELAXED),
+  };
+
+  return true;
+}
+
+bool specbleach_reset_telemetry(SpectralBleachHandle instance) {
+  if (!instance) {
+    return false;
+  }
+
+  SbSpectralDenoiser *self = (SbSpectralDenoiser *)instance;
+
+  for (uint32_t k = 0U; k < self->number_of_processors; k++) {
+    reduction_telemetry_reset(self->telemetries[k]);
+  }
+  __atomic_store_n(&self->offline_signals, 0U, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->accelerated_signals, 0U, __ATOMIC_RELAXED);
+
+  return true;
+}
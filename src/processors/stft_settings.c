@@ -0,0 +1,181 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "stft_settings.h"
+#include "../shared/configurations.h"
+#include <string.h>
+
+static bool resolve_window_type(WindowTypes *window_type,
+                                const SpectralBleachWindowType option) {
+  switch (option) {
+  case SPECBLEACH_WINDOW_DEFAULT:
+    return true;
+  case SPECBLEACH_WINDOW_HANN:
+    *window_type = HANN_WINDOW;
+    return true;
+  case SPECBLEACH_WINDOW_HAMMING:
+    *window_type = HAMMING_WINDOW;
+    return true;
+  case SPECBLEACH_WINDOW_BLACKMAN:
+    *window_type = BLACKMAN_WINDOW;
+    return true;
+  case SPECBLEACH_WINDOW_VORBIS:
+    *window_type = VORBIS_WINDOW;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Number of cosine harmonics of each raised cosine window
+static uint32_t get_window_order(const WindowTypes window_type) {
+  return window_type == BLACKMAN_WINDOW ? 2U : 1U;
+}
+
+// Whether overlapping the product of both windows adds up to a constant, so
+// frames left untouched come back exactly. The product of two sums of cosines
+// holds the harmonics of both orders added, which frames cancel when they
+// overlap more times than that. Vorbis windows are power complementary
+// instead, so a pair of them adds up with any even overlap
+static bool is_reconstructing_pair(const WindowTypes input_window,
+                                   const WindowTypes output_window,
+                                   const uint32_t overlap_factor) {
+  if (input_window == VORBIS_WINDOW || output_window == VORBIS_WINDOW) {
+    return input_window == output_window && overlap_factor % 2U == 0U;
+  }
+
+  return overlap_factor >
+         get_window_order(input_window) + get_window_order(output_window);
+}
+
+// Windows left to their default follow the one given or, when both are, take
+// a pair that reconstructs with the overlap chosen
+static void resolve_default_windows(StftSettings *settings,
+                                    const SpectralBleachInitOptions *options) {
+  const bool default_input = options->input_window == SPECBLEACH_WINDOW_DEFAULT;
+  const bool default_output =
+      options->output_window == SPECBLEACH_WINDOW_DEFAULT;
+
+  if (is_reconstructing_pair(settings->input_window, settings->output_window,
+                             settings->overlap_factor)) {
+    return;
+  }
+
+  if (default_input && default_output) {
+    const WindowTypes window_type =
+        settings->overlap_factor % 2U == 0U ? VORBIS_WINDOW : HANN_WINDOW;
+    settings->input_window = window_type;
+    settings->output_window = window_type;
+  } else if (default_input) {
+    settings->input_window = settings->output_window;
+  } else if (default_output) {
+    settings->output_window = settings->input_window;
+  }
+}
+
+static bool resolve_padding_type(ZeroPaddingType *padding_type,
+                                 const SpectralBleachPaddingType option) {
+  switch (option) {
+  case SPECBLEACH_PADDING_DEFAULT:
+    return true;
+  case SPECBLEACH_PADDING_NONE:
+    *padding_type = NO_PADDING;
+    return true;
+  case SPECBLEACH_PADDING_NEXT_POWER_OF_TWO:
+    *padding_type = NEXT_POWER_OF_TWO;
+    return true;
+  case SPECBLEACH_PADDING_FIXED_AMOUNT:
+    *padding_type = FIXED_AMOUNT;
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool resolve_stft_settings(StftSettings *settings,
+                           const SpectralBleachInitOptions *options) {
+  if (!settings || !options) {
+    return false;
+  }
+
+  settings->low_latency = options->low_latency;
+  settings->spread_processing = options->spread_processing;
+  if (settings->low_latency) {
+    settings->overlap_factor = LOW_LATENCY_OVERLAP_FACTOR;
+  }
+
+  if (options->overlap_factor != 0U) {
+    if (options->overlap_factor < MIN_OVERLAP_FACTOR ||
+        options->overlap_factor > MAX_OVERLAP_FACTOR) {
+      return false;
+    }
+    settings->overlap_factor = options->overlap_factor;
+  }
+
+  if (options->zeropadding_amount != 0U) {
+    settings->zeropadding_amount = options->zeropadding_amount;
+  }
+
+  if (!resolve_window_type(&settings->input_window, options->input_window) ||
+      !resolve_window_type(&settings->output_window,
+                           options->output_window) ||
+      !resolve_padding_type(&settings->padding_type, options->padding_type)) {
+    return false;
+  }
+
+  // Low latency mode uses its own pair, which always reconstructs
+  if (settings->low_latency) {
+    return true;
+  }
+
+  resolve_default_windows(settings, options);
+
+  return is_reconstructing_pair(settings->input_window,
+                                settings->output_window,
+                                settings->overlap_factor);
+}
+
+void get_layout_options(SpectralBleachInitOptions *layout,
+                        const SpectralBleachInitOptions *options) {
+  memset(layout, 0, sizeof(SpectralBleachInitOptions));
+
+  layout->sample_rate = options->sample_rate;
+  layout->frame_size = options->frame_size;
+  layout->number_of_channels = options->number_of_channels;
+  layout->link_channels = options->link_channels;
+  layout->median_window_length = options->median_window_length;
+  layout->profile_window_length = options->profile_window_length;
+  layout->approximate_math = options->approximate_math;
+  layout->low_latency = options->low_latency;
+  layout->overlap_factor = options->overlap_factor;
+  layout->spread_processing = options->spread_processing;
+  layout->input_window = options->input_window;
+  layout->output_window = options->output_window;
+  layout->padding_type = options->padding_type;
+  layout->zeropadding_amount = options->zeropadding_amount;
+  layout->multiresolution = options->multiresolution;
+  layout->crossover_frequency = options->crossover_frequency;
+  layout->skip_noise_frames = options->skip_noise_frames;
+  layout->noise_tracker = options->noise_tracker;
+  layout->band_processing = options->band_processing;
+  layout->speech_band_only = options->speech_band_only;
+  layout->transient_look_ahead = options->transient_look_ahead;
+  layout->gain_update_interval = options->gain_update_interval;
+}
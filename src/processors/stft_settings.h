@@ -0,0 +1,53 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef STFT_SETTINGS_H
+#define STFT_SETTINGS_H
+
+#include "../../include/specbleach_common.h"
+#include "../shared/stft/fft_transform.h"
+#include "../shared/utils/spectral_utils.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// STFT layout of an instance. Denoisers fill it with their own defaults and
+// the init options override whatever the user chose
+typedef struct StftSettings {
+  uint32_t overlap_factor;
+  ZeroPaddingType padding_type;
+  uint32_t zeropadding_amount;
+  WindowTypes input_window;
+  WindowTypes output_window;
+  bool low_latency;
+  bool spread_processing;
+} StftSettings;
+
+// Returns false if the options hold values out of range or windows that
+// don't reconstruct the signal with the overlap chosen
+bool resolve_stft_settings(StftSettings *settings,
+                           const SpectralBleachInitOptions *options);
+
+// Copy of the options holding only what shapes the memory of an instance,
+// with everything else and the padding zeroed so it can key the measured
+// sizes. Threads, job runners and planner rigor don't reach the arena
+void get_layout_options(SpectralBleachInitOptions *layout,
+                        const SpectralBleachInitOptions *options);
+
+#endif
@@ -39,6 +39,51 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 /* ------------------- Shared Modules configurations ------------------- */
 /* --------------------------------------------------------------------- */
 
+// Transforms used internally by shared modules (post filter and hearing
+// thresholds)
+#define FFT_TRANSFORM_TYPE HALFCOMPLEX_TRANSFORM
+
+// Channels of batched transforms start at multiples of this amount of floats
+// (64 bytes) so every channel keeps the alignment of the first one
+#define FFT_CHANNEL_ALIGNMENT 16U
+
+// Low latency STFT - Overlap factor used by both denoisers and number of hops
+// the short synthesis window spans at the end of the frame. Latency becomes
+// that many hops minus one instead of the frame size minus one hop
+#define LOW_LATENCY_OVERLAP_FACTOR 4U
+#define LOW_LATENCY_SYNTHESIS_HOPS 2U
+
+// Multiresolution STFT - Frames above the crossover frequency are this many
+// times shorter than below it. The crossover filter goes from passing to
+// rejecting over a band as wide as the crossover frequency, centered half of
+// it above the crossover, and takes this many taps per sample rate over that
+// width. The band below is decimated as much as that rejection allows. Speech
+// splits where its band ends, which decimates 48khz input to 16khz
+#define MULTIRESOLUTION_FRAME_RATIO 4U
+#define MULTIRESOLUTION_CROSSOVER CROSSOVER_POINT1
+#define MULTIRESOLUTION_CROSSOVER_SPEECH 4000.F
+#define CROSSOVER_FILTER_TAPS_FACTOR 5.5F
+#define MULTIRESOLUTION_BLOCK_SIZE 256U
+
+// Bypass - Time in milliseconds the output takes to crossfade between the
+// processed signal and the delayed input
+#define BYPASS_CROSSFADE_TIME 20.F
+
+// Range of overlap factors selectable at initialization
+#define MIN_OVERLAP_FACTOR 2U
+#define MAX_OVERLAP_FACTOR 16U
+
+// Parameter changes - Time in milliseconds continuous parameters take to move
+// to a newly loaded value
+#define PARAMETER_RAMP_TIME 50.F
+
+// Commands - Most commands posted from a control thread that can wait for the
+// processing thread to apply them
+#define COMMAND_QUEUE_CAPACITY 64U
+
+// Telemetry - Time in milliseconds the reported levels are averaged over
+#define TELEMETRY_AVERAGING_TIME 500.F
+
 // Absolute hearing thresholds
 #define REFERENCE_SINE_WAVE_FREQ 1000.F
 #define REFERENCE_LEVEL 90.F
@@ -51,6 +96,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 // Masking Thresholds
 #define BIAS false
 #define HIGH_FREQ_BIAS 20.F
+// Spreading between bands weaker than this (in dB) is left out of the
+// convolution. Each band further away is attenuated by roughly 10dB more
+#define SPREADING_FUNCTION_FLOOR -90.F
 #if BIAS
 #define relative_thresholds                                                    \
   [N_BARK_BANDS] = {-16.F, -17.F, -18.F, -19.F, -20.F, -21.F, -22.F,           \
@@ -91,6 +139,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define BAND_2_LEVEL 2.F
 #define BAND_3_LEVEL 5.F
 
+// Minimum Statistics Estimator
+#define MINIMUM_STATISTICS_SMOOTHING_TIME 0.1F // Seconds
+#define MINIMUM_STATISTICS_WINDOW 1.5F         // Seconds searched
+#define MINIMUM_STATISTICS_SUBWINDOWS 8U
+#define MINIMUM_STATISTICS_NOISE_SLOPE 2.F
+
 /* --------------------------------------------------------------- */
 /* ------------------- Denoiser configurations ------------------- */
 /* --------------------------------------------------------------- */
@@ -103,6 +157,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 // Fft configuration
 #define PADDING_CONFIGURATION_GENERAL NO_PADDING
 #define ZEROPADDING_AMOUNT_GENERAL 50 // Even Number
+#define FFT_TRANSFORM_TYPE_GENERAL HALFCOMPLEX_TRANSFORM
 
 // Spectral Type
 #define SPECTRAL_TYPE_GENERAL POWER_SPECTRUM
@@ -110,6 +165,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 // Transient protection
 #define UPPER_LIMIT 5.F
 #define DEFAULT_TRANSIENT_THRESHOLD 2.F
+// Hops the spectral flux is averaged over to adapt the detection threshold
+#define TRANSIENT_DETECTOR_WINDOW 64U
+// Most hops transient detection can look ahead of the frame being processed
+#define MAXIMUM_LOOK_AHEAD_HOPS 8U
+
+// Gain estimation - Most hops the reduction gains can be held between two
+// estimations
+#define MAXIMUM_GAIN_UPDATE_INTERVAL 8U
 
 // Masking
 #define CRITICAL_BANDS_TYPE OPUS_SCALE
@@ -117,13 +180,33 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 // Noise Estimator
 #define MIN_NUMBER_OF_WINDOWS_NOISE_AVERAGED 5
 #define NUMBER_OF_MEDIAN_SPECTRUM 5
+// Spectra followed by the decaying and windowed learn modes, and the number of
+// partial sums the windowed mode keeps of them
+#define NOISE_PROFILE_WINDOW_LENGTH 500U
+#define NOISE_PROFILE_SUBWINDOWS 8U
+// Frames learned into a profile before other threads see them in its snapshot
+#define NOISE_PROFILE_SNAPSHOT_INTERVAL 16U
 
 // Noise Scaling strategy
 #define GAIN_ESTIMATION_TYPE WIENER
 
+// Noise frame skipping - Frames with less power than this many dB above the
+// power of the noise profile are treated as only noise
+#define NOISE_FRAME_THRESHOLD 1.F
+
 // Time Smoothing
 #define TIME_SMOOTHING_TYPE TRANSIENT_AWARE
 
+// Offline processing - Audio processed before each segment in milliseconds so
+// recursive stages (smoothing, transient detection and whitening) converge
+#define OFFLINE_WARMUP_TIME 1000.F
+
+// Accelerated offline processing - Hops of every stream reduced by each
+// dispatch to the device and spectra a dispatch holds at most, which sets how
+// many streams go together
+#define ACCELERATOR_DISPATCH_HOPS 64U
+#define ACCELERATOR_DISPATCH_SPECTRA 8192U
+
 /* ------------------------------------------------------------------------ */
 /* ------------------- Adaptive Denoiser configurations ------------------- */
 /* ------------------------------------------------------------------------ */
@@ -136,6 +219,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 // Fft configurations
 #define PADDING_CONFIGURATION_SPEECH NO_PADDING
 #define ZEROPADDING_AMOUNT_SPEECH 50 // Even Number
+#define FFT_TRANSFORM_TYPE_SPEECH HALFCOMPLEX_TRANSFORM
 
 // Spectral Type
 #define SPECTRAL_TYPE_SPEECH POWER_SPECTRUM
@@ -20,32 +20,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "gain_estimators.h"
 #include "../configurations.h"
+#include "../utils/fast_math.h"
 #include "../utils/general_utils.h"
+#include "../utils/spectral_kernels.h"
 #include <float.h>
 #include <math.h>
 
-static void wiener_subtraction(const uint32_t real_spectrum_size,
-                               const uint32_t fft_size, const float *spectrum,
-                               const float *noise_spectrum,
-                               float *gain_spectrum) {
-  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
-    if (noise_spectrum[k] > FLT_MIN) {
-      if (spectrum[k] > noise_spectrum[k]) {
-        gain_spectrum[k] = (spectrum[k] - (noise_spectrum[k])) / spectrum[k];
-      } else {
-        gain_spectrum[k] = 0.F;
-      }
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
-    } else {
-      gain_spectrum[k] = 1.F;
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
-    }
-  }
-}
-
 static void spectral_gating(const uint32_t real_spectrum_size,
-                            const uint32_t fft_size, const float *spectrum,
-                            const float *noise_spectrum, float *gain_spectrum) {
+                            const float *spectrum, const float *noise_spectrum,
+                            float *gain_spectrum) {
   for (uint32_t k = 1U; k < real_spectrum_size; k++) {
     if (noise_spectrum[k] > FLT_MIN) {
       if (spectrum[k] >= noise_spectrum[k]) {
@@ -53,38 +36,67 @@ static void spectral_gating(const uint32_t real_spectrum_size,
       } else {
         gain_spectrum[k] = 0.F;
       }
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
     } else {
       gain_spectrum[k] = 1.F;
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
     }
   }
 }
 
+// GSS_EXPONENT is constant so these fold to multiplies or square roots for the
+// usual exponents and only the rest needs a power
+static inline float raise_to_gss_exponent(const float value,
+                                          const bool approximate_math) {
+  if (GSS_EXPONENT == 1.F) {
+    return value;
+  }
+  if (GSS_EXPONENT == 2.F) {
+    return value * value;
+  }
+  if (GSS_EXPONENT == 0.5F) {
+    return sqrtf(value);
+  }
+  if (approximate_math && value > 0.F) {
+    return fast_powf(value, GSS_EXPONENT);
+  }
+  return powf(value, GSS_EXPONENT);
+}
+
+static inline float take_gss_root(const float value,
+                                  const bool approximate_math) {
+  if (GSS_EXPONENT == 1.F) {
+    return value;
+  }
+  if (GSS_EXPONENT == 2.F) {
+    return sqrtf(value);
+  }
+  if (GSS_EXPONENT == 0.5F) {
+    return value * value;
+  }
+  if (approximate_math && value > 0.F) {
+    return fast_powf(value, 1.F / GSS_EXPONENT);
+  }
+  return powf(value, 1.F / GSS_EXPONENT);
+}
+
 static void generalized_spectral_subtraction(
-    const uint32_t real_spectrum_size, const uint32_t fft_size,
-    const float *spectrum, const float *noise_spectrum, float *gain_spectrum,
-    const float *alpha, const float *beta) {
+    const uint32_t real_spectrum_size, const float *spectrum,
+    const float *noise_spectrum, float *gain_spectrum, const float *alpha,
+    const float *beta, const bool approximate_math) {
   for (uint32_t k = 1U; k < real_spectrum_size; k++) {
     if (spectrum[k] > FLT_MIN) {
-      if (powf((noise_spectrum[k] / spectrum[k]), GSS_EXPONENT) <
-          (1.F / (alpha[k] + beta[k]))) {
-        gain_spectrum[k] =
-            fmaxf(powf(1.F - (alpha[k] * powf((noise_spectrum[k] / spectrum[k]),
-                                              GSS_EXPONENT)),
-                       1.F / GSS_EXPONENT),
-                  0.F);
+      const float noise_ratio = raise_to_gss_exponent(
+          noise_spectrum[k] / spectrum[k], approximate_math);
+
+      if (noise_ratio < (1.F / (alpha[k] + beta[k]))) {
+        gain_spectrum[k] = fmaxf(
+            take_gss_root(1.F - (alpha[k] * noise_ratio), approximate_math),
+            0.F);
       } else {
         gain_spectrum[k] =
-            fmaxf(powf(beta[k] * powf((noise_spectrum[k] / spectrum[k]),
-                                      GSS_EXPONENT),
-                       1.F / GSS_EXPONENT),
-                  0.F);
+            fmaxf(take_gss_root(beta[k] * noise_ratio, approximate_math), 0.F);
       }
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
     } else {
       gain_spectrum[k] = 1.F;
-      gain_spectrum[fft_size - k] = gain_spectrum[k];
     }
   }
 }
@@ -96,28 +108,36 @@ static void scale_noise_profile(uint32_t real_spectrum_size,
   }
 }
 
-void estimate_gains(uint32_t real_spectrum_size, uint32_t fft_size,
-                    const float *spectrum, float *noise_spectrum,
-                    float *gain_spectrum, const float *alpha, const float *beta,
-                    GainEstimationType type) {
-  switch (type) {
-  case GATES:
-    scale_noise_profile(real_spectrum_size, noise_spectrum, alpha);
-    spectral_gating(real_spectrum_size, fft_size, spectrum, noise_spectrum,
-                    gain_spectrum);
-    break;
-  case WIENER:
-    scale_noise_profile(real_spectrum_size, noise_spectrum, alpha);
-    wiener_subtraction(real_spectrum_size, fft_size, spectrum, noise_spectrum,
-                       gain_spectrum);
-    break;
-  case GENERALIZED_SPECTRALSUBTRACION:
-    generalized_spectral_subtraction(real_spectrum_size, fft_size, spectrum,
-                                     noise_spectrum, gain_spectrum, alpha,
-                                     beta);
-    break;
+void estimate_gating_gains(const uint32_t real_spectrum_size,
+                           const float *spectrum, float *noise_spectrum,
+                           float *gain_spectrum, const float *alpha) {
+  scale_noise_profile(real_spectrum_size, noise_spectrum, alpha);
+  spectral_gating(real_spectrum_size, spectrum, noise_spectrum, gain_spectrum);
+}
 
-  default:
-    break;
+void estimate_wiener_gains(const uint32_t real_spectrum_size,
+                           const float *spectrum, float *noise_spectrum,
+                           float *gain_spectrum, const float *alpha) {
+  scale_noise_profile(real_spectrum_size, noise_spectrum, alpha);
+  get_spectral_kernels()->wiener_gains(spectrum, noise_spectrum,
+                                       real_spectrum_size, gain_spectrum);
+}
+
+void estimate_subtraction_gains(const uint32_t real_spectrum_size,
+                                const float *spectrum,
+                                const float *noise_spectrum,
+                                float *gain_spectrum, const float *alpha,
+                                const float *beta,
+                                const bool approximate_math) {
+  // Power subtraction has vectorized kernels without the powf calls
+  if (GSS_EXPONENT == 2.F) {
+    get_spectral_kernels()->power_subtraction_gains(
+        spectrum, noise_spectrum, alpha, beta, real_spectrum_size,
+        gain_spectrum);
+    return;
   }
-}
\ No newline at end of file
+
+  generalized_spectral_subtraction(real_spectrum_size, spectrum,
+                                   noise_spectrum, gain_spectrum, alpha, beta,
+                                   approximate_math);
+}
@@ -30,9 +30,46 @@ typedef enum GainEstimationType {
   GENERALIZED_SPECTRALSUBTRACION = 2,
 } GainEstimationType;
 
-void estimate_gains(uint32_t real_spectrum_size, uint32_t fft_size,
-                    const float *spectrum, float *noise_spectrum,
-                    float *gain_spectrum, const float *alpha, const float *beta,
-                    GainEstimationType type);
+// Gains only cover the real half of the spectrum, from bin 1 up to Nyquist.
+// Gating and wiener scale the noise spectrum by alpha in place
+void estimate_gating_gains(uint32_t real_spectrum_size, const float *spectrum,
+                           float *noise_spectrum, float *gain_spectrum,
+                           const float *alpha);
+void estimate_wiener_gains(uint32_t real_spectrum_size, const float *spectrum,
+                           float *noise_spectrum, float *gain_spectrum,
+                           const float *alpha);
+void estimate_subtraction_gains(uint32_t real_spectrum_size,
+                                const float *spectrum,
+                                const float *noise_spectrum,
+                                float *gain_spectrum, const float *alpha,
+                                const float *beta, bool approximate_math);
+
+// Processors pick their estimator with a configuration constant, so being
+// inline the switch is resolved when they are compiled and only the call to
+// the estimator is left in the frame processing
+static inline void estimate_gains(const uint32_t real_spectrum_size,
+                                  const float *spectrum, float *noise_spectrum,
+                                  float *gain_spectrum, const float *alpha,
+                                  const float *beta,
+                                  const GainEstimationType type,
+                                  const bool approximate_math) {
+  switch (type) {
+  case GATES:
+    estimate_gating_gains(real_spectrum_size, spectrum, noise_spectrum,
+                          gain_spectrum, alpha);
+    break;
+  case WIENER:
+    estimate_wiener_gains(real_spectrum_size, spectrum, noise_spectrum,
+                          gain_spectrum, alpha);
+    break;
+  case GENERALIZED_SPECTRALSUBTRACION:
+    estimate_subtraction_gains(real_spectrum_size, spectrum, noise_spectrum,
+                               gain_spectrum, alpha, beta, approximate_math);
+    break;
+
+  default:
+    break;
+  }
+}
 
 #endif
\ No newline at end of file
@@ -21,77 +21,83 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "adaptive_noise_estimator.h"
 #include "../configurations.h"
 #include "../utils/general_utils.h"
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_kernels.h"
 #include "../utils/spectral_utils.h"
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct FrameSpectrum {
-  float *smoothed_spectrum;
-  float *local_minimum_spectrum;
-  float *speech_present_probability_spectrum;
-} FrameSpectrum;
-
-static FrameSpectrum *frame_spectrum_initialize(uint32_t frame_size);
-static void frame_spectrum_free(FrameSpectrum *self);
+static void noise_tracking_state_initialize(NoiseTrackingState *self,
+                                            uint32_t spectrum_size);
+static void noise_tracking_state_reset(NoiseTrackingState *self,
+                                       uint32_t spectrum_size);
+static void noise_tracking_state_free(NoiseTrackingState *self);
 static void compute_auto_thresholds(AdaptiveNoiseEstimator *self,
+                                    const uint32_t *first_bins,
                                     uint32_t sample_rate,
                                     uint32_t noise_spectrum_size,
                                     uint32_t fft_size);
-static void update_frame_spectums(AdaptiveNoiseEstimator *self,
-                                  const float *noise_spectrum);
 
 struct AdaptiveNoiseEstimator {
   uint32_t noise_spectrum_size;
-  float noisy_speech_ratio;
 
-  FrameSpectrum *current;
-  FrameSpectrum *previous;
+  // Two frames of state. The current one is written from the previous one
+  // and they are swapped afterwards instead of copying the spectra
+  NoiseTrackingState states[2];
+  NoiseTrackingState *current;
+  NoiseTrackingState *previous;
 
   float *minimum_detection_thresholds;
-  float *previous_noise_spectrum;
-  float *time_frequency_smoothing_constant;
-  uint32_t *speech_presence_detection;
 };
 
 AdaptiveNoiseEstimator *
 louizou_estimator_initialize(const uint32_t noise_spectrum_size,
                              const uint32_t sample_rate,
                              const uint32_t fft_size) {
-  AdaptiveNoiseEstimator *self =
-      (AdaptiveNoiseEstimator *)calloc(1U, sizeof(AdaptiveNoiseEstimator));
+  return louizou_estimator_initialize_bands(noise_spectrum_size, NULL,
+                                            sample_rate, fft_size);
+}
+
+AdaptiveNoiseEstimator *
+louizou_estimator_initialize_bands(const uint32_t noise_spectrum_size,
+                                   const uint32_t *first_bins,
+                                   const uint32_t sample_rate,
+                                   const uint32_t fft_size) {
+  AdaptiveNoiseEstimator *self = (AdaptiveNoiseEstimator *)spectral_calloc(
+      1U, sizeof(AdaptiveNoiseEstimator));
 
   self->noise_spectrum_size = noise_spectrum_size;
 
   self->minimum_detection_thresholds =
-      (float *)calloc(self->noise_spectrum_size, sizeof(float));
-  self->time_frequency_smoothing_constant =
-      (float *)calloc(self->noise_spectrum_size, sizeof(float));
-  self->speech_presence_detection =
-      (uint32_t *)calloc(self->noise_spectrum_size, sizeof(uint32_t));
-  self->previous_noise_spectrum =
-      (float *)calloc(self->noise_spectrum_size, sizeof(float));
-
-  compute_auto_thresholds(self, sample_rate, noise_spectrum_size, fft_size);
-  self->current = frame_spectrum_initialize(noise_spectrum_size);
-  self->previous = frame_spectrum_initialize(noise_spectrum_size);
+      (float *)spectral_calloc(self->noise_spectrum_size, sizeof(float));
 
-  self->noisy_speech_ratio = 0.F;
+  compute_auto_thresholds(self, first_bins, sample_rate, noise_spectrum_size,
+                          fft_size);
+  noise_tracking_state_initialize(&self->states[0], noise_spectrum_size);
+  noise_tracking_state_initialize(&self->states[1], noise_spectrum_size);
+  self->current = &self->states[0];
+  self->previous = &self->states[1];
 
   return self;
 }
 
 void louizou_estimator_free(AdaptiveNoiseEstimator *self) {
-  free(self->minimum_detection_thresholds);
-  free(self->time_frequency_smoothing_constant);
-  free(self->speech_presence_detection);
-  free(self->previous_noise_spectrum);
+  spectral_free(self->minimum_detection_thresholds);
 
-  frame_spectrum_free(self->current);
-  frame_spectrum_free(self->previous);
+  noise_tracking_state_free(&self->states[0]);
+  noise_tracking_state_free(&self->states[1]);
 
-  free(self);
+  spectral_free(self);
+}
+
+void louizou_estimator_reset(AdaptiveNoiseEstimator *self) {
+  for (uint32_t k = 0U; k < 2U; k++) {
+    noise_tracking_state_reset(&self->states[k], self->noise_spectrum_size);
+  }
+  self->current = &self->states[0];
+  self->previous = &self->states[1];
 }
 
 bool louizou_estimator_run(AdaptiveNoiseEstimator *self, const float *spectrum,
@@ -100,102 +106,64 @@ bool louizou_estimator_run(AdaptiveNoiseEstimator *self, const float *spectrum,
     return false;
   }
 
-  for (uint32_t k = 1U; k < self->noise_spectrum_size; k++) {
-    self->current->smoothed_spectrum[k] =
-        N_SMOOTH * self->previous->smoothed_spectrum[k] +
-        (1.F - N_SMOOTH) * spectrum[k];
-
-    if (self->previous->local_minimum_spectrum[k] <
-        self->current->smoothed_spectrum[k]) {
-      self->current->local_minimum_spectrum[k] =
-          GAMMA * self->previous->local_minimum_spectrum[k] +
-          ((1.F - GAMMA) / (1.F - BETA_AT)) *
-              (self->current->smoothed_spectrum[k] -
-               BETA_AT * self->previous->smoothed_spectrum[k]);
-    } else {
-      self->current->local_minimum_spectrum[k] =
-          self->current->smoothed_spectrum[k];
-    }
-
-    self->noisy_speech_ratio =
-        sanitize_denormal(self->current->smoothed_spectrum[k] /
-                          self->current->local_minimum_spectrum[k]);
-
-    if (self->noisy_speech_ratio > self->minimum_detection_thresholds[k]) {
-      self->speech_presence_detection[k] = 1U;
-    } else {
-      self->speech_presence_detection[k] = 0U;
-    }
-
-    self->current->speech_present_probability_spectrum[k] =
-        ALPHA_P * self->previous->speech_present_probability_spectrum[k] +
-        (1.F - ALPHA_P) * (float)self->speech_presence_detection[k];
-
-    self->time_frequency_smoothing_constant[k] =
-        ALPHA_D +
-        (1.F - ALPHA_D) * self->current->speech_present_probability_spectrum[k];
+  get_spectral_kernels()->track_noise(
+      spectrum, self->minimum_detection_thresholds, self->previous,
+      self->current, noise_spectrum, self->noise_spectrum_size);
 
-    noise_spectrum[k] =
-        self->time_frequency_smoothing_constant[k] *
-            self->previous_noise_spectrum[k] +
-        (1.F - self->time_frequency_smoothing_constant[k]) * spectrum[k];
-  }
-
-  update_frame_spectums(self, noise_spectrum);
+  NoiseTrackingState *previous = self->previous;
+  self->previous = self->current;
+  self->current = previous;
 
   return true;
 }
 
-static void update_frame_spectums(AdaptiveNoiseEstimator *self,
-                                  const float *noise_spectrum) {
-  memcpy(self->previous_noise_spectrum, noise_spectrum,
-         sizeof(float) * self->noise_spectrum_size);
-  memcpy(self->previous->local_minimum_spectrum,
-         self->current->local_minimum_spectrum,
-         sizeof(float) * self->noise_spectrum_size);
-  memcpy(self->previous->smoothed_spectrum, self->current->smoothed_spectrum,
-         sizeof(float) * self->noise_spectrum_size);
-  memcpy(self->previous->speech_present_probability_spectrum,
-         self->current->speech_present_probability_spectrum,
-         sizeof(float) * self->noise_spectrum_size);
+static void noise_tracking_state_initialize(NoiseTrackingState *self,
+                                            const uint32_t spectrum_size) {
+  self->smoothed_spectrum =
+      (float *)spectral_calloc(spectrum_size, sizeof(float));
+  self->local_minimum_spectrum =
+      (float *)spectral_calloc(spectrum_size, sizeof(float));
+  self->speech_presence_probability =
+      (float *)spectral_calloc(spectrum_size, sizeof(float));
+  self->noise_spectrum = (float *)spectral_calloc(spectrum_size, sizeof(float));
+
+  noise_tracking_state_reset(self, spectrum_size);
 }
 
-static FrameSpectrum *frame_spectrum_initialize(const uint32_t frame_size) {
-  FrameSpectrum *self = (FrameSpectrum *)calloc(1U, sizeof(FrameSpectrum));
-
-  self->smoothed_spectrum = (float *)calloc(frame_size, sizeof(float));
-  self->local_minimum_spectrum = (float *)calloc(frame_size, sizeof(float));
-  self->speech_present_probability_spectrum =
-      (float *)calloc(frame_size, sizeof(float));
-
-  initialize_spectrum_with_value(self->local_minimum_spectrum, frame_size,
+static void noise_tracking_state_reset(NoiseTrackingState *self,
+                                       const uint32_t spectrum_size) {
+  memset(self->smoothed_spectrum, 0, spectrum_size * sizeof(float));
+  memset(self->speech_presence_probability, 0, spectrum_size * sizeof(float));
+  memset(self->noise_spectrum, 0, spectrum_size * sizeof(float));
+  initialize_spectrum_with_value(self->local_minimum_spectrum, spectrum_size,
                                  FLT_MIN);
-
-  return self;
 }
 
-static void frame_spectrum_free(FrameSpectrum *self) {
-  free(self->smoothed_spectrum);
-  free(self->local_minimum_spectrum);
-  free(self->speech_present_probability_spectrum);
-
-  free(self);
+static void noise_tracking_state_free(NoiseTrackingState *self) {
+  spectral_free(self->smoothed_spectrum);
+  spectral_free(self->local_minimum_spectrum);
+  spectral_free(self->speech_presence_probability);
+  spectral_free(self->noise_spectrum);
 }
 
+// Without first bins every element of the spectra is a bin
 static void compute_auto_thresholds(AdaptiveNoiseEstimator *self,
+                                    const uint32_t *first_bins,
                                     const uint32_t sample_rate,
                                     const uint32_t noise_spectrum_size,
                                     const uint32_t fft_size) {
   uint32_t LF = freq_to_fft_bin(CROSSOVER_POINT1, sample_rate, fft_size);
   uint32_t MF = freq_to_fft_bin(CROSSOVER_POINT2, sample_rate, fft_size);
   for (uint32_t k = 0U; k < noise_spectrum_size; k++) {
-    if (k <= LF) {
+    const uint32_t bin = first_bins ? first_bins[k] : k;
+
+    if (bin <= LF) {
       self->minimum_detection_thresholds[k] = BAND_1_LEVEL;
     }
-    if (k > LF && k < MF) {
+    if (bin > LF && bin < MF) {
       self->minimum_detection_thresholds[k] = BAND_2_LEVEL;
     }
-    if (k >= MF) {
+    if (bin >= MF) {
       self->minimum_detection_thresholds[k] = BAND_3_LEVEL;
     }
   }
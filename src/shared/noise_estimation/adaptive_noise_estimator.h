@@ -29,7 +29,14 @@ typedef struct AdaptiveNoiseEstimator AdaptiveNoiseEstimator;
 AdaptiveNoiseEstimator *
 louizou_estimator_initialize(uint32_t noise_spectrum_size, uint32_t sample_rate,
                              uint32_t fft_size);
+// Tracks noise on bands instead of bins. Element k of the spectra starts at
+// bin first_bins[k], which sets the speech detection threshold it uses
+AdaptiveNoiseEstimator *
+louizou_estimator_initialize_bands(uint32_t noise_spectrum_size,
+                                   const uint32_t *first_bins,
+                                   uint32_t sample_rate, uint32_t fft_size);
 void louizou_estimator_free(AdaptiveNoiseEstimator *self);
+void louizou_estimator_reset(AdaptiveNoiseEstimator *self);
 bool louizou_estimator_run(AdaptiveNoiseEstimator *self, const float *spectrum,
                            float *noise_spectrum);
 
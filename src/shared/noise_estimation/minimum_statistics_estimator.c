@@ -0,0 +1,197 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "minimum_statistics_estimator.h"
+#include "../configurations.h"
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_utils.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static float get_bias_compensation(float smoothing);
+static void finish_subwindow(MinimumStatisticsEstimator *self);
+
+struct MinimumStatisticsEstimator {
+  uint32_t noise_spectrum_size;
+  uint32_t subwindow_length;
+  uint32_t subwindow_frames;
+  uint32_t subwindow_index;
+  float smoothing;
+  float bias_compensation;
+  bool first_frame;
+
+  float *smoothed_spectrum;
+  // Minimum of the sub window being filled and of the stored ones
+  float *subwindow_minimum;
+  float *window_minimum;
+  // One spectrum of minimums per sub window, used as a ring
+  float *stored_minimums;
+};
+
+MinimumStatisticsEstimator *
+minimum_statistics_estimator_initialize(const uint32_t noise_spectrum_size,
+                                        const uint32_t sample_rate,
+                                        const uint32_t hop) {
+  MinimumStatisticsEstimator *self =
+      (MinimumStatisticsEstimator *)spectral_calloc(
+          1U, sizeof(MinimumStatisticsEstimator));
+
+  self->noise_spectrum_size = noise_spectrum_size;
+  self->first_frame = true;
+
+  const float hop_time = (float)hop / (float)sample_rate;
+  self->smoothing = expf(-hop_time / MINIMUM_STATISTICS_SMOOTHING_TIME);
+  self->subwindow_length = (uint32_t)fmaxf(
+      roundf(MINIMUM_STATISTICS_WINDOW /
+             (hop_time * (float)MINIMUM_STATISTICS_SUBWINDOWS)),
+      1.F);
+  self->bias_compensation = get_bias_compensation(self->smoothing);
+
+  self->smoothed_spectrum =
+      (float *)spectral_calloc(self->noise_spectrum_size, sizeof(float));
+  self->subwindow_minimum =
+      (float *)spectral_calloc(self->noise_spectrum_size, sizeof(float));
+  self->window_minimum =
+      (float *)spectral_calloc(self->noise_spectrum_size, sizeof(float));
+  self->stored_minimums = (float *)spectral_calloc(
+      (size_t)self->noise_spectrum_size * MINIMUM_STATISTICS_SUBWINDOWS,
+      sizeof(float));
+
+  initialize_spectrum_with_value(self->subwindow_minimum,
+                                 self->noise_spectrum_size, FLT_MAX);
+  initialize_spectrum_with_value(self->window_minimum,
+                                 self->noise_spectrum_size, FLT_MAX);
+  initialize_spectrum_with_value(self->stored_minimums,
+                                 self->noise_spectrum_size *
+                                     MINIMUM_STATISTICS_SUBWINDOWS,
+                                 FLT_MAX);
+
+  return self;
+}
+
+void minimum_statistics_estimator_free(MinimumStatisticsEstimator *self) {
+  spectral_free(self->smoothed_spectrum);
+  spectral_free(self->subwindow_minimum);
+  spectral_free(self->window_minimum);
+  spectral_free(self->stored_minimums);
+
+  spectral_free(self);
+}
+
+void minimum_statistics_estimator_reset(MinimumStatisticsEstimator *self) {
+  self->first_frame = true;
+  self->subwindow_frames = 0U;
+  self->subwindow_index = 0U;
+
+  memset(self->smoothed_spectrum, 0, self->noise_spectrum_size * sizeof(float));
+  initialize_spectrum_with_value(self->subwindow_minimum,
+                                 self->noise_spectrum_size, FLT_MAX);
+  initialize_spectrum_with_value(self->window_minimum,
+                                 self->noise_spectrum_size, FLT_MAX);
+  initialize_spectrum_with_value(self->stored_minimums,
+                                 self->noise_spectrum_size *
+                                     MINIMUM_STATISTICS_SUBWINDOWS,
+                                 FLT_MAX);
+}
+
+bool minimum_statistics_estimator_run(MinimumStatisticsEstimator *self,
+                                      const float *spectrum,
+                                      float *noise_spectrum) {
+  if (!self || !spectrum || !noise_spectrum) {
+    return false;
+  }
+
+  if (self->first_frame) {
+    memcpy(self->smoothed_spectrum, spectrum,
+           sizeof(float) * self->noise_spectrum_size);
+    self->first_frame = false;
+  }
+
+  const float smoothing = self->smoothing;
+  const float bias_compensation = self->bias_compensation;
+  for (uint32_t k = 1U; k < self->noise_spectrum_size; k++) {
+    self->smoothed_spectrum[k] = smoothing * self->smoothed_spectrum[k] +
+                                 (1.F - smoothing) * spectrum[k];
+    self->subwindow_minimum[k] =
+        fminf(self->subwindow_minimum[k], self->smoothed_spectrum[k]);
+
+    noise_spectrum[k] =
+        bias_compensation *
+        fminf(self->window_minimum[k], self->subwindow_minimum[k]);
+  }
+
+  self->subwindow_frames++;
+  if (self->subwindow_frames == self->subwindow_length) {
+    finish_subwindow(self);
+  }
+
+  return true;
+}
+
+// Minimums fall below the mean of the noise, more so the less the spectrum is
+// smoothed. Smoothed noise power has about 2 * (1 + a) / (1 - a) degrees of
+// freedom and the ratio between its minimum over the window and its mean was
+// fitted on white noise from those. It is within 0.3 dB for hops of 5ms to 40ms
+static float get_bias_compensation(const float smoothing) {
+  const float degrees_of_freedom = 2.F * (1.F + smoothing) / (1.F - smoothing);
+  const float minimum_ratio =
+      1.F - 1.92F / sqrtf(degrees_of_freedom) + 1.63F / degrees_of_freedom;
+
+  return 1.F / minimum_ratio;
+}
+
+// Stores the minimum of the sub window replacing the oldest one. The whole
+// search is only repeated here, once every sub window, which keeps the cost
+// per frame constant
+static void finish_subwindow(MinimumStatisticsEstimator *self) {
+  const uint32_t size = self->noise_spectrum_size;
+  float *newest = &self->stored_minimums[self->subwindow_index * size];
+
+  for (uint32_t k = 1U; k < size; k++) {
+    const float minimum = self->subwindow_minimum[k];
+
+    // A minimum slightly above the stored ones means the noise level rose, so
+    // it takes over the whole window instead of waiting for them to expire
+    if (minimum > self->window_minimum[k] &&
+        minimum < MINIMUM_STATISTICS_NOISE_SLOPE * self->window_minimum[k]) {
+      for (uint32_t u = 0U; u < MINIMUM_STATISTICS_SUBWINDOWS; u++) {
+        self->stored_minimums[u * size + k] = minimum;
+      }
+      self->window_minimum[k] = minimum;
+    } else {
+      newest[k] = minimum;
+
+      float window_minimum = FLT_MAX;
+      for (uint32_t u = 0U; u < MINIMUM_STATISTICS_SUBWINDOWS; u++) {
+        window_minimum =
+            fminf(window_minimum, self->stored_minimums[u * size + k]);
+      }
+      self->window_minimum[k] = window_minimum;
+    }
+
+    self->subwindow_minimum[k] = FLT_MAX;
+  }
+
+  self->subwindow_index =
+      (self->subwindow_index + 1U) % MINIMUM_STATISTICS_SUBWINDOWS;
+  self->subwindow_frames = 0U;
+}
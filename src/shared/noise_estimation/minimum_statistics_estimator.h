@@ -0,0 +1,43 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MINIMUM_STATISTICS_ESTIMATOR_H
+#define MINIMUM_STATISTICS_ESTIMATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct MinimumStatisticsEstimator MinimumStatisticsEstimator;
+
+// Minimum statistics noise tracker. The noise is the minimum of the smoothed
+// spectrum over a window of about a second and a half, searched in sub windows
+// so each frame only compares against their stored minimums. It follows noise
+// level changes within a window, at the same per bin cost as the continuous
+// minimum tracker it can replace
+MinimumStatisticsEstimator *
+minimum_statistics_estimator_initialize(uint32_t noise_spectrum_size,
+                                        uint32_t sample_rate, uint32_t hop);
+void minimum_statistics_estimator_free(MinimumStatisticsEstimator *self);
+void minimum_statistics_estimator_reset(MinimumStatisticsEstimator *self);
+bool minimum_statistics_estimator_run(MinimumStatisticsEstimator *self,
+                                      const float *spectrum,
+                                      float *noise_spectrum);
+
+#endif
@@ -20,8 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "noise_estimator.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_features.h"
-#include "../utils/spectral_trailing_buffer.h"
+#include "../utils/spectral_rolling_median.h"
 #include "../utils/spectral_utils.h"
 #include <stdlib.h>
 #include <string.h>
@@ -29,22 +30,57 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 struct NoiseEstimator {
   uint32_t fft_size;
   uint32_t real_spectrum_size;
-  SpectralTrailingBuffer *median_buffer;
+  SpectralRollingMedian *rolling_median;
+
+  // Windowed mean as sums of consecutive runs of spectra. The window adds up
+  // the completed runs and is only summed again when one completes
+  uint32_t profile_window_length;
+  uint32_t subwindow_length;
+  float *subwindow_sums;
+  uint32_t completed_subwindows;
+  uint32_t subwindow_position;
+  float *window_sum;
+  float *partial_sum;
+  uint32_t partial_count;
 
   NoiseProfile *noise_profile;
 };
 
-NoiseEstimator *noise_estimation_initialize(const uint32_t fft_size,
-                                            NoiseProfile *noise_profile) {
-  NoiseEstimator *self = (NoiseEstimator *)calloc(1U, sizeof(NoiseEstimator));
+static void clear_window(NoiseEstimator *self);
+static void update_windowed_mean(NoiseEstimator *self, float *noise_profile,
+                                 const float *signal_spectrum);
+
+NoiseEstimator *
+noise_estimation_initialize(const uint32_t fft_size,
+                            const uint32_t median_window_length,
+                            const uint32_t profile_window_length,
+                            NoiseProfile *noise_profile) {
+  NoiseEstimator *self =
+      (NoiseEstimator *)spectral_calloc(1U, sizeof(NoiseEstimator));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
 
   self->noise_profile = noise_profile;
 
-  self->median_buffer = spectral_trailing_buffer_initialize(
-      self->real_spectrum_size, NUMBER_OF_MEDIAN_SPECTRUM);
+  self->rolling_median = spectral_rolling_median_initialize(
+      self->real_spectrum_size, median_window_length > 0U
+                                    ? median_window_length
+                                    : NUMBER_OF_MEDIAN_SPECTRUM);
+
+  self->profile_window_length = profile_window_length > 0U
+                                    ? profile_window_length
+                                    : NOISE_PROFILE_WINDOW_LENGTH;
+  self->subwindow_length =
+      (self->profile_window_length + NOISE_PROFILE_SUBWINDOWS - 1U) /
+      NOISE_PROFILE_SUBWINDOWS;
+  self->subwindow_sums = (float *)spectral_calloc(
+      (size_t)NOISE_PROFILE_SUBWINDOWS * self->real_spectrum_size,
+      sizeof(float));
+  self->window_sum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  self->partial_sum =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
   return self;
 }
@@ -53,14 +89,34 @@ void noise_estimation_free(NoiseEstimator *self) {
 
   // Don't free noise profile used as reference here
 
-  spectral_trailing_buffer_free(self->median_buffer);
+  spectral_rolling_median_free(self->rolling_median);
+  spectral_free(self->subwindow_sums);
+  spectral_free(self->window_sum);
+  spectral_free(self->partial_sum);
+
+  spectral_free(self);
+}
+
+// The profile is left alone, it's reset on its own
+void noise_estimation_reset(NoiseEstimator *self) {
+  spectral_rolling_median_reset(self->rolling_median);
+  clear_window(self);
+}
 
-  free(self);
+static void clear_window(NoiseEstimator *self) {
+  memset(self->subwindow_sums, 0,
+         (size_t)NOISE_PROFILE_SUBWINDOWS * self->real_spectrum_size *
+             sizeof(float));
+  memset(self->window_sum, 0, self->real_spectrum_size * sizeof(float));
+  memset(self->partial_sum, 0, self->real_spectrum_size * sizeof(float));
+  self->completed_subwindows = 0U;
+  self->subwindow_position = 0U;
+  self->partial_count = 0U;
 }
 
 bool noise_estimation_run(NoiseEstimator *self,
                           const NoiseEstimatorType noise_estimator_type,
-                          float *signal_spectrum) {
+                          const float *signal_spectrum) {
   if (!self || !signal_spectrum) {
     return false;
   }
@@ -76,23 +132,86 @@ bool noise_estimation_run(NoiseEstimator *self,
     increment_blocks_averaged(self->noise_profile);
     break;
   case MEDIAN:
-    spectral_trailing_buffer_push_back(self->median_buffer, signal_spectrum);
-    bool is_valid_median = get_rolling_median_spectrum(
-        noise_profile, get_trailing_spectral_buffer(self->median_buffer),
-        get_spectrum_buffer_size(self->median_buffer),
-        get_spectrum_size(self->median_buffer));
-    if (is_valid_median) {
-      set_noise_profile_available(self->noise_profile);
+    spectral_rolling_median_push(self->rolling_median, signal_spectrum);
+
+    // Taking the max of the median
+    for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
+      const float median = get_rolling_median_bin(self->rolling_median, k);
+      if (median > noise_profile[k]) {
+        noise_profile[k] = median;
+      }
     }
+    set_noise_profile_available(self->noise_profile);
     break;
   case MAX:
     max_spectrum(noise_profile, signal_spectrum, self->real_spectrum_size);
     set_noise_profile_available(self->noise_profile);
     break;
+  case DECAYING_MEAN: {
+    const uint32_t blocks_averaged =
+        get_noise_profile_blocks_averaged(self->noise_profile);
+    get_rolling_mean_spectrum(noise_profile, signal_spectrum,
+                              blocks_averaged < self->profile_window_length
+                                  ? blocks_averaged
+                                  : self->profile_window_length,
+                              self->real_spectrum_size);
+    increment_blocks_averaged(self->noise_profile);
+    break;
+  }
+  case WINDOWED_MEAN:
+    update_windowed_mean(self, noise_profile, signal_spectrum);
+    increment_blocks_averaged(self->noise_profile);
+    break;
 
   default:
     break;
   }
 
+  increment_noise_profile_generation(self->noise_profile);
+
   return true;
 }
+
+static void update_windowed_mean(NoiseEstimator *self, float *noise_profile,
+                                 const float *signal_spectrum) {
+  const uint32_t size = self->real_spectrum_size;
+
+  // A profile reset or loaded from scratch starts a new window
+  if (get_noise_profile_blocks_averaged(self->noise_profile) == 0U) {
+    clear_window(self);
+  }
+
+  for (uint32_t k = 0U; k < size; k++) {
+    self->partial_sum[k] += signal_spectrum[k];
+  }
+  self->partial_count++;
+
+  if (self->partial_count == self->subwindow_length) {
+    // The completed run replaces the oldest one once the window is full
+    memcpy(&self->subwindow_sums[(size_t)self->subwindow_position * size],
+           self->partial_sum, size * sizeof(float));
+    self->subwindow_position =
+        (self->subwindow_position + 1U) % NOISE_PROFILE_SUBWINDOWS;
+    if (self->completed_subwindows < NOISE_PROFILE_SUBWINDOWS) {
+      self->completed_subwindows++;
+    }
+
+    memset(self->window_sum, 0, size * sizeof(float));
+    for (uint32_t s = 0U; s < self->completed_subwindows; s++) {
+      const float *subwindow_sum = &self->subwindow_sums[(size_t)s * size];
+      for (uint32_t k = 0U; k < size; k++) {
+        self->window_sum[k] += subwindow_sum[k];
+      }
+    }
+    memset(self->partial_sum, 0, size * sizeof(float));
+    self->partial_count = 0U;
+  }
+
+  const float normalization =
+      1.F / (float)(self->completed_subwindows * self->subwindow_length +
+                    self->partial_count);
+  for (uint32_t k = 1U; k < size; k++) {
+    noise_profile[k] =
+        (self->window_sum[k] + self->partial_sum[k]) * normalization;
+  }
+}
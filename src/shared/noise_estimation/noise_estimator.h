@@ -32,13 +32,25 @@ typedef enum NoiseEstimatorType {
   ROLLING_MEAN = 1,
   MEDIAN = 2,
   MAX = 3,
+  // Averages that keep adapting on long streams. The decaying mean weights
+  // spectra exponentially less with age, as an average that never counts more
+  // than the window length of them. The windowed mean averages about the last
+  // window length spectra
+  DECAYING_MEAN = 4,
+  WINDOWED_MEAN = 5,
 } NoiseEstimatorType;
 
+// The median estimator considers the last median_window_length spectra and
+// the decaying and windowed means profile_window_length of them. Zero uses the
+// default lengths
 NoiseEstimator *noise_estimation_initialize(uint32_t fft_size,
+                                            uint32_t median_window_length,
+                                            uint32_t profile_window_length,
                                             NoiseProfile *noise_profile);
 void noise_estimation_free(NoiseEstimator *self);
+void noise_estimation_reset(NoiseEstimator *self);
 bool noise_estimation_run(NoiseEstimator *self,
                           NoiseEstimatorType noise_estimator_type,
-                          float *signal_spectrum);
+                          const float *signal_spectrum);
 
 #endif
\ No newline at end of file
@@ -20,81 +20,185 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "noise_profile.h"
 #include "../configurations.h"
-#include "../utils/spectral_utils.h"
-#include <stdlib.h>
+#include "../utils/memory_arena.h"
+#include "../utils/parameter_exchange.h"
+#include <pthread.h>
 #include <string.h>
 
+// Everything that changes together when a profile is loaded
+typedef struct NoiseProfileVersion {
+  uint32_t blocks_averaged;
+  bool available;
+  float spectrum[];
+} NoiseProfileVersion;
+
 struct NoiseProfile {
   uint32_t noise_profile_size;
-  uint32_t noise_profile_blocks_averaged;
-  float *noise_profile;
-  bool noise_spectrum_available;
+  // Changes with every modification of the profile so users can cache values
+  // derived from it
+  uint32_t generation;
+
+  // Versions loaded from other threads. The processing thread owns the one
+  // being used
+  ParameterExchange *versions;
+  NoiseProfileVersion *current;
+
+  // Sequence lock around the snapshot read by other threads. It is odd while
+  // the snapshot is being written. Writers are serialized by the mutex but the
+  // processing thread only tries to take it and, if it is busy, refreshes the
+  // snapshot on its next change instead of waiting
+  pthread_mutex_t snapshot_mutex;
+  uint32_t snapshot_sequence;
+  // Changes of the processing thread the snapshot doesn't hold yet
+  uint32_t unpublished_changes;
+  uint32_t snapshot_blocks_averaged;
+  uint32_t snapshot_available;
+  // Bit patterns of the spectrum so they can be accessed atomically
+  uint32_t *snapshot_spectrum;
 };
 
+static void write_snapshot(NoiseProfile *self,
+                           const NoiseProfileVersion *version);
+static void refresh_snapshot(NoiseProfile *self);
+static void mark_modified(NoiseProfile *self);
+
 NoiseProfile *noise_profile_initialize(const uint32_t size) {
-  NoiseProfile *self = (NoiseProfile *)calloc(1U, sizeof(NoiseProfile));
+  NoiseProfile *self =
+      (NoiseProfile *)spectral_calloc(1U, sizeof(NoiseProfile));
   self->noise_profile_size = size;
-  self->noise_profile_blocks_averaged = 0U;
-  self->noise_spectrum_available = false;
+  self->generation = 1U;
+
+  self->versions = parameter_exchange_initialize(
+      sizeof(NoiseProfileVersion) + (size_t)size * sizeof(float));
+  self->current =
+      (NoiseProfileVersion *)get_parameter_exchange_current(self->versions);
 
-  self->noise_profile = (float *)calloc(size, sizeof(float));
+  pthread_mutex_init(&self->snapshot_mutex, NULL);
+  self->snapshot_spectrum = (uint32_t *)spectral_calloc(size, sizeof(uint32_t));
 
   return self;
 }
 
 void noise_profile_free(NoiseProfile *self) {
-  free(self->noise_profile);
+  pthread_mutex_destroy(&self->snapshot_mutex);
+  parameter_exchange_free(self->versions);
+  spectral_free(self->snapshot_spectrum);
 
-  free(self);
+  spectral_free(self);
 }
 
 bool is_noise_estimation_available(NoiseProfile *self) {
-  return self->noise_spectrum_available;
+  return self->current->available;
 }
 
-float *get_noise_profile(NoiseProfile *self) { return self->noise_profile; }
+float *get_noise_profile(NoiseProfile *self) { return self->current->spectrum; }
 
 uint32_t get_noise_profile_size(NoiseProfile *self) {
   return self->noise_profile_size;
 }
 
 uint32_t get_noise_profile_blocks_averaged(NoiseProfile *self) {
-  return self->noise_profile_blocks_averaged;
+  return self->current->blocks_averaged;
 }
+
+uint32_t get_noise_profile_generation(NoiseProfile *self) {
+  return self->generation;
+}
+
+void increment_noise_profile_generation(NoiseProfile *self) {
+  mark_modified(self);
+
+  // Learning changes the profile on every frame, so copying all of it for
+  // other threads each time would cost as much as learning itself
+  if (self->unpublished_changes >= NOISE_PROFILE_SNAPSHOT_INTERVAL) {
+    refresh_snapshot(self);
+  }
+}
+
+void publish_noise_profile_snapshot(NoiseProfile *self) {
+  if (self->unpublished_changes > 0U) {
+    refresh_snapshot(self);
+  }
+}
+
 void set_noise_profile_available(NoiseProfile *self) {
-  self->noise_spectrum_available = true;
+  self->current->available = true;
 }
 
-bool set_noise_profile(NoiseProfile *self, const float *noise_profile,
-                       const uint32_t noise_profile_size,
-                       const uint32_t noise_profile_blocks_averaged) {
-  if (!self || !noise_profile ||
-      noise_profile_size != self->noise_profile_size) {
+bool increment_blocks_averaged(NoiseProfile *self) {
+  if (!self) {
     return false;
   }
-  memcpy(self->noise_profile, noise_profile,
-         noise_profile_size * sizeof(float));
 
-  self->noise_profile_size = noise_profile_size;
-  self->noise_profile_blocks_averaged = noise_profile_blocks_averaged;
-  self->noise_spectrum_available = true;
+  self->current->blocks_averaged++;
+
+  if (self->current->blocks_averaged > MIN_NUMBER_OF_WINDOWS_NOISE_AVERAGED &&
+      !self->current->available) {
+    self->current->available = true;
+  }
 
   return true;
 }
 
-bool increment_blocks_averaged(NoiseProfile *self) {
+bool update_noise_profile(NoiseProfile *self) {
   if (!self) {
     return false;
   }
 
-  self->noise_profile_blocks_averaged++;
+  const NoiseProfileVersion *loaded =
+      (const NoiseProfileVersion *)parameter_exchange_consume(self->versions);
+  if (!loaded) {
+    return false;
+  }
+
+  self->current = (NoiseProfileVersion *)loaded;
+  mark_modified(self);
+  refresh_snapshot(self);
+
+  return true;
+}
 
-  if (self->noise_profile_blocks_averaged >
-          MIN_NUMBER_OF_WINDOWS_NOISE_AVERAGED &&
-      !self->noise_spectrum_available) {
-    self->noise_spectrum_available = true;
+bool clear_noise_profile(NoiseProfile *self) {
+  if (!self) {
+    return false;
   }
 
+  memset(self->current->spectrum, 0,
+         (size_t)self->noise_profile_size * sizeof(float));
+  self->current->blocks_averaged = 0U;
+  self->current->available = false;
+  mark_modified(self);
+  refresh_snapshot(self);
+
+  return true;
+}
+
+bool set_noise_profile(NoiseProfile *self, const float *noise_profile,
+                       const uint32_t noise_profile_size,
+                       const uint32_t noise_profile_blocks_averaged) {
+  if (!self || noise_profile_size != self->noise_profile_size) {
+    return false;
+  }
+
+  NoiseProfileVersion *version =
+      (NoiseProfileVersion *)parameter_exchange_begin_publish(self->versions);
+  if (noise_profile) {
+    memcpy(version->spectrum, noise_profile,
+           noise_profile_size * sizeof(float));
+  } else {
+    memset(version->spectrum, 0, noise_profile_size * sizeof(float));
+  }
+  version->blocks_averaged = noise_profile_blocks_averaged;
+  version->available = noise_profile != NULL;
+
+  // Other threads see the loaded profile right away even if the processing
+  // thread takes it later
+  pthread_mutex_lock(&self->snapshot_mutex);
+  write_snapshot(self, version);
+  pthread_mutex_unlock(&self->snapshot_mutex);
+
+  parameter_exchange_end_publish(self->versions);
+
   return true;
 }
 
@@ -103,10 +207,93 @@ bool reset_noise_profile(NoiseProfile *self) {
     return false;
   }
 
-  initialize_spectrum_with_value(self->noise_profile, self->noise_profile_size,
-                                 0.F);
-  self->noise_profile_blocks_averaged = 0U;
-  self->noise_spectrum_available = false;
+  return set_noise_profile(self, NULL, self->noise_profile_size, 0U);
+}
+
+bool copy_noise_profile_snapshot(NoiseProfile *self, float *noise_profile,
+                                 uint32_t *averaged_blocks, bool *available) {
+  if (!self) {
+    return false;
+  }
+
+  uint32_t blocks_averaged = 0U;
+  uint32_t spectrum_available = 0U;
+  uint32_t sequence = 0U;
+
+  do {
+    // Retry while a writer is in the middle of the snapshot
+    do {
+      sequence = __atomic_load_n(&self->snapshot_sequence, __ATOMIC_ACQUIRE);
+    } while ((sequence & 1U) != 0U);
+
+    blocks_averaged =
+        __atomic_load_n(&self->snapshot_blocks_averaged, __ATOMIC_RELAXED);
+    spectrum_available =
+        __atomic_load_n(&self->snapshot_available, __ATOMIC_RELAXED);
+    if (noise_profile) {
+      for (uint32_t k = 0U; k < self->noise_profile_size; k++) {
+        const uint32_t bits =
+            __atomic_load_n(&self->snapshot_spectrum[k], __ATOMIC_RELAXED);
+        memcpy(&noise_profile[k], &bits, sizeof(float));
+      }
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (__atomic_load_n(&self->snapshot_sequence, __ATOMIC_RELAXED) !=
+           sequence);
+
+  if (averaged_blocks) {
+    *averaged_blocks = blocks_averaged;
+  }
+  if (available) {
+    *available = spectrum_available != 0U;
+  }
 
   return true;
-}
\ No newline at end of file
+}
+
+// Has to be called with the snapshot mutex taken
+static void write_snapshot(NoiseProfile *self,
+                           const NoiseProfileVersion *version) {
+  const uint32_t sequence =
+      __atomic_load_n(&self->snapshot_sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->snapshot_sequence, sequence + 1U, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&self->snapshot_blocks_averaged, version->blocks_averaged,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&self->snapshot_available, version->available ? 1U : 0U,
+                   __ATOMIC_RELAXED);
+  for (uint32_t k = 0U; k < self->noise_profile_size; k++) {
+    uint32_t bits = 0U;
+    memcpy(&bits, &version->spectrum[k], sizeof(float));
+    __atomic_store_n(&self->snapshot_spectrum[k], bits, __ATOMIC_RELAXED);
+  }
+
+  __atomic_store_n(&self->snapshot_sequence, sequence + 2U, __ATOMIC_RELEASE);
+}
+
+static void mark_modified(NoiseProfile *self) {
+  self->generation++;
+
+  // Zero is kept for spectra that change on every frame
+  if (self->generation == 0U) {
+    self->generation = 1U;
+  }
+
+  self->unpublished_changes++;
+}
+
+// Processing thread side. A load in progress already wrote its own snapshot
+// and the processing thread takes that version soon, so this one is skipped
+// and the changes stay unpublished until the next refresh
+static void refresh_snapshot(NoiseProfile *self) {
+  if (pthread_mutex_trylock(&self->snapshot_mutex) != 0) {
+    return;
+  }
+
+  write_snapshot(self, self->current);
+  self->unpublished_changes = 0U;
+
+  pthread_mutex_unlock(&self->snapshot_mutex);
+}
@@ -24,18 +24,41 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <stdbool.h>
 #include <stdint.h>
 
+// Noise profile learned and used by the processing thread. Other threads never
+// touch the profile in use: loads and resets hand a whole new version over to
+// the processing thread, which swaps it in with a single atomic exchange when
+// it calls update_noise_profile. Other threads read a snapshot the processing
+// thread refreshes, so they always get a consistent copy. Loads and clears
+// refresh it right away, while learning refreshes it every few frames and
+// publish_noise_profile_snapshot catches up once learning stops
 typedef struct NoiseProfile NoiseProfile;
 
 NoiseProfile *noise_profile_initialize(uint32_t size);
 void noise_profile_free(NoiseProfile *self);
-float *get_noise_profile(NoiseProfile *self);
 uint32_t get_noise_profile_size(NoiseProfile *self);
+
+// Processing thread only
+float *get_noise_profile(NoiseProfile *self);
 uint32_t get_noise_profile_blocks_averaged(NoiseProfile *self);
+uint32_t get_noise_profile_generation(NoiseProfile *self);
+// Marks the profile as modified. The snapshot is refreshed every few calls
+void increment_noise_profile_generation(NoiseProfile *self);
+// Refreshes the snapshot if it misses any change
+void publish_noise_profile_snapshot(NoiseProfile *self);
 bool increment_blocks_averaged(NoiseProfile *self);
+void set_noise_profile_available(NoiseProfile *self);
+bool is_noise_estimation_available(NoiseProfile *self);
+// Empties the profile in use right away, unlike reset_noise_profile
+bool clear_noise_profile(NoiseProfile *self);
+// Takes the version loaded last, if any. Returns true if the profile changed
+bool update_noise_profile(NoiseProfile *self);
+
+// Any thread
 bool set_noise_profile(NoiseProfile *self, const float *noise_profile,
                        uint32_t noise_profile_size, uint32_t averaged_blocks);
-void set_noise_profile_available(NoiseProfile *self);
 bool reset_noise_profile(NoiseProfile *self);
-bool is_noise_estimation_available(NoiseProfile *self);
+// Copies the snapshot. Any of the outputs can be NULL
+bool copy_noise_profile_snapshot(NoiseProfile *self, float *noise_profile,
+                                 uint32_t *averaged_blocks, bool *available);
 
 #endif
@@ -0,0 +1,339 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "noise_profile_record.h"
+#include <math.h>
+#include <string.h>
+
+#define LOG8_LEVELS 255U
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+#define CHECKSUM_POSITION 36U
+
+static const unsigned char record_magic[4] = {'S', 'B', 'N', 'P'};
+
+static void write_u16(unsigned char *bytes, uint16_t value);
+static void write_u32(unsigned char *bytes, uint32_t value);
+static void write_f32(unsigned char *bytes, float value);
+static uint16_t read_u16(const unsigned char *bytes);
+static uint32_t read_u32(const unsigned char *bytes);
+static float read_f32(const unsigned char *bytes);
+static uint16_t float_to_half(float value);
+static float half_to_float(uint16_t value);
+static uint32_t compute_checksum(const unsigned char *record,
+                                 size_t record_size);
+static size_t get_bytes_per_bin(NoiseProfileEncoding encoding);
+
+size_t get_noise_profile_record_size(const uint32_t profile_size,
+                                     const NoiseProfileEncoding encoding) {
+  const size_t bytes_per_bin = get_bytes_per_bin(encoding);
+  if (bytes_per_bin == 0U) {
+    return 0U;
+  }
+
+  return NOISE_PROFILE_RECORD_HEADER_SIZE +
+         (size_t)profile_size * bytes_per_bin;
+}
+
+size_t write_noise_profile_record(const NoiseProfileRecordInfo *info,
+                                  const float *noise_profile, void *record,
+                                  const size_t record_size) {
+  if (!info || !noise_profile || !record) {
+    return 0U;
+  }
+
+  const size_t size =
+      get_noise_profile_record_size(info->profile_size, info->encoding);
+  if (size == 0U || record_size < size) {
+    return 0U;
+  }
+
+  unsigned char *bytes = (unsigned char *)record;
+  memset(bytes, 0, NOISE_PROFILE_RECORD_HEADER_SIZE);
+  memcpy(bytes, record_magic, sizeof(record_magic));
+  write_u16(&bytes[4], (uint16_t)NOISE_PROFILE_RECORD_VERSION);
+  bytes[6] = (unsigned char)info->encoding;
+  bytes[7] = (unsigned char)info->spectrum_type;
+  bytes[8] = (unsigned char)info->learn_mode;
+  write_u32(&bytes[12], info->sample_rate);
+  write_f32(&bytes[16], info->frame_size);
+  write_u32(&bytes[20], info->profile_size);
+  write_u32(&bytes[24], info->blocks_averaged);
+
+  unsigned char *payload = &bytes[NOISE_PROFILE_RECORD_HEADER_SIZE];
+  float first_parameter = 0.F;
+  float second_parameter = 0.F;
+
+  switch (info->encoding) {
+  case FLOAT16_ENCODING: {
+    float scale = 0.F;
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      scale = fmaxf(scale, noise_profile[k]);
+    }
+    first_parameter = scale;
+
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      const float normalized = scale > 0.F ? noise_profile[k] / scale : 0.F;
+      write_u16(&payload[2U * k], float_to_half(normalized));
+    }
+    break;
+  }
+  case LOG8_ENCODING: {
+    float minimum = INFINITY;
+    float maximum = -INFINITY;
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      if (noise_profile[k] > 0.F) {
+        const float level = log2f(noise_profile[k]);
+        minimum = fminf(minimum, level);
+        maximum = fmaxf(maximum, level);
+      }
+    }
+    if (minimum > maximum) {
+      minimum = 0.F;
+      maximum = 0.F;
+    }
+    first_parameter = minimum;
+    second_parameter = (maximum - minimum) / (float)(LOG8_LEVELS - 1U);
+
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      if (noise_profile[k] <= 0.F) {
+        payload[k] = 0U;
+        continue;
+      }
+
+      const float position =
+          second_parameter > 0.F
+              ? (log2f(noise_profile[k]) - minimum) / second_parameter
+              : 0.F;
+      const long level = lrintf(fminf(position, (float)(LOG8_LEVELS - 1U)));
+      payload[k] = (unsigned char)(1L + level);
+    }
+    break;
+  }
+  case FLOAT32_ENCODING:
+  default:
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      write_f32(&payload[4U * k], noise_profile[k]);
+    }
+    break;
+  }
+
+  write_f32(&bytes[28], first_parameter);
+  write_f32(&bytes[32], second_parameter);
+  write_u32(&bytes[CHECKSUM_POSITION], compute_checksum(bytes, size));
+
+  return size;
+}
+
+bool read_noise_profile_record_info(const void *record,
+                                    const size_t record_size,
+                                    NoiseProfileRecordInfo *info) {
+  if (!record || !info || record_size < NOISE_PROFILE_RECORD_HEADER_SIZE) {
+    return false;
+  }
+
+  const unsigned char *bytes = (const unsigned char *)record;
+  if (memcmp(bytes, record_magic, sizeof(record_magic)) != 0 ||
+      read_u16(&bytes[4]) != NOISE_PROFILE_RECORD_VERSION) {
+    return false;
+  }
+
+  info->encoding = (NoiseProfileEncoding)bytes[6];
+  info->spectrum_type = bytes[7];
+  info->learn_mode = bytes[8];
+  info->sample_rate = read_u32(&bytes[12]);
+  info->frame_size = read_f32(&bytes[16]);
+  info->profile_size = read_u32(&bytes[20]);
+  info->blocks_averaged = read_u32(&bytes[24]);
+
+  const size_t size =
+      get_noise_profile_record_size(info->profile_size, info->encoding);
+  if (size == 0U || record_size < size) {
+    return false;
+  }
+
+  return read_u32(&bytes[CHECKSUM_POSITION]) == compute_checksum(bytes, size);
+}
+
+void read_noise_profile_record_spectrum(const void *record,
+                                        const NoiseProfileRecordInfo *info,
+                                        float *noise_profile) {
+  const unsigned char *bytes = (const unsigned char *)record;
+  const unsigned char *payload = &bytes[NOISE_PROFILE_RECORD_HEADER_SIZE];
+  const float first_parameter = read_f32(&bytes[28]);
+  const float second_parameter = read_f32(&bytes[32]);
+
+  switch (info->encoding) {
+  case FLOAT16_ENCODING:
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      noise_profile[k] =
+          half_to_float(read_u16(&payload[2U * k])) * first_parameter;
+    }
+    break;
+  case LOG8_ENCODING:
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      noise_profile[k] =
+          payload[k] == 0U
+              ? 0.F
+              : exp2f(first_parameter +
+                      (float)(payload[k] - 1U) * second_parameter);
+    }
+    break;
+  case FLOAT32_ENCODING:
+  default:
+    for (uint32_t k = 0U; k < info->profile_size; k++) {
+      noise_profile[k] = read_f32(&payload[4U * k]);
+    }
+    break;
+  }
+}
+
+static size_t get_bytes_per_bin(const NoiseProfileEncoding encoding) {
+  switch (encoding) {
+  case FLOAT32_ENCODING:
+    return 4U;
+  case FLOAT16_ENCODING:
+    return 2U;
+  case LOG8_ENCODING:
+    return 1U;
+  default:
+    return 0U;
+  }
+}
+
+static uint32_t compute_checksum(const unsigned char *record,
+                                 const size_t record_size) {
+  uint32_t hash = FNV_OFFSET_BASIS;
+
+  for (size_t k = 0U; k < record_size; k++) {
+    const bool is_checksum =
+        k >= CHECKSUM_POSITION && k < CHECKSUM_POSITION + 4U;
+    hash ^= is_checksum ? 0U : record[k];
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+static void write_u16(unsigned char *bytes, const uint16_t value) {
+  bytes[0] = (unsigned char)(value & 0xFFU);
+  bytes[1] = (unsigned char)(value >> 8U);
+}
+
+static void write_u32(unsigned char *bytes, const uint32_t value) {
+  for (uint32_t k = 0U; k < 4U; k++) {
+    bytes[k] = (unsigned char)((value >> (8U * k)) & 0xFFU);
+  }
+}
+
+static void write_f32(unsigned char *bytes, const float value) {
+  uint32_t bits = 0U;
+  memcpy(&bits, &value, sizeof(float));
+  write_u32(bytes, bits);
+}
+
+static uint16_t read_u16(const unsigned char *bytes) {
+  return (uint16_t)(bytes[0] | (bytes[1] << 8U));
+}
+
+static uint32_t read_u32(const unsigned char *bytes) {
+  uint32_t value = 0U;
+  for (uint32_t k = 0U; k < 4U; k++) {
+    value |= (uint32_t)bytes[k] << (8U * k);
+  }
+
+  return value;
+}
+
+static float read_f32(const unsigned char *bytes) {
+  const uint32_t bits = read_u32(bytes);
+  float value = 0.F;
+  memcpy(&value, &bits, sizeof(float));
+
+  return value;
+}
+
+// Rounds to the nearest half float, ties to even
+static uint16_t float_to_half(const float value) {
+  uint32_t bits = 0U;
+  memcpy(&bits, &value, sizeof(float));
+
+  const uint16_t sign = (uint16_t)((bits >> 16U) & 0x8000U);
+  const int32_t exponent = (int32_t)((bits >> 23U) & 0xFFU);
+  uint32_t mantissa = bits & 0x7FFFFFU;
+
+  if (exponent == 0xFF) {
+    return (uint16_t)(sign | 0x7C00U | (mantissa != 0U ? 0x200U : 0U));
+  }
+
+  const int32_t half_exponent = exponent - 127 + 15;
+  if (half_exponent >= 31) {
+    return (uint16_t)(sign | 0x7C00U);
+  }
+
+  if (half_exponent <= 0) {
+    if (half_exponent < -10) {
+      return sign;
+    }
+
+    // Subnormal half
+    mantissa |= 0x800000U;
+    const uint32_t shift = (uint32_t)(14 - half_exponent);
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1U << shift) - 1U);
+    const uint32_t halfway = 1U << (shift - 1U);
+    if (remainder > halfway || (remainder == halfway && (half & 1U) != 0U)) {
+      half++;
+    }
+    return (uint16_t)(sign | half);
+  }
+
+  // A carry out of the mantissa correctly moves to the next exponent
+  uint32_t half = ((uint32_t)half_exponent << 10U) | (mantissa >> 13U);
+  const uint32_t remainder = mantissa & 0x1FFFU;
+  if (remainder > 0x1000U || (remainder == 0x1000U && (half & 1U) != 0U)) {
+    half++;
+  }
+
+  return (uint16_t)(sign | half);
+}
+
+static float half_to_float(const uint16_t value) {
+  const uint32_t sign = ((uint32_t)value & 0x8000U) << 16U;
+  const uint32_t exponent = ((uint32_t)value >> 10U) & 0x1FU;
+  const uint32_t mantissa = (uint32_t)value & 0x3FFU;
+
+  if (exponent == 0U) {
+    const float magnitude = ldexpf((float)mantissa, -24);
+    return sign != 0U ? -magnitude : magnitude;
+  }
+
+  uint32_t bits = 0U;
+  if (exponent == 31U) {
+    bits = sign | 0x7F800000U | (mantissa << 13U);
+  } else {
+    bits = sign | ((exponent - 15U + 127U) << 23U) | (mantissa << 13U);
+  }
+
+  float result = 0.F;
+  memcpy(&result, &bits, sizeof(float));
+
+  return result;
+}
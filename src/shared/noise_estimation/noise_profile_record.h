@@ -0,0 +1,85 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef NOISE_PROFILE_RECORD_H
+#define NOISE_PROFILE_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary record of a noise profile. Values are stored little endian:
+//
+//   0  magic "SBNP"
+//   4  u16 format version
+//   6  u8  encoding of the spectrum
+//   7  u8  spectrum type
+//   8  u8  learn mode the profile was estimated with
+//   9  3 reserved bytes, zero
+//  12  u32 sample rate
+//  16  f32 frame size in milliseconds
+//  20  u32 number of bins
+//  24  u32 blocks averaged
+//  28  f32 first encoding parameter
+//  32  f32 second encoding parameter
+//  36  u32 FNV-1a checksum of the record with this field zeroed
+//  40  spectrum
+//
+// Float16 values are divided by the largest bin, stored as the first
+// parameter, so spectra of any level keep the precision of half floats. Log8
+// maps the base 2 logarithm of every bin from the minimum (first parameter)
+// in steps of the second parameter to bytes 1 to 255. Zero is kept for empty
+// bins. Steps are below half a dB for spectra spanning up to 120dB
+#define NOISE_PROFILE_RECORD_VERSION 1U
+#define NOISE_PROFILE_RECORD_HEADER_SIZE 40U
+
+typedef enum NoiseProfileEncoding {
+  FLOAT32_ENCODING = 0,
+  FLOAT16_ENCODING = 1,
+  LOG8_ENCODING = 2,
+} NoiseProfileEncoding;
+
+typedef struct NoiseProfileRecordInfo {
+  NoiseProfileEncoding encoding;
+  uint32_t spectrum_type;
+  uint32_t learn_mode;
+  uint32_t sample_rate;
+  float frame_size;
+  uint32_t profile_size;
+  uint32_t blocks_averaged;
+} NoiseProfileRecordInfo;
+
+size_t get_noise_profile_record_size(uint32_t profile_size,
+                                     NoiseProfileEncoding encoding);
+// Returns the bytes written or zero if the record doesn't fit
+size_t write_noise_profile_record(const NoiseProfileRecordInfo *info,
+                                  const float *noise_profile, void *record,
+                                  size_t record_size);
+// Checks the record and reads its header. Returns false if it is truncated,
+// corrupted or from an unknown version
+bool read_noise_profile_record_info(const void *record, size_t record_size,
+                                    NoiseProfileRecordInfo *info);
+// Decodes the spectrum of a record already checked with
+// read_noise_profile_record_info
+void read_noise_profile_record_spectrum(const void *record,
+                                        const NoiseProfileRecordInfo *info,
+                                        float *noise_profile);
+
+#endif
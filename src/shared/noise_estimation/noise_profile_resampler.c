@@ -0,0 +1,111 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "noise_profile_resampler.h"
+#include <math.h>
+
+// Integral of the source power, taken as constant over each bin, from the
+// lower edge of the first bin up to position (in source bins)
+static double get_accumulated_power(const float *profile,
+                                    const uint32_t profile_size,
+                                    const double position) {
+  const double upper_edge = (double)profile_size - 0.5;
+  const double clamped = fmin(fmax(position, -0.5), upper_edge);
+  const uint32_t whole_bins = (uint32_t)(clamped + 0.5);
+
+  double accumulated = 0.;
+  for (uint32_t k = 0U; k < whole_bins; k++) {
+    accumulated += (double)profile[k];
+  }
+  if (whole_bins < profile_size) {
+    accumulated += (clamped + 0.5 - (double)whole_bins) *
+                   (double)profile[whole_bins];
+  }
+
+  return accumulated;
+}
+
+static float interpolate_power(const float *profile,
+                               const uint32_t profile_size,
+                               const double position) {
+  if (position >= (double)(profile_size - 1U)) {
+    return profile[profile_size - 1U];
+  }
+
+  const uint32_t lower_bin = (uint32_t)position;
+  const double fraction = position - (double)lower_bin;
+
+  return (float)((1. - fraction) * (double)profile[lower_bin] +
+                 fraction * (double)profile[lower_bin + 1U]);
+}
+
+static float average_power(const float *profile, const uint32_t profile_size,
+                           const double position, const double width) {
+  const double lower_edge = position - (width / 2.);
+  const double upper_edge =
+      fmin(position + (width / 2.), (double)profile_size - 0.5);
+
+  if (upper_edge <= lower_edge) {
+    return profile[profile_size - 1U];
+  }
+
+  return (float)((get_accumulated_power(profile, profile_size, upper_edge) -
+                  get_accumulated_power(profile, profile_size, lower_edge)) /
+                 (upper_edge - fmax(lower_edge, -0.5)));
+}
+
+bool resample_noise_profile(const float *source_profile,
+                            const uint32_t source_profile_size,
+                            const uint32_t source_sample_rate,
+                            const uint32_t source_frame_length,
+                            float *target_profile,
+                            const uint32_t target_profile_size,
+                            const uint32_t target_sample_rate,
+                            const uint32_t target_frame_length) {
+  if (!source_profile || !target_profile || source_profile_size < 2U ||
+      target_profile_size < 2U || source_sample_rate == 0U ||
+      target_sample_rate == 0U || source_frame_length == 0U ||
+      target_frame_length == 0U) {
+    return false;
+  }
+
+  const double source_fft_size = 2. * (double)(source_profile_size - 1U);
+  const double target_fft_size = 2. * (double)(target_profile_size - 1U);
+
+  // Width of a target bin measured in source bins
+  const double bin_ratio = ((double)target_sample_rate / target_fft_size) /
+                           ((double)source_sample_rate / source_fft_size);
+  const float power_scale =
+      (float)((double)target_frame_length / (double)source_frame_length);
+
+  for (uint32_t k = 0U; k < target_profile_size; k++) {
+    const double position = (double)k * bin_ratio;
+
+    const float power =
+        bin_ratio <= 1.
+            ? interpolate_power(source_profile, source_profile_size, position)
+            : average_power(source_profile, source_profile_size, position,
+                            bin_ratio);
+
+    target_profile[k] = power * power_scale;
+  }
+
+  return true;
+}
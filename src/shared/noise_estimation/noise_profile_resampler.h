@@ -0,0 +1,43 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef NOISE_PROFILE_RESAMPLER_H
+#define NOISE_PROFILE_RESAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maps a power spectrum profile learned with one sample rate and transform
+// size onto the bins of another. Sizes are real spectrum sizes and frame
+// lengths are in samples, without the zero padding. Target bins narrower than
+// the source ones are interpolated linearly and wider ones take the mean power
+// of the source bins they cover. Bins above the source Nyquist keep the value
+// of its last bin. Powers are scaled by the ratio of the frame lengths since
+// the power of noise in a bin grows with the energy of the window, which is
+// proportional to its length. Padding adds bins but no energy
+bool resample_noise_profile(const float *source_profile,
+                            uint32_t source_profile_size,
+                            uint32_t source_sample_rate,
+                            uint32_t source_frame_length, float *target_profile,
+                            uint32_t target_profile_size,
+                            uint32_t target_sample_rate,
+                            uint32_t target_frame_length);
+
+#endif
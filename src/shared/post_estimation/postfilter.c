@@ -21,10 +21,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "postfilter.h"
 #include "../configurations.h"
 #include "../stft/fft_transform.h"
+#include "../utils/memory_arena.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+// The transforms and their buffers only exist for sizes too short for the
+// running sum to fit the longest kernel
 struct PostFilter {
   FftTransform *gain_fft_spectrum;
   FftTransform *postfilter_fft_spectrum;
@@ -36,86 +39,145 @@ struct PostFilter {
   uint32_t real_spectrum_size;
   bool preserve_minimun;
   float default_postfilter_scale;
+  // Whether the gains of the last frame were smoothed
+  bool active;
 };
 
-PostFilter *postfilter_initialize(const uint32_t fft_size) {
-  PostFilter *self = (PostFilter *)calloc(1U, sizeof(PostFilter));
+// Both sides of the kernel have to fit in the spectrum without overlapping
+static bool needs_transforms(const PostFilter *self, const uint32_t lambda) {
+  return 2U * lambda - 1U > self->fft_size;
+}
+
+PostFilter *postfilter_initialize(const uint32_t fft_size,
+                                  const FftPlannerRigor planner_rigor) {
+  PostFilter *self = (PostFilter *)spectral_calloc(1U, sizeof(PostFilter));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
   self->preserve_minimun = (bool)PRESERVE_MINIMUN_GAIN;
   self->default_postfilter_scale = POSTFILTER_SCALE;
 
-  self->gain_fft_spectrum = fft_transform_initialize_bins(self->fft_size);
-  self->postfilter_fft_spectrum = fft_transform_initialize_bins(self->fft_size);
-  self->pf_gain_spectrum = (float *)calloc(self->fft_size, sizeof(float));
-
-  self->postfilter = (float *)calloc(self->fft_size, sizeof(float));
+  const uint32_t longest_kernel =
+      2U * (uint32_t)roundf(self->default_postfilter_scale) + 1U;
+
+  if (needs_transforms(self, longest_kernel)) {
+    self->gain_fft_spectrum = fft_transform_initialize_bins(
+        self->fft_size, FFT_TRANSFORM_TYPE, planner_rigor);
+    self->postfilter_fft_spectrum = fft_transform_initialize_bins(
+        self->fft_size, FFT_TRANSFORM_TYPE, planner_rigor);
+    self->pf_gain_spectrum =
+        (float *)spectral_calloc(self->fft_size, sizeof(float));
+    self->postfilter = (float *)spectral_calloc(self->fft_size, sizeof(float));
+  } else {
+    self->pf_gain_spectrum =
+        (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  }
 
   return self;
 }
 
 void postfilter_free(PostFilter *self) {
-  fft_transform_free(self->gain_fft_spectrum);
-  fft_transform_free(self->postfilter_fft_spectrum);
+  if (self->gain_fft_spectrum) {
+    fft_transform_free(self->gain_fft_spectrum);
+    fft_transform_free(self->postfilter_fft_spectrum);
+    spectral_free(self->postfilter);
+  }
 
-  free(self->postfilter);
-  free(self->pf_gain_spectrum);
+  spectral_free(self->pf_gain_spectrum);
 
-  free(self);
+  spectral_free(self);
 }
 
-static void calculate_postfilter(PostFilter *self, const float *spectrum,
-                                 const float snr_threshold,
-                                 const float *gain_spectrum) {
+// Number of taps of the moving average, odd and growing as the a priori snr
+// falls below the threshold. One tap leaves the gains untouched
+static uint32_t calculate_postfilter_length(PostFilter *self,
+                                            const float *power_spectrum,
+                                            const float snr_threshold,
+                                            const float *gain_spectrum) {
   float clean_signal_sum = 0.F;
   float noisy_signa_sum = 0.F;
-  float a_priori_snr = 0.F;
-  float lambda = 0.F;
-  float threshold_decision = 0.F;
 
   for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
-    clean_signal_sum += powf(spectrum[k] * gain_spectrum[k], 2.F);
-    noisy_signa_sum += powf(spectrum[k], 2.F);
+    clean_signal_sum += power_spectrum[k] * gain_spectrum[k] * gain_spectrum[k];
+    noisy_signa_sum += power_spectrum[k];
   }
 
-  a_priori_snr = clean_signal_sum / noisy_signa_sum;
+  // Silent frames have nothing to smooth
+  if (noisy_signa_sum <= 0.F) {
+    return 1U;
+  }
+
+  const float a_priori_snr = clean_signal_sum / noisy_signa_sum;
 
   if (a_priori_snr >= snr_threshold) {
-    threshold_decision = 1.F;
-  } else {
-    threshold_decision = a_priori_snr;
+    return 1U;
   }
 
-  if (threshold_decision == 1.F) {
-    lambda = 1.F;
-  } else {
-    lambda = 2.F * roundf(self->default_postfilter_scale *
-                          (1.F - threshold_decision / snr_threshold)) +
-             1.F;
+  const float lambda =
+      2.F * roundf(self->default_postfilter_scale *
+                   (1.F - a_priori_snr / snr_threshold)) +
+      1.F;
+
+  return (uint32_t)lambda;
+}
+
+// Gains of the whole circular spectrum taken from the real half
+static inline float get_mirrored_gain(const PostFilter *self,
+                                      const float *gain_spectrum,
+                                      const uint32_t k) {
+  if (k < self->real_spectrum_size) {
+    return gain_spectrum[k];
+  }
+  return gain_spectrum[self->fft_size - k];
+}
+
+// The transforms multiply the bins of the mirrored gains and the kernel
+// element by element. Mirrored gains only have a real part, so that is the
+// circular convolution with the even part of the kernel: 1 / lambda at the
+// center and 1 / (2 * lambda) for lambda - 1 taps on each side. A running sum
+// over those taps gives the same smoothing in a single pass. Only valid while
+// both sides of the kernel fit in the spectrum without overlapping
+static void smooth_gains_directly(PostFilter *self, const float *gain_spectrum,
+                                  const uint32_t lambda) {
+  const uint32_t half_width = lambda - 1U;
+  const float scale = 1.F / (2.F * (float)lambda);
+
+  const uint32_t first_tap = self->fft_size - half_width;
+  float window_sum = 0.F;
+  for (uint32_t j = 0U; j <= 2U * half_width; j++) {
+    window_sum += get_mirrored_gain(self, gain_spectrum,
+                                    (first_tap + j) % self->fft_size);
   }
 
   for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
-    if ((float)k < lambda) {
-      self->postfilter[k] = 1.F / lambda;
+    self->pf_gain_spectrum[k] = (gain_spectrum[k] + window_sum) * scale;
+
+    window_sum += get_mirrored_gain(self, gain_spectrum,
+                                    (k + half_width + 1U) % self->fft_size);
+    window_sum -= get_mirrored_gain(
+        self, gain_spectrum,
+        (self->fft_size + k - half_width) % self->fft_size);
+  }
+}
+
+static void smooth_gains_with_transforms(PostFilter *self,
+                                         const float *gain_spectrum,
+                                         const uint32_t lambda) {
+  for (uint32_t k = 0U; k < self->fft_size; k++) {
+    if (k < lambda) {
+      self->postfilter[k] = 1.F / (float)lambda;
     } else {
       self->postfilter[k] = 0.F;
     }
   }
-}
 
-bool postfilter_apply(PostFilter *self, const float *spectrum,
-                      float *gain_spectrum,
-                      const PostFiltersParameters parameters) {
-  if (!spectrum || !gain_spectrum) {
-    return false;
+  // Gains only cover the real half. The convolution is circular, so they are
+  // mirrored as a whole spectrum for the bins near Nyquist to see the same
+  // neighbours they did before
+  for (uint32_t k = 0U; k < self->fft_size; k++) {
+    self->pf_gain_spectrum[k] = get_mirrored_gain(self, gain_spectrum, k);
   }
 
-  memcpy(self->pf_gain_spectrum, gain_spectrum, self->fft_size * sizeof(float));
-
-  calculate_postfilter(self, spectrum, parameters.snr_threshold,
-                       self->pf_gain_spectrum);
-
   fft_load_input_samples(self->gain_fft_spectrum, self->pf_gain_spectrum);
   fft_load_input_samples(self->postfilter_fft_spectrum, self->postfilter);
 
@@ -129,18 +191,44 @@ bool postfilter_apply(PostFilter *self, const float *spectrum,
 
   compute_backward_fft(self->gain_fft_spectrum);
 
-  for (uint32_t k = 0U; k < self->fft_size; k++) {
+  for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
     self->pf_gain_spectrum[k] =
         get_fft_input_buffer(self->gain_fft_spectrum)[k] /
         (float)self->fft_size;
   }
+}
+
+bool postfilter_apply(PostFilter *self, const float *power_spectrum,
+                      float *gain_spectrum,
+                      const PostFiltersParameters parameters) {
+  if (!power_spectrum || !gain_spectrum) {
+    return false;
+  }
+
+  const uint32_t lambda = calculate_postfilter_length(
+      self, power_spectrum, parameters.snr_threshold, gain_spectrum);
+
+  self->active = lambda > 1U;
+  if (!self->active) {
+    return true;
+  }
+
+  // Kernels too long for the running sum keep the transforms
+  if (!needs_transforms(self, lambda)) {
+    smooth_gains_directly(self, gain_spectrum, lambda);
+  } else {
+    smooth_gains_with_transforms(self, gain_spectrum, lambda);
+  }
 
   if (self->preserve_minimun) {
-    min_spectrum(gain_spectrum, self->pf_gain_spectrum, self->fft_size);
+    min_spectrum(gain_spectrum, self->pf_gain_spectrum,
+                 self->real_spectrum_size);
   } else {
     memcpy(gain_spectrum, self->pf_gain_spectrum,
-           self->fft_size * sizeof(float));
+           self->real_spectrum_size * sizeof(float));
   }
 
   return true;
 }
+
+bool is_postfilter_active(const PostFilter *self) { return self->active; }
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef POSTFILTER_H
 #define POSTFILTER_H
 
+#include "../stft/fft_transform.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -30,9 +31,12 @@ typedef struct PostFiltersParameters {
   float snr_threshold;
 } PostFiltersParameters;
 
-PostFilter *postfilter_initialize(uint32_t fft_size);
+PostFilter *postfilter_initialize(uint32_t fft_size,
+                                  FftPlannerRigor planner_rigor);
 void postfilter_free(PostFilter *self);
-bool postfilter_apply(PostFilter *self, const float *spectrum,
+// Energies are taken from the power spectrum of the hop being processed
+bool postfilter_apply(PostFilter *self, const float *power_spectrum,
                       float *gain_spectrum, PostFiltersParameters parameters);
+bool is_postfilter_active(const PostFilter *self);
 
 #endif
\ No newline at end of file
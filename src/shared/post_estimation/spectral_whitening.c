@@ -20,14 +20,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "spectral_whitening.h"
 #include "../configurations.h"
-#include <float.h>
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_kernels.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 struct SpectralWhitening {
   float *residual_max_spectrum;
-  float *whitened_residual_spectrum;
 
   float max_decay_rate;
   uint32_t whitening_window_count;
@@ -40,15 +40,14 @@ SpectralWhitening *spectral_whitening_initialize(const uint32_t fft_size,
                                                  const uint32_t sample_rate,
                                                  const uint32_t hop) {
   SpectralWhitening *self =
-      (SpectralWhitening *)calloc(1U, sizeof(SpectralWhitening));
+      (SpectralWhitening *)spectral_calloc(1U, sizeof(SpectralWhitening));
 
   self->fft_size = fft_size;
   self->sample_rate = sample_rate;
   self->hop = hop;
 
-  self->whitened_residual_spectrum =
-      (float *)calloc(self->fft_size, sizeof(float));
-  self->residual_max_spectrum = (float *)calloc(self->fft_size, sizeof(float));
+  self->residual_max_spectrum =
+      (float *)spectral_calloc(self->fft_size, sizeof(float));
   self->max_decay_rate =
       expf(-1000.F / (((WHITENING_DECAY_RATE) * (float)self->sample_rate) /
                       (float)self->hop));
@@ -58,10 +57,14 @@ SpectralWhitening *spectral_whitening_initialize(const uint32_t fft_size,
 }
 
 void spectral_whitening_free(SpectralWhitening *self) {
-  free(self->whitened_residual_spectrum);
-  free(self->residual_max_spectrum);
+  spectral_free(self->residual_max_spectrum);
 
-  free(self);
+  spectral_free(self);
+}
+
+void spectral_whitening_reset(SpectralWhitening *self) {
+  memset(self->residual_max_spectrum, 0, self->fft_size * sizeof(float));
+  self->whitening_window_count = 0U;
 }
 
 bool spectral_whitening_run(SpectralWhitening *self,
@@ -72,25 +75,10 @@ bool spectral_whitening_run(SpectralWhitening *self,
 
   self->whitening_window_count++;
 
-  for (uint32_t k = 1U; k < self->fft_size; k++) {
-    if (self->whitening_window_count > 1U) {
-      self->residual_max_spectrum[k] =
-          fmaxf(fmaxf(fft_spectrum[k], WHITENING_FLOOR),
-                self->residual_max_spectrum[k] * self->max_decay_rate);
-    } else {
-      self->residual_max_spectrum[k] = fmaxf(fft_spectrum[k], WHITENING_FLOOR);
-    }
-  }
-
-  for (uint32_t k = 1U; k < self->fft_size; k++) {
-    if (fft_spectrum[k] > FLT_MIN) {
-      self->whitened_residual_spectrum[k] =
-          fft_spectrum[k] / self->residual_max_spectrum[k];
-
-      fft_spectrum[k] = (1.F - whitening_factor) * fft_spectrum[k] +
-                        whitening_factor * self->whitened_residual_spectrum[k];
-    }
-  }
+  get_spectral_kernels()->whitening(
+      fft_spectrum, self->residual_max_spectrum, self->fft_size,
+      self->max_decay_rate, whitening_factor,
+      self->whitening_window_count <= 1U);
 
   return true;
 }
\ No newline at end of file
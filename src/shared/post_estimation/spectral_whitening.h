@@ -30,6 +30,7 @@ SpectralWhitening *spectral_whitening_initialize(uint32_t fft_size,
                                                  uint32_t sample_rate,
                                                  uint32_t hop);
 void spectral_whitening_free(SpectralWhitening *self);
+void spectral_whitening_reset(SpectralWhitening *self);
 bool spectral_whitening_run(SpectralWhitening *self, float whitening_factor,
                             float *fft_spectrum);
 
@@ -21,107 +21,116 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "absolute_hearing_thresholds.h"
 #include "../configurations.h"
 #include "../stft/fft_transform.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_utils.h"
+#include "../utils/table_cache.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void generate_sinewave(AbsoluteHearingThresholds *self);
-static void compute_spl_reference_spectrum(AbsoluteHearingThresholds *self);
-static void compute_absolute_thresholds(AbsoluteHearingThresholds *self);
-
+static void build_thresholds(float *table, const uint32_t *key);
+static void compute_spl_reference_spectrum(float *spl_reference_values,
+                                           uint32_t sample_rate,
+                                           uint32_t fft_size,
+                                           SpectrumType spectrum_type);
+static void compute_absolute_thresholds(float *absolute_thresholds,
+                                        uint32_t sample_rate,
+                                        uint32_t fft_size);
+
+// Reference values and thresholds only depend on the layout, so they live in a
+// cached table shared by every instance with the same one. The thresholds go
+// right after the reference values
 struct AbsoluteHearingThresholds {
-  float *sinewave;
-  float *window;
-  float *spl_reference_values;
-  float *absolute_thresholds;
-
-  SpectralFeatures *spectral_features;
-  FftTransform *fft_transform;
+  const float *table;
+  const float *spl_reference_values;
+  const float *absolute_thresholds;
 
-  SpectrumType spectrum_type;
-  uint32_t fft_size;
   uint32_t real_spectrum_size;
-  uint32_t sample_rate;
-  float sine_wave_amplitude;
-  float sine_wave_frequency;
-  float reference_level;
 };
 
 AbsoluteHearingThresholds *
 absolute_hearing_thresholds_initialize(const uint32_t sample_rate,
                                        const uint32_t fft_size,
                                        SpectrumType spectrum_type) {
-  AbsoluteHearingThresholds *self = (AbsoluteHearingThresholds *)calloc(
-      1U, sizeof(AbsoluteHearingThresholds));
-
-  self->fft_size = fft_size;
-  self->real_spectrum_size = self->fft_size / 2U + 1U;
-  self->sample_rate = sample_rate;
-  self->spectrum_type = spectrum_type;
-  self->sine_wave_amplitude = SINE_AMPLITUDE;
-  self->sine_wave_frequency = REFERENCE_SINE_WAVE_FREQ;
-  self->reference_level = REFERENCE_LEVEL;
-
-  self->fft_transform = fft_transform_initialize_bins(self->fft_size);
-
-  self->spl_reference_values =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
-
-  self->absolute_thresholds =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
-
-  self->sinewave = (float *)calloc(self->fft_size, sizeof(float));
-  self->window = (float *)calloc(self->fft_size, sizeof(float));
+  const uint32_t real_spectrum_size = fft_size / 2U + 1U;
+  const uint32_t key[TABLE_KEY_SIZE] = {sample_rate, fft_size,
+                                        (uint32_t)spectrum_type};
+  const float *table =
+      table_cache_acquire(HEARING_THRESHOLDS_TABLE, key,
+                          2U * real_spectrum_size, &build_thresholds);
+  if (!table) {
+    return NULL;
+  }
 
-  self->spectral_features =
-      spectral_features_initialize(self->real_spectrum_size);
+  AbsoluteHearingThresholds *self =
+      (AbsoluteHearingThresholds *)spectral_calloc(
+          1U, sizeof(AbsoluteHearingThresholds));
 
-  generate_sinewave(self);
-  get_fft_window(self->window, self->fft_size, VORBIS_WINDOW);
-  compute_spl_reference_spectrum(self);
-  compute_absolute_thresholds(self);
+  self->real_spectrum_size = real_spectrum_size;
+  self->table = table;
+  self->spl_reference_values = table;
+  self->absolute_thresholds = &table[real_spectrum_size];
 
   return self;
 }
 
 void absolute_hearing_thresholds_free(AbsoluteHearingThresholds *self) {
-  fft_transform_free(self->fft_transform);
-  spectral_features_free(self->spectral_features);
+  table_cache_release(self->table);
 
-  free(self->sinewave);
-  free(self->window);
-  free(self->spl_reference_values);
-  free(self->absolute_thresholds);
-
-  free(self);
+  spectral_free(self);
 }
 
-static void generate_sinewave(AbsoluteHearingThresholds *self) {
-  for (uint32_t k = 0U; k < self->fft_size; k++) {
-    self->sinewave[k] =
-        self->sine_wave_amplitude *
-        sinf((2.F * M_PI * (float)k * self->sine_wave_frequency) /
-             (float)self->sample_rate);
-  }
+// Key holds the sample rate, the transform size and the spectrum type
+static void build_thresholds(float *table, const uint32_t *key) {
+  const uint32_t sample_rate = key[0];
+  const uint32_t fft_size = key[1];
+
+  compute_spl_reference_spectrum(table, sample_rate, fft_size,
+                                 (SpectrumType)key[2]);
+  compute_absolute_thresholds(&table[fft_size / 2U + 1U], sample_rate,
+                              fft_size);
 }
 
-static void compute_spl_reference_spectrum(AbsoluteHearingThresholds *self) {
-  for (uint32_t k = 0U; k < self->fft_size; k++) {
-    get_fft_input_buffer(self->fft_transform)[k] =
-        self->sinewave[k] * self->window[k];
+// Level of every bin for a windowed reference sinewave, whose transform is
+// only computed once so it's not worth measuring a plan for it
+static void compute_spl_reference_spectrum(float *spl_reference_values,
+                                           const uint32_t sample_rate,
+                                           const uint32_t fft_size,
+                                           const SpectrumType spectrum_type) {
+  const uint32_t real_spectrum_size = fft_size / 2U + 1U;
+  FftTransform *fft_transform =
+      fft_transform_initialize_bins(fft_size, FFT_TRANSFORM_TYPE,
+                                    ESTIMATE_PLANNER);
+  SpectralFeatures *spectral_features =
+      spectral_features_initialize(real_spectrum_size);
+  float *window = (float *)spectral_calloc(fft_size, sizeof(float));
+
+  get_fft_window(window, fft_size, VORBIS_WINDOW);
+
+  float *input = get_fft_input_buffer(fft_transform);
+  for (uint32_t k = 0U; k < fft_size; k++) {
+    const float sinewave =
+        SINE_AMPLITUDE * sinf((2.F * M_PI * (float)k *
+                               REFERENCE_SINE_WAVE_FREQ) /
+                              (float)sample_rate);
+    input[k] = sinewave * window[k];
   }
 
-  compute_forward_fft(self->fft_transform);
+  compute_forward_fft(fft_transform);
 
-  float *reference_spectrum = get_spectral_feature(
-      self->spectral_features, get_fft_output_buffer(self->fft_transform),
-      self->fft_size, self->spectrum_type);
+  const float *reference_spectrum =
+      get_spectral_feature(spectral_features,
+                           get_fft_output_buffer(fft_transform), fft_size,
+                           spectrum_type);
 
-  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
-    self->spl_reference_values[k] =
-        self->reference_level - 10.F * log10f(reference_spectrum[k]);
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    spl_reference_values[k] =
+        REFERENCE_LEVEL - 10.F * log10f(reference_spectrum[k]);
   }
+
+  spectral_free(window);
+  spectral_features_free(spectral_features);
+  fft_transform_free(fft_transform);
 }
 
 bool apply_thresholds_as_floor(AbsoluteHearingThresholds *self,
@@ -138,12 +147,15 @@ bool apply_thresholds_as_floor(AbsoluteHearingThresholds *self,
   return true;
 }
 
-static void compute_absolute_thresholds(AbsoluteHearingThresholds *self) {
-  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
+static void compute_absolute_thresholds(float *absolute_thresholds,
+                                        const uint32_t sample_rate,
+                                        const uint32_t fft_size) {
+  const uint32_t real_spectrum_size = fft_size / 2U + 1U;
+
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
 
-    const float frequency =
-        fft_bin_to_freq(k, self->sample_rate, self->fft_size);
-    self->absolute_thresholds[k] =
+    const float frequency = fft_bin_to_freq(k, sample_rate, fft_size);
+    absolute_thresholds[k] =
         3.64F * powf((frequency / 1000.F), -0.8F) -
         6.5F * expf(-0.6F * powf((frequency / 1000.F - 3.3F), 2.F)) +
         powf(10.F, -3.F) * powf((frequency / 1000.F), 4.F);
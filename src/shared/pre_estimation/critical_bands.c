@@ -20,6 +20,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "critical_bands.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_kernels.h"
 #include "../utils/spectral_utils.h"
 #include <math.h>
 #include <stdlib.h>
@@ -46,9 +48,10 @@ static void compute_band_indexes(CriticalBands *self);
 static uint32_t get_last_valid_band_for_samplerate(CriticalBands *self,
                                                    uint32_t number_of_bands);
 
+// Bands are stored as in a compressed sparse row matrix. Bins of band j go from
+// band_offsets[j] to band_offsets[j + 1] so band loops need no extra lookups
 struct CriticalBands {
-  uint32_t *band_delimiter_bins;
-  uint32_t *number_bins_per_band;
+  uint32_t *band_offsets;
   float *current_critical_bands;
 
   uint32_t fft_size;
@@ -56,14 +59,14 @@ struct CriticalBands {
   uint32_t sample_rate;
   uint32_t number_bands;
   CriticalBandType type;
-  CriticalBandIndexes band_indexes;
 };
 
 CriticalBands *critical_bands_initialize(const uint32_t sample_rate,
                                          const uint32_t fft_size,
                                          const CriticalBandType type) {
 
-  CriticalBands *self = (CriticalBands *)calloc(1U, sizeof(CriticalBands));
+  CriticalBands *self =
+      (CriticalBands *)spectral_calloc(1U, sizeof(CriticalBands));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = fft_size / 2U + 1U;
@@ -72,10 +75,8 @@ CriticalBands *critical_bands_initialize(const uint32_t sample_rate,
 
   compute_mapping_spectrum(self);
 
-  self->band_delimiter_bins =
-      (uint32_t *)calloc(self->number_bands, sizeof(uint32_t));
-  self->number_bins_per_band =
-      (uint32_t *)calloc(self->number_bands, sizeof(uint32_t));
+  self->band_offsets = (uint32_t *)spectral_calloc(
+      (size_t)self->number_bands + 1U, sizeof(uint32_t));
 
   compute_band_indexes(self);
 
@@ -83,30 +84,22 @@ CriticalBands *critical_bands_initialize(const uint32_t sample_rate,
 }
 
 void critical_bands_free(CriticalBands *self) {
-  free(self->band_delimiter_bins);
-  free(self->number_bins_per_band);
+  spectral_free(self->band_offsets);
 
-  free(self);
+  spectral_free(self);
 }
 
 static void compute_band_indexes(CriticalBands *self) {
-  for (uint32_t k = 0U; k < self->number_bands; k++) {
+  // The first band starts at the DC bin and the last one ends at Nyquist
+  self->band_offsets[0] = 0U;
 
-    const uint32_t bin_index =
-        freq_to_fft_bin(self->current_critical_bands[k], self->sample_rate,
-                        self->real_spectrum_size);
-
-    if (k == 0) {
-      self->number_bins_per_band[k] = bin_index; // Don't include DC bin
-      self->band_delimiter_bins[k] = bin_index;
-    } else if (k == self->number_bands - 1U) {
-      self->band_delimiter_bins[k] = self->real_spectrum_size;
-      self->number_bins_per_band[k] =
-          self->band_delimiter_bins[k] - self->band_delimiter_bins[k - 1];
+  for (uint32_t k = 0U; k < self->number_bands; k++) {
+    if (k == self->number_bands - 1U) {
+      self->band_offsets[k + 1U] = self->real_spectrum_size;
     } else {
-      self->number_bins_per_band[k] =
-          bin_index - self->band_delimiter_bins[k - 1];
-      self->band_delimiter_bins[k] = bin_index;
+      self->band_offsets[k + 1U] =
+          freq_to_fft_bin(self->current_critical_bands[k], self->sample_rate,
+                          self->real_spectrum_size);
     }
   }
 }
@@ -162,30 +155,80 @@ static uint32_t get_last_valid_band_for_samplerate(CriticalBands *self,
 
 bool compute_critical_bands_spectrum(CriticalBands *self, const float *spectrum,
                                      float *critical_bands) {
-  if (!spectrum) {
+  return compute_critical_bands_spectra(self, &spectrum, &critical_bands, 1U);
+}
+
+bool compute_critical_bands_spectra(CriticalBands *self,
+                                    const float *const *spectra,
+                                    float *const *critical_bands,
+                                    const uint32_t number_of_spectra) {
+  if (!self || !spectra || !critical_bands) {
     return false;
   }
 
   for (uint32_t j = 0U; j < self->number_bands; j++) {
+    const uint32_t start = self->band_offsets[j];
+    const uint32_t end = self->band_offsets[j + 1U];
 
-    self->band_indexes = get_band_indexes(self, j);
+    for (uint32_t s = 0U; s < number_of_spectra; s++) {
+      const float *spectrum = spectra[s];
+
+      float band_sum = 0.F;
+      for (uint32_t k = start; k < end; k++) {
+        band_sum += spectrum[k];
+      }
+      critical_bands[s][j] = band_sum;
+    }
+  }
+
+  return true;
+}
+
+bool expand_critical_bands_spectrum(CriticalBands *self,
+                                    const float *critical_bands,
+                                    float *spectrum) {
+  if (!self || !critical_bands || !spectrum) {
+    return false;
+  }
 
-    for (uint32_t k = self->band_indexes.start_position;
-         k < self->band_indexes.end_position; k++) {
-      critical_bands[j] += spectrum[k];
+  const SpectralKernels *kernels = get_spectral_kernels();
+
+  for (uint32_t j = 0U; j < self->number_bands; j++) {
+    const uint32_t start = self->band_offsets[j];
+
+    kernels->fill(&spectrum[start], critical_bands[j],
+                  self->band_offsets[j + 1U] - start);
+  }
+
+  return true;
+}
+
+bool interpolate_critical_bands_spectrum(CriticalBands *self,
+                                         const float *critical_bands,
+                                         float *spectrum) {
+  if (!self || !critical_bands || !spectrum) {
+    return false;
+  }
+
+  for (uint32_t j = 0U; j < self->number_bands; j++) {
+    const uint32_t start = self->band_offsets[j];
+    const uint32_t end = self->band_offsets[j + 1U];
+    const float current = critical_bands[j];
+    // The last band has nothing to ramp to and stays flat
+    const float next = j + 1U < self->number_bands ? critical_bands[j + 1U]
+                                                   : critical_bands[j];
+    const float step = (next - current) / (float)(end - start);
+
+    for (uint32_t k = start; k < end; k++) {
+      spectrum[k] = current + step * (float)(k - start);
     }
   }
 
   return true;
 }
 
-CriticalBandIndexes get_band_indexes(CriticalBands *self,
-                                     const uint32_t band_number) {
-  return (CriticalBandIndexes){
-      .start_position = self->band_delimiter_bins[band_number] -
-                        self->number_bins_per_band[band_number],
-      .end_position = self->band_delimiter_bins[band_number],
-  };
+const uint32_t *get_critical_band_offsets(CriticalBands *self) {
+  return self->band_offsets;
 }
 
 uint32_t get_number_of_critical_bands(CriticalBands *self) {
@@ -33,18 +33,28 @@ typedef enum CriticalBandType {
   OCTAVE_SCALE = 3,
 } CriticalBandType;
 
-typedef struct CriticalBandIndexes {
-  uint32_t start_position;
-  uint32_t end_position;
-} CriticalBandIndexes;
-
 CriticalBands *critical_bands_initialize(uint32_t sample_rate,
                                          uint32_t fft_size,
                                          CriticalBandType type);
 void critical_bands_free(CriticalBands *self);
 bool compute_critical_bands_spectrum(CriticalBands *self, const float *spectrum,
                                      float *critical_bands);
-CriticalBandIndexes get_band_indexes(CriticalBands *self, uint32_t band_number);
+// Adds up the bands of several spectra in one pass over the band layout
+bool compute_critical_bands_spectra(CriticalBands *self,
+                                    const float *const *spectra,
+                                    float *const *critical_bands,
+                                    uint32_t number_of_spectra);
+// Writes the value of every band to all of its bins
+bool expand_critical_bands_spectrum(CriticalBands *self,
+                                    const float *critical_bands,
+                                    float *spectrum);
+// Ramps linearly from the value of every band to the value of the next one
+// across its bins, so band gains don't step at band edges
+bool interpolate_critical_bands_spectrum(CriticalBands *self,
+                                         const float *critical_bands,
+                                         float *spectrum);
+// Bins of band j go from offsets[j] to offsets[j + 1]
+const uint32_t *get_critical_band_offsets(CriticalBands *self);
 uint32_t get_number_of_critical_bands(CriticalBands *self);
 
 #endif
\ No newline at end of file
@@ -20,6 +20,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "masking_estimator.h"
 #include "../configurations.h"
+#include "../utils/fast_math.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_utils.h"
 #include "absolute_hearing_thresholds.h"
 #include "critical_bands.h"
@@ -37,52 +39,62 @@ struct MaskingEstimator {
   uint32_t real_spectrum_size;
   uint32_t sample_rate;
   uint32_t number_critical_bands;
+  bool approximate_math;
 
   AbsoluteHearingThresholds *reference_spectrum;
   CriticalBands *critical_bands;
-  CriticalBandIndexes band_indexes;
+  const uint32_t *band_offsets;
 
-  float *spectral_spreading_function;
+  float *spreading_diagonals;
+  int32_t *spreading_offsets;
+  uint32_t number_of_spreading_diagonals;
   float *unity_gain_critical_bands_spectrum;
   float *spreaded_unity_gain_critical_bands_spectrum;
+  float *unity_gain_spreading_level;
   float *threshold_j;
   float *masking_offset;
   float *spreaded_spectrum;
   float *critical_bands_reference_spectrum;
 };
 
-MaskingEstimator *masking_estimation_initialize(const uint32_t fft_size,
-                                                const uint32_t sample_rate,
-                                                SpectrumType spectrum_type) {
+MaskingEstimator *masking_estimation_initialize(
+    const uint32_t fft_size, const uint32_t sample_rate,
+    const CriticalBandType critical_band_type, SpectrumType spectrum_type,
+    const bool approximate_math) {
 
   MaskingEstimator *self =
-      (MaskingEstimator *)calloc(1U, sizeof(MaskingEstimator));
+      (MaskingEstimator *)spectral_calloc(1U, sizeof(MaskingEstimator));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
   self->sample_rate = sample_rate;
+  self->approximate_math = approximate_math;
 
   self->critical_bands = critical_bands_initialize(
-      self->sample_rate, self->fft_size, CRITICAL_BANDS_TYPE);
+      self->sample_rate, self->fft_size, critical_band_type);
   self->number_critical_bands =
       get_number_of_critical_bands(self->critical_bands);
+  self->band_offsets = get_critical_band_offsets(self->critical_bands);
 
-  self->spectral_spreading_function =
-      (float *)calloc(((size_t)self->number_critical_bands *
-                       (size_t)self->number_critical_bands),
-                      sizeof(float));
+  // Spreading between every pair of bands lies in one of these diagonals
+  self->spreading_diagonals = (float *)spectral_calloc(
+      2U * (size_t)self->number_critical_bands - 1U, sizeof(float));
+  self->spreading_offsets = (int32_t *)spectral_calloc(
+      2U * (size_t)self->number_critical_bands - 1U, sizeof(int32_t));
   self->unity_gain_critical_bands_spectrum =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->spreaded_unity_gain_critical_bands_spectrum =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
+  self->unity_gain_spreading_level =
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->threshold_j =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->masking_offset =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->spreaded_spectrum =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->critical_bands_reference_spectrum =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
 
   self->reference_spectrum = absolute_hearing_thresholds_initialize(
       self->sample_rate, self->fft_size, spectrum_type);
@@ -90,12 +102,20 @@ MaskingEstimator *masking_estimation_initialize(const uint32_t fft_size,
   compute_spectral_spreading_function(self);
   initialize_spectrum_with_value(self->unity_gain_critical_bands_spectrum,
                                  self->number_critical_bands, 1.F);
-  direct_matrix_to_vector_spectral_convolution(
-      self->spectral_spreading_function,
+  banded_matrix_to_vector_spectral_convolution(
+      self->spreading_diagonals, self->spreading_offsets,
+      self->number_of_spreading_diagonals,
       self->unity_gain_critical_bands_spectrum,
       self->spreaded_unity_gain_critical_bands_spectrum,
       self->number_critical_bands);
 
+  // Thresholds are corrected by the spreading of a flat spectrum, which never
+  // changes after initialization
+  for (uint32_t j = 0U; j < self->number_critical_bands; j++) {
+    self->unity_gain_spreading_level[j] =
+        10.F * log10f(self->spreaded_unity_gain_critical_bands_spectrum[j]);
+  }
+
   return self;
 }
 
@@ -103,15 +123,17 @@ void masking_estimation_free(MaskingEstimator *self) {
   absolute_hearing_thresholds_free(self->reference_spectrum);
   critical_bands_free(self->critical_bands);
 
-  free(self->spectral_spreading_function);
-  free(self->unity_gain_critical_bands_spectrum);
-  free(self->spreaded_unity_gain_critical_bands_spectrum);
-  free(self->threshold_j);
-  free(self->masking_offset);
-  free(self->spreaded_spectrum);
-  free(self->critical_bands_reference_spectrum);
-
-  free(self);
+  spectral_free(self->spreading_diagonals);
+  spectral_free(self->spreading_offsets);
+  spectral_free(self->unity_gain_critical_bands_spectrum);
+  spectral_free(self->spreaded_unity_gain_critical_bands_spectrum);
+  spectral_free(self->unity_gain_spreading_level);
+  spectral_free(self->threshold_j);
+  spectral_free(self->masking_offset);
+  spectral_free(self->spreaded_spectrum);
+  spectral_free(self->critical_bands_reference_spectrum);
+
+  spectral_free(self);
 }
 
 bool compute_masking_thresholds(MaskingEstimator *self, const float *spectrum,
@@ -123,8 +145,9 @@ bool compute_masking_thresholds(MaskingEstimator *self, const float *spectrum,
   compute_critical_bands_spectrum(self->critical_bands, spectrum,
                                   self->critical_bands_reference_spectrum);
 
-  direct_matrix_to_vector_spectral_convolution(
-      self->spectral_spreading_function,
+  banded_matrix_to_vector_spectral_convolution(
+      self->spreading_diagonals, self->spreading_offsets,
+      self->number_of_spreading_diagonals,
       self->critical_bands_reference_spectrum, self->spreaded_spectrum,
       self->number_critical_bands);
 
@@ -143,37 +166,49 @@ bool compute_masking_thresholds(MaskingEstimator *self, const float *spectrum,
     }
 #endif
 
-    self->threshold_j[j] =
-        powf(10.F, log10f(self->spreaded_spectrum[j]) -
-                       (self->masking_offset[j] / 10.F)) -
-        (10.F * log10f(self->spreaded_unity_gain_critical_bands_spectrum[j]));
-
-    self->band_indexes = get_band_indexes(self->critical_bands, j);
-
-    for (uint32_t k = self->band_indexes.start_position;
-         k < self->band_indexes.end_position; k++) {
-      masking_thresholds[k] = self->threshold_j[j];
+    if (self->approximate_math) {
+      self->threshold_j[j] =
+          fast_exp10f(fast_log10f(self->spreaded_spectrum[j]) -
+                      (self->masking_offset[j] / 10.F)) -
+          self->unity_gain_spreading_level[j];
+    } else {
+      self->threshold_j[j] =
+          powf(10.F, log10f(self->spreaded_spectrum[j]) -
+                         (self->masking_offset[j] / 10.F)) -
+          self->unity_gain_spreading_level[j];
     }
   }
 
+  expand_critical_bands_spectrum(self->critical_bands, self->threshold_j,
+                                 masking_thresholds);
   apply_thresholds_as_floor(self->reference_spectrum, masking_thresholds);
 
   return true;
 }
 
+// The spreading function only depends on the distance between the masker and
+// the masked band, so each diagonal of the spreading matrix holds one value.
+// Diagonals below the floor are left out and the rest are stored from the
+// farthest masker to the nearest, the order a row by row product adds them
 static void compute_spectral_spreading_function(MaskingEstimator *self) {
-  for (uint32_t i = 0U; i < self->number_critical_bands; i++) {
-    for (uint32_t j = 0U; j < self->number_critical_bands; j++) {
-      const uint32_t y = (i + 1) - (j + 1);
-
-      self->spectral_spreading_function[i * self->number_critical_bands + j] =
-          15.81F + 7.5F * ((float)y + 0.474F) -
-          17.5F * sqrtf(1.F + ((float)y + 0.474F) * ((float)y + 0.474F));
-
-      self->spectral_spreading_function[i * self->number_critical_bands + j] =
-          powf(10.F, self->spectral_spreading_function
-                             [i * self->number_critical_bands + j] /
-                         10.F);
+  const float floor = powf(10.F, SPREADING_FUNCTION_FLOOR / 10.F);
+  const int32_t last_band = (int32_t)self->number_critical_bands - 1;
+
+  self->number_of_spreading_diagonals = 0U;
+
+  for (int32_t offset = last_band; offset >= -last_band; offset--) {
+    const uint32_t y = (uint32_t)offset;
+
+    float spreading =
+        15.81F + 7.5F * ((float)y + 0.474F) -
+        17.5F * sqrtf(1.F + ((float)y + 0.474F) * ((float)y + 0.474F));
+    spreading = powf(10.F, spreading / 10.F);
+
+    if (spreading > 0.F && spreading >= floor) {
+      const uint32_t d = self->number_of_spreading_diagonals;
+      self->spreading_diagonals[d] = spreading;
+      self->spreading_offsets[d] = offset;
+      self->number_of_spreading_diagonals++;
     }
   }
 }
@@ -183,19 +218,28 @@ static float compute_tonality_factor(MaskingEstimator *self,
   float sum_bins = 0.F;
   float sum_log_bins = 0.F;
 
-  self->band_indexes = get_band_indexes(self->critical_bands, band);
+  const uint32_t start = self->band_offsets[band];
+  const uint32_t end = self->band_offsets[band + 1U];
+  const float bins_in_band = (float)end - (float)start;
 
-  for (uint32_t k = self->band_indexes.start_position;
-       k < self->band_indexes.end_position; k++) {
-    sum_bins += spectrum[k];
-    sum_log_bins += log10f(spectrum[k]);
-  }
+  float SFM = 0.F;
+  if (self->approximate_math) {
+    for (uint32_t k = start; k < end; k++) {
+      sum_bins += spectrum[k];
+      sum_log_bins += fast_log10f(spectrum[k]);
+    }
 
-  float bins_in_band = (float)self->band_indexes.end_position -
-                       (float)self->band_indexes.start_position;
+    SFM = 10.F * (sum_log_bins / bins_in_band) -
+          fast_log10f(sum_bins / bins_in_band);
+  } else {
+    for (uint32_t k = start; k < end; k++) {
+      sum_bins += spectrum[k];
+      sum_log_bins += log10f(spectrum[k]);
+    }
 
-  const float SFM =
-      10.F * (sum_log_bins / bins_in_band) - log10f(sum_bins / bins_in_band);
+    SFM = 10.F * (sum_log_bins / bins_in_band) -
+          log10f(sum_bins / bins_in_band);
+  }
 
   const float tonality_factor = fminf(SFM / -60.F, 1.F);
 
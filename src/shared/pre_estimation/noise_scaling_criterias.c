@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "noise_scaling_criterias.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_utils.h"
 #include "critical_bands.h"
 #include "masking_estimator.h"
@@ -39,6 +40,10 @@ static void masking_thresholds(NoiseScalingCriterias *self,
                                const float *spectrum,
                                const float *noise_spectrum, float *alpha,
                                float *beta, NoiseScalingParameters parameters);
+static float get_oversubtraction_factor(const NoiseScalingCriterias *self,
+                                        float a_posteriori_snr,
+                                        float previous_factor,
+                                        NoiseScalingParameters parameters);
 
 struct NoiseScalingCriterias {
   NoiseScalingType noise_scaling_type;
@@ -51,13 +56,18 @@ struct NoiseScalingCriterias {
   float higher_snr;
   float alpha_minimun;
   float beta_minimun;
-  CriticalBandIndexes band_indexes;
   CriticalBandType critical_band_type;
 
   float *masking_thresholds;
   float *clean_signal_estimation;
   float *critical_bands_noise_profile;
   float *critical_bands_reference_spectrum;
+  float *critical_bands_oversubtraction;
+
+  // Noise profile generation each cached value was computed from
+  float noise_spectrum_sum;
+  uint32_t noise_spectrum_sum_generation;
+  uint32_t critical_bands_noise_profile_generation;
 
   MaskingEstimator *masking_estimation;
   CriticalBands *critical_bands;
@@ -65,10 +75,11 @@ struct NoiseScalingCriterias {
 
 NoiseScalingCriterias *noise_scaling_criterias_initialize(
     const uint32_t fft_size, const CriticalBandType critical_band_type,
-    const uint32_t sample_rate, SpectrumType spectrum_type) {
+    const uint32_t sample_rate, SpectrumType spectrum_type,
+    const bool approximate_math) {
 
-  NoiseScalingCriterias *self =
-      (NoiseScalingCriterias *)calloc(1U, sizeof(NoiseScalingCriterias));
+  NoiseScalingCriterias *self = (NoiseScalingCriterias *)spectral_calloc(
+      1U, sizeof(NoiseScalingCriterias));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
@@ -83,19 +94,22 @@ NoiseScalingCriterias *noise_scaling_criterias_initialize(
   self->critical_bands = critical_bands_initialize(
       self->sample_rate, self->fft_size, self->critical_band_type);
   self->masking_estimation = masking_estimation_initialize(
-      self->fft_size, self->sample_rate, self->spectrum_type);
+      self->fft_size, self->sample_rate, self->critical_band_type,
+      self->spectrum_type, approximate_math);
   self->number_critical_bands =
       get_number_of_critical_bands(self->critical_bands);
 
   self->critical_bands_noise_profile =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
   self->critical_bands_reference_spectrum =
-      (float *)calloc(self->number_critical_bands, sizeof(float));
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
+  self->critical_bands_oversubtraction =
+      (float *)spectral_calloc(self->number_critical_bands, sizeof(float));
 
   self->masking_thresholds =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->clean_signal_estimation =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
   return self;
 }
@@ -104,12 +118,13 @@ void noise_scaling_criterias_free(NoiseScalingCriterias *self) {
   critical_bands_free(self->critical_bands);
   masking_estimation_free(self->masking_estimation);
 
-  free(self->clean_signal_estimation);
-  free(self->masking_thresholds);
-  free(self->critical_bands_noise_profile);
-  free(self->critical_bands_reference_spectrum);
+  spectral_free(self->clean_signal_estimation);
+  spectral_free(self->masking_thresholds);
+  spectral_free(self->critical_bands_noise_profile);
+  spectral_free(self->critical_bands_reference_spectrum);
+  spectral_free(self->critical_bands_oversubtraction);
 
-  free(self);
+  spectral_free(self);
 }
 
 bool apply_noise_scaling_criteria(NoiseScalingCriterias *self,
@@ -140,43 +155,46 @@ bool apply_noise_scaling_criteria(NoiseScalingCriterias *self,
   return true;
 }
 
+static bool is_noise_cached(const uint32_t cached_generation,
+                            const uint32_t generation) {
+  return generation != 0U && cached_generation == generation;
+}
+
 static void a_posteriori_snr_critical_bands(NoiseScalingCriterias *self,
                                             const float *spectrum,
                                             const float *noise_spectrum,
                                             float *alpha,
                                             NoiseScalingParameters parameters) {
 
-  compute_critical_bands_spectrum(self->critical_bands, noise_spectrum,
-                                  self->critical_bands_noise_profile);
-  compute_critical_bands_spectrum(self->critical_bands, spectrum,
-                                  self->critical_bands_reference_spectrum);
+  if (is_noise_cached(self->critical_bands_noise_profile_generation,
+                      parameters.noise_profile_generation)) {
+    compute_critical_bands_spectrum(self->critical_bands, spectrum,
+                                    self->critical_bands_reference_spectrum);
+  } else {
+    const float *spectra[2] = {spectrum, noise_spectrum};
+    float *critical_bands[2] = {self->critical_bands_reference_spectrum,
+                                self->critical_bands_noise_profile};
+    compute_critical_bands_spectra(self->critical_bands, spectra,
+                                   critical_bands, 2U);
+    self->critical_bands_noise_profile_generation =
+        parameters.noise_profile_generation;
+  }
 
-  float a_posteriori_snr = 20.F;
   float oversustraction_factor = 1.F;
 
   for (uint32_t j = 0U; j < self->number_critical_bands; j++) {
-
-    self->band_indexes = get_band_indexes(self->critical_bands, j);
-
-    a_posteriori_snr =
+    const float a_posteriori_snr =
         10.F * log10f(self->critical_bands_reference_spectrum[j] /
                       self->critical_bands_noise_profile[j]);
 
-    if (a_posteriori_snr >= self->lower_snr &&
-        a_posteriori_snr <= self->higher_snr) {
-      oversustraction_factor =
-          -0.05F * (a_posteriori_snr) + parameters.oversubtraction;
-    } else if (a_posteriori_snr < 0.F) {
-      oversustraction_factor = parameters.oversubtraction;
-    } else if (a_posteriori_snr > 20.F) {
-      oversustraction_factor = 1.F;
-    }
+    oversustraction_factor = get_oversubtraction_factor(
+        self, a_posteriori_snr, oversustraction_factor, parameters);
 
-    for (uint32_t k = self->band_indexes.start_position;
-         k < self->band_indexes.end_position; k++) {
-      alpha[k] = oversustraction_factor;
-    }
+    self->critical_bands_oversubtraction[j] = oversustraction_factor;
   }
+
+  expand_critical_bands_spectrum(self->critical_bands,
+                                 self->critical_bands_oversubtraction, alpha);
 }
 
 static void a_posteriori_snr(NoiseScalingCriterias *self, const float *spectrum,
@@ -185,28 +203,91 @@ static void a_posteriori_snr(NoiseScalingCriterias *self, const float *spectrum,
   float a_posteriori_snr = 20.F;
   float oversustraction_factor = 1.F;
   float noisy_spectrum_sum = 0.F;
-  float noise_spectrum_sum = 0.F;
 
   for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
     noisy_spectrum_sum += spectrum[k];
-    noise_spectrum_sum += noise_spectrum[k];
   }
 
-  a_posteriori_snr = 10.F * log10f(noisy_spectrum_sum / noise_spectrum_sum);
+  if (!is_noise_cached(self->noise_spectrum_sum_generation,
+                       parameters.noise_profile_generation)) {
+    self->noise_spectrum_sum = 0.F;
+    for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
+      self->noise_spectrum_sum += noise_spectrum[k];
+    }
+    self->noise_spectrum_sum_generation = parameters.noise_profile_generation;
+  }
+
+  a_posteriori_snr =
+      10.F * log10f(noisy_spectrum_sum / self->noise_spectrum_sum);
+
+  oversustraction_factor = get_oversubtraction_factor(
+      self, a_posteriori_snr, oversustraction_factor, parameters);
+
+  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
+    alpha[k] = oversustraction_factor;
+  }
+}
 
+// Oversubtraction falls linearly with the SNR between both limits. SNRs
+// outside of every range keep the previous factor
+static float get_oversubtraction_factor(const NoiseScalingCriterias *self,
+                                        const float a_posteriori_snr,
+                                        const float previous_factor,
+                                        NoiseScalingParameters parameters) {
   if (a_posteriori_snr >= self->lower_snr &&
       a_posteriori_snr <= self->higher_snr) {
-    oversustraction_factor =
-        -0.05F * (a_posteriori_snr) + parameters.oversubtraction;
-  } else if (a_posteriori_snr < 0.F) {
-    oversustraction_factor = parameters.oversubtraction;
-  } else if (a_posteriori_snr > 20.F) {
-    oversustraction_factor = 1.F;
+    return -0.05F * (a_posteriori_snr) + parameters.oversubtraction;
+  }
+  if (a_posteriori_snr < 0.F) {
+    return parameters.oversubtraction;
+  }
+  if (a_posteriori_snr > 20.F) {
+    return 1.F;
   }
 
-  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
-    alpha[k] = oversustraction_factor;
+  return previous_factor;
+}
+
+bool apply_noise_scaling_criteria_to_bands(NoiseScalingCriterias *self,
+                                           const float *band_spectrum,
+                                           const float *band_noise_spectrum,
+                                           float *alpha,
+                                           const uint32_t band_spectrum_size,
+                                           NoiseScalingParameters parameters) {
+  if (!self || !band_spectrum || !band_noise_spectrum || !alpha) {
+    return false;
+  }
+
+  float oversustraction_factor = 1.F;
+
+  if ((NoiseScalingType)parameters.scaling_type == A_POSTERIORI_SNR) {
+    float noisy_spectrum_sum = 0.F;
+    float noise_spectrum_sum = 0.F;
+    for (uint32_t j = 1U; j < band_spectrum_size; j++) {
+      noisy_spectrum_sum += band_spectrum[j];
+      noise_spectrum_sum += band_noise_spectrum[j];
+    }
+
+    oversustraction_factor = get_oversubtraction_factor(
+        self, 10.F * log10f(noisy_spectrum_sum / noise_spectrum_sum),
+        oversustraction_factor, parameters);
+
+    for (uint32_t j = 1U; j < band_spectrum_size; j++) {
+      alpha[j] = oversustraction_factor;
+    }
+
+    return true;
   }
+
+  for (uint32_t j = 1U; j < band_spectrum_size; j++) {
+    oversustraction_factor = get_oversubtraction_factor(
+        self, 10.F * log10f(band_spectrum[j] / band_noise_spectrum[j]),
+        oversustraction_factor, parameters);
+
+    alpha[j] = oversustraction_factor;
+  }
+
+  return true;
 }
 
 static void masking_thresholds(NoiseScalingCriterias *self,
@@ -36,18 +36,31 @@ typedef struct NoiseScalingParameters {
   float undersubtraction;
   float oversubtraction;
   int scaling_type;
+  // Generation of the noise profile the noise spectrum was copied from, so
+  // values that only depend on it are computed once. Zero recomputes them on
+  // every call for noise spectra estimated on each frame
+  uint32_t noise_profile_generation;
 } NoiseScalingParameters;
 
 typedef struct NoiseScalingCriterias NoiseScalingCriterias;
 
 NoiseScalingCriterias *noise_scaling_criterias_initialize(
     uint32_t fft_size, CriticalBandType critical_band_type,
-    uint32_t sample_rate, SpectrumType spectrum_type);
+    uint32_t sample_rate, SpectrumType spectrum_type, bool approximate_math);
 void noise_scaling_criterias_free(NoiseScalingCriterias *self);
 bool apply_noise_scaling_criteria(NoiseScalingCriterias *self,
                                   const float *spectrum,
                                   const float *noise_spectrum, float *alpha,
                                   float *beta,
                                   NoiseScalingParameters parameters);
+// Applies the criteria to spectra already reduced to bands, skipping their
+// first element as with bins. Masking thresholds need every bin so bands use
+// their a posteriori SNR instead
+bool apply_noise_scaling_criteria_to_bands(NoiseScalingCriterias *self,
+                                           const float *band_spectrum,
+                                           const float *band_noise_spectrum,
+                                           float *alpha,
+                                           uint32_t band_spectrum_size,
+                                           NoiseScalingParameters parameters);
 
 #endif
\ No newline at end of file
@@ -19,6 +19,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "spectral_smoother.h"
+#include "../utils/memory_arena.h"
 #include "transient_detector.h"
 #include <math.h>
 #include <stdlib.h>
@@ -28,6 +29,8 @@ static void spectrum_time_smoothing(SpectralSmoother *self, float smoothing);
 static void spectrum_transient_aware_time_smoothing(SpectralSmoother *self,
                                                     float smoothing,
                                                     float *spectrum);
+static float get_look_ahead_smoothing(SpectralSmoother *self,
+                                      float smoothing);
 
 struct SpectralSmoother {
   uint32_t fft_size;
@@ -35,18 +38,26 @@ struct SpectralSmoother {
   float adaptive_coefficient;
   float previous_adaptive_coefficient;
   TimeSmoothingType type;
+  // Whether the last frame smoothed was taken as a transient
+  bool transient_detected;
 
   float *noise_spectrum;
   float *smoothed_spectrum;
   float *smoothed_spectrum_previous;
 
   TransientDetector *transient_detection;
+
+  // Transients found on the spectra looked ahead, the oldest belonging to the
+  // spectrum smoothed next
+  uint32_t look_ahead_hops;
+  bool *onsets;
+  uint32_t onset_position;
 };
 
 SpectralSmoother *spectral_smoothing_initialize(const uint32_t fft_size,
                                                 TimeSmoothingType type) {
   SpectralSmoother *self =
-      (SpectralSmoother *)calloc(1U, sizeof(SpectralSmoother));
+      (SpectralSmoother *)spectral_calloc(1U, sizeof(SpectralSmoother));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
@@ -55,11 +66,11 @@ SpectralSmoother *spectral_smoothing_initialize(const uint32_t fft_size,
   self->adaptive_coefficient = 0.F;
 
   self->noise_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->smoothed_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->smoothed_spectrum_previous =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
   self->transient_detection = transient_detector_initialize(self->fft_size);
 
@@ -69,11 +80,60 @@ SpectralSmoother *spectral_smoothing_initialize(const uint32_t fft_size,
 void spectral_smoothing_free(SpectralSmoother *self) {
   transient_detector_free(self->transient_detection);
 
-  free(self->noise_spectrum);
-  free(self->smoothed_spectrum);
-  free(self->smoothed_spectrum_previous);
+  spectral_free(self->noise_spectrum);
+  spectral_free(self->smoothed_spectrum);
+  spectral_free(self->smoothed_spectrum_previous);
+  spectral_free(self->onsets);
+
+  spectral_free(self);
+}
+
+void spectral_smoothing_reset(SpectralSmoother *self) {
+  self->previous_adaptive_coefficient = 0.F;
+  self->adaptive_coefficient = 0.F;
+  self->transient_detected = false;
+
+  memset(self->noise_spectrum, 0, self->real_spectrum_size * sizeof(float));
+  memset(self->smoothed_spectrum, 0, self->real_spectrum_size * sizeof(float));
+  memset(self->smoothed_spectrum_previous, 0,
+         self->real_spectrum_size * sizeof(float));
+
+  transient_detector_reset(self->transient_detection);
+
+  if (self->onsets) {
+    memset(self->onsets, 0, (self->look_ahead_hops + 1U) * sizeof(bool));
+    self->onset_position = 0U;
+  }
+}
+
+bool spectral_smoothing_enable_look_ahead(SpectralSmoother *self,
+                                          const uint32_t look_ahead_hops) {
+  if (!self || self->onsets || look_ahead_hops == 0U) {
+    return false;
+  }
+
+  self->onsets = (bool *)spectral_calloc(look_ahead_hops + 1U, sizeof(bool));
+  self->look_ahead_hops = look_ahead_hops;
+  self->onset_position = 0U;
+
+  return true;
+}
+
+bool spectral_smoothing_look_ahead(SpectralSmoother *self,
+                                   TimeSmoothingParameters parameters,
+                                   const float *signal_spectrum) {
+  if (!self || !self->onsets || !signal_spectrum) {
+    return false;
+  }
+
+  self->onset_position =
+      (self->onset_position + 1U) % (self->look_ahead_hops + 1U);
+  self->onsets[self->onset_position] =
+      self->type == TRANSIENT_AWARE &&
+      parameters.transient_protection_enabled &&
+      transient_detector_run(self->transient_detection, signal_spectrum);
 
-  free(self);
+  return true;
 }
 
 bool spectral_smoothing_run(SpectralSmoother *self,
@@ -85,6 +145,7 @@ bool spectral_smoothing_run(SpectralSmoother *self,
 
   memcpy(self->smoothed_spectrum, signal_spectrum,
          sizeof(float) * self->real_spectrum_size);
+  self->transient_detected = false;
 
   switch (self->type) {
   case FIXED:
@@ -113,18 +174,42 @@ bool spectral_smoothing_run(SpectralSmoother *self,
 static void spectrum_transient_aware_time_smoothing(SpectralSmoother *self,
                                                     const float smoothing,
                                                     float *spectrum) {
+  float frame_smoothing = smoothing;
+  if (self->onsets) {
+    frame_smoothing = get_look_ahead_smoothing(self, smoothing);
+  } else {
+    self->transient_detected =
+        transient_detector_run(self->transient_detection, spectrum);
+  }
 
-  if (!transient_detector_run(self->transient_detection, spectrum)) {
+  if (!self->transient_detected) {
     for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
       if (self->smoothed_spectrum[k] > self->smoothed_spectrum_previous[k]) {
         self->smoothed_spectrum[k] =
-            smoothing * self->smoothed_spectrum_previous[k] +
-            (1.F - smoothing) * self->smoothed_spectrum[k];
+            frame_smoothing * self->smoothed_spectrum_previous[k] +
+            (1.F - frame_smoothing) * self->smoothed_spectrum[k];
       }
     }
   }
 }
 
+// Spectra leading to an onset already rise with it, so they are smoothed less
+// the closer the onset is
+static float get_look_ahead_smoothing(SpectralSmoother *self,
+                                      const float smoothing) {
+  const uint32_t ring_size = self->look_ahead_hops + 1U;
+  const uint32_t oldest = (self->onset_position + 1U) % ring_size;
+  self->transient_detected = self->onsets[oldest];
+
+  for (uint32_t k = 1U; k < ring_size; k++) {
+    if (self->onsets[(oldest + k) % ring_size]) {
+      return smoothing * (float)k / (float)ring_size;
+    }
+  }
+
+  return smoothing;
+}
+
 static void spectrum_time_smoothing(SpectralSmoother *self,
                                     const float smoothing) {
   for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
@@ -134,4 +219,8 @@ static void spectrum_time_smoothing(SpectralSmoother *self,
           (1.F - smoothing) * self->smoothed_spectrum[k];
     }
   }
-}
\ No newline at end of file
+}
+
+bool is_transient_detected(const SpectralSmoother *self) {
+  return self->transient_detected;
+}
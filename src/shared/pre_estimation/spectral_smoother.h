@@ -39,8 +39,21 @@ typedef struct SpectralSmoother SpectralSmoother;
 SpectralSmoother *spectral_smoothing_initialize(uint32_t fft_size,
                                                 TimeSmoothingType type);
 void spectral_smoothing_free(SpectralSmoother *self);
+void spectral_smoothing_reset(SpectralSmoother *self);
 bool spectral_smoothing_run(SpectralSmoother *self,
                             TimeSmoothingParameters parameters,
                             float *signal_spectrum);
+// Transients are detected on spectra the given number of hops ahead of the
+// ones smoothed, which must be passed to spectral_smoothing_look_ahead as they
+// arrive. Smoothing relaxes over the hops leading to an onset
+bool spectral_smoothing_enable_look_ahead(SpectralSmoother *self,
+                                          uint32_t look_ahead_hops);
+// Detects transients on a spectrum arriving while the one smoothed next is the
+// spectrum that arrived the look ahead hops before it
+bool spectral_smoothing_look_ahead(SpectralSmoother *self,
+                                   TimeSmoothingParameters parameters,
+                                   const float *signal_spectrum);
+// Only transient aware smoothing with protection enabled detects transients
+bool is_transient_detected(const SpectralSmoother *self);
 
 #endif
\ No newline at end of file
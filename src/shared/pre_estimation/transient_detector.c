@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "transient_detector.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_utils.h"
 #include <math.h>
 #include <stdlib.h>
@@ -28,54 +29,86 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 struct TransientDetector {
   uint32_t fft_size;
   uint32_t real_spectrum_size;
-  float rolling_mean;
   bool transient_present;
+
+  // Spectral flux of the last hops, whose mean sets the threshold. A mean over
+  // the whole history would adapt ever more slowly as the stream goes on
+  float *flux_window;
   uint32_t window_count;
+  uint32_t window_position;
 
-  float *previous_spectrum;
+  // Magnitudes are kept from one hop to the next, so each bin takes a
+  // single square root per hop
+  float *magnitude;
+  float *previous_magnitude;
 };
 
 TransientDetector *transient_detector_initialize(const uint32_t fft_size) {
   TransientDetector *self =
-      (TransientDetector *)calloc(1U, sizeof(TransientDetector));
+      (TransientDetector *)spectral_calloc(1U, sizeof(TransientDetector));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
 
-  self->previous_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+  self->magnitude =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  self->previous_magnitude =
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
+  self->flux_window =
+      (float *)spectral_calloc(TRANSIENT_DETECTOR_WINDOW, sizeof(float));
 
   self->window_count = 0U;
-  self->rolling_mean = 0.F;
+  self->window_position = 0U;
   self->transient_present = false;
 
   return self;
 }
 
 void transient_detector_free(TransientDetector *self) {
-  free(self->previous_spectrum);
+  spectral_free(self->magnitude);
+  spectral_free(self->previous_magnitude);
+  spectral_free(self->flux_window);
+
+  spectral_free(self);
+}
 
-  free(self);
+void transient_detector_reset(TransientDetector *self) {
+  memset(self->previous_magnitude, 0,
+         self->real_spectrum_size * sizeof(float));
+  memset(self->flux_window, 0, TRANSIENT_DETECTOR_WINDOW * sizeof(float));
+  self->window_count = 0U;
+  self->window_position = 0U;
+  self->transient_present = false;
 }
 
 bool transient_detector_run(TransientDetector *self, const float *spectrum) {
+  for (uint32_t k = 0U; k < self->real_spectrum_size; k++) {
+    self->magnitude[k] = sqrtf(spectrum[k]);
+  }
+
   const float reduction_function = spectral_flux(
-      spectrum, self->previous_spectrum, self->real_spectrum_size);
+      self->magnitude, self->previous_magnitude, self->real_spectrum_size);
 
-  self->window_count += 1U;
+  self->flux_window[self->window_position] = reduction_function;
+  self->window_position = (self->window_position + 1U) %
+                          TRANSIENT_DETECTOR_WINDOW;
+  if (self->window_count < TRANSIENT_DETECTOR_WINDOW) {
+    self->window_count += 1U;
+  }
 
-  if (self->window_count > 1U) {
-    self->rolling_mean +=
-        ((reduction_function - self->rolling_mean) / (float)self->window_count);
-  } else {
-    self->rolling_mean = reduction_function;
+  // Added up again every hop so rounding errors don't build up over time
+  float flux_sum = 0.F;
+  for (uint32_t k = 0U; k < self->window_count; k++) {
+    flux_sum += self->flux_window[k];
   }
+  const float rolling_mean = flux_sum / (float)self->window_count;
 
   const float adapted_threshold =
-      (UPPER_LIMIT - DEFAULT_TRANSIENT_THRESHOLD) * self->rolling_mean;
+      (UPPER_LIMIT - DEFAULT_TRANSIENT_THRESHOLD) * rolling_mean;
 
-  memcpy(self->previous_spectrum, spectrum,
-         sizeof(float) * self->real_spectrum_size);
+  float *previous_magnitude = self->previous_magnitude;
+  self->previous_magnitude = self->magnitude;
+  self->magnitude = previous_magnitude;
 
   if (reduction_function > adapted_threshold) {
     return true;
@@ -28,6 +28,7 @@ typedef struct TransientDetector TransientDetector;
 
 TransientDetector *transient_detector_initialize(uint32_t fft_size);
 void transient_detector_free(TransientDetector *self);
+void transient_detector_reset(TransientDetector *self);
 bool transient_detector_run(TransientDetector *self, const float *spectrum);
 
 #endif
\ No newline at end of file
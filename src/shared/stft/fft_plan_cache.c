@@ -0,0 +1,251 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fft_plan_cache.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct FftPlanEntry {
+  fftwf_plan plan;
+  uint32_t fft_size;
+  uint32_t number_of_transforms;
+  uint32_t real_distance;
+  uint32_t complex_distance;
+  FftPlanKind kind;
+  unsigned planner_flags;
+  uint32_t references;
+  struct FftPlanEntry *next;
+} FftPlanEntry;
+
+static fftwf_plan create_plan(uint32_t fft_size, uint32_t number_of_transforms,
+                              uint32_t real_distance, uint32_t complex_distance,
+                              FftPlanKind kind, unsigned planner_flags);
+static unsigned get_planner_flags(FftPlannerRigor planner_rigor);
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FftPlanEntry *cache_entries = NULL;
+
+fftwf_plan fft_plan_cache_acquire(const uint32_t fft_size,
+                                  const uint32_t number_of_transforms,
+                                  const uint32_t real_distance,
+                                  const uint32_t complex_distance,
+                                  const FftPlanKind kind,
+                                  const FftPlannerRigor planner_rigor) {
+  if (fft_size == 0U || number_of_transforms == 0U ||
+      real_distance < fft_size || complex_distance < fft_size / 2U + 1U) {
+    return NULL;
+  }
+
+  const unsigned planner_flags = get_planner_flags(planner_rigor);
+  fftwf_plan plan = NULL;
+
+  pthread_mutex_lock(&cache_mutex);
+
+  for (FftPlanEntry *entry = cache_entries; entry; entry = entry->next) {
+    if (entry->fft_size == fft_size &&
+        entry->number_of_transforms == number_of_transforms &&
+        entry->real_distance == real_distance &&
+        entry->complex_distance == complex_distance && entry->kind == kind &&
+        entry->planner_flags == planner_flags) {
+      entry->references++;
+      plan = entry->plan;
+      break;
+    }
+  }
+
+  if (!plan) {
+    FftPlanEntry *entry = (FftPlanEntry *)calloc(1U, sizeof(FftPlanEntry));
+    if (entry) {
+      entry->plan =
+          create_plan(fft_size, number_of_transforms, real_distance,
+                      complex_distance, kind, planner_flags);
+      if (entry->plan) {
+        entry->fft_size = fft_size;
+        entry->number_of_transforms = number_of_transforms;
+        entry->real_distance = real_distance;
+        entry->complex_distance = complex_distance;
+        entry->kind = kind;
+        entry->planner_flags = planner_flags;
+        entry->references = 1U;
+        entry->next = cache_entries;
+        cache_entries = entry;
+        plan = entry->plan;
+      } else {
+        free(entry);
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+
+  return plan;
+}
+
+void fft_plan_cache_release(fftwf_plan plan) {
+  if (!plan) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+
+  FftPlanEntry **link = &cache_entries;
+  while (*link) {
+    FftPlanEntry *entry = *link;
+    if (entry->plan == plan) {
+      entry->references--;
+      if (entry->references == 0U) {
+        *link = entry->next;
+        fftwf_destroy_plan(entry->plan);
+        free(entry);
+      }
+      break;
+    }
+    link = &entry->next;
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+}
+
+// Plans are created over scratch buffers so measuring planners never touch the
+// buffers of the instances sharing them
+static fftwf_plan create_plan(const uint32_t fft_size,
+                              const uint32_t number_of_transforms,
+                              const uint32_t real_distance,
+                              const uint32_t complex_distance,
+                              const FftPlanKind kind,
+                              const unsigned planner_flags) {
+  const int n = (int)fft_size;
+  const int howmany = (int)number_of_transforms;
+  const int real_dist = (int)real_distance;
+  const int complex_dist = (int)complex_distance;
+  const size_t real_size = (size_t)real_distance * number_of_transforms;
+  const size_t complex_size = (size_t)complex_distance * number_of_transforms;
+
+  float *real_buffer = (float *)fftwf_malloc(real_size * sizeof(float));
+  float *spectrum_buffer = (float *)fftwf_malloc(real_size * sizeof(float));
+  fftwf_complex *complex_buffer =
+      (fftwf_complex *)fftwf_malloc(complex_size * sizeof(fftwf_complex));
+
+  const fftwf_r2r_kind forward_kind = FFTW_R2HC;
+  const fftwf_r2r_kind backward_kind = FFTW_HC2R;
+  fftwf_plan plan = NULL;
+
+  if (real_buffer && spectrum_buffer && complex_buffer) {
+    switch (kind) {
+    case R2HC_PLAN:
+      plan = fftwf_plan_many_r2r(1, &n, howmany, real_buffer, NULL, 1,
+                                 real_dist, spectrum_buffer, NULL, 1,
+                                 real_dist, &forward_kind, planner_flags);
+      break;
+    case HC2R_PLAN:
+      plan = fftwf_plan_many_r2r(1, &n, howmany, spectrum_buffer, NULL, 1,
+                                 real_dist, real_buffer, NULL, 1, real_dist,
+                                 &backward_kind, planner_flags);
+      break;
+    case R2C_PLAN:
+      plan = fftwf_plan_many_dft_r2c(1, &n, howmany, real_buffer, NULL, 1,
+                                     real_dist, complex_buffer, NULL, 1,
+                                     complex_dist, planner_flags);
+      break;
+    case C2R_PLAN:
+      plan = fftwf_plan_many_dft_c2r(1, &n, howmany, complex_buffer, NULL, 1,
+                                     complex_dist, real_buffer, NULL, 1,
+                                     real_dist, planner_flags);
+      break;
+    default:
+      break;
+    }
+  }
+
+  fftwf_free(real_buffer);
+  fftwf_free(spectrum_buffer);
+  fftwf_free(complex_buffer);
+
+  return plan;
+}
+
+static unsigned get_planner_flags(const FftPlannerRigor planner_rigor) {
+  switch (planner_rigor) {
+  case MEASURE_PLANNER:
+    return FFTW_MEASURE;
+  case PATIENT_PLANNER:
+    return FFTW_PATIENT;
+  case EXHAUSTIVE_PLANNER:
+    return FFTW_EXHAUSTIVE;
+  case ESTIMATE_PLANNER:
+  default:
+    return FFTW_ESTIMATE;
+  }
+}
+
+bool fft_import_wisdom_from_file(const char *file_name) {
+  if (!file_name) {
+    return false;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+  const bool imported = fftwf_import_wisdom_from_filename(file_name) != 0;
+  pthread_mutex_unlock(&cache_mutex);
+
+  return imported;
+}
+
+bool fft_export_wisdom_to_file(const char *file_name) {
+  if (!file_name) {
+    return false;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+  const bool exported = fftwf_export_wisdom_to_filename(file_name) != 0;
+  pthread_mutex_unlock(&cache_mutex);
+
+  return exported;
+}
+
+bool fft_import_wisdom_from_string(const char *wisdom) {
+  if (!wisdom) {
+    return false;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+  const bool imported = fftwf_import_wisdom_from_string(wisdom) != 0;
+  pthread_mutex_unlock(&cache_mutex);
+
+  return imported;
+}
+
+char *fft_export_wisdom_to_string(void) {
+  pthread_mutex_lock(&cache_mutex);
+  char *wisdom = fftwf_export_wisdom_to_string();
+  pthread_mutex_unlock(&cache_mutex);
+
+  return wisdom;
+}
+
+void fft_free_wisdom_string(char *wisdom) {
+  // FFTW allocates the exported string with malloc
+  free(wisdom);
+}
+
+void fft_forget_wisdom(void) {
+  pthread_mutex_lock(&cache_mutex);
+  fftwf_forget_wisdom();
+  pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,62 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+#include "fft_transform.h"
+#include <fftw3.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Process wide cache of FFTW plans shared by every FftTransform. Plans are
+// keyed by size, batch layout, kind and planner rigor and are reference counted
+// so the last user frees them. Batched plans run number_of_transforms
+// transforms at once, each one placed real_distance floats (or
+// complex_distance complex values) apart from the previous one. Shared plans
+// are planned over scratch buffers and must be executed with the new-array
+// execute functions (fftwf_execute_r2r, fftwf_execute_dft_r2c and
+// fftwf_execute_dft_c2r) over out of place buffers allocated with
+// fftwf_malloc, so alignment matches the planned one. Acquiring, releasing and
+// every wisdom function are serialized since the FFTW planner is not thread
+// safe. Executing plans is thread safe
+typedef enum FftPlanKind {
+  R2HC_PLAN = 0,
+  HC2R_PLAN = 1,
+  R2C_PLAN = 2,
+  C2R_PLAN = 3,
+} FftPlanKind;
+
+fftwf_plan fft_plan_cache_acquire(uint32_t fft_size,
+                                  uint32_t number_of_transforms,
+                                  uint32_t real_distance,
+                                  uint32_t complex_distance, FftPlanKind kind,
+                                  FftPlannerRigor planner_rigor);
+void fft_plan_cache_release(fftwf_plan plan);
+
+// FFTW wisdom is process wide and it is used by any plan created afterwards
+bool fft_import_wisdom_from_file(const char *file_name);
+bool fft_export_wisdom_to_file(const char *file_name);
+bool fft_import_wisdom_from_string(const char *wisdom);
+char *fft_export_wisdom_to_string(void);
+void fft_free_wisdom_string(char *wisdom);
+void fft_forget_wisdom(void);
+
+#endif
@@ -20,20 +20,33 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "fft_transform.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
+#include "fft_plan_cache.h"
 #include "../utils/general_utils.h"
+#include "../utils/spectral_kernels.h"
 
 #include <fftw3.h>
 #include <stdlib.h>
 #include <string.h>
 
 static uint32_t calculate_fft_size(FftTransform *self);
+static uint32_t get_aligned_distance(uint32_t size, uint32_t alignment);
 static void allocate_fftw(FftTransform *self);
+static void *allocate_fft_buffer(size_t size);
+static void free_fft_buffer(void *buffer);
+static void pack_halfcomplex_spectrum(FftTransform *self);
+static void unpack_halfcomplex_spectrum(FftTransform *self);
 
 struct FftTransform {
   fftwf_plan forward;
   fftwf_plan backward;
 
+  FftTransformType transform_type;
+  FftPlannerRigor planner_rigor;
   uint32_t fft_size;
+  uint32_t number_of_channels;
+  uint32_t real_distance;
+  uint32_t complex_distance;
   uint32_t frame_size;
   uint32_t zeropadding_amount;
   uint32_t copy_position;
@@ -41,13 +54,22 @@ struct FftTransform {
   uint32_t padding_amount;
   float *input_fft_buffer;
   float *output_fft_buffer;
+  float *synthesis_fft_buffer;
+  fftwf_complex *complex_spectrum;
 };
 
 FftTransform *fft_transform_initialize(const uint32_t frame_size,
                                        const ZeroPaddingType padding_type,
-                                       const uint32_t zeropadding_amount) {
-  FftTransform *self = (FftTransform *)calloc(1U, sizeof(FftTransform));
-
+                                       const uint32_t zeropadding_amount,
+                                       const FftTransformType transform_type,
+                                       const FftPlannerRigor planner_rigor,
+                                       const uint32_t number_of_channels) {
+  FftTransform *self =
+      (FftTransform *)spectral_calloc(1U, sizeof(FftTransform));
+
+  self->number_of_channels = number_of_channels > 0U ? number_of_channels : 1U;
+  self->transform_type = transform_type;
+  self->planner_rigor = planner_rigor;
   self->padding_type = padding_type;
   self->zeropadding_amount = zeropadding_amount;
   self->frame_size = frame_size;
@@ -58,92 +80,218 @@ FftTransform *fft_transform_initialize(const uint32_t frame_size,
 
   allocate_fftw(self);
 
+  // The backward transform writes apart from the input so the padding of the
+  // input stays zeroed and only the frame region is ever written
+  const size_t real_size =
+      (size_t)self->real_distance * self->number_of_channels;
+  self->synthesis_fft_buffer =
+      (float *)allocate_fft_buffer(real_size * sizeof(float));
+  memset(self->synthesis_fft_buffer, 0, real_size * sizeof(float));
+
   return self;
 }
 
-FftTransform *fft_transform_initialize_bins(const uint32_t fft_size) {
-  FftTransform *self = (FftTransform *)calloc(1U, sizeof(FftTransform));
+FftTransform *
+fft_transform_initialize_bins(const uint32_t fft_size,
+                              const FftTransformType transform_type,
+                              const FftPlannerRigor planner_rigor) {
+  FftTransform *self =
+      (FftTransform *)spectral_calloc(1U, sizeof(FftTransform));
 
+  self->number_of_channels = 1U;
+  self->transform_type = transform_type;
+  self->planner_rigor = planner_rigor;
   self->fft_size = fft_size;
   self->frame_size = self->fft_size;
 
   allocate_fftw(self);
 
+  // Without padding there is nothing to preserve so the backward transform
+  // writes over the input as it always did
+  self->synthesis_fft_buffer = self->input_fft_buffer;
+
   return self;
 }
 
+// Channels are laid out one after the other, each one starting at an aligned
+// distance from the previous, so a single batched plan transforms all of them
 static void allocate_fftw(FftTransform *self) {
+  self->real_distance =
+      get_aligned_distance(self->fft_size, FFT_CHANNEL_ALIGNMENT);
+  self->complex_distance = get_aligned_distance(
+      self->fft_size / 2U + 1U, FFT_CHANNEL_ALIGNMENT / 2U);
+
+  const size_t real_size =
+      (size_t)self->real_distance * self->number_of_channels;
+
   self->input_fft_buffer =
-      (float *)fftwf_malloc(self->fft_size * sizeof(float));
+      (float *)allocate_fft_buffer(real_size * sizeof(float));
   self->output_fft_buffer =
-      (float *)fftwf_malloc(self->fft_size * sizeof(float));
-  self->forward =
-      fftwf_plan_r2r_1d((int)self->fft_size, self->input_fft_buffer,
-                        self->output_fft_buffer, FFTW_FORWARD, FFTW_ESTIMATE);
-  self->backward =
-      fftwf_plan_r2r_1d((int)self->fft_size, self->output_fft_buffer,
-                        self->input_fft_buffer, FFTW_BACKWARD, FFTW_ESTIMATE);
+      (float *)allocate_fft_buffer(real_size * sizeof(float));
+
+  // A measured instance never transforms anything so it leaves the plans
+  // alone, which keeps it from planning or holding them in the cache
+  const bool planned = !is_bound_memory_arena_measuring();
+
+  switch (self->transform_type) {
+  case REAL_TO_COMPLEX_TRANSFORM:
+    self->complex_spectrum = (fftwf_complex *)allocate_fft_buffer(
+        (size_t)self->complex_distance * self->number_of_channels *
+        sizeof(fftwf_complex));
+    if (!planned) {
+      break;
+    }
+    self->forward = fft_plan_cache_acquire(
+        self->fft_size, self->number_of_channels, self->real_distance,
+        self->complex_distance, R2C_PLAN, self->planner_rigor);
+    self->backward = fft_plan_cache_acquire(
+        self->fft_size, self->number_of_channels, self->real_distance,
+        self->complex_distance, C2R_PLAN, self->planner_rigor);
+    break;
+  case HALFCOMPLEX_TRANSFORM:
+  default:
+    if (!planned) {
+      break;
+    }
+    self->forward = fft_plan_cache_acquire(
+        self->fft_size, self->number_of_channels, self->real_distance,
+        self->complex_distance, R2HC_PLAN, self->planner_rigor);
+    self->backward = fft_plan_cache_acquire(
+        self->fft_size, self->number_of_channels, self->real_distance,
+        self->complex_distance, HC2R_PLAN, self->planner_rigor);
+    break;
+  }
+
+  // Padding has to start zeroed since only the frame region is loaded
+  memset(self->input_fft_buffer, 0, real_size * sizeof(float));
+  memset(self->output_fft_buffer, 0, real_size * sizeof(float));
 }
 
-static uint32_t calculate_fft_size(FftTransform *self) {
-  switch (self->padding_type) {
-  case NO_PADDING: {
-    self->padding_amount = 0;
-    return get_next_divisible_two((int)self->frame_size);
+// Buffers are carved from the bound arena like every other block, which keeps
+// them aligned to a cache line. Without one they come from FFTW so they get
+// its alignment
+static void *allocate_fft_buffer(const size_t size) {
+  void *buffer = carve_from_bound_memory_arena(size);
+
+  return buffer ? buffer : fftwf_malloc(size);
+}
+
+static void free_fft_buffer(void *buffer) {
+  if (!is_in_bound_memory_arena(buffer)) {
+    fftwf_free(buffer);
   }
-  case NEXT_POWER_OF_TWO: {
-    uint32_t next_power_of_two = get_next_power_two((int)self->frame_size);
-    self->padding_amount = next_power_of_two - self->frame_size;
-    return next_power_of_two;
+}
+
+static uint32_t get_aligned_distance(const uint32_t size,
+                                     const uint32_t alignment) {
+  return ((size + alignment - 1U) / alignment) * alignment;
+}
+
+uint32_t get_padded_fft_size(const uint32_t frame_size,
+                             const ZeroPaddingType padding_type,
+                             const uint32_t zeropadding_amount) {
+  switch (padding_type) {
+  case NO_PADDING:
+    return get_next_divisible_two((int)frame_size);
+  case NEXT_POWER_OF_TWO:
+    return get_next_power_two((int)frame_size);
+  case FIXED_AMOUNT:
+    return get_next_divisible_two((int)(frame_size + zeropadding_amount));
+  default:
+    return get_next_divisible_two((int)frame_size);
   }
-  case FIXED_AMOUNT: {
+}
+
+static uint32_t calculate_fft_size(FftTransform *self) {
+  const uint32_t fft_size = get_padded_fft_size(
+      self->frame_size, self->padding_type, self->zeropadding_amount);
+
+  switch (self->padding_type) {
+  case NEXT_POWER_OF_TWO:
+    self->padding_amount = fft_size - self->frame_size;
+    break;
+  case FIXED_AMOUNT:
     self->padding_amount = self->zeropadding_amount;
-    return get_next_divisible_two(
-        (int)(self->frame_size + self->padding_amount));
-  }
+    break;
   default:
-    return get_next_divisible_two((int)self->frame_size);
+    self->padding_amount = 0;
+    break;
   }
+
+  return fft_size;
 }
 
 void fft_transform_free(FftTransform *self) {
-  fftwf_free(self->input_fft_buffer);
-  fftwf_free(self->output_fft_buffer);
-  fftwf_destroy_plan(self->forward);
-  fftwf_destroy_plan(self->backward);
+  if (self->synthesis_fft_buffer != self->input_fft_buffer) {
+    free_fft_buffer(self->synthesis_fft_buffer);
+  }
+  free_fft_buffer(self->input_fft_buffer);
+  free_fft_buffer(self->output_fft_buffer);
+  free_fft_buffer(self->complex_spectrum);
+  fft_plan_cache_release(self->forward);
+  fft_plan_cache_release(self->backward);
 
-  free(self);
+  spectral_free(self);
 }
 
 uint32_t get_fft_size(FftTransform *self) { return self->fft_size; }
 uint32_t get_fft_real_spectrum_size(FftTransform *self) {
   return self->fft_size / 2U + 1U;
 }
+uint32_t get_fft_number_of_channels(FftTransform *self) {
+  return self->number_of_channels;
+}
 
 bool fft_load_input_samples(FftTransform *self, const float *input) {
-  if (!self || !input) {
+  return fft_load_channel_input_samples(self, 0U, input);
+}
+
+bool fft_get_output_samples(FftTransform *self, float *output) {
+  return fft_get_channel_output_samples(self, 0U, output);
+}
+
+bool fft_load_channel_input_samples(FftTransform *self, const uint32_t channel,
+                                    const float *input) {
+  if (!self || !input || channel >= self->number_of_channels) {
     return false;
   }
 
+  float *input_fft_buffer = get_fft_channel_input_buffer(self, channel);
+
   // Copy centered values only
-  for (uint32_t i = self->copy_position;
-       i < (self->frame_size + self->copy_position); i++) {
-    self->input_fft_buffer[i] = input[i - self->copy_position];
+  memcpy(&input_fft_buffer[self->copy_position], input,
+         sizeof(float) * self->frame_size);
+
+  return true;
+}
+
+bool fft_load_channel_windowed_input_samples(FftTransform *self,
+                                             const uint32_t channel,
+                                             const float *input,
+                                             const float *window) {
+  if (!self || !input || !window || channel >= self->number_of_channels) {
+    return false;
   }
 
+  float *input_fft_buffer = get_fft_channel_input_buffer(self, channel);
+
+  // Window centered values while copying them. Padding is never written
+  get_spectral_kernels()->apply_window_to(
+      input, &window[self->copy_position],
+      &input_fft_buffer[self->copy_position], self->frame_size);
+
   return true;
 }
 
-bool fft_get_output_samples(FftTransform *self, float *output) {
-  if (!self || !output) {
+bool fft_get_channel_output_samples(FftTransform *self, const uint32_t channel,
+                                    float *output) {
+  if (!self || !output || channel >= self->number_of_channels) {
     return false;
   }
 
   // Copy centered values only
-  for (uint32_t i = self->copy_position;
-       i < (self->frame_size + self->copy_position); i++) {
-    output[i - self->copy_position] = self->input_fft_buffer[i];
-  }
+  memcpy(output, get_fft_channel_frame(self, channel),
+         sizeof(float) * self->frame_size);
 
   return true;
 }
@@ -153,7 +301,14 @@ bool compute_forward_fft(FftTransform *self) {
     return false;
   }
 
-  fftwf_execute(self->forward);
+  if (self->transform_type == REAL_TO_COMPLEX_TRANSFORM) {
+    fftwf_execute_dft_r2c(self->forward, self->input_fft_buffer,
+                          self->complex_spectrum);
+    pack_halfcomplex_spectrum(self);
+  } else {
+    fftwf_execute_r2r(self->forward, self->input_fft_buffer,
+                      self->output_fft_buffer);
+  }
 
   return true;
 }
@@ -163,7 +318,36 @@ bool compute_backward_fft(FftTransform *self) {
     return false;
   }
 
-  fftwf_execute(self->backward);
+  if (self->transform_type == REAL_TO_COMPLEX_TRANSFORM) {
+    unpack_halfcomplex_spectrum(self);
+    fftwf_execute_dft_c2r(self->backward, self->complex_spectrum,
+                          self->synthesis_fft_buffer);
+  } else {
+    fftwf_execute_r2r(self->backward, self->output_fft_buffer,
+                      self->synthesis_fft_buffer);
+  }
+
+  return true;
+}
+
+bool compute_forward_fft_complex(FftTransform *self) {
+  if (!self || self->transform_type != REAL_TO_COMPLEX_TRANSFORM) {
+    return false;
+  }
+
+  fftwf_execute_dft_r2c(self->forward, self->input_fft_buffer,
+                        self->complex_spectrum);
+
+  return true;
+}
+
+bool compute_backward_fft_complex(FftTransform *self) {
+  if (!self || self->transform_type != REAL_TO_COMPLEX_TRANSFORM) {
+    return false;
+  }
+
+  fftwf_execute_dft_c2r(self->backward, self->complex_spectrum,
+                        self->synthesis_fft_buffer);
 
   return true;
 }
@@ -174,4 +358,72 @@ float *get_fft_input_buffer(FftTransform *self) {
 
 float *get_fft_output_buffer(FftTransform *self) {
   return self->output_fft_buffer;
-}
\ No newline at end of file
+}
+
+float *get_fft_complex_buffer(FftTransform *self) {
+  return (float *)self->complex_spectrum;
+}
+
+float *get_fft_channel_input_buffer(FftTransform *self,
+                                    const uint32_t channel) {
+  return &self->input_fft_buffer[(size_t)channel * self->real_distance];
+}
+
+const float *get_fft_channel_frame(FftTransform *self,
+                                   const uint32_t channel) {
+  return &self->synthesis_fft_buffer[(size_t)channel * self->real_distance +
+                                     self->copy_position];
+}
+
+uint32_t get_fft_frame_offset(FftTransform *self) {
+  return self->copy_position;
+}
+
+float *get_fft_channel_output_buffer(FftTransform *self,
+                                     const uint32_t channel) {
+  return &self->output_fft_buffer[(size_t)channel * self->real_distance];
+}
+
+float *get_fft_channel_complex_buffer(FftTransform *self,
+                                      const uint32_t channel) {
+  return (float *)&self->complex_spectrum[(size_t)channel *
+                                          self->complex_distance];
+}
+
+// Adapter from the r2c complex layout to the halfcomplex layout (r0, r1, ...,
+// r(n/2), i((n+1)/2-1), ..., i1) that every spectral processor expects
+static void pack_halfcomplex_spectrum(FftTransform *self) {
+  const uint32_t real_spectrum_size = self->fft_size / 2U + 1U;
+
+  for (uint32_t channel = 0U; channel < self->number_of_channels; channel++) {
+    const fftwf_complex *complex_spectrum =
+        &self->complex_spectrum[(size_t)channel * self->complex_distance];
+    float *output_fft_buffer = get_fft_channel_output_buffer(self, channel);
+
+    for (uint32_t k = 0U; k < real_spectrum_size; k++) {
+      output_fft_buffer[k] = complex_spectrum[k][0];
+    }
+    for (uint32_t k = 1U; k < (self->fft_size + 1U) / 2U; k++) {
+      output_fft_buffer[self->fft_size - k] = complex_spectrum[k][1];
+    }
+  }
+}
+
+static void unpack_halfcomplex_spectrum(FftTransform *self) {
+  const uint32_t real_spectrum_size = self->fft_size / 2U + 1U;
+
+  for (uint32_t channel = 0U; channel < self->number_of_channels; channel++) {
+    fftwf_complex *complex_spectrum =
+        &self->complex_spectrum[(size_t)channel * self->complex_distance];
+    const float *output_fft_buffer =
+        get_fft_channel_output_buffer(self, channel);
+
+    for (uint32_t k = 0U; k < real_spectrum_size; k++) {
+      complex_spectrum[k][0] = output_fft_buffer[k];
+      complex_spectrum[k][1] = 0.F;
+    }
+    for (uint32_t k = 1U; k < (self->fft_size + 1U) / 2U; k++) {
+      complex_spectrum[k][1] = output_fft_buffer[self->fft_size - k];
+    }
+  }
+}
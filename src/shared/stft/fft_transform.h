@@ -30,20 +30,74 @@ typedef enum ZeroPaddingType {
   NO_PADDING = 2,
 } ZeroPaddingType;
 
+// Halfcomplex transforms use FFTW r2r plans directly. Real to complex
+// transforms use FFTW r2c/c2r plans and convert from and to the halfcomplex
+// layout so spectral processors keep working unchanged, while the interleaved
+// complex spectrum is also available. Both give the same spectra, the
+// benchmark reports which one is faster on each machine
+typedef enum FftTransformType {
+  HALFCOMPLEX_TRANSFORM = 0,
+  REAL_TO_COMPLEX_TRANSFORM = 1,
+} FftTransformType;
+
+// Effort spent by FFTW when planning. Values match SpectralBleachPlannerRigor
+typedef enum FftPlannerRigor {
+  ESTIMATE_PLANNER = 0,
+  MEASURE_PLANNER = 1,
+  PATIENT_PLANNER = 2,
+  EXHAUSTIVE_PLANNER = 3,
+} FftPlannerRigor;
+
 typedef struct FftTransform FftTransform;
 
 FftTransform *fft_transform_initialize(uint32_t frame_size,
                                        ZeroPaddingType padding_type,
-                                       uint32_t zeropadding_amount);
-FftTransform *fft_transform_initialize_bins(uint32_t fft_size);
+                                       uint32_t zeropadding_amount,
+                                       FftTransformType transform_type,
+                                       FftPlannerRigor planner_rigor,
+                                       uint32_t number_of_channels);
+FftTransform *fft_transform_initialize_bins(uint32_t fft_size,
+                                            FftTransformType transform_type,
+                                            FftPlannerRigor planner_rigor);
 void fft_transform_free(FftTransform *self);
+// Transform size used for frames of frame_size samples with the given padding
+uint32_t get_padded_fft_size(uint32_t frame_size, ZeroPaddingType padding_type,
+                             uint32_t zeropadding_amount);
 bool fft_load_input_samples(FftTransform *self, const float *input);
 bool fft_get_output_samples(FftTransform *self, float *output);
 uint32_t get_fft_size(FftTransform *self);
 uint32_t get_fft_real_spectrum_size(FftTransform *self);
+uint32_t get_fft_number_of_channels(FftTransform *self);
 bool compute_forward_fft(FftTransform *self);
 bool compute_backward_fft(FftTransform *self);
 float *get_fft_input_buffer(FftTransform *self);
 float *get_fft_output_buffer(FftTransform *self);
 
+// Only for REAL_TO_COMPLEX_TRANSFORM. These skip the halfcomplex conversion and
+// work directly over the interleaved complex spectrum (real, imaginary pairs of
+// fft_size / 2 + 1 bins)
+bool compute_forward_fft_complex(FftTransform *self);
+bool compute_backward_fft_complex(FftTransform *self);
+float *get_fft_complex_buffer(FftTransform *self);
+
+// Transforms with more than one channel run every channel with a single
+// batched plan. The functions above work over the first channel
+bool fft_load_channel_input_samples(FftTransform *self, uint32_t channel,
+                                    const float *input);
+bool fft_get_channel_output_samples(FftTransform *self, uint32_t channel,
+                                    float *output);
+// Loads the input multiplied by the frame region of a window as long as the
+// transform
+bool fft_load_channel_windowed_input_samples(FftTransform *self,
+                                             uint32_t channel,
+                                             const float *input,
+                                             const float *window);
+// Centered frame of the backward transform output, so reconstructed samples
+// can be read without copying
+const float *get_fft_channel_frame(FftTransform *self, uint32_t channel);
+uint32_t get_fft_frame_offset(FftTransform *self);
+float *get_fft_channel_input_buffer(FftTransform *self, uint32_t channel);
+float *get_fft_channel_output_buffer(FftTransform *self, uint32_t channel);
+float *get_fft_channel_complex_buffer(FftTransform *self, uint32_t channel);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,509 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "multiresolution_stft.h"
+#include "../configurations.h"
+#include "../utils/memory_arena.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static float get_whole_hops_frame_size(uint32_t frame_size,
+                                       uint32_t overlap_factor,
+                                       uint32_t sample_rate);
+static bool initialize_crossover(MultiresolutionStft *self);
+static void split_bands(MultiresolutionStft *self, const float *input,
+                        uint32_t number_of_samples);
+static void merge_bands(MultiresolutionStft *self, float *output,
+                        uint32_t number_of_samples);
+
+struct MultiresolutionStft {
+  uint32_t sample_rate;
+  uint32_t decimation_factor;
+  float crossover_frequency;
+  uint32_t reference_spectrum_size;
+  uint32_t latency;
+
+  StftProcessor *low_band;
+  StftProcessor *high_band;
+
+  // Symmetric lowpass used both to decimate and to interpolate the low band.
+  // Interpolation runs one polyphase branch per output sample with the taps
+  // in reverse order and scaled by the decimation factor
+  uint32_t number_of_taps;
+  float *crossover_taps;
+  uint32_t polyphase_length;
+  float *polyphase_taps;
+  uint32_t phase;
+
+  // Histories are mirrored rings so the last samples are always contiguous
+  float *input_history;
+  uint32_t input_position;
+  float *low_band_history;
+  uint32_t low_band_position;
+  float *processed_history;
+  uint32_t processed_position;
+
+  // Delays the band with the shorter latency to match the other one
+  MultiresolutionBand delayed_band;
+  uint32_t alignment_size;
+  uint32_t alignment_position;
+  float *alignment_delay;
+
+  uint32_t number_of_low_band_samples;
+  float *low_band_input;
+  float *low_band_output;
+  float *high_band_input;
+  float *high_band_output;
+
+  spectral_processing spectral_processing;
+  SpectralProcessorHandle low_band_processor;
+  SpectralProcessorHandle high_band_processor;
+};
+
+MultiresolutionStft *multiresolution_stft_initialize(
+    const uint32_t sample_rate, const float stft_frame_size,
+    const float crossover_frequency, const uint32_t overlap_factor,
+    const ZeroPaddingType padding_type, const uint32_t zeropadding_amount,
+    const WindowTypes input_window, const WindowTypes output_window,
+    const bool low_latency, const FftTransformType transform_type,
+    const FftPlannerRigor planner_rigor, const bool process_high_band) {
+  if (crossover_frequency <= 0.F ||
+      crossover_frequency > (float)sample_rate / 4.F) {
+    return NULL;
+  }
+
+  MultiresolutionStft *self =
+      (MultiresolutionStft *)spectral_calloc(1U, sizeof(MultiresolutionStft));
+  if (!self) {
+    return NULL;
+  }
+
+  self->sample_rate = sample_rate;
+  self->crossover_frequency = crossover_frequency;
+
+  // The filter rejects from twice the crossover frequency up, which has to
+  // stay below the Nyquist frequency of the decimated band
+  self->decimation_factor =
+      (uint32_t)((float)sample_rate / (4.F * crossover_frequency));
+  if (self->decimation_factor < 1U) {
+    self->decimation_factor = 1U;
+  }
+
+  const uint32_t frame_size =
+      (uint32_t)((stft_frame_size / 1000.F) * (float)sample_rate);
+  self->reference_spectrum_size =
+      get_padded_fft_size(frame_size, padding_type, zeropadding_amount) / 2U +
+      1U;
+
+  // Frames of each band are kept a whole number of hops long so their windows
+  // still overlap add to a constant
+  const uint32_t low_band_sample_rate = sample_rate / self->decimation_factor;
+  self->low_band = stft_processor_initialize(
+      low_band_sample_rate,
+      get_whole_hops_frame_size(frame_size / self->decimation_factor,
+                                overlap_factor, low_band_sample_rate),
+      overlap_factor, padding_type, zeropadding_amount, input_window,
+      output_window, low_latency, transform_type, planner_rigor, 1U);
+  if (process_high_band) {
+    self->high_band = stft_processor_initialize(
+        sample_rate,
+        get_whole_hops_frame_size(frame_size / MULTIRESOLUTION_FRAME_RATIO,
+                                  overlap_factor, sample_rate),
+        overlap_factor, padding_type, zeropadding_amount, input_window,
+        output_window, low_latency, transform_type, planner_rigor, 1U);
+  }
+
+  if (!self->low_band || (process_high_band && !self->high_band) ||
+      !initialize_crossover(self)) {
+    multiresolution_stft_free(self);
+    return NULL;
+  }
+
+  // Processed samples come out a hop after the latency of each STFT. A high
+  // band passed through comes out right away
+  const uint32_t low_band_delay =
+      self->decimation_factor *
+      (get_stft_latency(self->low_band) + get_stft_hop(self->low_band));
+  const uint32_t high_band_delay =
+      self->high_band
+          ? get_stft_latency(self->high_band) + get_stft_hop(self->high_band)
+          : 0U;
+
+  self->delayed_band =
+      low_band_delay < high_band_delay ? LOW_BAND : HIGH_BAND;
+  self->alignment_size = low_band_delay < high_band_delay
+                             ? high_band_delay - low_band_delay
+                             : low_band_delay - high_band_delay;
+  self->latency = (self->number_of_taps - 1U) +
+                  (low_band_delay > high_band_delay ? low_band_delay
+                                                    : high_band_delay);
+
+  self->alignment_delay = (float *)spectral_calloc(
+      self->alignment_size > 0U ? self->alignment_size : 1U, sizeof(float));
+
+  self->number_of_low_band_samples =
+      MULTIRESOLUTION_BLOCK_SIZE / self->decimation_factor + 1U;
+  self->low_band_input = (float *)spectral_calloc(
+      self->number_of_low_band_samples, sizeof(float));
+  self->low_band_output = (float *)spectral_calloc(
+      self->number_of_low_band_samples, sizeof(float));
+  self->high_band_input =
+      (float *)spectral_calloc(MULTIRESOLUTION_BLOCK_SIZE, sizeof(float));
+  self->high_band_output =
+      (float *)spectral_calloc(MULTIRESOLUTION_BLOCK_SIZE, sizeof(float));
+
+  return self;
+}
+
+// Frame size in milliseconds holding the largest whole number of hops that
+// fits in the given samples
+static float get_whole_hops_frame_size(const uint32_t frame_size,
+                                       const uint32_t overlap_factor,
+                                       const uint32_t sample_rate) {
+  const uint32_t whole_hops_size =
+      (frame_size / overlap_factor) * overlap_factor;
+
+  // Half a sample more so converting back to samples truncates to the size
+  return ((float)whole_hops_size + 0.5F) * 1000.F / (float)sample_rate;
+}
+
+// Blackman windowed sinc with its cutoff halfway through the transition band
+static bool initialize_crossover(MultiresolutionStft *self) {
+  const float transition_width = self->crossover_frequency;
+  const float cutoff = 1.5F * self->crossover_frequency;
+
+  self->number_of_taps =
+      2U * (uint32_t)(CROSSOVER_FILTER_TAPS_FACTOR * (float)self->sample_rate /
+                      (2.F * transition_width)) +
+      1U;
+  self->polyphase_length =
+      (self->number_of_taps + self->decimation_factor - 1U) /
+      self->decimation_factor;
+
+  self->crossover_taps =
+      (float *)spectral_calloc(self->number_of_taps, sizeof(float));
+  self->polyphase_taps = (float *)spectral_calloc(
+      (size_t)self->decimation_factor * self->polyphase_length, sizeof(float));
+  self->input_history =
+      (float *)spectral_calloc(2U * self->number_of_taps, sizeof(float));
+  self->low_band_history =
+      (float *)spectral_calloc(2U * self->polyphase_length, sizeof(float));
+  self->processed_history =
+      (float *)spectral_calloc(2U * self->polyphase_length, sizeof(float));
+
+  if (!self->crossover_taps || !self->polyphase_taps ||
+      !self->input_history || !self->low_band_history ||
+      !self->processed_history) {
+    return false;
+  }
+
+  const float normalized_cutoff = 2.F * cutoff / (float)self->sample_rate;
+  const int32_t center = (int32_t)(self->number_of_taps - 1U) / 2;
+  double sum = 0.;
+  for (uint32_t k = 0U; k < self->number_of_taps; k++) {
+    const float distance = (float)((int32_t)k - center);
+    const float sinc =
+        k == (uint32_t)center
+            ? normalized_cutoff
+            : sinf(M_PI * normalized_cutoff * distance) / (M_PI * distance);
+    const float p = (float)k / (float)(self->number_of_taps - 1U);
+    const float window = 0.42F - (0.5F * cosf(2.F * M_PI * p)) +
+                         (0.08F * cosf(4.F * M_PI * p));
+
+    self->crossover_taps[k] = sinc * window;
+    sum += (double)self->crossover_taps[k];
+  }
+  for (uint32_t k = 0U; k < self->number_of_taps; k++) {
+    self->crossover_taps[k] /= (float)sum;
+  }
+
+  for (uint32_t phase = 0U; phase < self->decimation_factor; phase++) {
+    float *taps = &self->polyphase_taps[phase * self->polyphase_length];
+    for (uint32_t i = 0U; i < self->polyphase_length; i++) {
+      const uint32_t tap = phase + (self->polyphase_length - 1U - i) *
+                                       self->decimation_factor;
+      taps[i] = tap < self->number_of_taps
+                    ? self->crossover_taps[tap] *
+                          (float)self->decimation_factor
+                    : 0.F;
+    }
+  }
+
+  return true;
+}
+
+void multiresolution_stft_free(MultiresolutionStft *self) {
+  if (self->low_band) {
+    stft_processor_free(self->low_band);
+  }
+  if (self->high_band) {
+    stft_processor_free(self->high_band);
+  }
+
+  spectral_free(self->crossover_taps);
+  spectral_free(self->polyphase_taps);
+  spectral_free(self->input_history);
+  spectral_free(self->low_band_history);
+  spectral_free(self->processed_history);
+  spectral_free(self->alignment_delay);
+  spectral_free(self->low_band_input);
+  spectral_free(self->low_band_output);
+  spectral_free(self->high_band_input);
+  spectral_free(self->high_band_output);
+
+  spectral_free(self);
+}
+
+bool multiresolution_stft_reset(MultiresolutionStft *self) {
+  if (!self) {
+    return false;
+  }
+
+  memset(self->input_history, 0,
+         2U * self->number_of_taps * sizeof(float));
+  memset(self->low_band_history, 0,
+         2U * self->polyphase_length * sizeof(float));
+  memset(self->processed_history, 0,
+         2U * self->polyphase_length * sizeof(float));
+  memset(self->alignment_delay, 0,
+         (self->alignment_size > 0U ? self->alignment_size : 1U) *
+             sizeof(float));
+  self->input_position = 0U;
+  self->low_band_position = 0U;
+  self->processed_position = 0U;
+  self->alignment_position = 0U;
+  self->phase = 0U;
+
+  if (self->high_band && !stft_processor_reset(self->high_band)) {
+    return false;
+  }
+
+  return stft_processor_reset(self->low_band);
+}
+
+StftProcessor *get_multiresolution_band(MultiresolutionStft *self,
+                                        const MultiresolutionBand band) {
+  return band == LOW_BAND ? self->low_band : self->high_band;
+}
+
+uint32_t get_multiresolution_band_sample_rate(MultiresolutionStft *self,
+                                              const MultiresolutionBand band) {
+  return band == LOW_BAND ? self->sample_rate / self->decimation_factor
+                          : self->sample_rate;
+}
+
+float get_multiresolution_crossover(MultiresolutionStft *self) {
+  return self->crossover_frequency;
+}
+
+float get_multiresolution_band_gain(MultiresolutionStft *self,
+                                    const MultiresolutionBand band,
+                                    const float frequency) {
+  // Zero phase response of the symmetric crossover filter
+  const int32_t center = (int32_t)(self->number_of_taps - 1U) / 2;
+  double response = 0.;
+  for (uint32_t k = 0U; k < self->number_of_taps; k++) {
+    response += (double)self->crossover_taps[k] *
+                cos(2. * M_PI * (double)frequency *
+                    (double)((int32_t)k - center) / (double)self->sample_rate);
+  }
+
+  // The low band is filtered once before decimating. The high band removes
+  // the low band after it was also filtered by the interpolation
+  const double gain = band == LOW_BAND ? response : 1. - (response * response);
+
+  return (float)(gain * gain);
+}
+
+uint32_t get_multiresolution_latency(MultiresolutionStft *self) {
+  return self->latency;
+}
+
+uint32_t
+get_multiresolution_reference_spectrum_size(MultiresolutionStft *self) {
+  return self->reference_spectrum_size;
+}
+
+bool multiresolution_stft_set_profiler(MultiresolutionStft *self,
+                                       StageProfiler *profiler) {
+  if (!self) {
+    return false;
+  }
+
+  stft_processor_set_profiler(self->low_band, profiler);
+  if (self->high_band) {
+    stft_processor_set_profiler(self->high_band, profiler);
+  }
+
+  return true;
+}
+
+bool multiresolution_stft_set_bypass(MultiresolutionStft *self,
+                                     const bool bypass) {
+  if (!self) {
+    return false;
+  }
+
+  stft_processor_set_bypass(self->low_band, bypass);
+  if (self->high_band) {
+    stft_processor_set_bypass(self->high_band, bypass);
+  }
+
+  return true;
+}
+
+static void push_to_history(float *history, uint32_t *position,
+                            const uint32_t size, const float value) {
+  history[*position] = value;
+  history[*position + size] = value;
+  *position = (*position + 1U) % size;
+}
+
+static float dot_product(const float *taps, const float *samples,
+                         const uint32_t size) {
+  float sum = 0.F;
+  for (uint32_t i = 0U; i < size; i++) {
+    sum += taps[i] * samples[i];
+  }
+
+  return sum;
+}
+
+static float interpolate(MultiresolutionStft *self, const float *history,
+                         const uint32_t position) {
+  return dot_product(&self->polyphase_taps[self->phase *
+                                           self->polyphase_length],
+                     &history[position], self->polyphase_length);
+}
+
+bool multiresolution_stft_run(MultiresolutionStft *self,
+                              const uint32_t number_of_samples,
+                              const float *input, float *output,
+                              spectral_processing spectral_processing,
+                              SpectralProcessorHandle low_band_processor,
+                              SpectralProcessorHandle high_band_processor) {
+  if (!self || !input || !output || number_of_samples == 0U) {
+    return false;
+  }
+
+  self->spectral_processing = spectral_processing;
+  self->low_band_processor = low_band_processor;
+  self->high_band_processor = high_band_processor;
+
+  uint32_t processed_samples = 0U;
+  while (processed_samples < number_of_samples) {
+    const uint32_t block_size =
+        number_of_samples - processed_samples < MULTIRESOLUTION_BLOCK_SIZE
+            ? number_of_samples - processed_samples
+            : MULTIRESOLUTION_BLOCK_SIZE;
+
+    const uint32_t phase = self->phase;
+    split_bands(self, &input[processed_samples], block_size);
+    self->phase = phase;
+    merge_bands(self, &output[processed_samples], block_size);
+
+    processed_samples += block_size;
+  }
+
+  return true;
+}
+
+// Decimates the low band and leaves the input minus the interpolated low band
+// as the high band, then processes both
+static void split_bands(MultiresolutionStft *self, const float *input,
+                        const uint32_t number_of_samples) {
+  uint32_t low_band_samples = 0U;
+
+  for (uint32_t i = 0U; i < number_of_samples; i++) {
+    push_to_history(self->input_history, &self->input_position,
+                    self->number_of_taps, input[i]);
+    const float *input_window = &self->input_history[self->input_position];
+
+    if (self->phase == 0U) {
+      const float low_band_sample = dot_product(
+          self->crossover_taps, input_window, self->number_of_taps);
+      self->low_band_input[low_band_samples++] = low_band_sample;
+      push_to_history(self->low_band_history, &self->low_band_position,
+                      self->polyphase_length, low_band_sample);
+    }
+
+    // The oldest input sample is delayed as much as both filters
+    self->high_band_input[i] =
+        input_window[0] - interpolate(self, self->low_band_history,
+                                      self->low_band_position);
+
+    self->phase = (self->phase + 1U) % self->decimation_factor;
+  }
+
+  if (low_band_samples > 0U) {
+    stft_processor_run(self->low_band, low_band_samples, self->low_band_input,
+                       self->low_band_output, self->spectral_processing,
+                       self->low_band_processor);
+  }
+  if (self->high_band) {
+    stft_processor_run(self->high_band, number_of_samples,
+                       self->high_band_input, self->high_band_output,
+                       self->spectral_processing, self->high_band_processor);
+  } else {
+    memcpy(self->high_band_output, self->high_band_input,
+           number_of_samples * sizeof(float));
+  }
+}
+
+static float align(MultiresolutionStft *self, const float sample) {
+  if (self->alignment_size == 0U) {
+    return sample;
+  }
+
+  const float delayed_sample = self->alignment_delay[self->alignment_position];
+  self->alignment_delay[self->alignment_position] = sample;
+  self->alignment_position =
+      (self->alignment_position + 1U) % self->alignment_size;
+
+  return delayed_sample;
+}
+
+// Interpolates the processed low band and adds both bands aligned
+static void merge_bands(MultiresolutionStft *self, float *output,
+                        const uint32_t number_of_samples) {
+  uint32_t low_band_samples = 0U;
+
+  for (uint32_t i = 0U; i < number_of_samples; i++) {
+    if (self->phase == 0U) {
+      push_to_history(self->processed_history, &self->processed_position,
+                      self->polyphase_length,
+                      self->low_band_output[low_band_samples++]);
+    }
+
+    float low_band_sample = interpolate(self, self->processed_history,
+                                        self->processed_position);
+    float high_band_sample = self->high_band_output[i];
+    if (self->delayed_band == LOW_BAND) {
+      low_band_sample = align(self, low_band_sample);
+    } else {
+      high_band_sample = align(self, high_band_sample);
+    }
+
+    output[i] = low_band_sample + high_band_sample;
+
+    self->phase = (self->phase + 1U) % self->decimation_factor;
+  }
+}
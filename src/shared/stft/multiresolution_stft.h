@@ -0,0 +1,82 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MULTIRESOLUTION_STFT_H
+#define MULTIRESOLUTION_STFT_H
+
+#include "../../interfaces/spectral_processor.h"
+#include "../utils/spectral_utils.h"
+#include "../utils/stage_profiler.h"
+#include "fft_transform.h"
+#include "stft_processor.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Processes a mono signal with two time frequency resolutions. A linear phase
+// crossover splits it: the band below the crossover frequency is decimated and
+// processed with frames of stft_frame_size, keeping their frequency resolution
+// with much smaller transforms, and the band above it is processed at the full
+// sample rate with frames MULTIRESOLUTION_FRAME_RATIO times shorter. The high
+// band is the input minus the low band, so both add back to the input when
+// nothing is processed. The faster band is delayed to match the slower one.
+// Without processing the high band it has no STFT and is only delayed
+typedef struct MultiresolutionStft MultiresolutionStft;
+
+typedef enum MultiresolutionBand {
+  LOW_BAND = 0,
+  HIGH_BAND = 1,
+} MultiresolutionBand;
+
+MultiresolutionStft *multiresolution_stft_initialize(
+    uint32_t sample_rate, float stft_frame_size, float crossover_frequency,
+    uint32_t overlap_factor, ZeroPaddingType padding_type,
+    uint32_t zeropadding_amount, WindowTypes input_window,
+    WindowTypes output_window, bool low_latency,
+    FftTransformType transform_type, FftPlannerRigor planner_rigor,
+    bool process_high_band);
+void multiresolution_stft_free(MultiresolutionStft *self);
+// Clears the crossover histories and the STFT of both bands
+bool multiresolution_stft_reset(MultiresolutionStft *self);
+// NULL for a high band that isn't processed
+StftProcessor *get_multiresolution_band(MultiresolutionStft *self,
+                                        MultiresolutionBand band);
+uint32_t get_multiresolution_band_sample_rate(MultiresolutionStft *self,
+                                              MultiresolutionBand band);
+float get_multiresolution_crossover(MultiresolutionStft *self);
+// Power the crossover leaves in a band at a frequency of the input
+float get_multiresolution_band_gain(MultiresolutionStft *self,
+                                    MultiresolutionBand band, float frequency);
+// Samples between the input and the output
+uint32_t get_multiresolution_latency(MultiresolutionStft *self);
+// Bins a single resolution STFT with the frames of the low band would have at
+// the full sample rate
+uint32_t get_multiresolution_reference_spectrum_size(MultiresolutionStft *self);
+bool multiresolution_stft_set_profiler(MultiresolutionStft *self,
+                                       StageProfiler *profiler);
+// Bypasses the STFT of both bands. The crossover keeps running
+bool multiresolution_stft_set_bypass(MultiresolutionStft *self, bool bypass);
+bool multiresolution_stft_run(MultiresolutionStft *self,
+                              uint32_t number_of_samples, const float *input,
+                              float *output,
+                              spectral_processing spectral_processing,
+                              SpectralProcessorHandle low_band_processor,
+                              SpectralProcessorHandle high_band_processor);
+
+#endif
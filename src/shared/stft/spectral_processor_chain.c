@@ -0,0 +1,113 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spectral_processor_chain.h"
+#include "../utils/memory_arena.h"
+#include <stdlib.h>
+
+typedef struct ChainStage {
+  spectral_processing spectral_processing;
+  SpectralProcessorHandle spectral_processor;
+  bool enabled;
+} ChainStage;
+
+struct SpectralProcessorChain {
+  uint32_t capacity;
+  uint32_t number_of_stages;
+  ChainStage *stages;
+};
+
+SpectralProcessorChain *
+spectral_processor_chain_initialize(const uint32_t capacity) {
+  SpectralProcessorChain *self = (SpectralProcessorChain *)spectral_calloc(
+      1U, sizeof(SpectralProcessorChain));
+  if (!self) {
+    return NULL;
+  }
+
+  self->capacity = capacity > 0U ? capacity : 1U;
+  self->stages =
+      (ChainStage *)spectral_calloc(self->capacity, sizeof(ChainStage));
+  if (!self->stages) {
+    spectral_processor_chain_free(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+void spectral_processor_chain_free(SpectralProcessorChain *self) {
+  spectral_free(self->stages);
+  spectral_free(self);
+}
+
+bool spectral_processor_chain_append(
+    SpectralProcessorChain *self, spectral_processing spectral_processing,
+    SpectralProcessorHandle spectral_processor) {
+  if (!self || !spectral_processing ||
+      self->number_of_stages >= self->capacity) {
+    return false;
+  }
+
+  self->stages[self->number_of_stages++] = (ChainStage){
+      .spectral_processing = spectral_processing,
+      .spectral_processor = spectral_processor,
+      .enabled = true,
+  };
+
+  return true;
+}
+
+bool spectral_processor_chain_set_enabled(SpectralProcessorChain *self,
+                                          const uint32_t stage,
+                                          const bool enabled) {
+  if (!self || stage >= self->number_of_stages) {
+    return false;
+  }
+
+  self->stages[stage].enabled = enabled;
+
+  return true;
+}
+
+uint32_t get_spectral_processor_chain_size(SpectralProcessorChain *self) {
+  return self->number_of_stages;
+}
+
+bool spectral_processor_chain_run(SpectralProcessorHandle instance,
+                                  float *fft_spectrum) {
+  if (!instance || !fft_spectrum) {
+    return false;
+  }
+
+  SpectralProcessorChain *self = (SpectralProcessorChain *)instance;
+
+  bool processed = true;
+  for (uint32_t k = 0U; k < self->number_of_stages; k++) {
+    const ChainStage *stage = &self->stages[k];
+    if (stage->enabled) {
+      processed = stage->spectral_processing(stage->spectral_processor,
+                                             fft_spectrum) &&
+                  processed;
+    }
+  }
+
+  return processed;
+}
@@ -0,0 +1,47 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPECTRAL_PROCESSOR_CHAIN_H
+#define SPECTRAL_PROCESSOR_CHAIN_H
+
+#include "../../interfaces/spectral_processor.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Ordered list of spectral processors applied one after the other to the same
+// spectrum. Running it is a spectral processing itself, so a single STFT
+// analyzes and synthesizes every frame once for all of them
+typedef struct SpectralProcessorChain SpectralProcessorChain;
+
+SpectralProcessorChain *spectral_processor_chain_initialize(uint32_t capacity);
+void spectral_processor_chain_free(SpectralProcessorChain *self);
+// Adds a stage after the last one. Returns false once the capacity is reached
+bool spectral_processor_chain_append(
+    SpectralProcessorChain *self, spectral_processing spectral_processing,
+    SpectralProcessorHandle spectral_processor);
+// Disabled stages leave the spectrum untouched. Stages start enabled
+bool spectral_processor_chain_set_enabled(SpectralProcessorChain *self,
+                                          uint32_t stage, bool enabled);
+uint32_t get_spectral_processor_chain_size(SpectralProcessorChain *self);
+// Runs every enabled stage in order. It takes the chain as its processor
+bool spectral_processor_chain_run(SpectralProcessorHandle instance,
+                                  float *fft_spectrum);
+
+#endif
@@ -19,39 +19,70 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "stft_buffer.h"
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_kernels.h"
 #include <stdlib.h>
 #include <string.h>
 
+static void write_mirrored_block(StftBuffer *self, uint32_t ring_position,
+                                 const float *input_block,
+                                 uint32_t block_size);
+static void read_accumulator_block(StftBuffer *self, uint32_t ring_position,
+                                   float *output_block, uint32_t block_size);
+static uint32_t advance_output_head(StftBuffer *self);
+
+// Input samples are kept in a circular buffer mirrored into a second copy of
+// itself, so the current frame is always contiguous starting at frame_start.
+// The overlap-add accumulator is a plain circular buffer and the samples ready
+// to be output start output_offset samples after its head. Per hop work is
+// proportional to the hop and not to the frame size
 struct StftBuffer {
   uint32_t read_position;
   uint32_t start_position;
   uint32_t stft_frame_size;
   uint32_t block_step;
+  uint32_t frame_start;
+  uint32_t output_head;
+  uint32_t output_offset;
 
   float *in_fifo;
-  float *out_fifo;
+  float *output_accumulator;
 };
 
 StftBuffer *stft_buffer_initialize(const uint32_t stft_frame_size,
                                    const uint32_t start_position,
-                                   const uint32_t block_step) {
-  StftBuffer *self = (StftBuffer *)calloc(1U, sizeof(StftBuffer));
+                                   const uint32_t block_step,
+                                   const uint32_t output_offset) {
+  StftBuffer *self = (StftBuffer *)spectral_calloc(1U, sizeof(StftBuffer));
 
   self->stft_frame_size = stft_frame_size;
   self->start_position = start_position;
   self->block_step = block_step;
   self->read_position = self->start_position;
-  self->in_fifo = (float *)calloc(self->stft_frame_size, sizeof(float));
-  self->out_fifo = (float *)calloc(self->stft_frame_size, sizeof(float));
+  self->frame_start = 0U;
+  self->output_head = 0U;
+  self->output_offset = output_offset;
+  self->in_fifo = (float *)spectral_calloc(
+      (size_t)self->stft_frame_size * 2U, sizeof(float));
+  self->output_accumulator =
+      (float *)spectral_calloc(self->stft_frame_size, sizeof(float));
 
   return self;
 }
 
 void stft_buffer_free(StftBuffer *self) {
-  free(self->in_fifo);
-  free(self->out_fifo);
+  spectral_free(self->in_fifo);
+  spectral_free(self->output_accumulator);
+
+  spectral_free(self);
+}
 
-  free(self);
+void stft_buffer_reset(StftBuffer *self) {
+  self->read_position = self->start_position;
+  self->frame_start = 0U;
+  self->output_head = 0U;
+  memset(self->in_fifo, 0, (size_t)self->stft_frame_size * 2U * sizeof(float));
+  memset(self->output_accumulator, 0, self->stft_frame_size * sizeof(float));
 }
 
 bool is_buffer_full(StftBuffer *self) {
@@ -62,16 +93,30 @@ bool is_buffer_full(StftBuffer *self) {
   return false;
 }
 
-float stft_buffer_fill(StftBuffer *self, const float input_sample) {
-  float sample_value = 0.F;
-
-  self->in_fifo[self->read_position] = input_sample;
-  sample_value = self->out_fifo[self->read_position - self->start_position];
-  if (self->read_position < self->stft_frame_size) {
-    self->read_position++; // Advance
+uint32_t stft_buffer_fill(StftBuffer *self, const float *input_block,
+                          const uint32_t number_of_samples,
+                          float *output_block) {
+  if (!self || !input_block || !output_block) {
+    return 0U;
   }
 
-  return sample_value;
+  // Copy as many samples as fit before the next hop boundary
+  const uint32_t available = self->stft_frame_size - self->read_position;
+  const uint32_t block_size =
+      number_of_samples < available ? number_of_samples : available;
+
+  write_mirrored_block(
+      self, (self->frame_start + self->read_position) % self->stft_frame_size,
+      input_block, block_size);
+  read_accumulator_block(self,
+                         (self->output_head + self->output_offset +
+                          self->read_position - self->start_position) %
+                             self->stft_frame_size,
+                         output_block, block_size);
+
+  self->read_position += block_size; // Advance
+
+  return block_size;
 }
 
 bool stft_buffer_advance_block(StftBuffer *self,
@@ -80,15 +125,154 @@ bool stft_buffer_advance_block(StftBuffer *self,
     return false;
   }
 
-  self->read_position = self->start_position; // Reset read
+  const uint32_t wrap_position = advance_output_head(self);
+
+  // STFT Overlap Add
+  const SpectralKernels *kernels = get_spectral_kernels();
+  kernels->accumulate(&self->output_accumulator[self->output_head],
+                      reconstructed_signal, wrap_position);
+  kernels->accumulate(self->output_accumulator,
+                      &reconstructed_signal[wrap_position],
+                      self->stft_frame_size - wrap_position);
+
+  return true;
+}
 
-  memmove(self->in_fifo, &self->in_fifo[self->block_step],
-          sizeof(float) * self->start_position);
+bool stft_buffer_advance_block_windowed(StftBuffer *self,
+                                        const float *reconstructed_signal,
+                                        const float *synthesis_window) {
+  if (!reconstructed_signal || !synthesis_window) {
+    return false;
+  }
 
-  memcpy(self->out_fifo, reconstructed_signal,
-         sizeof(float) * self->block_step);
+  const uint32_t wrap_position = advance_output_head(self);
+
+  // STFT Overlap Add of the windowed frame
+  const SpectralKernels *kernels = get_spectral_kernels();
+  kernels->accumulate_windowed(&self->output_accumulator[self->output_head],
+                               reconstructed_signal, synthesis_window,
+                               wrap_position);
+  kernels->accumulate_windowed(
+      self->output_accumulator, &reconstructed_signal[wrap_position],
+      &synthesis_window[wrap_position], self->stft_frame_size - wrap_position);
 
   return true;
 }
 
-float *get_full_buffer_block(StftBuffer *self) { return self->in_fifo; }
\ No newline at end of file
+float *get_full_buffer_block(StftBuffer *self) {
+  return &self->in_fifo[self->frame_start];
+}
+
+uint32_t stft_buffer_read_delayed_input(StftBuffer *self,
+                                        const uint32_t number_of_samples,
+                                        float *output_block) {
+  if (!self || !output_block) {
+    return 0U;
+  }
+
+  const uint32_t available = self->stft_frame_size - self->read_position;
+  const uint32_t block_size =
+      number_of_samples < available ? number_of_samples : available;
+
+  // Reconstructed samples come out as many samples late as the part of the
+  // frame after the output offset. The mirror keeps the block contiguous
+  const uint32_t delay = self->stft_frame_size - self->output_offset;
+  const uint32_t ring_position =
+      (self->frame_start + self->read_position + self->stft_frame_size -
+       delay) %
+      self->stft_frame_size;
+  memcpy(output_block, &self->in_fifo[ring_position],
+         sizeof(float) * block_size);
+
+  return block_size;
+}
+
+uint32_t stft_buffer_fill_bypassed(StftBuffer *self, const float *input_block,
+                                   const uint32_t number_of_samples,
+                                   float *output_block) {
+  if (!self || !input_block || !output_block) {
+    return 0U;
+  }
+
+  const uint32_t block_size =
+      stft_buffer_read_delayed_input(self, number_of_samples, output_block);
+
+  write_mirrored_block(
+      self, (self->frame_start + self->read_position) % self->stft_frame_size,
+      input_block, block_size);
+
+  self->read_position += block_size; // Advance
+
+  return block_size;
+}
+
+bool stft_buffer_skip_block(StftBuffer *self) {
+  if (!self) {
+    return false;
+  }
+
+  advance_output_head(self);
+
+  return true;
+}
+
+// Moves to the next hop and returns how many samples of the incoming frame fit
+// before the accumulator wraps around
+static uint32_t advance_output_head(StftBuffer *self) {
+  self->read_position = self->start_position; // Reset read
+
+  self->frame_start = (self->frame_start + self->block_step) %
+                      self->stft_frame_size;
+
+  // Samples already output are cleared so they can be accumulated again as the
+  // tail of the incoming frame
+  const uint32_t first_segment =
+      self->stft_frame_size - self->output_head < self->block_step
+          ? self->stft_frame_size - self->output_head
+          : self->block_step;
+  memset(&self->output_accumulator[self->output_head], 0,
+         sizeof(float) * first_segment);
+  memset(self->output_accumulator, 0,
+         sizeof(float) * (self->block_step - first_segment));
+
+  self->output_head = (self->output_head + self->block_step) %
+                      self->stft_frame_size;
+
+  return self->stft_frame_size - self->output_head;
+}
+
+static void write_mirrored_block(StftBuffer *self,
+                                 const uint32_t ring_position,
+                                 const float *input_block,
+                                 const uint32_t block_size) {
+  const uint32_t first_segment =
+      self->stft_frame_size - ring_position < block_size
+          ? self->stft_frame_size - ring_position
+          : block_size;
+  const uint32_t second_segment = block_size - first_segment;
+
+  memcpy(&self->in_fifo[ring_position], input_block,
+         sizeof(float) * first_segment);
+  memcpy(&self->in_fifo[ring_position + self->stft_frame_size], input_block,
+         sizeof(float) * first_segment);
+
+  memcpy(self->in_fifo, &input_block[first_segment],
+         sizeof(float) * second_segment);
+  memcpy(&self->in_fifo[self->stft_frame_size], &input_block[first_segment],
+         sizeof(float) * second_segment);
+}
+
+static void read_accumulator_block(StftBuffer *self,
+                                   const uint32_t ring_position,
+                                   float *output_block,
+                                   const uint32_t block_size) {
+  const uint32_t first_segment =
+      self->stft_frame_size - ring_position < block_size
+          ? self->stft_frame_size - ring_position
+          : block_size;
+
+  memcpy(output_block, &self->output_accumulator[ring_position],
+         sizeof(float) * first_segment);
+  memcpy(&output_block[first_segment], self->output_accumulator,
+         sizeof(float) * (block_size - first_segment));
+}
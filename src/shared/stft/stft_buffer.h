@@ -25,14 +25,40 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <stdint.h>
 
 typedef struct StftBuffer StftBuffer;
+// Every hop outputs the samples of the last frame starting at output_offset,
+// which is zero unless the synthesis window only covers the end of the frame
 StftBuffer *stft_buffer_initialize(uint32_t stft_frame_size,
-                                   uint32_t start_position,
-                                   uint32_t block_step);
+                                   uint32_t start_position, uint32_t block_step,
+                                   uint32_t output_offset);
 void stft_buffer_free(StftBuffer *self);
+// Empties the buffer as it was right after initialization
+void stft_buffer_reset(StftBuffer *self);
 bool is_buffer_full(StftBuffer *self);
-float stft_buffer_fill(StftBuffer *self, float input_sample);
+// Copies input samples into the buffer up to the next hop boundary and writes
+// the same amount of reconstructed samples into the output. Returns the number
+// of samples consumed
+uint32_t stft_buffer_fill(StftBuffer *self, const float *input_block,
+                          uint32_t number_of_samples, float *output_block);
 bool stft_buffer_advance_block(StftBuffer *self,
                                const float *reconstructed_signal);
+// Same as above but windows the reconstructed frame while overlap-adding it
+bool stft_buffer_advance_block_windowed(StftBuffer *self,
+                                        const float *reconstructed_signal,
+                                        const float *synthesis_window);
 float *get_full_buffer_block(StftBuffer *self);
+// Writes the input samples delayed as much as the reconstructed ones into the
+// output, so a bypassed stream stays aligned with a processed one. It consumes
+// the same samples stft_buffer_fill would, which have to be read before they
+// are filled
+uint32_t stft_buffer_read_delayed_input(StftBuffer *self,
+                                        uint32_t number_of_samples,
+                                        float *output_block);
+// Same as stft_buffer_fill outputting the delayed input instead of the
+// reconstructed samples
+uint32_t stft_buffer_fill_bypassed(StftBuffer *self, const float *input_block,
+                                   uint32_t number_of_samples,
+                                   float *output_block);
+// Moves to the next hop without overlap-adding a reconstructed frame
+bool stft_buffer_skip_block(StftBuffer *self);
 
 #endif
\ No newline at end of file
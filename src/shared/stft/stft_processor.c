@@ -20,25 +20,99 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "stft_processor.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
 #include "../utils/spectral_features.h"
+#include "../utils/spectral_kernels.h"
+#include "../utils/stage_profiler.h"
 #include "stft_buffer.h"
 #include "stft_windows.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+static bool run_blocks(StftProcessor *self, uint32_t number_of_frames,
+                       const float *const *input, float **output,
+                       spectral_processing spectral_processing,
+                       SpectralProcessorHandle *spectral_processors);
+static bool run_spread(StftProcessor *self, uint32_t number_of_frames,
+                       const float *const *input, float **output,
+                       spectral_processing spectral_processing,
+                       SpectralProcessorHandle *spectral_processors);
+static void process_frame(StftProcessor *self,
+                          spectral_processing spectral_processing,
+                          SpectralProcessorHandle *spectral_processors);
+static void analyze_frame(StftProcessor *self);
+static void process_spectra(StftProcessor *self);
+static void synthesize_frame(StftProcessor *self);
+static void process_channel_spectrum(void *instance, uint32_t channel);
+
+// Steps of a frame that spread processing leaves for the next hop, in order.
+// Each one is due once that hop is filled past its share of the samples
+typedef enum FrameStep {
+  FRAME_SPECTRAL_PROCESSING = 0,
+  FRAME_SYNTHESIS = 1,
+  FRAME_COMPLETE = 2,
+} FrameStep;
+
+static void run_due_frame_steps(StftProcessor *self, uint32_t filled_samples);
+static void run_hop_callback(StftProcessor *self);
+
+// Progress of the crossfade between the processed signal and the delayed
+// input. Processing that just resumed outputs the delayed input during the
+// warmup, until every frame overlapping the output has been processed again
+typedef struct BypassFade {
+  float dry_mix;
+  uint32_t warmup_remaining;
+} BypassFade;
+
+static void crossfade_delayed_input(const StftProcessor *self, float *output,
+                                    const float *delayed_input,
+                                    uint32_t block_size, BypassFade *fade);
+
 struct StftProcessor {
   uint32_t input_latency;
   uint32_t hop;
   uint32_t overlap_factor;
   uint32_t fft_size;
   uint32_t frame_size;
-  float *output_accumulator;
-  float *tmp_buffer;
+  uint32_t number_of_channels;
+
+  // Planar scratch used to deinterleave blocks of frame_size samples
+  float *planar_buffer;
+  float **planar_input;
+  float **planar_output;
 
   FftTransform *fft_transform;
-  StftBuffer *stft_buffer;
+  StftBuffer **stft_buffers;
   StftWindows *stft_windows;
+
+  job_runner runner;
+  void *runner_data;
+  spectral_processing spectral_processing;
+  SpectralProcessorHandle *spectral_processors;
+
+  hop_callback hop_callback;
+  void *hop_callback_instance;
+
+  // Bypassed processors skip the transforms and output the input delayed by
+  // the same amount once the crossfade towards it ends
+  bool bypass;
+  bool processing;
+  BypassFade fade;
+  float dry_mix_step;
+  uint32_t warmup_size;
+  float *delayed_input;
+
+  // Spread processing collects a hop of every channel before it goes through
+  // the STFT and plays the output of the previous one meanwhile
+  bool spread_processing;
+  FrameStep pending_step;
+  uint32_t staged_samples;
+  float *staging_buffer;
+  float **staged_input;
+  float **staged_output;
+
+  StageProfiler *profiler;
 };
 
 StftProcessor *stft_processor_initialize(const uint32_t sample_rate,
@@ -47,97 +121,564 @@ StftProcessor *stft_processor_initialize(const uint32_t sample_rate,
                                          ZeroPaddingType padding_type,
                                          const uint32_t zeropadding_amount,
                                          WindowTypes input_window,
-                                         WindowTypes output_window) {
-  StftProcessor *self = (StftProcessor *)calloc(1U, sizeof(StftProcessor));
-
+                                         WindowTypes output_window,
+                                         const bool low_latency,
+                                         FftTransformType transform_type,
+                                         FftPlannerRigor planner_rigor,
+                                         const uint32_t number_of_channels) {
+  StftProcessor *self =
+      (StftProcessor *)spectral_calloc(1U, sizeof(StftProcessor));
+
+  self->number_of_channels = number_of_channels > 0U ? number_of_channels : 1U;
   self->frame_size =
       (uint32_t)((stft_frame_size / 1000.F) * (float)sample_rate);
-  self->fft_transform = fft_transform_initialize(self->frame_size, padding_type,
-                                                 zeropadding_amount);
+  self->fft_transform = fft_transform_initialize(
+      self->frame_size, padding_type, zeropadding_amount, transform_type,
+      planner_rigor, self->number_of_channels);
   self->fft_size = get_fft_size(self->fft_transform);
   self->overlap_factor = overlap_factor;
   self->hop = self->frame_size / self->overlap_factor;
-  self->input_latency = self->frame_size - self->hop;
 
-  self->output_accumulator =
-      (float *)calloc(self->frame_size * 2L, sizeof(float));
-  self->tmp_buffer = (float *)calloc(self->frame_size, sizeof(float));
+  // Samples of the frame the synthesis window spans, counted from its end
+  uint32_t synthesis_size = self->frame_size;
+  if (low_latency &&
+      LOW_LATENCY_SYNTHESIS_HOPS * self->hop < self->frame_size) {
+    synthesis_size = LOW_LATENCY_SYNTHESIS_HOPS * self->hop;
+  }
+  self->input_latency = synthesis_size - self->hop;
+
+  self->processing = true;
+  self->pending_step = FRAME_COMPLETE;
+  self->dry_mix_step =
+      1.F / fmaxf((BYPASS_CROSSFADE_TIME / 1000.F) * (float)sample_rate, 1.F);
+  self->warmup_size = synthesis_size;
+  self->delayed_input = (float *)spectral_calloc(self->hop, sizeof(float));
+
+  self->planar_buffer = (float *)spectral_calloc(
+      (size_t)self->frame_size * self->number_of_channels * 2U, sizeof(float));
+  self->planar_input =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  self->planar_output =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    self->planar_input[k] = &self->planar_buffer[(size_t)k * self->frame_size];
+    self->planar_output[k] =
+        &self->planar_buffer[(size_t)(self->number_of_channels + k) *
+                             self->frame_size];
+  }
 
-  self->stft_buffer =
-      stft_buffer_initialize(self->frame_size, self->input_latency, self->hop);
+  self->stft_buffers = (StftBuffer **)spectral_calloc(
+      self->number_of_channels, sizeof(StftBuffer *));
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    self->stft_buffers[k] =
+        stft_buffer_initialize(self->frame_size, self->frame_size - self->hop,
+                               self->hop, self->frame_size - synthesis_size);
+  }
 
-  self->stft_windows = stft_window_initialize(
-      self->fft_size, self->overlap_factor, input_window, output_window);
+  if (synthesis_size < self->frame_size) {
+    self->stft_windows = stft_window_initialize_asymmetric(
+        self->fft_size, get_fft_frame_offset(self->fft_transform),
+        self->frame_size, synthesis_size, self->overlap_factor);
+  } else if (padding_type == NO_PADDING) {
+    self->stft_windows =
+        stft_window_initialize(self->fft_size, 0U, self->fft_size,
+                               self->overlap_factor, input_window,
+                               output_window);
+  } else {
+    self->stft_windows = stft_window_initialize(
+        self->fft_size, get_fft_frame_offset(self->fft_transform),
+        self->frame_size, self->overlap_factor, input_window, output_window);
+  }
 
   return self;
 }
 
 void stft_processor_free(StftProcessor *self) {
-  stft_buffer_free(self->stft_buffer);
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    stft_buffer_free(self->stft_buffers[k]);
+  }
+  spectral_free(self->stft_buffers);
   stft_window_free(self->stft_windows);
   fft_transform_free(self->fft_transform);
 
-  free(self->output_accumulator);
-  free(self->tmp_buffer);
+  spectral_free(self->planar_buffer);
+  spectral_free(self->planar_input);
+  spectral_free(self->planar_output);
+  spectral_free(self->delayed_input);
+  spectral_free(self->staging_buffer);
+  spectral_free(self->staged_input);
+  spectral_free(self->staged_output);
+
+  spectral_free(self);
+}
+
+bool stft_processor_reset(StftProcessor *self) {
+  if (!self) {
+    return false;
+  }
+
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    stft_buffer_reset(self->stft_buffers[k]);
+  }
+  memset(self->delayed_input, 0, self->hop * sizeof(float));
+
+  self->pending_step = FRAME_COMPLETE;
+  self->staged_samples = 0U;
+  if (self->spread_processing) {
+    memset(self->staging_buffer, 0,
+           (size_t)self->hop * self->number_of_channels * 2U * sizeof(float));
+  }
+
+  self->bypass = false;
+  self->processing = true;
+  self->fade = (BypassFade){0};
 
-  free(self);
+  return true;
 }
 
 bool stft_processor_run(StftProcessor *self, const uint32_t number_of_samples,
                         const float *input, float *output,
                         spectral_processing spectral_processing,
                         SpectralProcessorHandle spectral_processor) {
-  if (!self || !input || !output || number_of_samples <= 0U) {
+  if (!self || self->number_of_channels != 1U) {
+    return false;
+  }
+
+  return stft_processor_run_multichannel(self, number_of_samples, &input,
+                                         &output, spectral_processing,
+                                         &spectral_processor);
+}
+
+bool stft_processor_run_multichannel(
+    StftProcessor *self, const uint32_t number_of_frames,
+    const float *const *input, float **output,
+    spectral_processing spectral_processing,
+    SpectralProcessorHandle *spectral_processors) {
+  if (!self || !input || !output || !spectral_processors ||
+      number_of_frames <= 0U) {
     return false;
   }
 
-  for (uint32_t k = 0U; k < number_of_samples; k++) {
-    // Start filling buffer sample per sample
-    output[k] = stft_buffer_fill(self->stft_buffer, input[k]);
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    if (!input[k] || !output[k]) {
+      return false;
+    }
+  }
+
+  if (self->spread_processing) {
+    return run_spread(self, number_of_frames, input, output,
+                      spectral_processing, spectral_processors);
+  }
+
+  return run_blocks(self, number_of_frames, input, output, spectral_processing,
+                    spectral_processors);
+}
+
+static bool run_blocks(StftProcessor *self, const uint32_t number_of_frames,
+                       const float *const *input, float **output,
+                       spectral_processing spectral_processing,
+                       SpectralProcessorHandle *spectral_processors) {
+  uint32_t processed_samples = 0U;
+
+  while (processed_samples < number_of_frames) {
+    const uint32_t remaining_samples = number_of_frames - processed_samples;
+    uint32_t block_size = 0U;
+
+    if (!self->processing) {
+      for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+        block_size = stft_buffer_fill_bypassed(
+            self->stft_buffers[k], &input[k][processed_samples],
+            remaining_samples, &output[k][processed_samples]);
+      }
+      processed_samples += block_size;
+
+      if (is_buffer_full(self->stft_buffers[0])) {
+        for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+          stft_buffer_skip_block(self->stft_buffers[k]);
+        }
+        run_hop_callback(self);
+      }
+      continue;
+    }
+
+    // Fill buffers with whole runs of samples up to the next hop boundary. All
+    // channels advance together so they reach the boundary at the same time
+    const bool crossfading = self->bypass || self->fade.dry_mix > 0.F;
+    BypassFade fade = self->fade;
+    for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+      if (crossfading) {
+        stft_buffer_read_delayed_input(self->stft_buffers[k],
+                                       remaining_samples, self->delayed_input);
+      }
+      block_size = stft_buffer_fill(
+          self->stft_buffers[k], &input[k][processed_samples],
+          remaining_samples, &output[k][processed_samples]);
+      if (crossfading) {
+        // Every channel crossfades from the same point
+        fade = self->fade;
+        crossfade_delayed_input(self, &output[k][processed_samples],
+                                self->delayed_input, block_size, &fade);
+      }
+    }
+    processed_samples += block_size;
+
+    self->fade = fade;
+    if (self->bypass && self->fade.dry_mix >= 1.F) {
+      self->processing = false;
+    }
+
+    if (is_buffer_full(self->stft_buffers[0])) {
+      run_hop_callback(self);
+      if (self->spread_processing) {
+        self->spectral_processing = spectral_processing;
+        self->spectral_processors = spectral_processors;
+        analyze_frame(self);
+        self->pending_step = FRAME_SPECTRAL_PROCESSING;
+      } else {
+        process_frame(self, spectral_processing, spectral_processors);
+      }
+    }
+  }
+
+  return true;
+}
+
+// Samples go through the STFT a hop at a time once the hop is collected. Its
+// reconstructed samples are ready right away and are output while the next hop
+// is collected, during which the rest of its frame is done step by step
+static bool run_spread(StftProcessor *self, const uint32_t number_of_frames,
+                       const float *const *input, float **output,
+                       spectral_processing spectral_processing,
+                       SpectralProcessorHandle *spectral_processors) {
+  uint32_t processed_samples = 0U;
+
+  while (processed_samples < number_of_frames) {
+    const uint32_t remaining_samples = number_of_frames - processed_samples;
+    const uint32_t missing_samples = self->hop - self->staged_samples;
+    const uint32_t block_size = remaining_samples < missing_samples
+                                    ? remaining_samples
+                                    : missing_samples;
+
+    for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+      memcpy(&self->staged_input[k][self->staged_samples],
+             &input[k][processed_samples], sizeof(float) * block_size);
+      memcpy(&output[k][processed_samples],
+             &self->staged_output[k][self->staged_samples],
+             sizeof(float) * block_size);
+    }
+    self->staged_samples += block_size;
+    processed_samples += block_size;
+
+    run_due_frame_steps(self, self->staged_samples);
+
+    if (self->staged_samples == self->hop) {
+      run_blocks(self, self->hop, (const float *const *)self->staged_input,
+                 self->staged_output, spectral_processing,
+                 spectral_processors);
+      self->staged_samples = 0U;
+    }
+  }
+
+  return true;
+}
+
+static void run_due_frame_steps(StftProcessor *self,
+                                const uint32_t filled_samples) {
+  // Analysis takes the first share of the hop and each step one more
+  const uint32_t shares = (uint32_t)FRAME_COMPLETE + 1U;
+  while (self->pending_step != FRAME_COMPLETE &&
+         filled_samples * shares >=
+             ((uint32_t)self->pending_step + 1U) * self->hop) {
+    switch (self->pending_step) {
+    case FRAME_SPECTRAL_PROCESSING:
+      process_spectra(self);
+      self->pending_step = FRAME_SYNTHESIS;
+      break;
+    case FRAME_SYNTHESIS:
+    default:
+      synthesize_frame(self);
+      self->pending_step = FRAME_COMPLETE;
+      break;
+    }
+  }
+}
 
-    if (is_buffer_full(self->stft_buffer)) {
-      fft_load_input_samples(self->fft_transform,
-                             get_full_buffer_block(self->stft_buffer));
+static void crossfade_delayed_input(const StftProcessor *self, float *output,
+                                    const float *delayed_input,
+                                    const uint32_t block_size,
+                                    BypassFade *fade) {
+  const float step = self->bypass ? self->dry_mix_step : -self->dry_mix_step;
+
+  for (uint32_t i = 0U; i < block_size; i++) {
+    if (fade->warmup_remaining > 0U) {
+      fade->warmup_remaining--;
+    } else {
+      fade->dry_mix = fminf(fmaxf(fade->dry_mix + step, 0.F), 1.F);
+    }
 
-      // STFT Analysis
-      stft_window_apply(self->stft_windows,
-                        get_fft_input_buffer(self->fft_transform),
-                        INPUT_WINDOW);
+    output[i] += fade->dry_mix * (delayed_input[i] - output[i]);
+  }
+}
 
-      compute_forward_fft(self->fft_transform);
+bool stft_processor_run_interleaved(
+    StftProcessor *self, const uint32_t number_of_frames, const float *input,
+    float *output, spectral_processing spectral_processing,
+    SpectralProcessorHandle *spectral_processors) {
+  if (!self || !input || !output || !spectral_processors ||
+      number_of_frames <= 0U) {
+    return false;
+  }
 
-      // Apply processing
-      spectral_processing(spectral_processor,
-                          get_fft_output_buffer(self->fft_transform));
+  const uint32_t channels = self->number_of_channels;
+  uint32_t processed_frames = 0U;
 
-      // STFT Synthesis
-      compute_backward_fft(self->fft_transform);
+  while (processed_frames < number_of_frames) {
+    const uint32_t block_size =
+        number_of_frames - processed_frames < self->frame_size
+            ? number_of_frames - processed_frames
+            : self->frame_size;
+    const float *input_block = &input[(size_t)processed_frames * channels];
+    float *output_block = &output[(size_t)processed_frames * channels];
 
-      stft_window_apply(self->stft_windows,
-                        get_fft_input_buffer(self->fft_transform),
-                        OUTPUT_WINDOW);
+    for (uint32_t i = 0U; i < block_size; i++) {
+      for (uint32_t k = 0U; k < channels; k++) {
+        self->planar_input[k][i] = input_block[(size_t)i * channels + k];
+      }
+    }
 
-      fft_get_output_samples(self->fft_transform, self->tmp_buffer);
+    stft_processor_run_multichannel(
+        self, block_size, (const float *const *)self->planar_input,
+        self->planar_output, spectral_processing, spectral_processors);
 
-      // STFT Overlap Add
-      for (uint32_t k = 0U; k < self->frame_size; k++) {
-        self->output_accumulator[k] += self->tmp_buffer[k];
+    for (uint32_t i = 0U; i < block_size; i++) {
+      for (uint32_t k = 0U; k < channels; k++) {
+        output_block[(size_t)i * channels + k] = self->planar_output[k][i];
       }
+    }
+
+    processed_frames += block_size;
+  }
+
+  return true;
+}
+
+bool stft_processor_analyze(StftProcessor *self,
+                            const uint32_t number_of_samples,
+                            const float *input,
+                            spectral_processing spectral_processing,
+                            SpectralProcessorHandle spectral_processor) {
+  if (!self || !input || !spectral_processing ||
+      self->number_of_channels != 1U) {
+    return false;
+  }
+
+  const float *input_window = get_stft_input_window(self->stft_windows);
+  float *fft_spectrum = get_fft_channel_output_buffer(self->fft_transform, 0U);
+
+  for (uint32_t position = 0U;
+       number_of_samples >= self->frame_size &&
+       position <= number_of_samples - self->frame_size;
+       position += self->hop) {
+    fft_load_channel_windowed_input_samples(self->fft_transform, 0U,
+                                            &input[position], input_window);
+    compute_forward_fft(self->fft_transform);
+
+    spectral_processing(spectral_processor, fft_spectrum);
+  }
+
+  return true;
+}
+
+bool stft_processor_synthesize(StftProcessor *self,
+                               const uint32_t number_of_spectra,
+                               const float *spectra, float *output) {
+  if (!self || !spectra || !output || self->number_of_channels != 1U) {
+    return false;
+  }
+
+  float *fft_spectrum = get_fft_channel_output_buffer(self->fft_transform, 0U);
+  const float *frame = get_fft_channel_frame(self->fft_transform, 0U);
+  const float *synthesis_window =
+      &get_stft_output_window(self->stft_windows)[get_fft_frame_offset(
+          self->fft_transform)];
+  const SpectralKernels *kernels = get_spectral_kernels();
+
+  for (uint32_t k = 0U; k < number_of_spectra; k++) {
+    memcpy(fft_spectrum, &spectra[(size_t)k * self->fft_size],
+           self->fft_size * sizeof(float));
+    compute_backward_fft(self->fft_transform);
+
+    kernels->accumulate_windowed(&output[(size_t)k * self->hop], frame,
+                                 synthesis_window, self->frame_size);
+  }
+
+  return true;
+}
 
-      stft_buffer_advance_block(self->stft_buffer, self->output_accumulator);
+static void process_frame(StftProcessor *self,
+                          spectral_processing spectral_processing,
+                          SpectralProcessorHandle *spectral_processors) {
+  self->spectral_processing = spectral_processing;
+  self->spectral_processors = spectral_processors;
 
-      memmove(self->output_accumulator, &self->output_accumulator[self->hop],
-              self->frame_size * sizeof(float));
+  analyze_frame(self);
+  process_spectra(self);
+  synthesize_frame(self);
+}
+
+static void analyze_frame(StftProcessor *self) {
+  PROFILE_STAGE_BEGIN(analysis);
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    // STFT Analysis windowing straight into the transform buffer
+    fft_load_channel_windowed_input_samples(
+        self->fft_transform, k, get_full_buffer_block(self->stft_buffers[k]),
+        get_stft_input_window(self->stft_windows));
+  }
+  PROFILE_STAGE_END(self->profiler, STFT_ANALYSIS_STAGE, analysis);
+
+  PROFILE_STAGE_BEGIN(forward_fft);
+  compute_forward_fft(self->fft_transform);
+  PROFILE_STAGE_END(self->profiler, FORWARD_FFT_STAGE, forward_fft);
+}
+
+// Channels are independent so they can run in parallel
+static void process_spectra(StftProcessor *self) {
+  PROFILE_STAGE_BEGIN(processing);
+  if (self->runner && self->number_of_channels > 1U) {
+    self->runner(self->runner_data, self->number_of_channels,
+                 &process_channel_spectrum, self);
+  } else {
+    for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+      process_channel_spectrum(self, k);
     }
   }
+  PROFILE_STAGE_END(self->profiler, SPECTRAL_PROCESSING_STAGE, processing);
+}
+
+static void synthesize_frame(StftProcessor *self) {
+  PROFILE_STAGE_BEGIN(backward_fft);
+  compute_backward_fft(self->fft_transform);
+  PROFILE_STAGE_END(self->profiler, BACKWARD_FFT_STAGE, backward_fft);
+
+  PROFILE_STAGE_BEGIN(synthesis);
+  const uint32_t frame_offset = get_fft_frame_offset(self->fft_transform);
+  const float *synthesis_window =
+      &get_stft_output_window(self->stft_windows)[frame_offset];
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    // STFT Overlap Add of the windowed frame and advance to next hop
+    stft_buffer_advance_block_windowed(
+        self->stft_buffers[k], get_fft_channel_frame(self->fft_transform, k),
+        synthesis_window);
+  }
+  PROFILE_STAGE_END(self->profiler, STFT_SYNTHESIS_STAGE, synthesis);
+}
+
+static void process_channel_spectrum(void *instance, const uint32_t channel) {
+  StftProcessor *self = (StftProcessor *)instance;
+
+  self->spectral_processing(
+      self->spectral_processors[channel],
+      get_fft_channel_output_buffer(self->fft_transform, channel));
+}
+
+bool stft_processor_set_profiler(StftProcessor *self,
+                                 StageProfiler *profiler) {
+  if (!self) {
+    return false;
+  }
+
+  self->profiler = profiler;
+
+  return true;
+}
+
+bool stft_processor_set_job_runner(StftProcessor *self, job_runner runner,
+                                   void *runner_data) {
+  if (!self) {
+    return false;
+  }
+
+  self->runner = runner;
+  self->runner_data = runner_data;
+
+  return true;
+}
+
+bool stft_processor_set_hop_callback(StftProcessor *self,
+                                     hop_callback callback, void *instance) {
+  if (!self) {
+    return false;
+  }
+
+  self->hop_callback = callback;
+  self->hop_callback_instance = instance;
+
+  return true;
+}
+
+static void run_hop_callback(StftProcessor *self) {
+  if (self->hop_callback) {
+    self->hop_callback(self->hop_callback_instance);
+  }
+}
+
+bool stft_processor_set_bypass(StftProcessor *self, const bool bypass) {
+  if (!self) {
+    return false;
+  }
+
+  // Resuming from a full bypass waits until the frames are processed again
+  if (!bypass && !self->processing) {
+    self->processing = true;
+    self->fade = (BypassFade){
+        .dry_mix = 1.F,
+        .warmup_remaining = self->warmup_size,
+    };
+  }
+  self->bypass = bypass;
+
+  return true;
+}
+
+bool stft_processor_enable_spread_processing(StftProcessor *self) {
+  if (!self || self->spread_processing) {
+    return false;
+  }
+
+  self->staging_buffer = (float *)spectral_calloc(
+      (size_t)self->hop * self->number_of_channels * 2U, sizeof(float));
+  self->staged_input =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  self->staged_output =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    self->staged_input[k] = &self->staging_buffer[(size_t)k * self->hop];
+    self->staged_output[k] =
+        &self->staging_buffer[(size_t)(self->number_of_channels + k) *
+                              self->hop];
+  }
+
+  // Output waits for a whole hop to be collected
+  self->input_latency += self->hop;
+  self->spread_processing = true;
 
   return true;
 }
 
 uint32_t get_stft_latency(StftProcessor *self) { return self->input_latency; }
 
+uint32_t get_stft_hop(StftProcessor *self) { return self->hop; }
+
+uint32_t get_stft_frame_size(StftProcessor *self) {
+  return self->frame_size;
+}
+
 uint32_t get_stft_fft_size(StftProcessor *self) { return self->fft_size; }
 
 uint32_t get_stft_real_spectrum_size(StftProcessor *self) {
   return get_fft_real_spectrum_size(self->fft_transform);
-}
\ No newline at end of file
+}
+
+uint32_t get_stft_number_of_channels(StftProcessor *self) {
+  return self->number_of_channels;
+}
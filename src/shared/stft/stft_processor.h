@@ -21,31 +21,98 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef STFT_PROCESSOR_H
 #define STFT_PROCESSOR_H
 
+#include "../../interfaces/job_runner.h"
 #include "../../interfaces/spectral_processor.h"
 #include "../utils/spectral_utils.h"
+#include "../utils/stage_profiler.h"
 #include "fft_transform.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 typedef struct StftProcessor StftProcessor;
 
+// Called by the processor every time a hop is filled, before its frame is
+// processed
+typedef void (*hop_callback)(void *instance);
+
+// Low latency replaces the given windows by an asymmetric pair whose synthesis
+// window only spans the last LOW_LATENCY_SYNTHESIS_HOPS hops of the frame, so
+// reconstructed samples are ready that much earlier
 StftProcessor *
 stft_processor_initialize(uint32_t sample_rate, float stft_frame_size,
                           uint32_t overlap_factor, ZeroPaddingType padding_type,
                           uint32_t zeropadding_amount, WindowTypes input_window,
-                          WindowTypes output_window);
+                          WindowTypes output_window, bool low_latency,
+                          FftTransformType transform_type,
+                          FftPlannerRigor planner_rigor,
+                          uint32_t number_of_channels);
 void stft_processor_free(StftProcessor *self);
+// Clears every sample buffered by the processor so the next input starts a new
+// stream, as right after initialization. Bypass is disabled too
+bool stft_processor_reset(StftProcessor *self);
 uint32_t get_stft_latency(StftProcessor *self);
+uint32_t get_stft_hop(StftProcessor *self);
+uint32_t get_stft_frame_size(StftProcessor *self);
 uint32_t get_stft_fft_size(StftProcessor *self);
 uint32_t get_stft_real_spectrum_size(StftProcessor *self);
+uint32_t get_stft_number_of_channels(StftProcessor *self);
+// Stages are only timed when built with profiling enabled
+bool stft_processor_set_profiler(StftProcessor *self, StageProfiler *profiler);
+// Sets a runner used to apply the spectral processing of every channel in
+// parallel. Without a runner channels are processed one after the other
+bool stft_processor_set_job_runner(StftProcessor *self, job_runner runner,
+                                   void *runner_data);
+// Sets a callback run at every hop boundary, even while bypassed, so changes
+// applied by it take effect from the frame of that hop on without waiting for
+// the end of the block being processed. It may change the bypass
+bool stft_processor_set_hop_callback(StftProcessor *self,
+                                     hop_callback callback, void *instance);
+// Crossfades the output to the input delayed by the same amount as the
+// reconstructed signal and stops transforming and processing frames until the
+// bypass is disabled, which crossfades back once frames are processed again
+bool stft_processor_set_bypass(StftProcessor *self, bool bypass);
+// Only analyzes each frame when its hop is filled and leaves the spectral
+// processing and the synthesis for later points of the next hop, so callbacks
+// shorter than a hop share the work of a frame instead of one of them doing it
+// all. Output comes a hop later. It has to be enabled before processing starts
+bool stft_processor_enable_spread_processing(StftProcessor *self);
 
 // Receives an input and output buffer with a a number_of_samples and does the
 // STFT transform applying any spectral_processing. It works similar to qsort,
 // because it receives a function pointer of any spectral processing that needs
-// to be applied in between the analysis and the synthesis
+// to be applied in between the analysis and the synthesis. Several processors
+// share the transforms of a frame by passing a SpectralProcessorChain
 bool stft_processor_run(StftProcessor *self, uint32_t number_of_samples,
                         const float *input, float *output,
                         spectral_processing spectral_processing,
                         SpectralProcessorHandle spectral_processor);
 
+// Same as stft_processor_run for every channel of the processor at once. Each
+// channel has its own spectral processor and the transforms of all channels are
+// computed together. Buffers are planar, one per channel
+bool stft_processor_run_multichannel(
+    StftProcessor *self, uint32_t number_of_frames, const float *const *input,
+    float **output, spectral_processing spectral_processing,
+    SpectralProcessorHandle *spectral_processors);
+
+// Same as stft_processor_run_multichannel with interleaved buffers
+bool stft_processor_run_interleaved(
+    StftProcessor *self, uint32_t number_of_frames, const float *input,
+    float *output, spectral_processing spectral_processing,
+    SpectralProcessorHandle *spectral_processors);
+// Runs the analysis of every whole frame of a mono signal, a hop apart from its
+// first sample, passing each spectrum to spectral_processing. Nothing is
+// synthesized and the buffered samples of the processor are left untouched
+bool stft_processor_analyze(StftProcessor *self, uint32_t number_of_samples,
+                            const float *input,
+                            spectral_processing spectral_processing,
+                            SpectralProcessorHandle spectral_processor);
+// Inverse transforms number_of_spectra spectra of fft_size floats laid out one
+// after the other and overlap-adds their windowed frames a hop apart into
+// output from its first sample, the counterpart of stft_processor_analyze.
+// Output has to hold (number_of_spectra - 1) * hop + frame_size samples and is
+// accumulated into, so the tail of earlier frames can be carried in it
+bool stft_processor_synthesize(StftProcessor *self, uint32_t number_of_spectra,
+                               const float *spectra, float *output);
+
 #endif
\ No newline at end of file
@@ -20,56 +20,182 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "stft_windows.h"
 #include "../configurations.h"
+#include "../utils/memory_arena.h"
+#include "../utils/spectral_kernels.h"
+#include "../utils/table_cache.h"
+#include <math.h>
 #include <stdlib.h>
 
-static float get_windows_scale_factor(StftWindows *self,
-                                      uint32_t overlap_factor);
-
+static void build_windows(float *windows, const uint32_t *key);
+static void build_asymmetric_windows(float *windows, const uint32_t *key);
+static float periodic_hann(uint32_t index, uint32_t size);
+static float get_windows_scale_factor(const float *input_window,
+                                      const float *output_window,
+                                      uint32_t stft_frame_size,
+                                      uint32_t overlap_factor,
+                                      uint32_t window_size);
+static void fold_windows_scale_factor(const float *input_window,
+                                      float *output_window,
+                                      uint32_t stft_frame_size,
+                                      uint32_t overlap_factor,
+                                      uint32_t window_size);
+
+// Both windows live in a single cached table, the output one right after the
+// input one, shared by every processor with the same layout
 struct StftWindows {
-  float *input_window;
-  float *output_window;
+  const float *windows;
+  const float *input_window;
+  const float *output_window;
 
   uint32_t stft_frame_size;
-  float scale_factor;
 };
 
+static StftWindows *initialize_from_table(const uint32_t stft_frame_size,
+                                          const float *windows) {
+  if (!windows) {
+    return NULL;
+  }
+
+  StftWindows *self = (StftWindows *)spectral_calloc(1U, sizeof(StftWindows));
+
+  self->stft_frame_size = stft_frame_size;
+  self->windows = windows;
+  self->input_window = windows;
+  self->output_window = &windows[stft_frame_size];
+
+  return self;
+}
+
 StftWindows *stft_window_initialize(const uint32_t stft_frame_size,
+                                    const uint32_t window_offset,
+                                    const uint32_t window_size,
                                     const uint32_t overlap_factor,
                                     const WindowTypes input_window,
                                     const WindowTypes output_window) {
-  StftWindows *self = (StftWindows *)calloc(1U, sizeof(StftWindows));
+  const uint32_t key[TABLE_KEY_SIZE] = {stft_frame_size, window_offset,
+                                        window_size, overlap_factor,
+                                        (uint32_t)input_window,
+                                        (uint32_t)output_window};
+
+  return initialize_from_table(
+      stft_frame_size, table_cache_acquire(STFT_WINDOWS_TABLE, key,
+                                           2U * stft_frame_size,
+                                           &build_windows));
+}
 
-  self->stft_frame_size = stft_frame_size;
+StftWindows *stft_window_initialize_asymmetric(const uint32_t stft_frame_size,
+                                               const uint32_t frame_offset,
+                                               const uint32_t frame_size,
+                                               const uint32_t synthesis_size,
+                                               const uint32_t overlap_factor) {
+  const uint32_t key[TABLE_KEY_SIZE] = {stft_frame_size, frame_offset,
+                                        frame_size, synthesis_size,
+                                        overlap_factor};
+
+  return initialize_from_table(
+      stft_frame_size,
+      table_cache_acquire(ASYMMETRIC_STFT_WINDOWS_TABLE, key,
+                          2U * stft_frame_size, &build_asymmetric_windows));
+}
 
-  self->input_window = (float *)calloc(self->stft_frame_size, sizeof(float));
-  self->output_window = (float *)calloc(self->stft_frame_size, sizeof(float));
+void stft_window_free(StftWindows *self) {
+  table_cache_release(self->windows);
 
-  get_fft_window(self->input_window, self->stft_frame_size, input_window);
-  get_fft_window(self->output_window, self->stft_frame_size, output_window);
+  spectral_free(self);
+}
 
-  self->scale_factor = get_windows_scale_factor(self, overlap_factor);
+// Key holds the frame size, window offset and size, overlap factor and the
+// input and output window types
+static void build_windows(float *windows, const uint32_t *key) {
+  const uint32_t stft_frame_size = key[0];
+  const uint32_t window_offset = key[1];
+  const uint32_t window_size = key[2];
+  float *input_window = windows;
+  float *output_window = &windows[stft_frame_size];
+
+  get_fft_window(&input_window[window_offset], window_size,
+                 (WindowTypes)key[4]);
+  get_fft_window(&output_window[window_offset], window_size,
+                 (WindowTypes)key[5]);
+
+  fold_windows_scale_factor(input_window, output_window, stft_frame_size,
+                            key[3], window_size);
+}
 
-  return self;
+// Mauler and Martin low delay windows. The analysis window is the rising half
+// of a square root Hann window spanning the frame minus half the synthesis
+// window followed by the falling half of the square root of the synthesis Hann
+// window. Key holds the frame size of the transform, the frame offset and size,
+// the synthesis size and the overlap factor
+static void build_asymmetric_windows(float *windows, const uint32_t *key) {
+  const uint32_t stft_frame_size = key[0];
+  const uint32_t frame_offset = key[1];
+  const uint32_t frame_size = key[2];
+  const uint32_t synthesis_size = key[3];
+
+  const uint32_t half_synthesis = synthesis_size / 2U;
+  const uint32_t rising_size = frame_size - half_synthesis;
+  const uint32_t synthesis_start = frame_size - synthesis_size;
+  float *input_window = &windows[frame_offset];
+  float *output_window = &windows[stft_frame_size + frame_offset];
+
+  for (uint32_t i = 0U; i < frame_size; i++) {
+    if (i < rising_size) {
+      input_window[i] = sqrtf(periodic_hann(i, 2U * rising_size));
+    } else {
+      input_window[i] =
+          sqrtf(periodic_hann(i - synthesis_start, synthesis_size));
+    }
+
+    if (i >= rising_size) {
+      output_window[i] = input_window[i];
+    } else if (i >= synthesis_start) {
+      output_window[i] =
+          periodic_hann(i - synthesis_start, synthesis_size) / input_window[i];
+    }
+  }
+
+  fold_windows_scale_factor(windows, &windows[stft_frame_size],
+                            stft_frame_size, key[4], frame_size);
 }
 
-void stft_window_free(StftWindows *self) {
-  free(self->input_window);
-  free(self->output_window);
+static float periodic_hann(const uint32_t index, const uint32_t size) {
+  return 0.5F - (0.5F * cosf(2.F * M_PI * (float)index / (float)size));
+}
 
-  free(self);
+// The synthesis scaling is folded into the output window once
+static void fold_windows_scale_factor(const float *input_window,
+                                      float *output_window,
+                                      const uint32_t stft_frame_size,
+                                      const uint32_t overlap_factor,
+                                      const uint32_t window_size) {
+  const float scale_factor =
+      get_windows_scale_factor(input_window, output_window, stft_frame_size,
+                               overlap_factor, window_size);
+
+  for (uint32_t i = 0U; i < stft_frame_size; i++) {
+    output_window[i] /= scale_factor;
+  }
 }
 
-static float get_windows_scale_factor(StftWindows *self,
-                                      const uint32_t overlap_factor) {
+// The backward transform scales by its size and overlapping frames add up to
+// the sum of the windows product over the hop. Windows shorter than the
+// transform have hops relative to their own size
+static float get_windows_scale_factor(const float *input_window,
+                                      const float *output_window,
+                                      const uint32_t stft_frame_size,
+                                      const uint32_t overlap_factor,
+                                      const uint32_t window_size) {
   if (overlap_factor < 2) {
     return 0.F;
   }
   float sum = 0.F;
-  for (uint32_t i = 0U; i < self->stft_frame_size; i++) {
-    sum += self->input_window[i] * self->output_window[i];
+  for (uint32_t i = 0U; i < stft_frame_size; i++) {
+    sum += input_window[i] * output_window[i];
   }
 
-  return sum * (float)overlap_factor;
+  return sum * (float)overlap_factor *
+         ((float)stft_frame_size / (float)window_size);
 }
 
 bool stft_window_apply(StftWindows *self, float *frame,
@@ -78,18 +204,25 @@ bool stft_window_apply(StftWindows *self, float *frame,
     return false;
   }
 
-  for (uint32_t i = 0U; i < self->stft_frame_size; i++) {
-    switch (place) {
-    case INPUT_WINDOW:
-      frame[i] *= self->input_window[i];
-      break;
-    case OUTPUT_WINDOW:
-      frame[i] *= self->output_window[i] / self->scale_factor;
-      break;
-    default:
-      break;
-    }
+  switch (place) {
+  case INPUT_WINDOW:
+    get_spectral_kernels()->apply_window(frame, self->input_window,
+                                         self->stft_frame_size);
+    break;
+  case OUTPUT_WINDOW:
+    get_spectral_kernels()->apply_window(frame, self->output_window,
+                                         self->stft_frame_size);
+    break;
+  default:
+    break;
   }
 
   return true;
-}
\ No newline at end of file
+}
+const float *get_stft_input_window(StftWindows *self) {
+  return self->input_window;
+}
+
+const float *get_stft_output_window(StftWindows *self) {
+  return self->output_window;
+}
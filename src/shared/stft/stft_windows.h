@@ -29,11 +29,29 @@ typedef struct StftWindows StftWindows;
 
 typedef enum WindowPlace { INPUT_WINDOW = 1, OUTPUT_WINDOW = 2 } WindowPlace;
 
+// Windows span window_size samples from window_offset and are zero over the
+// rest of the transform frame, so padded transforms only window the samples
 StftWindows *stft_window_initialize(uint32_t stft_frame_size,
+                                    uint32_t window_offset,
+                                    uint32_t window_size,
                                     uint32_t overlap_factor,
                                     WindowTypes input_window,
                                     WindowTypes output_window);
+// Low delay pair for frames of frame_size samples starting at frame_offset. The
+// analysis window rises over most of the frame and falls over its last half
+// synthesis_size, the synthesis window is zero except for the last
+// synthesis_size samples. Their product is a Hann window of synthesis_size at
+// the end of the frame, which reconstructs perfectly with hops of half its size
+StftWindows *stft_window_initialize_asymmetric(uint32_t stft_frame_size,
+                                               uint32_t frame_offset,
+                                               uint32_t frame_size,
+                                               uint32_t synthesis_size,
+                                               uint32_t overlap_factor);
 void stft_window_free(StftWindows *self);
 bool stft_window_apply(StftWindows *self, float *frame, WindowPlace place);
+// Windows spanning the whole frame. The output window already includes the
+// overlap-add scaling so it can be fused with the copies around the transform
+const float *get_stft_input_window(StftWindows *self);
+const float *get_stft_output_window(StftWindows *self);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "command_queue.h"
+#include "memory_arena.h"
+#include <string.h>
+
+struct CommandQueue {
+  size_t command_size;
+  // One slot is always left empty to tell a full queue from an empty one
+  uint32_t number_of_slots;
+  unsigned char *slots;
+
+  // Only moved by the producer
+  uint32_t write_position;
+  // Only moved by the consumer
+  uint32_t read_position;
+};
+
+CommandQueue *command_queue_initialize(const size_t command_size,
+                                       const uint32_t capacity) {
+  if (command_size == 0U || capacity == 0U) {
+    return NULL;
+  }
+
+  CommandQueue *self =
+      (CommandQueue *)spectral_calloc(1U, sizeof(CommandQueue));
+
+  self->command_size = command_size;
+  self->number_of_slots = capacity + 1U;
+  self->slots = (unsigned char *)spectral_calloc(self->number_of_slots,
+                                                 command_size);
+
+  return self;
+}
+
+void command_queue_free(CommandQueue *self) {
+  spectral_free(self->slots);
+
+  spectral_free(self);
+}
+
+bool command_queue_push(CommandQueue *self, const void *command) {
+  if (!self || !command) {
+    return false;
+  }
+
+  const uint32_t write_position =
+      __atomic_load_n(&self->write_position, __ATOMIC_RELAXED);
+  const uint32_t next_position = (write_position + 1U) % self->number_of_slots;
+
+  // Acquire pairs with the consumer so the slot is no longer being read
+  if (next_position ==
+      __atomic_load_n(&self->read_position, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  memcpy(&self->slots[(size_t)write_position * self->command_size], command,
+         self->command_size);
+  // Release makes the copy visible before the slot can be taken
+  __atomic_store_n(&self->write_position, next_position, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+bool command_queue_pop(CommandQueue *self, void *command) {
+  if (!self || !command) {
+    return false;
+  }
+
+  const uint32_t read_position =
+      __atomic_load_n(&self->read_position, __ATOMIC_RELAXED);
+
+  // Acquire pairs with the producer so the whole copy is seen
+  if (read_position ==
+      __atomic_load_n(&self->write_position, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  memcpy(command, &self->slots[(size_t)read_position * self->command_size],
+         self->command_size);
+  __atomic_store_n(&self->read_position,
+                   (read_position + 1U) % self->number_of_slots,
+                   __ATOMIC_RELEASE);
+
+  return true;
+}
@@ -0,0 +1,44 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Queue of fixed size commands from a single control thread to the processing
+// thread. It is a ring whose write position is only moved by the producer and
+// whose read position is only moved by the consumer, so neither side ever
+// waits and every command is copied whole before the consumer can see it.
+// Commands are taken in the order they were pushed
+typedef struct CommandQueue CommandQueue;
+
+CommandQueue *command_queue_initialize(size_t command_size, uint32_t capacity);
+void command_queue_free(CommandQueue *self);
+// Copies the command at the end of the queue. Returns false if it is full.
+// Only one thread may push
+bool command_queue_push(CommandQueue *self, const void *command);
+// Copies the oldest command into command and removes it. Returns false if the
+// queue is empty. Only one thread may pop
+bool command_queue_pop(CommandQueue *self, void *command);
+
+#endif
@@ -20,6 +20,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "denoise_mixer.h"
 #include "../post_estimation/spectral_whitening.h"
+#include "memory_arena.h"
+#include "spectral_kernels.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,7 +29,6 @@ struct DenoiseMixer {
   SpectralWhitening *whitener;
 
   float *residual_spectrum;
-  float *denoised_spectrum;
 
   uint32_t fft_size;
   uint32_t real_spectrum_size;
@@ -37,15 +38,16 @@ struct DenoiseMixer {
 
 DenoiseMixer *denoise_mixer_initialize(uint32_t fft_size, uint32_t sample_rate,
                                        uint32_t hop) {
-  DenoiseMixer *self = (DenoiseMixer *)calloc(1U, sizeof(DenoiseMixer));
+  DenoiseMixer *self =
+      (DenoiseMixer *)spectral_calloc(1U, sizeof(DenoiseMixer));
 
   self->fft_size = fft_size;
   self->real_spectrum_size = self->fft_size / 2U + 1U;
   self->sample_rate = sample_rate;
   self->hop = hop;
 
-  self->residual_spectrum = (float *)calloc((self->fft_size), sizeof(float));
-  self->denoised_spectrum = (float *)calloc((self->fft_size), sizeof(float));
+  self->residual_spectrum =
+      (float *)spectral_calloc((self->fft_size), sizeof(float));
 
   self->whitener = spectral_whitening_initialize(self->fft_size,
                                                  self->sample_rate, self->hop);
@@ -56,10 +58,13 @@ DenoiseMixer *denoise_mixer_initialize(uint32_t fft_size, uint32_t sample_rate,
 void denoise_mixer_free(DenoiseMixer *self) {
   spectral_whitening_free(self->whitener);
 
-  free(self->residual_spectrum);
-  free(self->denoised_spectrum);
+  spectral_free(self->residual_spectrum);
 
-  free(self);
+  spectral_free(self);
+}
+
+void denoise_mixer_reset(DenoiseMixer *self) {
+  spectral_whitening_reset(self->whitener);
 }
 
 bool denoise_mixer_run(DenoiseMixer *self, float *fft_spectrum,
@@ -70,32 +75,47 @@ bool denoise_mixer_run(DenoiseMixer *self, float *fft_spectrum,
     return false;
   }
 
-  // Get denoised spectrum - Apply to both real and complex parts
-  for (uint32_t k = 1U; k < self->fft_size; k++) {
-    self->denoised_spectrum[k] = fft_spectrum[k] * gain_spectrum[k];
-  }
+  const SpectralKernels *kernels = get_spectral_kernels();
+
+  // Without whitening the residual is never needed on its own, so gains are
+  // applied in place. Gains only cover the real half and are read backwards
+  // for the imaginary parts
+  if (parameters.whitening_amount <= 0.F) {
+    if (parameters.residual_listen) {
+      kernels->apply_gains(fft_spectrum, gain_spectrum, 0.F, 1.F,
+                           self->fft_size, self->real_spectrum_size);
+    } else {
+      kernels->apply_gains(fft_spectrum, gain_spectrum, 1.F,
+                           parameters.noise_level, self->fft_size,
+                           self->real_spectrum_size);
+    }
 
-  // Get residual spectrum - Apply to both real and complex parts
-  for (uint32_t k = 1U; k < self->fft_size; k++) {
-    self->residual_spectrum[k] = fft_spectrum[k] - self->denoised_spectrum[k];
+    return true;
   }
 
-  if (parameters.whitening_amount > 0.F) {
+  // Listening to the whitened residual needs no mix, so it is isolated and
+  // whitened in place
+  if (parameters.residual_listen) {
+    kernels->split_residual(fft_spectrum, gain_spectrum, self->fft_size,
+                            self->real_spectrum_size, fft_spectrum);
+
     spectral_whitening_run(self->whitener, parameters.whitening_amount,
-                           self->residual_spectrum);
-  }
+                           fft_spectrum);
 
-  // Mix denoised and residual
-  if (parameters.residual_listen) {
-    for (uint32_t k = 1U; k < self->fft_size; k++) {
-      fft_spectrum[k] = self->residual_spectrum[k];
-    }
-  } else {
-    for (uint32_t k = 1U; k < self->fft_size; k++) {
-      fft_spectrum[k] = self->denoised_spectrum[k] +
-                        self->residual_spectrum[k] * parameters.noise_level;
-    }
+    return true;
   }
 
+  // Otherwise only the residual is kept aside for whitening and the denoised
+  // bins are computed again while mixing, which saves a scratch spectrum
+  kernels->split_residual(fft_spectrum, gain_spectrum, self->fft_size,
+                          self->real_spectrum_size, self->residual_spectrum);
+
+  spectral_whitening_run(self->whitener, parameters.whitening_amount,
+                         self->residual_spectrum);
+
+  kernels->mix_residual(fft_spectrum, gain_spectrum, self->residual_spectrum,
+                        parameters.noise_level, self->fft_size,
+                        self->real_spectrum_size);
+
   return true;
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "memory_arena.h"
+#include "realtime_audit.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct MemoryArena {
+  unsigned char *region;
+  size_t capacity;
+  size_t used;
+  bool measuring;
+  bool exhausted;
+  // Heap memory released with the arena
+  void *owned_memory;
+};
+
+static pthread_key_t bound_arena_key;
+static pthread_once_t bound_arena_once = PTHREAD_ONCE_INIT;
+
+static size_t align_size(size_t size);
+static size_t get_header_size(void);
+
+MemoryArena *memory_arena_initialize(void *memory, const size_t size) {
+  if (!memory) {
+    return NULL;
+  }
+
+  const uintptr_t address = (uintptr_t)memory;
+  const size_t padding = (size_t)(align_size((size_t)address) - address);
+  if (size < padding + get_header_size()) {
+    return NULL;
+  }
+
+  MemoryArena *self = (MemoryArena *)((unsigned char *)memory + padding);
+  memset(self, 0, sizeof(MemoryArena));
+  self->region = (unsigned char *)self + get_header_size();
+  self->capacity = size - padding - get_header_size();
+
+  return self;
+}
+
+MemoryArena *memory_arena_initialize_owned(const size_t size) {
+  void *memory = malloc(size > 0U ? size : 1U);
+  MemoryArena *self = memory_arena_initialize(memory, size);
+
+  if (!self) {
+    free(memory);
+    return NULL;
+  }
+
+  self->owned_memory = memory;
+
+  return self;
+}
+
+MemoryArena *memory_arena_initialize_measuring(void) {
+  MemoryArena *self = (MemoryArena *)calloc(1U, sizeof(MemoryArena));
+
+  if (!self) {
+    return NULL;
+  }
+
+  self->measuring = true;
+  self->owned_memory = self;
+
+  return self;
+}
+
+void memory_arena_free(MemoryArena *self) {
+  if (!self) {
+    return;
+  }
+
+  // Owned regions hold the arena itself so nothing can be touched after this
+  free(self->owned_memory);
+}
+
+size_t get_memory_arena_required_size(const MemoryArena *self) {
+  if (!self) {
+    return 0U;
+  }
+
+  return (MEMORY_ARENA_ALIGNMENT - 1U) + get_header_size() + self->used;
+}
+
+bool is_memory_arena_exhausted(const MemoryArena *self) {
+  return self && self->exhausted;
+}
+
+static void create_bound_arena_key(void) {
+  pthread_key_create(&bound_arena_key, NULL);
+}
+
+MemoryArena *memory_arena_bind(MemoryArena *arena) {
+  pthread_once(&bound_arena_once, create_bound_arena_key);
+
+  MemoryArena *previous = (MemoryArena *)pthread_getspecific(bound_arena_key);
+  pthread_setspecific(bound_arena_key, arena);
+
+  return previous;
+}
+
+static MemoryArena *get_bound_memory_arena(void) {
+  pthread_once(&bound_arena_once, create_bound_arena_key);
+
+  return (MemoryArena *)pthread_getspecific(bound_arena_key);
+}
+
+void *carve_from_bound_memory_arena(const size_t size) {
+  MemoryArena *self = get_bound_memory_arena();
+  if (!self || size == 0U) {
+    return NULL;
+  }
+
+  const size_t aligned_size = align_size(size);
+  if (aligned_size < size) {
+    return NULL;
+  }
+
+  if (self->measuring) {
+    self->used += aligned_size;
+    return NULL;
+  }
+
+  if (aligned_size > self->capacity - self->used) {
+    self->exhausted = true;
+    return NULL;
+  }
+
+  void *block = self->region + self->used;
+  self->used += aligned_size;
+  memset(block, 0, size);
+
+  return block;
+}
+
+bool is_in_bound_memory_arena(const void *block) {
+  const MemoryArena *self = get_bound_memory_arena();
+  if (!self || self->measuring || !block) {
+    return false;
+  }
+
+  const uintptr_t address = (uintptr_t)block;
+  const uintptr_t start = (uintptr_t)self->region;
+
+  return address >= start && address - start < self->capacity;
+}
+
+bool is_bound_memory_arena_measuring(void) {
+  const MemoryArena *self = get_bound_memory_arena();
+
+  return self && self->measuring;
+}
+
+// Carving from an arena doesn't reach the heap but processing must not take
+// memory from any of them
+void *spectral_calloc(const size_t count, const size_t size) {
+  REALTIME_AUDIT_CHECK("spectral_calloc");
+
+  if (size > 0U && count > SIZE_MAX / size) {
+    return NULL;
+  }
+
+  void *block = carve_from_bound_memory_arena(count * size);
+
+  return block ? block : calloc(count, size);
+}
+
+void spectral_free(void *block) {
+  if (block) {
+    REALTIME_AUDIT_CHECK("spectral_free");
+  }
+
+  if (!is_in_bound_memory_arena(block)) {
+    free(block);
+  }
+}
+
+static size_t align_size(const size_t size) {
+  return (size + (MEMORY_ARENA_ALIGNMENT - 1U)) &
+         ~((size_t)MEMORY_ARENA_ALIGNMENT - 1U);
+}
+
+static size_t get_header_size(void) { return align_size(sizeof(MemoryArena)); }
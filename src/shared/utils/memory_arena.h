@@ -0,0 +1,70 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Blocks are carved at cache line boundaries
+#define MEMORY_ARENA_ALIGNMENT 64U
+
+// Linear allocator that carves the blocks of a processor instance from a
+// single memory region. Modules allocate with spectral_calloc and release with
+// spectral_free. While an arena is bound to the calling thread those take
+// memory from it, and otherwise they fall back to the heap so modules built
+// without an arena keep working. Freeing a block carved from the arena does
+// nothing, the whole region goes away with the arena
+typedef struct MemoryArena MemoryArena;
+
+// Arena over caller memory. The arena bookkeeping is carved from the region
+// too. Returns NULL if the region can't hold it
+MemoryArena *memory_arena_initialize(void *memory, size_t size);
+// Arena over a heap block of the given size that is freed with the arena
+MemoryArena *memory_arena_initialize_owned(size_t size);
+// Arena that takes every block from the heap and only adds up the memory they
+// would have used. It tells the size a region needs to build the same thing
+MemoryArena *memory_arena_initialize_measuring(void);
+void memory_arena_free(MemoryArena *self);
+// Size of a region able to hold everything carved or measured so far,
+// including the arena bookkeeping and the slack to align the region
+size_t get_memory_arena_required_size(const MemoryArena *self);
+// True if some block didn't fit in the region and came from the heap instead
+bool is_memory_arena_exhausted(const MemoryArena *self);
+
+// Binds the arena to the calling thread and returns the previously bound one
+// so it can be restored. NULL unbinds
+MemoryArena *memory_arena_bind(MemoryArena *arena);
+// Zeroed block from the bound arena. NULL if there is no arena bound, the
+// block doesn't fit or the bound arena is measuring, in which case the size
+// still gets added up. Meant for blocks that need a specific heap fallback
+void *carve_from_bound_memory_arena(size_t size);
+bool is_in_bound_memory_arena(const void *block);
+// True while the bound arena is measuring. Resources that don't come from the
+// arena, like transform plans or worker threads, can be skipped then since the
+// measured instance is never used for processing
+bool is_bound_memory_arena_measuring(void);
+
+// calloc and free counterparts aware of the bound arena
+void *spectral_calloc(size_t count, size_t size);
+void spectral_free(void *block);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "parameter_exchange.h"
+#include "memory_arena.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUMBER_OF_SLOTS 3U
+#define SLOT_INDEX_MASK 3U
+// Set on the latest slot index while the consumer hasn't taken it
+#define FRESH_SLOT_FLAG 4U
+
+struct ParameterExchange {
+  size_t parameters_size;
+  unsigned char *slots[NUMBER_OF_SLOTS];
+
+  // Only touched by publishers, under the mutex
+  uint32_t back_slot;
+  pthread_mutex_t publish_mutex;
+
+  // Exchanged atomically between publishers and the consumer
+  uint32_t latest_slot;
+
+  // Only touched by the consumer
+  uint32_t front_slot;
+};
+
+ParameterExchange *parameter_exchange_initialize(const size_t parameters_size) {
+  ParameterExchange *self =
+      (ParameterExchange *)spectral_calloc(1U, sizeof(ParameterExchange));
+
+  self->parameters_size = parameters_size;
+  for (uint32_t k = 0U; k < NUMBER_OF_SLOTS; k++) {
+    self->slots[k] = (unsigned char *)spectral_calloc(1U, parameters_size);
+  }
+
+  self->front_slot = 0U;
+  self->latest_slot = 1U;
+  self->back_slot = 2U;
+  pthread_mutex_init(&self->publish_mutex, NULL);
+
+  return self;
+}
+
+void parameter_exchange_free(ParameterExchange *self) {
+  pthread_mutex_destroy(&self->publish_mutex);
+  for (uint32_t k = 0U; k < NUMBER_OF_SLOTS; k++) {
+    spectral_free(self->slots[k]);
+  }
+
+  spectral_free(self);
+}
+
+bool parameter_exchange_publish(ParameterExchange *self,
+                                const void *parameters) {
+  if (!self || !parameters) {
+    return false;
+  }
+
+  memcpy(parameter_exchange_begin_publish(self), parameters,
+         self->parameters_size);
+  parameter_exchange_end_publish(self);
+
+  return true;
+}
+
+void *parameter_exchange_begin_publish(ParameterExchange *self) {
+  pthread_mutex_lock(&self->publish_mutex);
+
+  return self->slots[self->back_slot];
+}
+
+void parameter_exchange_end_publish(ParameterExchange *self) {
+  // Release makes the copy visible before the slot can be taken
+  const uint32_t previous_slot =
+      __atomic_exchange_n(&self->latest_slot, self->back_slot | FRESH_SLOT_FLAG,
+                          __ATOMIC_ACQ_REL);
+  self->back_slot = previous_slot & SLOT_INDEX_MASK;
+
+  pthread_mutex_unlock(&self->publish_mutex);
+}
+
+const void *parameter_exchange_consume(ParameterExchange *self) {
+  if (!self) {
+    return NULL;
+  }
+
+  if ((__atomic_load_n(&self->latest_slot, __ATOMIC_RELAXED) &
+       FRESH_SLOT_FLAG) == 0U) {
+    return NULL;
+  }
+
+  // Acquire pairs with the publisher so the whole copy is seen
+  const uint32_t latest_slot = __atomic_exchange_n(
+      &self->latest_slot, self->front_slot, __ATOMIC_ACQ_REL);
+  self->front_slot = latest_slot & SLOT_INDEX_MASK;
+
+  return self->slots[self->front_slot];
+}
+
+void *get_parameter_exchange_current(ParameterExchange *self) {
+  return self->slots[self->front_slot];
+}
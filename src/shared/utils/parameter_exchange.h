@@ -0,0 +1,53 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARAMETER_EXCHANGE_H
+#define PARAMETER_EXCHANGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Hands parameter sets, or any other fixed size data, from control threads to
+// the processing thread without locking the latter. It is a triple buffer: the
+// publisher fills a spare copy and swaps it with the latest one, and the
+// consumer swaps the latest one with the copy it holds only when there is a
+// newer one. Both swaps are a single atomic exchange so the consumer never
+// waits and never sees a partially written set. Publishers are serialized
+// between themselves so any number of control threads can publish
+typedef struct ParameterExchange ParameterExchange;
+
+ParameterExchange *parameter_exchange_initialize(size_t parameters_size);
+void parameter_exchange_free(ParameterExchange *self);
+// Copies the parameters and makes them the latest set
+bool parameter_exchange_publish(ParameterExchange *self,
+                                const void *parameters);
+// Same as publish but writing the set in place. Begin returns the spare copy
+// to fill, which can hold anything, and end makes it the latest set. Other
+// publishers wait in between
+void *parameter_exchange_begin_publish(ParameterExchange *self);
+void parameter_exchange_end_publish(ParameterExchange *self);
+// Latest set published since the previous call or NULL if there is none. The
+// set stays valid until the next call. Only one thread may consume
+const void *parameter_exchange_consume(ParameterExchange *self);
+// Set held by the consumer. It belongs to the consumer until the next
+// consume, so the consumer may modify it
+void *get_parameter_exchange_current(ParameterExchange *self);
+
+#endif
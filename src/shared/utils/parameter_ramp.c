@@ -0,0 +1,69 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "parameter_ramp.h"
+#include "../configurations.h"
+#include <math.h>
+
+void parameter_ramp_reset(ParameterRamp *self, const float value) {
+  self->value = value;
+  self->target = value;
+  self->step = 0.F;
+  self->remaining_frames = 0U;
+}
+
+void parameter_ramp_set_target(ParameterRamp *self, const float target,
+                               const uint32_t ramp_frames) {
+  if (target == self->target) {
+    return;
+  }
+
+  if (ramp_frames == 0U) {
+    parameter_ramp_reset(self, target);
+    return;
+  }
+
+  self->target = target;
+  self->step = (target - self->value) / (float)ramp_frames;
+  self->remaining_frames = ramp_frames;
+}
+
+float parameter_ramp_advance(ParameterRamp *self) {
+  if (self->remaining_frames > 0U) {
+    self->remaining_frames--;
+    // Land exactly on the target whatever the rounding of the steps
+    self->value = self->remaining_frames == 0U ? self->target
+                                               : self->value + self->step;
+  }
+
+  return self->value;
+}
+
+uint32_t get_parameter_ramp_frames(const uint32_t sample_rate,
+                                   const uint32_t hop) {
+  if (hop == 0U) {
+    return 0U;
+  }
+
+  const float ramp_frames =
+      ceilf((PARAMETER_RAMP_TIME / 1000.F) * (float)sample_rate / (float)hop);
+
+  return ramp_frames > 1.F ? (uint32_t)ramp_frames : 1U;
+}
@@ -0,0 +1,43 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARAMETER_RAMP_H
+#define PARAMETER_RAMP_H
+
+#include <stdint.h>
+
+// Moves a continuous parameter linearly to a new target over a number of
+// frames so changes don't produce steps in the gains
+typedef struct ParameterRamp {
+  float value;
+  float target;
+  float step;
+  uint32_t remaining_frames;
+} ParameterRamp;
+
+// Jumps straight to the value
+void parameter_ramp_reset(ParameterRamp *self, float value);
+void parameter_ramp_set_target(ParameterRamp *self, float target,
+                               uint32_t ramp_frames);
+// Value to use for the current frame
+float parameter_ramp_advance(ParameterRamp *self);
+uint32_t get_parameter_ramp_frames(uint32_t sample_rate, uint32_t hop);
+
+#endif
@@ -0,0 +1,143 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifdef SPECBLEACH_REALTIME_AUDIT
+// For RTLD_NEXT
+#define _GNU_SOURCE
+#endif
+
+#include "realtime_audit.h"
+
+#ifdef SPECBLEACH_REALTIME_AUDIT
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Initial exec keeps the depth out of the lazily allocated thread storage, so
+// reading it from the allocators doesn't allocate
+static __thread uint32_t section_depth
+    __attribute__((tls_model("initial-exec")));
+
+void realtime_audit_enter(void) { section_depth++; }
+
+void realtime_audit_leave(void) { section_depth--; }
+
+uint32_t realtime_audit_suspend(void) {
+  const uint32_t depth = section_depth;
+  section_depth = 0U;
+
+  return depth;
+}
+
+void realtime_audit_resume(const uint32_t depth) { section_depth = depth; }
+
+// Writes straight to the descriptor since stdio may allocate
+void realtime_audit_check(const char *operation) {
+  if (section_depth == 0U) {
+    return;
+  }
+
+  // Reporting and aborting must not trap again
+  section_depth = 0U;
+
+  static const char message[] = "libspecbleach: real time processing called ";
+  ssize_t written = write(STDERR_FILENO, message, sizeof(message) - 1U);
+  written = write(STDERR_FILENO, operation, strlen(operation));
+  written = write(STDERR_FILENO, "\n", 1U);
+  (void)written;
+
+  abort();
+}
+
+#if defined(__GLIBC__)
+// glibc exports the allocators behind its public names, which lets these
+// replacements forward to them without looking them up. Looking up allocates
+// and the lookup itself would land here again
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *block, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *block);
+
+typedef int (*MutexLock)(pthread_mutex_t *mutex);
+static MutexLock next_mutex_lock = NULL;
+
+void *malloc(size_t size) {
+  realtime_audit_check("malloc");
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  realtime_audit_check("calloc");
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *block, size_t size) {
+  realtime_audit_check("realloc");
+  return __libc_realloc(block, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  realtime_audit_check("aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+// FFTW allocates its buffers through this one
+int posix_memalign(void **block, size_t alignment, size_t size) {
+  realtime_audit_check("posix_memalign");
+  if (alignment % sizeof(void *) != 0U ||
+      (alignment & (alignment - 1U)) != 0U) {
+    return EINVAL;
+  }
+
+  *block = __libc_memalign(alignment, size);
+
+  return *block || size == 0U ? 0 : ENOMEM;
+}
+
+void free(void *block) {
+  if (block) {
+    realtime_audit_check("free");
+  }
+  __libc_free(block);
+}
+
+// Waiting on a lock can block the processing thread for as long as the holder
+// runs. Try locks don't wait and stay allowed
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  realtime_audit_check("pthread_mutex_lock");
+
+  // Racing threads resolve the same symbol, so whichever store wins is fine
+  MutexLock mutex_lock = __atomic_load_n(&next_mutex_lock, __ATOMIC_RELAXED);
+  if (!mutex_lock) {
+    *(void **)&mutex_lock = dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    __atomic_store_n(&next_mutex_lock, mutex_lock, __ATOMIC_RELAXED);
+  }
+
+  return mutex_lock(mutex);
+}
+#endif
+
+#endif
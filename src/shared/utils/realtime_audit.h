@@ -0,0 +1,58 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef REALTIME_AUDIT_H
+#define REALTIME_AUDIT_H
+
+#include <stdint.h>
+
+// Processing calls never allocate, free or wait on a lock. Built with
+// SPECBLEACH_REALTIME_AUDIT defined, the library replaces the heap allocators
+// and pthread_mutex_lock of the whole program with versions that abort when
+// they are called by a thread inside a processing call, so any regression is
+// caught right where it happens. It is a debug build only supported on glibc.
+// Otherwise the macros expand to nothing and there is no cost in the
+// processing path
+#ifdef SPECBLEACH_REALTIME_AUDIT
+// Sections nest, so a processing call may call another one
+void realtime_audit_enter(void);
+void realtime_audit_leave(void);
+// Aborts naming the operation if the calling thread is inside a section
+void realtime_audit_check(const char *operation);
+// Leaves every section of the calling thread for code allowed to lock, and
+// returns how deep it was to restore it afterwards
+uint32_t realtime_audit_suspend(void);
+void realtime_audit_resume(uint32_t depth);
+
+#define REALTIME_SECTION_BEGIN() realtime_audit_enter()
+#define REALTIME_SECTION_END() realtime_audit_leave()
+#define REALTIME_AUDIT_CHECK(operation) realtime_audit_check(operation)
+#define REALTIME_AUDIT_SUSPEND(id)                                             \
+  const uint32_t id##_audit_depth = realtime_audit_suspend()
+#define REALTIME_AUDIT_RESUME(id) realtime_audit_resume(id##_audit_depth)
+#else
+#define REALTIME_SECTION_BEGIN() ((void)0)
+#define REALTIME_SECTION_END() ((void)0)
+#define REALTIME_AUDIT_CHECK(operation) ((void)0)
+#define REALTIME_AUDIT_SUSPEND(id) ((void)0)
+#define REALTIME_AUDIT_RESUME(id) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "reduction_telemetry.h"
+#include "../configurations.h"
+#include "memory_arena.h"
+#include <math.h>
+#include <string.h>
+
+// Floor of the energies so silent frames don't give infinite levels
+#define ENERGY_FLOOR 1e-20F
+
+struct ReductionTelemetry {
+  float level_coefficient;
+
+  // Odd while the processing thread writes the counters
+  uint32_t sequence;
+  uint32_t reset_requested;
+  ReductionTelemetryCounters counters;
+};
+
+ReductionTelemetry *reduction_telemetry_initialize(const uint32_t sample_rate,
+                                                   const uint32_t hop) {
+  ReductionTelemetry *self =
+      (ReductionTelemetry *)spectral_calloc(1U, sizeof(ReductionTelemetry));
+
+  // One pole average reaching about two thirds of a change in the time given
+  self->level_coefficient =
+      expf(-1000.F * (float)hop /
+           (TELEMETRY_AVERAGING_TIME * (float)sample_rate));
+
+  return self;
+}
+
+void reduction_telemetry_free(ReductionTelemetry *self) { spectral_free(self); }
+
+static float energy_ratio_db(const float numerator, const float denominator) {
+  return 10.F * log10f((numerator + ENERGY_FLOOR) /
+                       (denominator + ENERGY_FLOOR));
+}
+
+void reduction_telemetry_update(ReductionTelemetry *self,
+                                const ReductionTelemetryFrame frame) {
+  if (!self) {
+    return;
+  }
+
+  // The writer is the only one changing the counters, so it reads them freely
+  ReductionTelemetryCounters counters = self->counters;
+  if (__atomic_exchange_n(&self->reset_requested, 0U, __ATOMIC_ACQUIRE)) {
+    memset(&counters, 0, sizeof(ReductionTelemetryCounters));
+  }
+
+  const float input_snr =
+      energy_ratio_db(frame.input_energy, frame.noise_energy);
+  const float attenuation =
+      energy_ratio_db(frame.input_energy, frame.output_energy);
+
+  if (counters.frames == 0U) {
+    counters.input_snr = input_snr;
+    counters.attenuation = attenuation;
+  } else {
+    const float coefficient = self->level_coefficient;
+    counters.input_snr =
+        coefficient * counters.input_snr + (1.F - coefficient) * input_snr;
+    counters.attenuation =
+        coefficient * counters.attenuation + (1.F - coefficient) * attenuation;
+  }
+  counters.frames++;
+  counters.transient_frames += frame.transient ? 1U : 0U;
+  counters.postfilter_frames += frame.postfiltered ? 1U : 0U;
+
+  const uint32_t sequence = self->sequence;
+  __atomic_store_n(&self->sequence, sequence + 1U, __ATOMIC_RELAXED);
+  // Readers seeing any of the new counters also see the odd sequence
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  self->counters = counters;
+  __atomic_store_n(&self->sequence, sequence + 2U, __ATOMIC_RELEASE);
+}
+
+bool reduction_telemetry_read(ReductionTelemetry *self,
+                              ReductionTelemetryCounters *counters) {
+  if (!self || !counters) {
+    return false;
+  }
+
+  uint32_t sequence_before = 0U;
+  uint32_t sequence_after = 0U;
+  do {
+    sequence_before = __atomic_load_n(&self->sequence, __ATOMIC_ACQUIRE);
+    memcpy(counters, &self->counters, sizeof(ReductionTelemetryCounters));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    sequence_after = __atomic_load_n(&self->sequence, __ATOMIC_RELAXED);
+  } while ((sequence_before & 1U) != 0U || sequence_before != sequence_after);
+
+  // Counters waiting to be cleared already read as cleared
+  if (__atomic_load_n(&self->reset_requested, __ATOMIC_ACQUIRE)) {
+    memset(counters, 0, sizeof(ReductionTelemetryCounters));
+  }
+
+  return true;
+}
+
+void reduction_telemetry_reset(ReductionTelemetry *self) {
+  if (!self) {
+    return;
+  }
+
+  __atomic_store_n(&self->reset_requested, 1U, __ATOMIC_RELEASE);
+}
+
+bool reduction_telemetry_merge(ReductionTelemetry *const *telemetries,
+                               const uint32_t number_of_telemetries,
+                               ReductionTelemetryCounters *counters) {
+  if (!telemetries || !counters) {
+    return false;
+  }
+
+  memset(counters, 0, sizeof(ReductionTelemetryCounters));
+
+  uint32_t measured = 0U;
+  for (uint32_t k = 0U; k < number_of_telemetries; k++) {
+    ReductionTelemetryCounters telemetry_counters;
+    if (!reduction_telemetry_read(telemetries[k], &telemetry_counters) ||
+        telemetry_counters.frames == 0U) {
+      continue;
+    }
+
+    counters->frames += telemetry_counters.frames;
+    counters->transient_frames += telemetry_counters.transient_frames;
+    counters->postfilter_frames += telemetry_counters.postfilter_frames;
+    counters->input_snr += telemetry_counters.input_snr;
+    counters->attenuation += telemetry_counters.attenuation;
+    measured++;
+  }
+
+  if (measured > 0U) {
+    counters->input_snr /= (float)measured;
+    counters->attenuation /= (float)measured;
+  }
+
+  return true;
+}
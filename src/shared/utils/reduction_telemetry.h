@@ -0,0 +1,68 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef REDUCTION_TELEMETRY_H
+#define REDUCTION_TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// What a processor measured while reducing one frame. Energies are sums over
+// the bins of the frame
+typedef struct ReductionTelemetryFrame {
+  float input_energy;
+  float noise_energy;
+  float output_energy;
+  bool transient;
+  bool postfiltered;
+} ReductionTelemetryFrame;
+
+typedef struct ReductionTelemetryCounters {
+  uint64_t frames;
+  uint64_t transient_frames;
+  uint64_t postfilter_frames;
+  // Averaged over the last frames, in db
+  float input_snr;
+  float attenuation;
+} ReductionTelemetryCounters;
+
+// Counters of a processor, written by the processing thread and read from any
+// other. Writes go through a sequence lock: the writer never waits and readers
+// retry the copy if a frame was written meanwhile. Only one thread may update
+typedef struct ReductionTelemetry ReductionTelemetry;
+
+ReductionTelemetry *reduction_telemetry_initialize(uint32_t sample_rate,
+                                                   uint32_t hop);
+void reduction_telemetry_free(ReductionTelemetry *self);
+void reduction_telemetry_update(ReductionTelemetry *self,
+                                ReductionTelemetryFrame frame);
+// Consistent copy of the counters. Safe from any thread
+bool reduction_telemetry_read(ReductionTelemetry *self,
+                              ReductionTelemetryCounters *counters);
+// Counters are cleared by the processing thread on its next update, so this is
+// safe from any thread too
+void reduction_telemetry_reset(ReductionTelemetry *self);
+// Reads several telemetries as one. Frames are added up and levels averaged
+// over the telemetries that have any
+bool reduction_telemetry_merge(ReductionTelemetry *const *telemetries,
+                               uint32_t number_of_telemetries,
+                               ReductionTelemetryCounters *counters);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "sample_converter.h"
+#include "memory_arena.h"
+#include <math.h>
+#include <stddef.h>
+
+// Frames converted at once. Small enough for the planar blocks of a few
+// channels to stay in cache between conversion and processing
+#define CONVERSION_BLOCK_SIZE 256U
+
+#define S16_SCALE 32768.
+#define S32_SCALE 2147483648.
+
+static void read_block(const SampleConverter *self, SampleFormat format,
+                       const void *input, size_t first_sample,
+                       uint32_t block_size);
+static void write_block(const SampleConverter *self, SampleFormat format,
+                        void *output, size_t first_sample,
+                        uint32_t block_size);
+static double clip_scaled(double sample, double scale);
+
+struct SampleConverter {
+  uint32_t number_of_channels;
+
+  float *planar_buffer;
+  float **planar_input;
+  float **planar_output;
+};
+
+SampleConverter *sample_converter_initialize(
+    const uint32_t number_of_channels) {
+  SampleConverter *self =
+      (SampleConverter *)spectral_calloc(1U, sizeof(SampleConverter));
+
+  self->number_of_channels = number_of_channels > 0U ? number_of_channels : 1U;
+
+  self->planar_buffer = (float *)spectral_calloc(
+      (size_t)CONVERSION_BLOCK_SIZE * self->number_of_channels * 2U,
+      sizeof(float));
+  self->planar_input =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  self->planar_output =
+      (float **)spectral_calloc(self->number_of_channels, sizeof(float *));
+  for (uint32_t k = 0U; k < self->number_of_channels; k++) {
+    self->planar_input[k] =
+        &self->planar_buffer[(size_t)k * CONVERSION_BLOCK_SIZE];
+    self->planar_output[k] =
+        &self->planar_buffer[(size_t)(self->number_of_channels + k) *
+                             CONVERSION_BLOCK_SIZE];
+  }
+
+  return self;
+}
+
+void sample_converter_free(SampleConverter *self) {
+  spectral_free(self->planar_buffer);
+  spectral_free(self->planar_input);
+  spectral_free(self->planar_output);
+
+  spectral_free(self);
+}
+
+bool sample_converter_run(SampleConverter *self,
+                          const uint32_t number_of_frames,
+                          const SampleFormat format, const void *input,
+                          void *output, planar_processing processing,
+                          void *instance) {
+  if (!self || !input || !output || !processing || number_of_frames == 0U) {
+    return false;
+  }
+
+  uint32_t processed_frames = 0U;
+
+  while (processed_frames < number_of_frames) {
+    const uint32_t block_size =
+        number_of_frames - processed_frames < CONVERSION_BLOCK_SIZE
+            ? number_of_frames - processed_frames
+            : CONVERSION_BLOCK_SIZE;
+    const size_t first_sample =
+        (size_t)processed_frames * self->number_of_channels;
+
+    read_block(self, format, input, first_sample, block_size);
+
+    if (!processing(instance, block_size,
+                    (const float *const *)self->planar_input,
+                    self->planar_output)) {
+      return false;
+    }
+
+    write_block(self, format, output, first_sample, block_size);
+
+    processed_frames += block_size;
+  }
+
+  return true;
+}
+
+static void read_block(const SampleConverter *self, const SampleFormat format,
+                       const void *input, const size_t first_sample,
+                       const uint32_t block_size) {
+  const uint32_t channels = self->number_of_channels;
+
+  for (uint32_t k = 0U; k < channels; k++) {
+    float *planar = self->planar_input[k];
+    const size_t first = first_sample + k;
+
+    switch (format) {
+    case SAMPLE_FORMAT_S16: {
+      const int16_t *samples = (const int16_t *)input + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        planar[i] = (float)((double)samples[(size_t)i * channels] / S16_SCALE);
+      }
+      break;
+    }
+    case SAMPLE_FORMAT_S32: {
+      const int32_t *samples = (const int32_t *)input + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        planar[i] = (float)((double)samples[(size_t)i * channels] / S32_SCALE);
+      }
+      break;
+    }
+    case SAMPLE_FORMAT_F64:
+    default: {
+      const double *samples = (const double *)input + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        planar[i] = (float)samples[(size_t)i * channels];
+      }
+      break;
+    }
+    }
+  }
+}
+
+static void write_block(const SampleConverter *self, const SampleFormat format,
+                        void *output, const size_t first_sample,
+                        const uint32_t block_size) {
+  const uint32_t channels = self->number_of_channels;
+
+  for (uint32_t k = 0U; k < channels; k++) {
+    const float *planar = self->planar_output[k];
+    const size_t first = first_sample + k;
+
+    switch (format) {
+    case SAMPLE_FORMAT_S16: {
+      int16_t *samples = (int16_t *)output + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        samples[(size_t)i * channels] =
+            (int16_t)clip_scaled((double)planar[i], S16_SCALE);
+      }
+      break;
+    }
+    case SAMPLE_FORMAT_S32: {
+      int32_t *samples = (int32_t *)output + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        samples[(size_t)i * channels] =
+            (int32_t)clip_scaled((double)planar[i], S32_SCALE);
+      }
+      break;
+    }
+    case SAMPLE_FORMAT_F64:
+    default: {
+      double *samples = (double *)output + first;
+      for (uint32_t i = 0U; i < block_size; i++) {
+        samples[(size_t)i * channels] = (double)planar[i];
+      }
+      break;
+    }
+    }
+  }
+}
+
+// Rounds a sample scaled to the integer range and clips it to [-scale, scale)
+static double clip_scaled(const double sample, const double scale) {
+  return fmin(fmax(nearbyint(sample * scale), -scale), scale - 1.);
+}
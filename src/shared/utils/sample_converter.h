@@ -0,0 +1,49 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SAMPLE_CONVERTER_H
+#define SAMPLE_CONVERTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum SampleFormat {
+  SAMPLE_FORMAT_S16 = 0,
+  SAMPLE_FORMAT_S32 = 1,
+  SAMPLE_FORMAT_F64 = 2,
+} SampleFormat;
+
+// Processes planar float blocks of every channel
+typedef bool (*planar_processing)(void *instance, uint32_t number_of_frames,
+                                  const float *const *input, float **output);
+
+typedef struct SampleConverter SampleConverter;
+
+SampleConverter *sample_converter_initialize(uint32_t number_of_channels);
+void sample_converter_free(SampleConverter *self);
+// Converts interleaved samples of another format into planar float blocks
+// while deinterleaving them, processes each block and writes the result back
+// in the same format. Integer samples are scaled to [-1, 1) and output ones are
+// rounded and clipped to their range. Input and output can be the same buffer
+bool sample_converter_run(SampleConverter *self, uint32_t number_of_frames,
+                          SampleFormat format, const void *input, void *output,
+                          planar_processing processing, void *instance);
+
+#endif
@@ -19,6 +19,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "spectral_features.h"
+#include "memory_arena.h"
+#include "spectral_kernels.h"
 #include <math.h>
 #include <stdlib.h>
 
@@ -27,42 +29,43 @@ struct SpectralFeatures {
   float *phase_spectrum;
   float *magnitude_spectrum;
 
+  // Features already computed for the spectrum of the current hop
+  bool power_ready;
+  bool phase_ready;
+  bool magnitude_ready;
+
   uint32_t real_spectrum_size;
 };
 
 SpectralFeatures *
 spectral_features_initialize(const uint32_t real_spectrum_size) {
   SpectralFeatures *self =
-      (SpectralFeatures *)calloc(1U, sizeof(SpectralFeatures));
+      (SpectralFeatures *)spectral_calloc(1U, sizeof(SpectralFeatures));
 
   self->real_spectrum_size = real_spectrum_size;
 
   self->power_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->phase_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
   self->magnitude_spectrum =
-      (float *)calloc(self->real_spectrum_size, sizeof(float));
+      (float *)spectral_calloc(self->real_spectrum_size, sizeof(float));
 
   return self;
 }
 
 void spectral_features_free(SpectralFeatures *self) {
-  free(self->power_spectrum);
-  free(self->phase_spectrum);
-  free(self->magnitude_spectrum);
+  spectral_free(self->power_spectrum);
+  spectral_free(self->phase_spectrum);
+  spectral_free(self->magnitude_spectrum);
 
-  free(self);
+  spectral_free(self);
 }
 
-float *get_power_spectrum(SpectralFeatures *self) {
-  return self->power_spectrum;
-}
-float *get_magnitude_spectrum(SpectralFeatures *self) {
-  return self->magnitude_spectrum;
-}
-float *get_phase_spectrum(SpectralFeatures *self) {
-  return self->phase_spectrum;
+void spectral_features_invalidate(SpectralFeatures *self) {
+  self->power_ready = false;
+  self->phase_ready = false;
+  self->magnitude_ready = false;
 }
 
 static bool compute_power_spectrum(SpectralFeatures *self,
@@ -72,24 +75,9 @@ static bool compute_power_spectrum(SpectralFeatures *self,
     return false;
   }
 
-  float real_bin = fft_spectrum[0];
-
-  self->power_spectrum[0] = real_bin * real_bin;
-
-  for (uint32_t k = 1U; k < self->real_spectrum_size; k++) {
-    float power = 0.F;
-
-    real_bin = fft_spectrum[k];
-    float imag_bin = fft_spectrum[fft_spectrum_size - k];
-
-    if (k < self->real_spectrum_size) {
-      power = (real_bin * real_bin + imag_bin * imag_bin);
-    } else {
-      power = real_bin * real_bin;
-    }
-
-    self->power_spectrum[k] = power;
-  }
+  get_spectral_kernels()->power_spectrum(fft_spectrum, fft_spectrum_size,
+                                         self->real_spectrum_size,
+                                         self->power_spectrum);
 
   return true;
 }
@@ -152,28 +140,39 @@ static bool compute_phase_spectrum(SpectralFeatures *self,
   return true;
 }
 
-float *get_spectral_feature(SpectralFeatures *self, const float *fft_spectrum,
-                            uint32_t fft_spectrum_size, SpectrumType type) {
+const float *get_spectral_feature(SpectralFeatures *self,
+                                  const float *fft_spectrum,
+                                  uint32_t fft_spectrum_size,
+                                  SpectrumType type) {
   if (!self || !fft_spectrum || fft_spectrum_size <= 0U) {
     return NULL;
   }
 
   switch (type) {
   case POWER_SPECTRUM:
-    compute_power_spectrum(self, fft_spectrum, fft_spectrum_size);
-    return get_power_spectrum(self);
+    if (!self->power_ready) {
+      self->power_ready =
+          compute_power_spectrum(self, fft_spectrum, fft_spectrum_size);
+    }
+    return self->power_spectrum;
     break;
   case MAGNITUDE_SPECTRUM:
-    compute_magnitude_spectrum(self, fft_spectrum, fft_spectrum_size);
-    return get_magnitude_spectrum(self);
+    if (!self->magnitude_ready) {
+      self->magnitude_ready =
+          compute_magnitude_spectrum(self, fft_spectrum, fft_spectrum_size);
+    }
+    return self->magnitude_spectrum;
     break;
   case PHASE_SPECTRUM:
-    compute_phase_spectrum(self, fft_spectrum, fft_spectrum_size);
-    return get_phase_spectrum(self);
+    if (!self->phase_ready) {
+      self->phase_ready =
+          compute_phase_spectrum(self, fft_spectrum, fft_spectrum_size);
+    }
+    return self->phase_spectrum;
     break;
 
   default:
     return NULL;
     break;
   }
-}
\ No newline at end of file
+}
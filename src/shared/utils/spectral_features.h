@@ -34,7 +34,12 @@ typedef enum SpectrumType {
 
 SpectralFeatures *spectral_features_initialize(uint32_t real_spectrum_size);
 void spectral_features_free(SpectralFeatures *self);
-float *get_spectral_feature(SpectralFeatures *self, const float *fft_spectrum,
-                            uint32_t fft_spectrum_size, SpectrumType type);
+// Features are computed once per hop and shared by every stage asking for
+// them. Invalidate before querying the spectrum of a new hop
+void spectral_features_invalidate(SpectralFeatures *self);
+const float *get_spectral_feature(SpectralFeatures *self,
+                                  const float *fft_spectrum,
+                                  uint32_t fft_spectrum_size,
+                                  SpectrumType type);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,311 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spectral_kernels.h"
+#include "../configurations.h"
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+static void apply_window_scalar(float *frame, const float *window,
+                                const uint32_t frame_size) {
+  for (uint32_t k = 0U; k < frame_size; k++) {
+    frame[k] *= window[k];
+  }
+}
+
+static void accumulate_scalar(float *accumulator, const float *samples,
+                              const uint32_t number_of_samples) {
+  for (uint32_t k = 0U; k < number_of_samples; k++) {
+    accumulator[k] += samples[k];
+  }
+}
+
+static void apply_window_to_scalar(const float *frame, const float *window,
+                                   float *windowed_frame,
+                                   const uint32_t frame_size) {
+  for (uint32_t k = 0U; k < frame_size; k++) {
+    windowed_frame[k] = frame[k] * window[k];
+  }
+}
+
+static void accumulate_windowed_scalar(float *accumulator, const float *samples,
+                                       const float *window,
+                                       const uint32_t number_of_samples) {
+  for (uint32_t k = 0U; k < number_of_samples; k++) {
+    accumulator[k] += samples[k] * window[k];
+  }
+}
+
+static void accumulate_scaled_scalar(float *accumulator, const float *samples,
+                                     const float gain,
+                                     const uint32_t number_of_samples) {
+  for (uint32_t k = 0U; k < number_of_samples; k++) {
+    accumulator[k] += gain * samples[k];
+  }
+}
+
+static void fill_scalar(float *spectrum, const float value,
+                        const uint32_t spectrum_size) {
+  for (uint32_t k = 0U; k < spectrum_size; k++) {
+    spectrum[k] = value;
+  }
+}
+
+static void power_spectrum_scalar(const float *fft_spectrum,
+                                  const uint32_t fft_size,
+                                  const uint32_t real_spectrum_size,
+                                  float *power_spectrum) {
+  power_spectrum[0] = fft_spectrum[0] * fft_spectrum[0];
+
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    const float real_bin = fft_spectrum[k];
+    const float imag_bin = fft_spectrum[fft_size - k];
+
+    power_spectrum[k] = real_bin * real_bin + imag_bin * imag_bin;
+  }
+}
+
+static void wiener_gains_scalar(const float *spectrum,
+                                const float *noise_spectrum,
+                                const uint32_t real_spectrum_size,
+                                float *gain_spectrum) {
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    if (noise_spectrum[k] > FLT_MIN) {
+      if (spectrum[k] > noise_spectrum[k]) {
+        gain_spectrum[k] = (spectrum[k] - (noise_spectrum[k])) / spectrum[k];
+      } else {
+        gain_spectrum[k] = 0.F;
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static void power_subtraction_gains_scalar(
+    const float *spectrum, const float *noise_spectrum, const float *alpha,
+    const float *beta, const uint32_t real_spectrum_size,
+    float *gain_spectrum) {
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    if (spectrum[k] > FLT_MIN) {
+      const float ratio = noise_spectrum[k] / spectrum[k];
+      const float power_ratio = ratio * ratio;
+
+      if (power_ratio < (1.F / (alpha[k] + beta[k]))) {
+        gain_spectrum[k] = fmaxf(sqrtf(1.F - alpha[k] * power_ratio), 0.F);
+      } else {
+        gain_spectrum[k] = fmaxf(sqrtf(beta[k] * power_ratio), 0.F);
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static void split_residual_scalar(const float *fft_spectrum,
+                                  const float *gain_spectrum,
+                                  const uint32_t fft_size,
+                                  const uint32_t real_spectrum_size,
+                                  float *residual_spectrum) {
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    residual_spectrum[k] = fft_spectrum[k] - fft_spectrum[k] * gain_spectrum[k];
+  }
+
+  // Imaginary parts are stored backwards from the end
+  for (uint32_t k = 1U; k <= fft_size - real_spectrum_size; k++) {
+    const uint32_t position = fft_size - k;
+    residual_spectrum[position] =
+        fft_spectrum[position] - fft_spectrum[position] * gain_spectrum[k];
+  }
+}
+
+static void mix_residual_scalar(float *fft_spectrum, const float *gain_spectrum,
+                                const float *residual_spectrum,
+                                const float residual_level,
+                                const uint32_t fft_size,
+                                const uint32_t real_spectrum_size) {
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    fft_spectrum[k] = fft_spectrum[k] * gain_spectrum[k] +
+                      residual_spectrum[k] * residual_level;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  for (uint32_t k = 1U; k <= fft_size - real_spectrum_size; k++) {
+    const uint32_t position = fft_size - k;
+    fft_spectrum[position] = fft_spectrum[position] * gain_spectrum[k] +
+                             residual_spectrum[position] * residual_level;
+  }
+}
+
+static void apply_gains_scalar(float *fft_spectrum, const float *gain_spectrum,
+                               const float denoised_level,
+                               const float residual_level,
+                               const uint32_t fft_size,
+                               const uint32_t real_spectrum_size) {
+  const float level_difference = denoised_level - residual_level;
+
+  for (uint32_t k = 1U; k < real_spectrum_size; k++) {
+    fft_spectrum[k] *= residual_level + gain_spectrum[k] * level_difference;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  for (uint32_t k = 1U; k <= fft_size - real_spectrum_size; k++) {
+    fft_spectrum[fft_size - k] *=
+        residual_level + gain_spectrum[k] * level_difference;
+  }
+}
+
+static void whitening_scalar(float *fft_spectrum, float *residual_max_spectrum,
+                             const uint32_t fft_size,
+                             const float max_decay_rate,
+                             const float whitening_factor,
+                             const bool first_window) {
+  for (uint32_t k = 1U; k < fft_size; k++) {
+    if (!first_window) {
+      residual_max_spectrum[k] =
+          fmaxf(fmaxf(fft_spectrum[k], WHITENING_FLOOR),
+                residual_max_spectrum[k] * max_decay_rate);
+    } else {
+      residual_max_spectrum[k] = fmaxf(fft_spectrum[k], WHITENING_FLOOR);
+    }
+
+    if (fft_spectrum[k] > FLT_MIN) {
+      const float whitened_residual =
+          fft_spectrum[k] / residual_max_spectrum[k];
+
+      fft_spectrum[k] = (1.F - whitening_factor) * fft_spectrum[k] +
+                        whitening_factor * whitened_residual;
+    }
+  }
+}
+
+static void track_noise_scalar(const float *spectrum,
+                               const float *detection_thresholds,
+                               const NoiseTrackingState *previous,
+                               const NoiseTrackingState *current,
+                               float *noise_spectrum,
+                               const uint32_t spectrum_size) {
+  for (uint32_t k = 1U; k < spectrum_size; k++) {
+    const float smoothed = N_SMOOTH * previous->smoothed_spectrum[k] +
+                           (1.F - N_SMOOTH) * spectrum[k];
+
+    float minimum = smoothed;
+    if (previous->local_minimum_spectrum[k] < smoothed) {
+      minimum = GAMMA * previous->local_minimum_spectrum[k] +
+                ((1.F - GAMMA) / (1.F - BETA_AT)) *
+                    (smoothed - BETA_AT * previous->smoothed_spectrum[k]);
+    }
+
+    // Ratios that aren't finite or normal never count as speech
+    const float ratio = smoothed / minimum;
+    const float detected =
+        isnormal(ratio) && ratio > detection_thresholds[k] ? 1.F : 0.F;
+    const float probability =
+        ALPHA_P * previous->speech_presence_probability[k] +
+        (1.F - ALPHA_P) * detected;
+
+    const float smoothing = ALPHA_D + (1.F - ALPHA_D) * probability;
+    const float noise = smoothing * previous->noise_spectrum[k] +
+                        (1.F - smoothing) * spectrum[k];
+
+    current->smoothed_spectrum[k] = smoothed;
+    current->local_minimum_spectrum[k] = minimum;
+    current->speech_presence_probability[k] = probability;
+    current->noise_spectrum[k] = noise;
+    noise_spectrum[k] = noise;
+  }
+}
+
+static const SpectralKernels scalar_kernels = {
+    .name = "scalar",
+    .apply_window = &apply_window_scalar,
+    .accumulate = &accumulate_scalar,
+    .apply_window_to = &apply_window_to_scalar,
+    .accumulate_windowed = &accumulate_windowed_scalar,
+    .accumulate_scaled = &accumulate_scaled_scalar,
+    .fill = &fill_scalar,
+    .power_spectrum = &power_spectrum_scalar,
+    .wiener_gains = &wiener_gains_scalar,
+    .power_subtraction_gains = &power_subtraction_gains_scalar,
+    .split_residual = &split_residual_scalar,
+    .mix_residual = &mix_residual_scalar,
+    .apply_gains = &apply_gains_scalar,
+    .whitening = &whitening_scalar,
+    .track_noise = &track_noise_scalar,
+};
+
+const SpectralKernels *get_scalar_spectral_kernels(void) {
+  return &scalar_kernels;
+}
+
+static const SpectralKernels *cpu_kernels = NULL;
+static const SpectralKernels *selected_kernels = NULL;
+static pthread_once_t kernels_selection = PTHREAD_ONCE_INIT;
+
+static void select_spectral_kernels(void) {
+  const SpectralKernels *kernels = NULL;
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+  // Checks cpuid and that the operating system saves the wider registers
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    kernels = get_avx512_spectral_kernels();
+  }
+  if (!kernels && __builtin_cpu_supports("avx2")) {
+    kernels = get_avx2_spectral_kernels();
+  }
+  if (!kernels && __builtin_cpu_supports("sse2")) {
+    kernels = get_sse2_spectral_kernels();
+  }
+#elif defined(__aarch64__) && defined(__linux__)
+  if (getauxval(AT_HWCAP) & HWCAP_ASIMD) {
+    kernels = get_neon_spectral_kernels();
+  }
+#else
+  kernels = get_neon_spectral_kernels();
+#endif
+
+  cpu_kernels = kernels ? kernels : &scalar_kernels;
+  selected_kernels = cpu_kernels;
+}
+
+void spectral_kernels_initialize(void) {
+  pthread_once(&kernels_selection, &select_spectral_kernels);
+}
+
+const SpectralKernels *get_spectral_kernels(void) {
+  // Only an atomic check once the kernels were selected
+  spectral_kernels_initialize();
+
+  return selected_kernels;
+}
+
+void set_spectral_kernels(const SpectralKernels *kernels) {
+  spectral_kernels_initialize();
+
+  selected_kernels = kernels ? kernels : cpu_kernels;
+}
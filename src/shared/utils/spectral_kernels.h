@@ -0,0 +1,109 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPECTRAL_KERNELS_H
+#define SPECTRAL_KERNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per bin loops of the processing path. The scalar kernels are the reference
+// implementation and the vectorized ones must give the same results. Spectra
+// use the FFTW halfcomplex layout while gains only cover the real half, so the
+// ones applying them read gains backwards for the imaginary parts. Every loop
+// skips the DC bin as the scalar code always did
+// One frame of the per bin state of the adaptive noise estimator. The
+// estimator keeps two of them and swaps them every frame
+typedef struct NoiseTrackingState {
+  float *smoothed_spectrum;
+  float *local_minimum_spectrum;
+  float *speech_presence_probability;
+  float *noise_spectrum;
+} NoiseTrackingState;
+
+typedef struct SpectralKernels {
+  const char *name;
+
+  void (*apply_window)(float *frame, const float *window, uint32_t frame_size);
+  void (*accumulate)(float *accumulator, const float *samples,
+                     uint32_t number_of_samples);
+  // Fused variants that window while copying or while overlap-adding
+  void (*apply_window_to)(const float *frame, const float *window,
+                          float *windowed_frame, uint32_t frame_size);
+  void (*accumulate_windowed)(float *accumulator, const float *samples,
+                              const float *window, uint32_t number_of_samples);
+  // Adds samples multiplied by a constant, as in a diagonal of a convolution
+  void (*accumulate_scaled)(float *accumulator, const float *samples,
+                            float gain, uint32_t number_of_samples);
+  // Writes a constant, as when expanding band values to their bins
+  void (*fill)(float *spectrum, float value, uint32_t spectrum_size);
+  void (*power_spectrum)(const float *fft_spectrum, uint32_t fft_size,
+                         uint32_t real_spectrum_size, float *power_spectrum);
+  void (*wiener_gains)(const float *spectrum, const float *noise_spectrum,
+                       uint32_t real_spectrum_size, float *gain_spectrum);
+  // Generalized spectral subtraction with an exponent of 2
+  void (*power_subtraction_gains)(const float *spectrum,
+                                  const float *noise_spectrum,
+                                  const float *alpha, const float *beta,
+                                  uint32_t real_spectrum_size,
+                                  float *gain_spectrum);
+  // The two passes used when the residual is processed on its own. The first
+  // writes the bins times one minus their gain, the second mixes the denoised
+  // bins in place with the processed residual times its level
+  void (*split_residual)(const float *fft_spectrum, const float *gain_spectrum,
+                         uint32_t fft_size, uint32_t real_spectrum_size,
+                         float *residual_spectrum);
+  void (*mix_residual)(float *fft_spectrum, const float *gain_spectrum,
+                       const float *residual_spectrum, float residual_level,
+                       uint32_t fft_size, uint32_t real_spectrum_size);
+  // Splits and mixes in place in one pass. Each bin is scaled by its gain
+  // times the denoised level plus the rest times the residual level
+  void (*apply_gains)(float *fft_spectrum, const float *gain_spectrum,
+                      float denoised_level, float residual_level,
+                      uint32_t fft_size, uint32_t real_spectrum_size);
+  void (*whitening)(float *fft_spectrum, float *residual_max_spectrum,
+                    uint32_t fft_size, float max_decay_rate,
+                    float whitening_factor, bool first_window);
+  // Minimum tracking noise estimation of a frame from the previous state. The
+  // estimate is also written to noise_spectrum
+  void (*track_noise)(const float *spectrum, const float *detection_thresholds,
+                      const NoiseTrackingState *previous,
+                      const NoiseTrackingState *current, float *noise_spectrum,
+                      uint32_t spectrum_size);
+} SpectralKernels;
+
+// Selects the fastest kernels supported by the running cpu. Processors call it
+// on initialization so the cpu is only queried outside of processing
+void spectral_kernels_initialize(void);
+// Returns the selected kernels, selecting them first if needed
+const SpectralKernels *get_spectral_kernels(void);
+const SpectralKernels *get_scalar_spectral_kernels(void);
+// Overrides the selected kernels, or restores the ones of the cpu when NULL,
+// as when validating the vectorized kernels against the scalar ones. It must
+// not be called while anything is processing
+void set_spectral_kernels(const SpectralKernels *kernels);
+
+// Vectorized variants. They return NULL when not built for the target
+const SpectralKernels *get_sse2_spectral_kernels(void);
+const SpectralKernels *get_avx2_spectral_kernels(void);
+const SpectralKernels *get_avx512_spectral_kernels(void);
+const SpectralKernels *get_neon_spectral_kernels(void);
+
+#endif
@@ -0,0 +1,560 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spectral_kernels.h"
+#include <stddef.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#include "../configurations.h"
+#include <float.h>
+#include <math.h>
+
+// AVX-512 implies FMA, which would fuse multiplies and additions and round
+// differently than the other kernels
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#define TARGET __attribute__((target("avx512f")))
+#else
+#define TARGET                                                                 \
+  __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#endif
+#define LANES 16U
+
+// Lets halfcomplex spectra be read and written backwards from the end
+static inline TARGET __m512 reverse(const __m512 vector) {
+  const __m512i indices = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                            5, 4, 3, 2, 1, 0);
+
+  return _mm512_permutexvar_ps(indices, vector);
+}
+
+static inline TARGET __m512 blend(const __mmask16 mask, const __m512 a,
+                                  const __m512 b) {
+  return _mm512_mask_blend_ps(mask, b, a);
+}
+
+static inline TARGET __mmask16 greater(const __m512 a, const __m512 b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+}
+
+static inline TARGET __mmask16 less(const __m512 a, const __m512 b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+}
+
+static TARGET void apply_window(float *frame, const float *window,
+                                const uint32_t frame_size) {
+  uint32_t k = 0U;
+  for (; k + LANES <= frame_size; k += LANES) {
+    const __m512 frame_samples = _mm512_loadu_ps(&frame[k]);
+    const __m512 window_samples = _mm512_loadu_ps(&window[k]);
+
+    _mm512_storeu_ps(&frame[k], _mm512_mul_ps(frame_samples, window_samples));
+  }
+
+  for (; k < frame_size; k++) {
+    frame[k] *= window[k];
+  }
+}
+
+static TARGET void accumulate(float *accumulator, const float *samples,
+                              const uint32_t number_of_samples) {
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const __m512 accumulated = _mm512_loadu_ps(&accumulator[k]);
+    const __m512 new_samples = _mm512_loadu_ps(&samples[k]);
+
+    _mm512_storeu_ps(&accumulator[k],
+                     _mm512_add_ps(accumulated, new_samples));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += samples[k];
+  }
+}
+
+static TARGET void apply_window_to(const float *frame, const float *window,
+                                   float *windowed_frame,
+                                   const uint32_t frame_size) {
+  uint32_t k = 0U;
+  for (; k + LANES <= frame_size; k += LANES) {
+    const __m512 frame_samples = _mm512_loadu_ps(&frame[k]);
+    const __m512 window_samples = _mm512_loadu_ps(&window[k]);
+
+    _mm512_storeu_ps(&windowed_frame[k],
+                     _mm512_mul_ps(frame_samples, window_samples));
+  }
+
+  for (; k < frame_size; k++) {
+    windowed_frame[k] = frame[k] * window[k];
+  }
+}
+
+static TARGET void accumulate_windowed(float *accumulator, const float *samples,
+                                       const float *window,
+                                       const uint32_t number_of_samples) {
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const __m512 accumulated = _mm512_loadu_ps(&accumulator[k]);
+    const __m512 new_samples = _mm512_loadu_ps(&samples[k]);
+    const __m512 window_samples = _mm512_loadu_ps(&window[k]);
+    const __m512 windowed = _mm512_mul_ps(new_samples, window_samples);
+
+    _mm512_storeu_ps(&accumulator[k], _mm512_add_ps(accumulated, windowed));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += samples[k] * window[k];
+  }
+}
+
+static TARGET void accumulate_scaled(float *accumulator, const float *samples,
+                                     const float gain,
+                                     const uint32_t number_of_samples) {
+  const __m512 scale = _mm512_set1_ps(gain);
+
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const __m512 accumulated = _mm512_loadu_ps(&accumulator[k]);
+    const __m512 new_samples = _mm512_loadu_ps(&samples[k]);
+    const __m512 scaled = _mm512_mul_ps(scale, new_samples);
+
+    _mm512_storeu_ps(&accumulator[k], _mm512_add_ps(accumulated, scaled));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += gain * samples[k];
+  }
+}
+
+static TARGET void fill(float *spectrum, const float value,
+                        const uint32_t spectrum_size) {
+  const __m512 values = _mm512_set1_ps(value);
+
+  uint32_t k = 0U;
+  for (; k + LANES <= spectrum_size; k += LANES) {
+    _mm512_storeu_ps(&spectrum[k], values);
+  }
+
+  for (; k < spectrum_size; k++) {
+    spectrum[k] = value;
+  }
+}
+
+static TARGET void power_spectrum(const float *fft_spectrum,
+                                  const uint32_t fft_size,
+                                  const uint32_t real_spectrum_size,
+                                  float *power_spectrum) {
+  power_spectrum[0] = fft_spectrum[0] * fft_spectrum[0];
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 real_bins = _mm512_loadu_ps(&fft_spectrum[k]);
+    const __m512 imag_bins =
+        reverse(_mm512_loadu_ps(&fft_spectrum[fft_size - k - (LANES - 1U)]));
+
+    const __m512 real_power = _mm512_mul_ps(real_bins, real_bins);
+    const __m512 imag_power = _mm512_mul_ps(imag_bins, imag_bins);
+
+    _mm512_storeu_ps(&power_spectrum[k], _mm512_add_ps(real_power, imag_power));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    const float real_bin = fft_spectrum[k];
+    const float imag_bin = fft_spectrum[fft_size - k];
+
+    power_spectrum[k] = real_bin * real_bin + imag_bin * imag_bin;
+  }
+}
+
+static TARGET void wiener_gains(const float *spectrum,
+                                const float *noise_spectrum,
+                                const uint32_t real_spectrum_size,
+                                float *gain_spectrum) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.F);
+  const __m512 minimum = _mm512_set1_ps(FLT_MIN);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 signal = _mm512_loadu_ps(&spectrum[k]);
+    const __m512 noise = _mm512_loadu_ps(&noise_spectrum[k]);
+
+    const __m512 subtracted =
+        _mm512_div_ps(_mm512_sub_ps(signal, noise), signal);
+    const __m512 gain = blend(greater(signal, noise), subtracted, zero);
+
+    _mm512_storeu_ps(&gain_spectrum[k],
+                     blend(greater(noise, minimum), gain, one));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    if (noise_spectrum[k] > FLT_MIN) {
+      if (spectrum[k] > noise_spectrum[k]) {
+        gain_spectrum[k] = (spectrum[k] - (noise_spectrum[k])) / spectrum[k];
+      } else {
+        gain_spectrum[k] = 0.F;
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static TARGET void power_subtraction_gains(
+    const float *spectrum, const float *noise_spectrum, const float *alpha,
+    const float *beta, const uint32_t real_spectrum_size,
+    float *gain_spectrum) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.F);
+  const __m512 minimum = _mm512_set1_ps(FLT_MIN);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 signal = _mm512_loadu_ps(&spectrum[k]);
+    const __m512 alphas = _mm512_loadu_ps(&alpha[k]);
+    const __m512 betas = _mm512_loadu_ps(&beta[k]);
+    const __m512 noise = _mm512_loadu_ps(&noise_spectrum[k]);
+    const __m512 ratio = _mm512_div_ps(noise, signal);
+    const __m512 power_ratio = _mm512_mul_ps(ratio, ratio);
+
+    // Square roots of negative values give NaN which max replaces with zero
+    const __m512 subtracted = _mm512_max_ps(
+        _mm512_sqrt_ps(_mm512_sub_ps(one, _mm512_mul_ps(alphas, power_ratio))),
+        zero);
+    const __m512 floored =
+        _mm512_max_ps(_mm512_sqrt_ps(_mm512_mul_ps(betas, power_ratio)), zero);
+    const __m512 threshold = _mm512_div_ps(one, _mm512_add_ps(alphas, betas));
+    const __m512 gain =
+        blend(less(power_ratio, threshold), subtracted, floored);
+
+    _mm512_storeu_ps(&gain_spectrum[k],
+                     blend(greater(signal, minimum), gain, one));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    if (spectrum[k] > FLT_MIN) {
+      const float ratio = noise_spectrum[k] / spectrum[k];
+      const float power_ratio = ratio * ratio;
+
+      if (power_ratio < (1.F / (alpha[k] + beta[k]))) {
+        gain_spectrum[k] = fmaxf(sqrtf(1.F - alpha[k] * power_ratio), 0.F);
+      } else {
+        gain_spectrum[k] = fmaxf(sqrtf(beta[k] * power_ratio), 0.F);
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static TARGET void split_residual(const float *fft_spectrum,
+                                  const float *gain_spectrum,
+                                  const uint32_t fft_size,
+                                  const uint32_t real_spectrum_size,
+                                  float *residual_spectrum) {
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[k]);
+    const __m512 gains = _mm512_loadu_ps(&gain_spectrum[k]);
+    const __m512 denoised = _mm512_mul_ps(bins, gains);
+
+    _mm512_storeu_ps(&residual_spectrum[k], _mm512_sub_ps(bins, denoised));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    residual_spectrum[k] = fft_spectrum[k] - fft_spectrum[k] * gain_spectrum[k];
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[position]);
+    const __m512 gains = reverse(_mm512_loadu_ps(&gain_spectrum[k]));
+    const __m512 denoised = _mm512_mul_ps(bins, gains);
+    const __m512 residual = _mm512_sub_ps(bins, denoised);
+
+    _mm512_storeu_ps(&residual_spectrum[position], residual);
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    const uint32_t position = fft_size - k;
+    residual_spectrum[position] =
+        fft_spectrum[position] - fft_spectrum[position] * gain_spectrum[k];
+  }
+}
+
+static TARGET void mix_residual(float *fft_spectrum,
+                                const float *gain_spectrum,
+                                const float *residual_spectrum,
+                                const float residual_level,
+                                const uint32_t fft_size,
+                                const uint32_t real_spectrum_size) {
+  const __m512 level = _mm512_set1_ps(residual_level);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[k]);
+    const __m512 gains = _mm512_loadu_ps(&gain_spectrum[k]);
+    const __m512 residual =
+        _mm512_mul_ps(_mm512_loadu_ps(&residual_spectrum[k]), level);
+    const __m512 mixed = _mm512_add_ps(_mm512_mul_ps(bins, gains), residual);
+
+    _mm512_storeu_ps(&fft_spectrum[k], mixed);
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    fft_spectrum[k] = fft_spectrum[k] * gain_spectrum[k] +
+                      residual_spectrum[k] * residual_level;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[position]);
+    const __m512 gains = reverse(_mm512_loadu_ps(&gain_spectrum[k]));
+    const __m512 residual =
+        _mm512_mul_ps(_mm512_loadu_ps(&residual_spectrum[position]), level);
+    const __m512 mixed = _mm512_add_ps(_mm512_mul_ps(bins, gains), residual);
+
+    _mm512_storeu_ps(&fft_spectrum[position], mixed);
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    const uint32_t position = fft_size - k;
+    fft_spectrum[position] = fft_spectrum[position] * gain_spectrum[k] +
+                             residual_spectrum[position] * residual_level;
+  }
+}
+
+static TARGET void apply_gains(float *fft_spectrum,
+                               const float *gain_spectrum,
+                               const float denoised_level,
+                               const float residual_level,
+                               const uint32_t fft_size,
+                               const uint32_t real_spectrum_size) {
+  const __m512 residual = _mm512_set1_ps(residual_level);
+  const __m512 difference = _mm512_set1_ps(denoised_level - residual_level);
+  const float level_difference = denoised_level - residual_level;
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const __m512 gains = _mm512_loadu_ps(&gain_spectrum[k]);
+    const __m512 levels =
+        _mm512_add_ps(residual, _mm512_mul_ps(gains, difference));
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[k]);
+
+    _mm512_storeu_ps(&fft_spectrum[k], _mm512_mul_ps(bins, levels));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    fft_spectrum[k] *= residual_level + gain_spectrum[k] * level_difference;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const __m512 gains = reverse(_mm512_loadu_ps(&gain_spectrum[k]));
+    const __m512 levels =
+        _mm512_add_ps(residual, _mm512_mul_ps(gains, difference));
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[position]);
+
+    _mm512_storeu_ps(&fft_spectrum[position], _mm512_mul_ps(bins, levels));
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    fft_spectrum[fft_size - k] *=
+        residual_level + gain_spectrum[k] * level_difference;
+  }
+}
+
+static TARGET void whitening(float *fft_spectrum, float *residual_max_spectrum,
+                             const uint32_t fft_size,
+                             const float max_decay_rate,
+                             const float whitening_factor,
+                             const bool first_window) {
+  const __m512 whitening_floor = _mm512_set1_ps(WHITENING_FLOOR);
+  const __m512 minimum = _mm512_set1_ps(FLT_MIN);
+  const __m512 decay = _mm512_set1_ps(first_window ? 0.F : max_decay_rate);
+  const __m512 factor = _mm512_set1_ps(whitening_factor);
+  const __m512 complement = _mm512_set1_ps(1.F - whitening_factor);
+
+  // Maximums are positive so a zero decay restarts them on the first window
+  uint32_t k = 1U;
+  for (; k + LANES <= fft_size; k += LANES) {
+    const __m512 bins = _mm512_loadu_ps(&fft_spectrum[k]);
+    const __m512 decayed =
+        _mm512_mul_ps(_mm512_loadu_ps(&residual_max_spectrum[k]), decay);
+    const __m512 maximum =
+        _mm512_max_ps(_mm512_max_ps(bins, whitening_floor), decayed);
+    const __m512 whitened =
+        _mm512_add_ps(_mm512_mul_ps(complement, bins),
+                   _mm512_mul_ps(factor, _mm512_div_ps(bins, maximum)));
+
+    _mm512_storeu_ps(&residual_max_spectrum[k], maximum);
+    _mm512_storeu_ps(&fft_spectrum[k],
+                  blend(greater(bins, minimum), whitened, bins));
+  }
+
+  for (; k < fft_size; k++) {
+    if (!first_window) {
+      residual_max_spectrum[k] =
+          fmaxf(fmaxf(fft_spectrum[k], WHITENING_FLOOR),
+                residual_max_spectrum[k] * max_decay_rate);
+    } else {
+      residual_max_spectrum[k] = fmaxf(fft_spectrum[k], WHITENING_FLOOR);
+    }
+
+    if (fft_spectrum[k] > FLT_MIN) {
+      const float whitened_residual =
+          fft_spectrum[k] / residual_max_spectrum[k];
+
+      fft_spectrum[k] = (1.F - whitening_factor) * fft_spectrum[k] +
+                        whitening_factor * whitened_residual;
+    }
+  }
+}
+
+static TARGET void track_noise(const float *spectrum,
+                               const float *detection_thresholds,
+                               const NoiseTrackingState *previous,
+                               const NoiseTrackingState *current,
+                               float *noise_spectrum,
+                               const uint32_t spectrum_size) {
+  const __m512 smooth = _mm512_set1_ps(N_SMOOTH);
+  const __m512 smooth_complement = _mm512_set1_ps(1.F - N_SMOOTH);
+  const __m512 gamma = _mm512_set1_ps(GAMMA);
+  const __m512 rise = _mm512_set1_ps((1.F - GAMMA) / (1.F - BETA_AT));
+  const __m512 beta = _mm512_set1_ps(BETA_AT);
+  const __m512 alpha_p = _mm512_set1_ps(ALPHA_P);
+  const __m512 presence = _mm512_set1_ps(1.F - ALPHA_P);
+  const __m512 alpha_d = _mm512_set1_ps(ALPHA_D);
+  const __m512 alpha_d_complement = _mm512_set1_ps(1.F - ALPHA_D);
+  const __m512 one = _mm512_set1_ps(1.F);
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 infinity = _mm512_set1_ps(INFINITY);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= spectrum_size; k += LANES) {
+    const __m512 bins = _mm512_loadu_ps(&spectrum[k]);
+    const __m512 last_smoothed =
+        _mm512_loadu_ps(&previous->smoothed_spectrum[k]);
+    const __m512 last_minimum =
+        _mm512_loadu_ps(&previous->local_minimum_spectrum[k]);
+    const __m512 last_probability =
+        _mm512_loadu_ps(&previous->speech_presence_probability[k]);
+    const __m512 last_noise = _mm512_loadu_ps(&previous->noise_spectrum[k]);
+
+    const __m512 smoothed =
+        _mm512_add_ps(_mm512_mul_ps(smooth, last_smoothed),
+                      _mm512_mul_ps(smooth_complement, bins));
+    const __m512 increase =
+        _mm512_sub_ps(smoothed, _mm512_mul_ps(beta, last_smoothed));
+    const __m512 tracked_minimum =
+        _mm512_add_ps(_mm512_mul_ps(gamma, last_minimum),
+                      _mm512_mul_ps(rise, increase));
+    const __m512 minimum =
+        blend(less(last_minimum, smoothed), tracked_minimum, smoothed);
+
+    // Ratios that aren't finite never count as speech, as in the scalar code
+    const __m512 ratio = _mm512_div_ps(smoothed, minimum);
+    const __m512 thresholds = _mm512_loadu_ps(&detection_thresholds[k]);
+    const __m512 detected = blend(greater(ratio, thresholds),
+                                  blend(less(ratio, infinity), presence, zero),
+                                  zero);
+    const __m512 probability =
+        _mm512_add_ps(_mm512_mul_ps(alpha_p, last_probability), detected);
+
+    const __m512 smoothing =
+        _mm512_add_ps(alpha_d, _mm512_mul_ps(alpha_d_complement, probability));
+    const __m512 noise =
+        _mm512_add_ps(_mm512_mul_ps(smoothing, last_noise),
+                      _mm512_mul_ps(_mm512_sub_ps(one, smoothing), bins));
+
+    _mm512_storeu_ps(&current->smoothed_spectrum[k], smoothed);
+    _mm512_storeu_ps(&current->local_minimum_spectrum[k], minimum);
+    _mm512_storeu_ps(&current->speech_presence_probability[k], probability);
+    _mm512_storeu_ps(&current->noise_spectrum[k], noise);
+    _mm512_storeu_ps(&noise_spectrum[k], noise);
+  }
+
+  for (; k < spectrum_size; k++) {
+    const float smoothed = N_SMOOTH * previous->smoothed_spectrum[k] +
+                           (1.F - N_SMOOTH) * spectrum[k];
+
+    float minimum = smoothed;
+    if (previous->local_minimum_spectrum[k] < smoothed) {
+      minimum = GAMMA * previous->local_minimum_spectrum[k] +
+                ((1.F - GAMMA) / (1.F - BETA_AT)) *
+                    (smoothed - BETA_AT * previous->smoothed_spectrum[k]);
+    }
+
+    const float ratio = smoothed / minimum;
+    const float detected =
+        isnormal(ratio) && ratio > detection_thresholds[k] ? 1.F : 0.F;
+    const float probability =
+        ALPHA_P * previous->speech_presence_probability[k] +
+        (1.F - ALPHA_P) * detected;
+
+    const float smoothing = ALPHA_D + (1.F - ALPHA_D) * probability;
+    const float noise = smoothing * previous->noise_spectrum[k] +
+                        (1.F - smoothing) * spectrum[k];
+
+    current->smoothed_spectrum[k] = smoothed;
+    current->local_minimum_spectrum[k] = minimum;
+    current->speech_presence_probability[k] = probability;
+    current->noise_spectrum[k] = noise;
+    noise_spectrum[k] = noise;
+  }
+}
+
+static const SpectralKernels avx512_kernels = {
+    .name = "avx512",
+    .apply_window = &apply_window,
+    .accumulate = &accumulate,
+    .apply_window_to = &apply_window_to,
+    .accumulate_windowed = &accumulate_windowed,
+    .accumulate_scaled = &accumulate_scaled,
+    .fill = &fill,
+    .power_spectrum = &power_spectrum,
+    .wiener_gains = &wiener_gains,
+    .power_subtraction_gains = &power_subtraction_gains,
+    .split_residual = &split_residual,
+    .mix_residual = &mix_residual,
+    .apply_gains = &apply_gains,
+    .whitening = &whitening,
+    .track_noise = &track_noise,
+};
+
+const SpectralKernels *get_avx512_spectral_kernels(void) {
+  return &avx512_kernels;
+}
+
+#else
+
+const SpectralKernels *get_avx512_spectral_kernels(void) { return NULL; }
+
+#endif
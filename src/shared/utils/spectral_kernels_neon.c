@@ -0,0 +1,537 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spectral_kernels.h"
+#include <stddef.h>
+
+// Division and square roots are only vectorized by AArch64 NEON
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#include "../configurations.h"
+#include <float.h>
+#include <math.h>
+
+#define LANES 4U
+
+// Lets halfcomplex spectra be read and written backwards from the end
+static inline float32x4_t reverse(const float32x4_t vector) {
+  const float32x4_t swapped = vrev64q_f32(vector);
+
+  return vcombine_f32(vget_high_f32(swapped), vget_low_f32(swapped));
+}
+
+static inline float32x4_t blend(const uint32x4_t mask, const float32x4_t a,
+                                const float32x4_t b) {
+  return vbslq_f32(mask, a, b);
+}
+
+static inline uint32x4_t greater(const float32x4_t a, const float32x4_t b) {
+  return vcgtq_f32(a, b);
+}
+
+static inline uint32x4_t less(const float32x4_t a, const float32x4_t b) {
+  return vcltq_f32(a, b);
+}
+
+static void apply_window(float *frame, const float *window,
+                         const uint32_t frame_size) {
+  uint32_t k = 0U;
+  for (; k + LANES <= frame_size; k += LANES) {
+    const float32x4_t frame_samples = vld1q_f32(&frame[k]);
+    const float32x4_t window_samples = vld1q_f32(&window[k]);
+
+    vst1q_f32(&frame[k], vmulq_f32(frame_samples, window_samples));
+  }
+
+  for (; k < frame_size; k++) {
+    frame[k] *= window[k];
+  }
+}
+
+static void accumulate(float *accumulator, const float *samples,
+                       const uint32_t number_of_samples) {
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const float32x4_t accumulated = vld1q_f32(&accumulator[k]);
+    const float32x4_t new_samples = vld1q_f32(&samples[k]);
+
+    vst1q_f32(&accumulator[k], vaddq_f32(accumulated, new_samples));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += samples[k];
+  }
+}
+
+static void apply_window_to(const float *frame, const float *window,
+                            float *windowed_frame, const uint32_t frame_size) {
+  uint32_t k = 0U;
+  for (; k + LANES <= frame_size; k += LANES) {
+    const float32x4_t frame_samples = vld1q_f32(&frame[k]);
+    const float32x4_t window_samples = vld1q_f32(&window[k]);
+
+    vst1q_f32(&windowed_frame[k], vmulq_f32(frame_samples, window_samples));
+  }
+
+  for (; k < frame_size; k++) {
+    windowed_frame[k] = frame[k] * window[k];
+  }
+}
+
+static void accumulate_windowed(float *accumulator, const float *samples,
+                                const float *window,
+                                const uint32_t number_of_samples) {
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const float32x4_t accumulated = vld1q_f32(&accumulator[k]);
+    const float32x4_t new_samples = vld1q_f32(&samples[k]);
+    const float32x4_t window_samples = vld1q_f32(&window[k]);
+    const float32x4_t windowed = vmulq_f32(new_samples, window_samples);
+
+    vst1q_f32(&accumulator[k], vaddq_f32(accumulated, windowed));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += samples[k] * window[k];
+  }
+}
+
+static void accumulate_scaled(float *accumulator, const float *samples,
+                              const float gain,
+                              const uint32_t number_of_samples) {
+  const float32x4_t scale = vdupq_n_f32(gain);
+
+  uint32_t k = 0U;
+  for (; k + LANES <= number_of_samples; k += LANES) {
+    const float32x4_t accumulated = vld1q_f32(&accumulator[k]);
+    const float32x4_t new_samples = vld1q_f32(&samples[k]);
+    const float32x4_t scaled = vmulq_f32(scale, new_samples);
+
+    vst1q_f32(&accumulator[k], vaddq_f32(accumulated, scaled));
+  }
+
+  for (; k < number_of_samples; k++) {
+    accumulator[k] += gain * samples[k];
+  }
+}
+
+static void fill(float *spectrum, const float value,
+                 const uint32_t spectrum_size) {
+  const float32x4_t values = vdupq_n_f32(value);
+
+  uint32_t k = 0U;
+  for (; k + LANES <= spectrum_size; k += LANES) {
+    vst1q_f32(&spectrum[k], values);
+  }
+
+  for (; k < spectrum_size; k++) {
+    spectrum[k] = value;
+  }
+}
+
+static void power_spectrum(const float *fft_spectrum, const uint32_t fft_size,
+                           const uint32_t real_spectrum_size,
+                           float *power_spectrum) {
+  power_spectrum[0] = fft_spectrum[0] * fft_spectrum[0];
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t real_bins = vld1q_f32(&fft_spectrum[k]);
+    const float32x4_t imag_bins =
+        reverse(vld1q_f32(&fft_spectrum[fft_size - k - (LANES - 1U)]));
+
+    const float32x4_t real_power = vmulq_f32(real_bins, real_bins);
+    const float32x4_t imag_power = vmulq_f32(imag_bins, imag_bins);
+
+    vst1q_f32(&power_spectrum[k], vaddq_f32(real_power, imag_power));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    const float real_bin = fft_spectrum[k];
+    const float imag_bin = fft_spectrum[fft_size - k];
+
+    power_spectrum[k] = real_bin * real_bin + imag_bin * imag_bin;
+  }
+}
+
+static void wiener_gains(const float *spectrum, const float *noise_spectrum,
+                         const uint32_t real_spectrum_size,
+                         float *gain_spectrum) {
+  const float32x4_t zero = vdupq_n_f32(0.F);
+  const float32x4_t one = vdupq_n_f32(1.F);
+  const float32x4_t minimum = vdupq_n_f32(FLT_MIN);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t signal = vld1q_f32(&spectrum[k]);
+    const float32x4_t noise = vld1q_f32(&noise_spectrum[k]);
+
+    const float32x4_t subtracted =
+        vdivq_f32(vsubq_f32(signal, noise), signal);
+    const float32x4_t gain = blend(greater(signal, noise), subtracted, zero);
+
+    vst1q_f32(&gain_spectrum[k], blend(greater(noise, minimum), gain, one));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    if (noise_spectrum[k] > FLT_MIN) {
+      if (spectrum[k] > noise_spectrum[k]) {
+        gain_spectrum[k] = (spectrum[k] - (noise_spectrum[k])) / spectrum[k];
+      } else {
+        gain_spectrum[k] = 0.F;
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static void power_subtraction_gains(
+    const float *spectrum, const float *noise_spectrum, const float *alpha,
+    const float *beta, const uint32_t real_spectrum_size,
+    float *gain_spectrum) {
+  const float32x4_t zero = vdupq_n_f32(0.F);
+  const float32x4_t one = vdupq_n_f32(1.F);
+  const float32x4_t minimum = vdupq_n_f32(FLT_MIN);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t signal = vld1q_f32(&spectrum[k]);
+    const float32x4_t alphas = vld1q_f32(&alpha[k]);
+    const float32x4_t betas = vld1q_f32(&beta[k]);
+    const float32x4_t ratio = vdivq_f32(vld1q_f32(&noise_spectrum[k]), signal);
+    const float32x4_t power_ratio = vmulq_f32(ratio, ratio);
+
+    // Square roots of negative values give NaN which max replaces with zero
+    const float32x4_t subtracted = vmaxnmq_f32(
+        vsqrtq_f32(vsubq_f32(one, vmulq_f32(alphas, power_ratio))), zero);
+    const float32x4_t floored =
+        vmaxnmq_f32(vsqrtq_f32(vmulq_f32(betas, power_ratio)), zero);
+    const float32x4_t threshold = vdivq_f32(one, vaddq_f32(alphas, betas));
+    const float32x4_t gain =
+        blend(less(power_ratio, threshold), subtracted, floored);
+
+    vst1q_f32(&gain_spectrum[k], blend(greater(signal, minimum), gain, one));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    if (spectrum[k] > FLT_MIN) {
+      const float ratio = noise_spectrum[k] / spectrum[k];
+      const float power_ratio = ratio * ratio;
+
+      if (power_ratio < (1.F / (alpha[k] + beta[k]))) {
+        gain_spectrum[k] = fmaxf(sqrtf(1.F - alpha[k] * power_ratio), 0.F);
+      } else {
+        gain_spectrum[k] = fmaxf(sqrtf(beta[k] * power_ratio), 0.F);
+      }
+    } else {
+      gain_spectrum[k] = 1.F;
+    }
+  }
+}
+
+static void split_residual(const float *fft_spectrum,
+                           const float *gain_spectrum,
+                           const uint32_t fft_size,
+                           const uint32_t real_spectrum_size,
+                           float *residual_spectrum) {
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[k]);
+    const float32x4_t gains = vld1q_f32(&gain_spectrum[k]);
+    const float32x4_t denoised = vmulq_f32(bins, gains);
+
+    vst1q_f32(&residual_spectrum[k], vsubq_f32(bins, denoised));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    residual_spectrum[k] = fft_spectrum[k] - fft_spectrum[k] * gain_spectrum[k];
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[position]);
+    const float32x4_t gains = reverse(vld1q_f32(&gain_spectrum[k]));
+    const float32x4_t denoised = vmulq_f32(bins, gains);
+
+    vst1q_f32(&residual_spectrum[position], vsubq_f32(bins, denoised));
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    const uint32_t position = fft_size - k;
+    residual_spectrum[position] =
+        fft_spectrum[position] - fft_spectrum[position] * gain_spectrum[k];
+  }
+}
+
+static void mix_residual(float *fft_spectrum,
+                         const float *gain_spectrum,
+                         const float *residual_spectrum,
+                         const float residual_level,
+                         const uint32_t fft_size,
+                         const uint32_t real_spectrum_size) {
+  const float32x4_t level = vdupq_n_f32(residual_level);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[k]);
+    const float32x4_t gains = vld1q_f32(&gain_spectrum[k]);
+    const float32x4_t residual =
+        vmulq_f32(vld1q_f32(&residual_spectrum[k]), level);
+    const float32x4_t mixed = vaddq_f32(vmulq_f32(bins, gains), residual);
+
+    vst1q_f32(&fft_spectrum[k], mixed);
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    fft_spectrum[k] = fft_spectrum[k] * gain_spectrum[k] +
+                      residual_spectrum[k] * residual_level;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[position]);
+    const float32x4_t gains = reverse(vld1q_f32(&gain_spectrum[k]));
+    const float32x4_t residual =
+        vmulq_f32(vld1q_f32(&residual_spectrum[position]), level);
+    const float32x4_t mixed = vaddq_f32(vmulq_f32(bins, gains), residual);
+
+    vst1q_f32(&fft_spectrum[position], mixed);
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    const uint32_t position = fft_size - k;
+    fft_spectrum[position] = fft_spectrum[position] * gain_spectrum[k] +
+                             residual_spectrum[position] * residual_level;
+  }
+}
+
+static void apply_gains(float *fft_spectrum,
+                        const float *gain_spectrum,
+                        const float denoised_level,
+                        const float residual_level,
+                        const uint32_t fft_size,
+                        const uint32_t real_spectrum_size) {
+  const float32x4_t residual = vdupq_n_f32(residual_level);
+  const float32x4_t difference = vdupq_n_f32(denoised_level - residual_level);
+  const float level_difference = denoised_level - residual_level;
+
+  uint32_t k = 1U;
+  for (; k + LANES <= real_spectrum_size; k += LANES) {
+    const float32x4_t gains = vld1q_f32(&gain_spectrum[k]);
+    const float32x4_t levels =
+        vaddq_f32(residual, vmulq_f32(gains, difference));
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[k]);
+
+    vst1q_f32(&fft_spectrum[k], vmulq_f32(bins, levels));
+  }
+
+  for (; k < real_spectrum_size; k++) {
+    fft_spectrum[k] *= residual_level + gain_spectrum[k] * level_difference;
+  }
+
+  // Imaginary parts are stored backwards from the end
+  const uint32_t imaginary_bins = fft_size - real_spectrum_size;
+  for (k = 1U; k + LANES <= imaginary_bins + 1U; k += LANES) {
+    const uint32_t position = fft_size - k - (LANES - 1U);
+    const float32x4_t gains = reverse(vld1q_f32(&gain_spectrum[k]));
+    const float32x4_t levels =
+        vaddq_f32(residual, vmulq_f32(gains, difference));
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[position]);
+
+    vst1q_f32(&fft_spectrum[position], vmulq_f32(bins, levels));
+  }
+
+  for (; k <= imaginary_bins; k++) {
+    fft_spectrum[fft_size - k] *=
+        residual_level + gain_spectrum[k] * level_difference;
+  }
+}
+
+static void whitening(float *fft_spectrum, float *residual_max_spectrum,
+                      const uint32_t fft_size, const float max_decay_rate,
+                      const float whitening_factor, const bool first_window) {
+  const float32x4_t whitening_floor = vdupq_n_f32(WHITENING_FLOOR);
+  const float32x4_t minimum = vdupq_n_f32(FLT_MIN);
+  const float32x4_t decay = vdupq_n_f32(first_window ? 0.F : max_decay_rate);
+  const float32x4_t factor = vdupq_n_f32(whitening_factor);
+  const float32x4_t complement = vdupq_n_f32(1.F - whitening_factor);
+
+  // Maximums are positive so a zero decay restarts them on the first window
+  uint32_t k = 1U;
+  for (; k + LANES <= fft_size; k += LANES) {
+    const float32x4_t bins = vld1q_f32(&fft_spectrum[k]);
+    const float32x4_t decayed =
+        vmulq_f32(vld1q_f32(&residual_max_spectrum[k]), decay);
+    const float32x4_t maximum =
+        vmaxnmq_f32(vmaxnmq_f32(bins, whitening_floor), decayed);
+    const float32x4_t whitened =
+        vaddq_f32(vmulq_f32(complement, bins),
+                   vmulq_f32(factor, vdivq_f32(bins, maximum)));
+
+    vst1q_f32(&residual_max_spectrum[k], maximum);
+    vst1q_f32(&fft_spectrum[k],
+                  blend(greater(bins, minimum), whitened, bins));
+  }
+
+  for (; k < fft_size; k++) {
+    if (!first_window) {
+      residual_max_spectrum[k] =
+          fmaxf(fmaxf(fft_spectrum[k], WHITENING_FLOOR),
+                residual_max_spectrum[k] * max_decay_rate);
+    } else {
+      residual_max_spectrum[k] = fmaxf(fft_spectrum[k], WHITENING_FLOOR);
+    }
+
+    if (fft_spectrum[k] > FLT_MIN) {
+      const float whitened_residual =
+          fft_spectrum[k] / residual_max_spectrum[k];
+
+      fft_spectrum[k] = (1.F - whitening_factor) * fft_spectrum[k] +
+                        whitening_factor * whitened_residual;
+    }
+  }
+}
+
+static void track_noise(const float *spectrum,
+                               const float *detection_thresholds,
+                               const NoiseTrackingState *previous,
+                               const NoiseTrackingState *current,
+                               float *noise_spectrum,
+                               const uint32_t spectrum_size) {
+  const float32x4_t smooth = vdupq_n_f32(N_SMOOTH);
+  const float32x4_t smooth_complement = vdupq_n_f32(1.F - N_SMOOTH);
+  const float32x4_t gamma = vdupq_n_f32(GAMMA);
+  const float32x4_t rise = vdupq_n_f32((1.F - GAMMA) / (1.F - BETA_AT));
+  const float32x4_t beta = vdupq_n_f32(BETA_AT);
+  const float32x4_t alpha_p = vdupq_n_f32(ALPHA_P);
+  const float32x4_t presence = vdupq_n_f32(1.F - ALPHA_P);
+  const float32x4_t alpha_d = vdupq_n_f32(ALPHA_D);
+  const float32x4_t alpha_d_complement = vdupq_n_f32(1.F - ALPHA_D);
+  const float32x4_t one = vdupq_n_f32(1.F);
+  const float32x4_t zero = vdupq_n_f32(0.F);
+  const float32x4_t infinity = vdupq_n_f32(INFINITY);
+
+  uint32_t k = 1U;
+  for (; k + LANES <= spectrum_size; k += LANES) {
+    const float32x4_t bins = vld1q_f32(&spectrum[k]);
+    const float32x4_t last_smoothed =
+        vld1q_f32(&previous->smoothed_spectrum[k]);
+    const float32x4_t last_minimum =
+        vld1q_f32(&previous->local_minimum_spectrum[k]);
+    const float32x4_t last_probability =
+        vld1q_f32(&previous->speech_presence_probability[k]);
+    const float32x4_t last_noise = vld1q_f32(&previous->noise_spectrum[k]);
+
+    const float32x4_t smoothed =
+        vaddq_f32(vmulq_f32(smooth, last_smoothed),
+                  vmulq_f32(smooth_complement, bins));
+    const float32x4_t increase =
+        vsubq_f32(smoothed, vmulq_f32(beta, last_smoothed));
+    const float32x4_t tracked_minimum =
+        vaddq_f32(vmulq_f32(gamma, last_minimum), vmulq_f32(rise, increase));
+    const float32x4_t minimum =
+        blend(less(last_minimum, smoothed), tracked_minimum, smoothed);
+
+    // Ratios that aren't finite never count as speech, as in the scalar code
+    const float32x4_t ratio = vdivq_f32(smoothed, minimum);
+    const float32x4_t thresholds = vld1q_f32(&detection_thresholds[k]);
+    const float32x4_t detected =
+        blend(greater(ratio, thresholds),
+              blend(less(ratio, infinity), presence, zero), zero);
+    const float32x4_t probability =
+        vaddq_f32(vmulq_f32(alpha_p, last_probability), detected);
+
+    const float32x4_t smoothing =
+        vaddq_f32(alpha_d, vmulq_f32(alpha_d_complement, probability));
+    const float32x4_t noise =
+        vaddq_f32(vmulq_f32(smoothing, last_noise),
+                  vmulq_f32(vsubq_f32(one, smoothing), bins));
+
+    vst1q_f32(&current->smoothed_spectrum[k], smoothed);
+    vst1q_f32(&current->local_minimum_spectrum[k], minimum);
+    vst1q_f32(&current->speech_presence_probability[k], probability);
+    vst1q_f32(&current->noise_spectrum[k], noise);
+    vst1q_f32(&noise_spectrum[k], noise);
+  }
+
+  for (; k < spectrum_size; k++) {
+    const float smoothed = N_SMOOTH * previous->smoothed_spectrum[k] +
+                           (1.F - N_SMOOTH) * spectrum[k];
+
+    float minimum = smoothed;
+    if (previous->local_minimum_spectrum[k] < smoothed) {
+      minimum = GAMMA * previous->local_minimum_spectrum[k] +
+                ((1.F - GAMMA) / (1.F - BETA_AT)) *
+                    (smoothed - BETA_AT * previous->smoothed_spectrum[k]);
+    }
+
+    const float ratio = smoothed / minimum;
+    const float detected =
+        isnormal(ratio) && ratio > detection_thresholds[k] ? 1.F : 0.F;
+    const float probability =
+        ALPHA_P * previous->speech_presence_probability[k] +
+        (1.F - ALPHA_P) * detected;
+
+    const float smoothing = ALPHA_D + (1.F - ALPHA_D) * probability;
+    const float noise = smoothing * previous->noise_spectrum[k] +
+                        (1.F - smoothing) * spectrum[k];
+
+    current->smoothed_spectrum[k] = smoothed;
+    current->local_minimum_spectrum[k] = minimum;
+    current->speech_presence_probability[k] = probability;
+    current->noise_spectrum[k] = noise;
+    noise_spectrum[k] = noise;
+  }
+}
+
+static const SpectralKernels neon_kernels = {
+    .name = "neon",
+    .apply_window = &apply_window,
+    .accumulate = &accumulate,
+    .apply_window_to = &apply_window_to,
+    .accumulate_windowed = &accumulate_windowed,
+    .accumulate_scaled = &accumulate_scaled,
+    .fill = &fill,
+    .power_spectrum = &power_spectrum,
+    .wiener_gains = &wiener_gains,
+    .power_subtraction_gains = &power_subtraction_gains,
+    .split_residual = &split_residual,
+    .mix_residual = &mix_residual,
+    .apply_gains = &apply_gains,
+    .whitening = &whitening,
+    .track_noise = &track_noise,
+};
+
+const SpectralKernels *get_neon_spectral_kernels(void) {
+  return &neon_kernels;
+}
+
+#else
+
+const SpectralKernels *get_neon_spectral_kernels(void) { return NULL; }
+
+#endif
@@ -0,0 +1,248 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "spectral_rolling_median.h"
+#include "memory_arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Every bin keeps its window in a mediator: a max heap and a min heap joined at
+// the median, stored in a single array indexed from -max_count to min_count so
+// index 0 holds the median. Values are kept in a ring shared by all bins and
+// every value knows its place in the heaps, so the oldest value is replaced by
+// the incoming one and sifted into place (Hardle and Steiger, 1995)
+struct SpectralRollingMedian {
+  uint32_t spectrum_size;
+  uint32_t window_length;
+  uint32_t ring_position;
+  int32_t min_count;
+  int32_t max_count;
+
+  float *values;
+  int32_t *heap_positions;
+  int32_t *heaps;
+};
+
+typedef struct Mediator {
+  float *values;
+  int32_t *heap_positions;
+  int32_t *heap;
+  int32_t min_count;
+  int32_t max_count;
+} Mediator;
+
+static Mediator get_mediator(SpectralRollingMedian *self, uint32_t bin);
+static void insert_value(Mediator *mediator, int32_t slot, float value);
+static void lay_out_zeroed_window(SpectralRollingMedian *self);
+
+SpectralRollingMedian *
+spectral_rolling_median_initialize(const uint32_t spectrum_size,
+                                   const uint32_t window_length) {
+  if (window_length == 0U) {
+    return NULL;
+  }
+
+  SpectralRollingMedian *self = (SpectralRollingMedian *)spectral_calloc(
+      1U, sizeof(SpectralRollingMedian));
+
+  self->spectrum_size = spectrum_size;
+  self->window_length = window_length;
+  self->ring_position = 0U;
+  self->min_count = (int32_t)(window_length - 1U) / 2;
+  self->max_count = (int32_t)window_length / 2;
+
+  const size_t size = (size_t)spectrum_size * window_length;
+  self->values = (float *)spectral_calloc(size, sizeof(float));
+  self->heap_positions = (int32_t *)spectral_calloc(size, sizeof(int32_t));
+  self->heaps = (int32_t *)spectral_calloc(size, sizeof(int32_t));
+
+  lay_out_zeroed_window(self);
+
+  return self;
+}
+
+void spectral_rolling_median_free(SpectralRollingMedian *self) {
+  spectral_free(self->values);
+  spectral_free(self->heap_positions);
+  spectral_free(self->heaps);
+
+  spectral_free(self);
+}
+
+void spectral_rolling_median_reset(SpectralRollingMedian *self) {
+  self->ring_position = 0U;
+
+  memset(self->values, 0,
+         (size_t)self->spectrum_size * self->window_length * sizeof(float));
+  lay_out_zeroed_window(self);
+}
+
+bool spectral_rolling_median_push(SpectralRollingMedian *self,
+                                  const float *spectrum) {
+  if (!self || !spectrum) {
+    return false;
+  }
+
+  for (uint32_t bin = 0U; bin < self->spectrum_size; bin++) {
+    Mediator mediator = get_mediator(self, bin);
+    insert_value(&mediator, (int32_t)self->ring_position, spectrum[bin]);
+  }
+
+  self->ring_position = (self->ring_position + 1U) % self->window_length;
+
+  return true;
+}
+
+float get_rolling_median_bin(SpectralRollingMedian *self, const uint32_t bin) {
+  Mediator mediator = get_mediator(self, bin);
+  const float median = mediator.values[mediator.heap[0]];
+
+  // Even windows average the median with the largest value below it
+  if (self->window_length % 2U == 0U) {
+    return (mediator.values[mediator.heap[-1]] + median) / 2.F;
+  }
+
+  return median;
+}
+
+uint32_t get_rolling_median_window_length(SpectralRollingMedian *self) {
+  return self->window_length;
+}
+
+static Mediator get_mediator(SpectralRollingMedian *self, const uint32_t bin) {
+  const size_t offset = (size_t)bin * self->window_length;
+
+  return (Mediator){
+      .values = &self->values[offset],
+      .heap_positions = &self->heap_positions[offset],
+      .heap = &self->heaps[offset + (size_t)self->max_count],
+      .min_count = self->min_count,
+      .max_count = self->max_count,
+  };
+}
+
+static bool is_less(const Mediator *mediator, const int32_t i,
+                    const int32_t j) {
+  return mediator->values[mediator->heap[i]] <
+         mediator->values[mediator->heap[j]];
+}
+
+static void exchange(Mediator *mediator, const int32_t i, const int32_t j) {
+  const int32_t slot = mediator->heap[i];
+
+  mediator->heap[i] = mediator->heap[j];
+  mediator->heap[j] = slot;
+  mediator->heap_positions[mediator->heap[i]] = i;
+  mediator->heap_positions[mediator->heap[j]] = j;
+}
+
+// Swaps heap entries i and j when the value at i is less than the one at j
+static bool compare_exchange(Mediator *mediator, const int32_t i,
+                             const int32_t j) {
+  if (!is_less(mediator, i, j)) {
+    return false;
+  }
+
+  exchange(mediator, i, j);
+
+  return true;
+}
+
+// Both start from the first child of the entry to sift down and restore the
+// heap below it, the median being the parent of both heap roots
+static void min_sort_down(Mediator *mediator, int32_t i) {
+  for (; i <= mediator->min_count; i *= 2) {
+    if (i < mediator->min_count && is_less(mediator, i + 1, i)) {
+      ++i;
+    }
+    if (!compare_exchange(mediator, i, i / 2)) {
+      break;
+    }
+  }
+}
+
+static void max_sort_down(Mediator *mediator, int32_t i) {
+  for (; i >= -mediator->max_count; i *= 2) {
+    if (i > -mediator->max_count && is_less(mediator, i, i - 1)) {
+      --i;
+    }
+    if (!compare_exchange(mediator, i / 2, i)) {
+      break;
+    }
+  }
+}
+
+// Both return whether the value reached the median
+static bool min_sort_up(Mediator *mediator, int32_t i) {
+  while (i > 0 && compare_exchange(mediator, i, i / 2)) {
+    i /= 2;
+  }
+
+  return i == 0;
+}
+
+static bool max_sort_up(Mediator *mediator, int32_t i) {
+  while (i < 0 && compare_exchange(mediator, i / 2, i)) {
+    i /= 2;
+  }
+
+  return i == 0;
+}
+
+static void insert_value(Mediator *mediator, const int32_t slot,
+                         const float value) {
+  const int32_t position = mediator->heap_positions[slot];
+  const float old_value = mediator->values[slot];
+
+  mediator->values[slot] = value;
+
+  if (position > 0) {
+    if (old_value < value) {
+      min_sort_down(mediator, position * 2);
+    } else if (min_sort_up(mediator, position)) {
+      max_sort_down(mediator, -1);
+    }
+  } else if (position < 0) {
+    if (value < old_value) {
+      max_sort_down(mediator, position * 2);
+    } else if (max_sort_up(mediator, position)) {
+      min_sort_down(mediator, 1);
+    }
+  } else {
+    if (mediator->max_count > 0) {
+      max_sort_down(mediator, -1);
+    }
+    if (mediator->min_count > 0) {
+      min_sort_down(mediator, 1);
+    }
+  }
+}
+
+// Equal values form valid heaps in any order, so the zeroed window is laid out
+// alternating median, max heap and min heap
+static void lay_out_zeroed_window(SpectralRollingMedian *self) {
+  for (uint32_t bin = 0U; bin < self->spectrum_size; bin++) {
+    Mediator mediator = get_mediator(self, bin);
+    for (int32_t slot = 0; slot < (int32_t)self->window_length; slot++) {
+      mediator.heap_positions[slot] = ((slot + 1) / 2) * (slot & 1 ? -1 : 1);
+      mediator.heap[mediator.heap_positions[slot]] = slot;
+    }
+  }
+}
@@ -0,0 +1,41 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SPECTRAL_ROLLING_MEDIAN_H
+#define SPECTRAL_ROLLING_MEDIAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Median of every bin over the last spectra pushed. The window starts filled
+// with zeroed spectra and each push updates every bin in O(log window_length)
+typedef struct SpectralRollingMedian SpectralRollingMedian;
+
+SpectralRollingMedian *
+spectral_rolling_median_initialize(uint32_t spectrum_size,
+                                   uint32_t window_length);
+void spectral_rolling_median_free(SpectralRollingMedian *self);
+void spectral_rolling_median_reset(SpectralRollingMedian *self);
+bool spectral_rolling_median_push(SpectralRollingMedian *self,
+                                  const float *spectrum);
+float get_rolling_median_bin(SpectralRollingMedian *self, uint32_t bin);
+uint32_t get_rolling_median_window_length(SpectralRollingMedian *self);
+
+#endif
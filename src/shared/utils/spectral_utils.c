@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "spectral_utils.h"
 #include "../configurations.h"
 #include "general_utils.h"
+#include "spectral_kernels.h"
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
@@ -113,6 +114,31 @@ float min_spectral_value(const float *spectrum,
   return min;
 }
 
+float sum_spectrum(const float *spectrum, const uint32_t spectrum_size) {
+  if (!spectrum || spectrum_size <= 0U) {
+    return 0.F;
+  }
+
+  float sum = 0.F;
+  for (uint32_t k = 0U; k < spectrum_size; k++) {
+    sum += spectrum[k];
+  }
+  return sum;
+}
+
+float sum_squared_spectrum(const float *spectrum,
+                           const uint32_t spectrum_size) {
+  if (!spectrum || spectrum_size <= 0U) {
+    return 0.F;
+  }
+
+  float sum = 0.F;
+  for (uint32_t k = 0U; k < spectrum_size; k++) {
+    sum += spectrum[k] * spectrum[k];
+  }
+  return sum;
+}
+
 bool min_spectrum(float *spectrum_one, const float *spectrum_two,
                   const uint32_t spectrum_size) {
   if (!spectrum_one || !spectrum_two || spectrum_size <= 0U) {
@@ -139,18 +165,31 @@ bool max_spectrum(float *spectrum_one, const float *spectrum_two,
   return true;
 }
 
-bool direct_matrix_to_vector_spectral_convolution(const float *matrix_spectum,
-                                                  const float *spectrum,
-                                                  float *out_spectrum,
-                                                  uint32_t spectrum_size) {
-  if (!matrix_spectum || !spectrum || !out_spectrum || spectrum_size <= 0) {
+bool banded_matrix_to_vector_spectral_convolution(
+    const float *diagonals, const int32_t *offsets,
+    const uint32_t number_of_diagonals, const float *spectrum,
+    float *out_spectrum, const uint32_t spectrum_size) {
+  if (!diagonals || !offsets || !spectrum || !out_spectrum ||
+      spectrum_size <= 0) {
     return false;
   }
 
-  for (uint32_t i = 0U; i < spectrum_size; i++) {
-    out_spectrum[i] = 0.F;
-    for (uint32_t j = 0U; j < spectrum_size; j++) {
-      out_spectrum[i] += matrix_spectum[i * spectrum_size + j] * spectrum[j];
+  const SpectralKernels *kernels = get_spectral_kernels();
+
+  initialize_spectrum_with_value(out_spectrum, spectrum_size, 0.F);
+
+  for (uint32_t d = 0U; d < number_of_diagonals; d++) {
+    const uint32_t distance = (uint32_t)abs(offsets[d]);
+    if (distance >= spectrum_size) {
+      continue;
+    }
+
+    if (offsets[d] >= 0) {
+      kernels->accumulate_scaled(&out_spectrum[distance], spectrum,
+                                 diagonals[d], spectrum_size - distance);
+    } else {
+      kernels->accumulate_scaled(out_spectrum, &spectrum[distance],
+                                 diagonals[d], spectrum_size - distance);
     }
   }
 
@@ -167,16 +206,16 @@ uint32_t freq_to_fft_bin(const float freq, const uint32_t sample_rate,
   return (uint32_t)(freq / ((float)sample_rate / (float)fft_size / 2.F));
 }
 
-float spectral_flux(const float *spectrum, const float *previous_spectrum,
+float spectral_flux(const float *magnitude, const float *previous_magnitude,
                     const uint32_t spectrum_size) {
-  if (!spectrum || !previous_spectrum || spectrum_size <= 0U) {
+  if (!magnitude || !previous_magnitude || spectrum_size <= 0U) {
     return 0.F;
   }
 
   float spectral_flux = 0.F;
 
   for (uint32_t i = 0U; i < spectrum_size; i++) {
-    const float temp = sqrtf(spectrum[i]) - sqrtf(previous_spectrum[i]);
+    const float temp = magnitude[i] - previous_magnitude[i];
     spectral_flux += (temp + fabsf(temp)) / 2.F;
   }
   return spectral_flux;
@@ -201,53 +240,31 @@ bool get_rolling_mean_spectrum(float *averaged_spectrum,
 
   return true;
 }
-
-static int min_max_comparator(const void *a, const void *b) {
-  float x = *(const float *)a;
-  float y = *(const float *)b;
-
-  return x >= y ? 1 : -1;
-}
-
-static float find_median(const float *array, uint32_t array_size) {
-  float median = 0.F;
-
-  if (array_size % 2 == 0) {
-    // if number of elements are even
-    median = (array[(array_size - 1U) / 2U] + array[array_size / 2U]) / 2.F;
-  } else {
-    // if number of elements are odd
-    median = array[array_size / 2U];
-  }
-
-  return median;
-}
-
-bool get_rolling_median_spectrum(float *median_spectrum,
-                                 const float *current_spectrum_buffer,
-                                 const uint32_t number_of_blocks,
-                                 const uint32_t spectrum_size) {
-  if (!median_spectrum || !current_spectrum_buffer || spectrum_size <= 0U) {
+bool merge_averaged_spectra(float *averaged_spectrum,
+                            uint32_t *averaged_blocks,
+                            const float *other_spectrum,
+                            const uint32_t other_blocks,
+                            const uint32_t spectrum_size) {
+  if (!averaged_spectrum || !averaged_blocks || !other_spectrum ||
+      spectrum_size <= 0U) {
     return false;
   }
 
-  float tmp_buffer[number_of_blocks];
-
-  for (uint32_t i = 1U; i < spectrum_size; i++) {
-    for (uint32_t j = 0U; j < number_of_blocks; j++) {
-      tmp_buffer[j] = current_spectrum_buffer[j * spectrum_size + i];
-    }
-
-    // Sorting array
-    qsort(tmp_buffer, number_of_blocks, sizeof(float), min_max_comparator);
-
-    float median_of_buffer = find_median(tmp_buffer, number_of_blocks);
+  if (*averaged_blocks == 0U && other_blocks == 0U) {
+    return max_spectrum(averaged_spectrum, other_spectrum, spectrum_size);
+  }
+  if (other_blocks == 0U) {
+    return true;
+  }
 
-    // Taking the max of the median
-    if (median_of_buffer > median_spectrum[i]) {
-      median_spectrum[i] = median_of_buffer;
-    }
+  const float weight =
+      (float)other_blocks / ((float)*averaged_blocks + (float)other_blocks);
+  for (uint32_t k = 0U; k < spectrum_size; k++) {
+    averaged_spectrum[k] += (other_spectrum[k] - averaged_spectrum[k]) * weight;
   }
+  *averaged_blocks = other_blocks > UINT32_MAX - *averaged_blocks
+                         ? UINT32_MAX
+                         : *averaged_blocks + other_blocks;
 
   return true;
-}
\ No newline at end of file
+}
@@ -34,12 +34,20 @@ typedef enum WindowTypes {
 bool get_fft_window(float *window, uint32_t fft_size, WindowTypes window_type);
 bool initialize_spectrum_with_value(float *spectrum, uint32_t spectrum_size,
                                     float value);
-bool direct_matrix_to_vector_spectral_convolution(const float *matrix_spectum,
+// Multiplies the spectrum by a matrix whose values only depend on the distance
+// between row and column, storing just the diagonals that matter. Diagonal
+// offsets are row minus column and they are added in the given order
+bool banded_matrix_to_vector_spectral_convolution(const float *diagonals,
+                                                  const int32_t *offsets,
+                                                  uint32_t number_of_diagonals,
                                                   const float *spectrum,
                                                   float *out_spectrum,
                                                   uint32_t spectrum_size);
 float max_spectral_value(const float *spectrum, uint32_t real_spectrum_size);
 float min_spectral_value(const float *spectrum, uint32_t real_spectrum_size);
+float sum_spectrum(const float *spectrum, uint32_t spectrum_size);
+// Energy of a whole fft spectrum, the same as adding its power spectrum
+float sum_squared_spectrum(const float *spectrum, uint32_t spectrum_size);
 bool min_spectrum(float *spectrum_one, const float *spectrum_two,
                   uint32_t spectrum_size);
 bool max_spectrum(float *spectrum_one, const float *spectrum_two,
@@ -47,15 +55,18 @@ bool max_spectrum(float *spectrum_one, const float *spectrum_two,
 float fft_bin_to_freq(uint32_t bin_index, uint32_t sample_rate,
                       uint32_t fft_size);
 uint32_t freq_to_fft_bin(float freq, uint32_t sample_rate, uint32_t fft_size);
-float spectral_flux(const float *spectrum, const float *previous_spectrum,
+// Rise of the magnitudes from the previous hop, half-wave rectified
+float spectral_flux(const float *magnitude, const float *previous_magnitude,
                     uint32_t spectrum_size);
 bool get_rolling_mean_spectrum(float *averaged_spectrum,
                                const float *current_spectrum,
                                uint32_t number_of_blocks,
                                uint32_t spectrum_size);
-bool get_rolling_median_spectrum(float *median_spectrum,
-                               const float *current_spectrum_buffer,
-                               uint32_t number_of_blocks,
-                               uint32_t spectrum_size);
+// Averages two averaged spectra weighted by the blocks behind each, adding the
+// blocks up. Without blocks behind either every bin keeps the largest value
+bool merge_averaged_spectra(float *averaged_spectrum,
+                            uint32_t *averaged_blocks,
+                            const float *other_spectrum, uint32_t other_blocks,
+                            uint32_t spectrum_size);
 
 #endif
\ No newline at end of file
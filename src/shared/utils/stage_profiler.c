@@ -0,0 +1,92 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stage_profiler.h"
+#include "memory_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+struct StageProfiler {
+  StageCounter stages[NUMBER_OF_PROFILED_STAGES];
+};
+
+StageProfiler *stage_profiler_initialize(void) {
+  StageProfiler *self =
+      (StageProfiler *)spectral_calloc(1U, sizeof(StageProfiler));
+
+  return self;
+}
+
+void stage_profiler_free(StageProfiler *self) { spectral_free(self); }
+
+void stage_profiler_reset(StageProfiler *self) {
+  if (!self) {
+    return;
+  }
+
+  memset(self->stages, 0, sizeof(self->stages));
+}
+
+void stage_profiler_add(StageProfiler *self, const ProfiledStage stage,
+                        const uint64_t nanoseconds, const uint64_t cycles) {
+  if (!self || stage >= NUMBER_OF_PROFILED_STAGES) {
+    return;
+  }
+
+  self->stages[stage].calls++;
+  self->stages[stage].nanoseconds += nanoseconds;
+  self->stages[stage].cycles += cycles;
+}
+
+void stage_profiler_accumulate(StageProfiler *self,
+                               StageCounter *stage_counters) {
+  if (!self || !stage_counters) {
+    return;
+  }
+
+  for (uint32_t k = 0U; k < NUMBER_OF_PROFILED_STAGES; k++) {
+    stage_counters[k].calls += self->stages[k].calls;
+    stage_counters[k].nanoseconds += self->stages[k].nanoseconds;
+    stage_counters[k].cycles += self->stages[k].cycles;
+  }
+}
+
+uint64_t get_profiler_time_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+// Time stamp counter where available. Other architectures only report time
+uint64_t get_profiler_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return (uint64_t)__rdtsc();
+#else
+  return 0U;
+#endif
+}
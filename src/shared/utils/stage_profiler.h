@@ -0,0 +1,80 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Stages timed when profiling is enabled. Order matches SpectralBleachStage
+typedef enum ProfiledStage {
+  STFT_ANALYSIS_STAGE = 0,
+  FORWARD_FFT_STAGE = 1,
+  SPECTRAL_PROCESSING_STAGE = 2,
+  BACKWARD_FFT_STAGE = 3,
+  STFT_SYNTHESIS_STAGE = 4,
+  SPECTRAL_FEATURES_STAGE = 5,
+  NOISE_ESTIMATION_STAGE = 6,
+  NOISE_SCALING_STAGE = 7,
+  SPECTRAL_SMOOTHING_STAGE = 8,
+  GAIN_ESTIMATION_STAGE = 9,
+  POSTFILTER_STAGE = 10,
+  DENOISE_MIXER_STAGE = 11,
+  NUMBER_OF_PROFILED_STAGES = 12,
+} ProfiledStage;
+
+typedef struct StageCounter {
+  uint64_t calls;
+  uint64_t nanoseconds;
+  uint64_t cycles;
+} StageCounter;
+
+// Accumulates the calls, time and cycles spent per stage. A profiler must only
+// be written from one thread at a time
+typedef struct StageProfiler StageProfiler;
+
+StageProfiler *stage_profiler_initialize(void);
+void stage_profiler_free(StageProfiler *self);
+void stage_profiler_reset(StageProfiler *self);
+void stage_profiler_add(StageProfiler *self, ProfiledStage stage,
+                        uint64_t nanoseconds, uint64_t cycles);
+// Adds the counters of the profiler to the ones passed
+void stage_profiler_accumulate(StageProfiler *self,
+                               StageCounter *stage_counters);
+uint64_t get_profiler_time_ns(void);
+uint64_t get_profiler_cycles(void);
+
+// Timing macros are only compiled with SPECBLEACH_PROFILING defined. Otherwise
+// they expand to nothing and there is no cost in the processing path
+#ifdef SPECBLEACH_PROFILING
+#define PROFILE_STAGE_BEGIN(id)                                                \
+  const uint64_t id##_start_ns = get_profiler_time_ns();                       \
+  const uint64_t id##_start_cycles = get_profiler_cycles()
+#define PROFILE_STAGE_END(profiler, stage, id)                                 \
+  stage_profiler_add((profiler), (stage),                                      \
+                     get_profiler_time_ns() - id##_start_ns,                   \
+                     get_profiler_cycles() - id##_start_cycles)
+#else
+#define PROFILE_STAGE_BEGIN(id) ((void)0)
+#define PROFILE_STAGE_END(profiler, stage, id) ((void)0)
+#endif
+
+#endif
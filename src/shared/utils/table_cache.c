@@ -0,0 +1,184 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "table_cache.h"
+#include "memory_arena.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct TableEntry {
+  float *table;
+  TableKind kind;
+  uint32_t key[TABLE_KEY_SIZE];
+  uint32_t table_size;
+  uint32_t references;
+  struct TableEntry *next;
+} TableEntry;
+
+typedef struct MeasuredSizeEntry {
+  InstanceKind kind;
+  void *key;
+  size_t key_size;
+  size_t size;
+} MeasuredSizeEntry;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TableEntry *cache_entries = NULL;
+static MeasuredSizeEntry measured_sizes[MEASURED_SIZE_CACHE_LENGTH];
+static uint32_t oldest_measured_size = 0U;
+
+static MeasuredSizeEntry *find_measured_size(InstanceKind kind,
+                                             const void *key,
+                                             size_t key_size);
+
+const float *table_cache_acquire(const TableKind kind,
+                                 const uint32_t key[TABLE_KEY_SIZE],
+                                 const uint32_t table_size,
+                                 table_builder build) {
+  if (!key || !build || table_size == 0U) {
+    return NULL;
+  }
+
+  const float *table = NULL;
+
+  pthread_mutex_lock(&cache_mutex);
+
+  for (TableEntry *entry = cache_entries; entry; entry = entry->next) {
+    if (entry->kind == kind && entry->table_size == table_size &&
+        memcmp(entry->key, key, sizeof(entry->key)) == 0) {
+      entry->references++;
+      table = entry->table;
+      break;
+    }
+  }
+
+  if (!table) {
+    TableEntry *entry = (TableEntry *)calloc(1U, sizeof(TableEntry));
+    if (entry) {
+      entry->table = (float *)calloc(table_size, sizeof(float));
+      if (entry->table) {
+        // Scratch used while building goes to the heap as well
+        MemoryArena *previous_arena = memory_arena_bind(NULL);
+        build(entry->table, key);
+        memory_arena_bind(previous_arena);
+
+        entry->kind = kind;
+        memcpy(entry->key, key, sizeof(entry->key));
+        entry->table_size = table_size;
+        entry->references = 1U;
+        entry->next = cache_entries;
+        cache_entries = entry;
+        table = entry->table;
+      } else {
+        free(entry);
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+
+  return table;
+}
+
+void table_cache_release(const float *table) {
+  if (!table) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+
+  TableEntry **link = &cache_entries;
+  while (*link) {
+    TableEntry *entry = *link;
+    if (entry->table == table) {
+      entry->references--;
+      if (entry->references == 0U) {
+        *link = entry->next;
+        free(entry->table);
+        free(entry);
+      }
+      break;
+    }
+    link = &entry->next;
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+}
+
+bool table_cache_find_size(const InstanceKind kind, const void *key,
+                           const size_t key_size, size_t *size) {
+  if (!key || !size) {
+    return false;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+
+  const MeasuredSizeEntry *entry = find_measured_size(kind, key, key_size);
+  if (entry) {
+    *size = entry->size;
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+
+  return entry != NULL;
+}
+
+void table_cache_store_size(const InstanceKind kind, const void *key,
+                            const size_t key_size, const size_t size) {
+  if (!key || key_size == 0U) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache_mutex);
+
+  if (!find_measured_size(kind, key, key_size)) {
+    void *stored_key = malloc(key_size);
+    if (stored_key) {
+      memcpy(stored_key, key, key_size);
+
+      MeasuredSizeEntry *entry = &measured_sizes[oldest_measured_size];
+      free(entry->key);
+      entry->kind = kind;
+      entry->key = stored_key;
+      entry->key_size = key_size;
+      entry->size = size;
+
+      oldest_measured_size =
+          (oldest_measured_size + 1U) % MEASURED_SIZE_CACHE_LENGTH;
+    }
+  }
+
+  pthread_mutex_unlock(&cache_mutex);
+}
+
+static MeasuredSizeEntry *find_measured_size(const InstanceKind kind,
+                                             const void *key,
+                                             const size_t key_size) {
+  for (uint32_t i = 0U; i < MEASURED_SIZE_CACHE_LENGTH; i++) {
+    MeasuredSizeEntry *entry = &measured_sizes[i];
+    if (entry->key && entry->kind == kind && entry->key_size == key_size &&
+        memcmp(entry->key, key, key_size) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
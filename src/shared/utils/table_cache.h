@@ -0,0 +1,66 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Process wide cache of the tables instances compute at initialization and
+// never change afterwards. Tables are keyed by kind and the parameters they
+// depend on, unused ones being zero, and are reference counted so instances of
+// the same layout share a single copy that the last one frees. Tables outlive
+// the instance building them, so they never come from its arena. Acquiring and
+// releasing are serialized while reading tables is thread safe
+#define TABLE_KEY_SIZE 6U
+
+typedef enum TableKind {
+  STFT_WINDOWS_TABLE = 0,
+  ASYMMETRIC_STFT_WINDOWS_TABLE = 1,
+  HEARING_THRESHOLDS_TABLE = 2,
+} TableKind;
+
+// Fills a zeroed table of the acquired size
+typedef void (*table_builder)(float *table, const uint32_t *key);
+
+const float *table_cache_acquire(TableKind kind,
+                                 const uint32_t key[TABLE_KEY_SIZE],
+                                 uint32_t table_size, table_builder build);
+void table_cache_release(const float *table);
+
+// Memory instances of a layout take, so building a throwaway instance to
+// measure it happens once per layout. Keys are opaque bytes, padding included,
+// that callers fill with only what shapes the instance. Sizes are kept until
+// the process ends, the oldest one making room once the cache is full
+#define MEASURED_SIZE_CACHE_LENGTH 32U
+
+typedef enum InstanceKind {
+  DENOISER_INSTANCE = 0,
+  ADAPTIVE_DENOISER_INSTANCE = 1,
+} InstanceKind;
+
+bool table_cache_find_size(InstanceKind kind, const void *key, size_t key_size,
+                           size_t *size);
+void table_cache_store_size(InstanceKind kind, const void *key,
+                            size_t key_size, size_t size);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Jobs are claimed through a ticket holding the run in its high half and the
+// next job to claim in its low half
+#define TICKET_RUN_SHIFT 32U
+#define TICKET_JOB_MASK 0xFFFFFFFFU
+// Times an idle worker checks for a new run before sleeping, so runs coming
+// right after one another find it awake
+#define WORKER_SPIN_COUNT 4096U
+
+typedef struct ThreadPoolWorker {
+  struct ThreadPool *pool;
+  pthread_t thread;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+  uint32_t number_of_threads;
+  uint32_t number_of_workers;
+  uint32_t started_workers;
+  ThreadPoolWorker *workers;
+
+  // Only idle workers wait on the mutex, to sleep until the next run
+  pthread_mutex_t mutex;
+  pthread_cond_t work_available;
+  uint32_t sleeping_workers;
+  bool finish;
+
+  // The run is written before its ticket is published and kept until all of
+  // its jobs completed
+  uint64_t ticket;
+  uint32_t completed_jobs;
+  parallel_job job;
+  void *job_data;
+  uint32_t number_of_jobs;
+};
+
+static void *worker_loop(void *instance);
+static uint64_t get_current_run(ThreadPool *self);
+static void wake_workers(ThreadPool *self);
+static void run_jobs(ThreadPool *self);
+
+ThreadPool *thread_pool_initialize(const uint32_t number_of_threads) {
+  ThreadPool *self = (ThreadPool *)calloc(1U, sizeof(ThreadPool));
+
+  // The calling thread does its share of the jobs too
+  self->number_of_threads = number_of_threads > 0U ? number_of_threads : 1U;
+  self->number_of_workers = self->number_of_threads - 1U;
+
+  pthread_mutex_init(&self->mutex, NULL);
+  pthread_cond_init(&self->work_available, NULL);
+
+  self->workers = (ThreadPoolWorker *)calloc(
+      self->number_of_workers > 0U ? self->number_of_workers : 1U,
+      sizeof(ThreadPoolWorker));
+
+  for (uint32_t k = 0U; k < self->number_of_workers; k++) {
+    self->workers[k].pool = self;
+
+    if (pthread_create(&self->workers[k].thread, NULL, worker_loop,
+                       &self->workers[k]) != 0) {
+      thread_pool_free(self);
+      return NULL;
+    }
+    self->started_workers++;
+  }
+
+  return self;
+}
+
+void thread_pool_free(ThreadPool *self) {
+  pthread_mutex_lock(&self->mutex);
+  self->finish = true;
+  pthread_cond_broadcast(&self->work_available);
+  pthread_mutex_unlock(&self->mutex);
+
+  for (uint32_t k = 0U; k < self->started_workers; k++) {
+    pthread_join(self->workers[k].thread, NULL);
+  }
+
+  pthread_cond_destroy(&self->work_available);
+  pthread_mutex_destroy(&self->mutex);
+
+  free(self->workers);
+  free(self);
+}
+
+uint32_t get_thread_pool_size(ThreadPool *self) {
+  return self->number_of_threads;
+}
+
+void thread_pool_run(void *instance, const uint32_t number_of_jobs,
+                     parallel_job job, void *job_data) {
+  ThreadPool *self = (ThreadPool *)instance;
+
+  if (!self || !job || number_of_jobs == 0U) {
+    return;
+  }
+
+  if (self->number_of_workers == 0U || number_of_jobs == 1U) {
+    for (uint32_t k = 0U; k < number_of_jobs; k++) {
+      job(job_data, k);
+    }
+    return;
+  }
+
+  // Closing the ticket before writing the run keeps workers still looking at
+  // the previous one from claiming a job of this one half written
+  const uint64_t run = get_current_run(self) + 1U;
+  __atomic_store_n(&self->ticket, (run << TICKET_RUN_SHIFT) | TICKET_JOB_MASK,
+                   __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&self->job, job, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->job_data, job_data, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->number_of_jobs, number_of_jobs, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->completed_jobs, 0U, __ATOMIC_RELAXED);
+  __atomic_store_n(&self->ticket, run << TICKET_RUN_SHIFT, __ATOMIC_SEQ_CST);
+
+  wake_workers(self);
+  run_jobs(self);
+
+  // Every job is claimed by now, so this only waits for the ones other threads
+  // are still running and never for a sleeping worker
+  while (__atomic_load_n(&self->completed_jobs, __ATOMIC_ACQUIRE) <
+         number_of_jobs) {
+  }
+}
+
+static uint64_t get_current_run(ThreadPool *self) {
+  return __atomic_load_n(&self->ticket, __ATOMIC_SEQ_CST) >> TICKET_RUN_SHIFT;
+}
+
+// The running thread never waits for the mutex, it only tries it. Without it
+// the broadcast can miss a worker about to sleep, which then sleeps through
+// the run while the other threads take its jobs
+static void wake_workers(ThreadPool *self) {
+  if (__atomic_load_n(&self->sleeping_workers, __ATOMIC_SEQ_CST) == 0U) {
+    return;
+  }
+
+  const bool locked = pthread_mutex_trylock(&self->mutex) == 0;
+  pthread_cond_broadcast(&self->work_available);
+  if (locked) {
+    pthread_mutex_unlock(&self->mutex);
+  }
+}
+
+static void *worker_loop(void *instance) {
+  ThreadPoolWorker *worker = (ThreadPoolWorker *)instance;
+  ThreadPool *self = worker->pool;
+  uint64_t seen_run = 0U;
+
+  while (true) {
+    uint64_t run = seen_run;
+    for (uint32_t k = 0U; k < WORKER_SPIN_COUNT && run == seen_run; k++) {
+      run = get_current_run(self);
+    }
+
+    if (run == seen_run) {
+      pthread_mutex_lock(&self->mutex);
+      __atomic_add_fetch(&self->sleeping_workers, 1U, __ATOMIC_SEQ_CST);
+      while (!self->finish && (run = get_current_run(self)) == seen_run) {
+        pthread_cond_wait(&self->work_available, &self->mutex);
+      }
+      __atomic_sub_fetch(&self->sleeping_workers, 1U, __ATOMIC_SEQ_CST);
+      const bool finish = self->finish;
+      pthread_mutex_unlock(&self->mutex);
+
+      if (finish) {
+        break;
+      }
+    }
+
+    seen_run = run;
+    run_jobs(self);
+  }
+
+  return NULL;
+}
+
+// Claims jobs of the current run until none is left. A claim only succeeds
+// while the ticket is the one the run was read with, so jobs of a run being
+// replaced are never started
+static void run_jobs(ThreadPool *self) {
+  uint64_t ticket = __atomic_load_n(&self->ticket, __ATOMIC_ACQUIRE);
+
+  while (true) {
+    const uint32_t job_index = (uint32_t)(ticket & TICKET_JOB_MASK);
+    const parallel_job job = __atomic_load_n(&self->job, __ATOMIC_RELAXED);
+    void *job_data = __atomic_load_n(&self->job_data, __ATOMIC_RELAXED);
+    const uint32_t number_of_jobs =
+        __atomic_load_n(&self->number_of_jobs, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (job_index >= number_of_jobs) {
+      return;
+    }
+
+    if (__atomic_compare_exchange_n(&self->ticket, &ticket, ticket + 1U, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      job(job_data, job_index);
+      __atomic_add_fetch(&self->completed_jobs, 1U, __ATOMIC_RELEASE);
+      ticket++;
+    }
+  }
+}
@@ -0,0 +1,43 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "../../interfaces/job_runner.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed set of worker threads created at initialization. Running jobs doesn't
+// allocate nor wait on a lock. The calling thread takes part in the work and
+// every thread claims the next job left, so a job can run in any thread.
+// Returning waits, spinning, only for the jobs other threads already started.
+// Idle workers sleep, and one that misses the wake up sleeps through the run
+// while the others take its jobs
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool *thread_pool_initialize(uint32_t number_of_threads);
+void thread_pool_free(ThreadPool *self);
+uint32_t get_thread_pool_size(ThreadPool *self);
+// Matches job_runner so the pool can be passed as the runner data
+void thread_pool_run(void *instance, uint32_t number_of_jobs, parallel_job job,
+                     void *job_data);
+
+#endif
@@ -0,0 +1,358 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Runs the adaptive denoiser over the reference signal stored in the data
+ * directory with every noise tracker, noise scaling type and a set of presets,
+ * and compares the output of each one with the golden one stored next to it.
+ * The internal STFT of the adaptive denoiser is also compared alone and with
+ * the spectral processor, with both the halfcomplex and the real to complex
+ * transforms against the same golden output. Every stage prints one JSON
+ * object per line with its signal to error ratio and fails below its bound.
+ * The generate mode rewrites the golden outputs instead, which is only meant
+ * for intended changes of the processing. Usage:
+ *   golden_adenoiser_test <data directory>
+ *   golden_adenoiser_test <data directory> generate
+ */
+
+#include "../src/processors/adaptivedenoiser/adaptive_denoiser.h"
+#include "../src/shared/configurations.h"
+#include "../src/shared/stft/stft_processor.h"
+#include "../src/shared/utils/general_utils.h"
+#include "../src/shared/utils/spectral_kernels.h"
+#include <specbleach_adenoiser.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The reference signal is half a second of colored noise at 16khz with voiced
+// bursts after the first 150ms and a click, stored as little endian floats
+#define SAMPLE_RATE 16000U
+#define FRAME_SIZE 20.F
+#define NUMBER_OF_SAMPLES 8000U
+#define BLOCK_SIZE 256U
+#define REFERENCE_INPUT "reference_input.f32"
+#define MAXIMUM_PATH_LENGTH 1024U
+
+// Lowest signal to error ratios accepted. Goldens are generated with the scalar
+// kernels, so vectorized kernels and transforms that only reorder operations
+// stay far above the bounds of most stages. Masking thresholds compare tonality
+// and spreading terms per band and a rounding error can move a bin across them,
+// so the presets using them are given room for a few frames changing
+#define MINIMUM_STFT_SNR 100.0
+#define MINIMUM_SPECTRAL_DENOISER_SNR 90.0
+#define MINIMUM_OUTPUT_SNR 90.0
+#define MINIMUM_MASKING_OUTPUT_SNR 40.0
+// Reported instead of an infinite ratio when outputs are identical
+#define MAXIMUM_REPORTED_SNR 300.0
+
+typedef struct GoldenCase {
+  const char *name;
+  SpectralBleachInitOptions options;
+  int noise_scaling_type;
+  double minimum_output_snr;
+} GoldenCase;
+
+static float input[NUMBER_OF_SAMPLES];
+static float output[NUMBER_OF_SAMPLES];
+static float golden[NUMBER_OF_SAMPLES];
+
+static void get_path(char *path, const char *directory, const char *name,
+                     const char *stage) {
+  snprintf(path, MAXIMUM_PATH_LENGTH, "%s/adenoiser_%s_%s.f32", directory, name,
+           stage);
+}
+
+// Floats are stored little endian whatever the byte order of the host
+static bool read_floats(const char *path, float *values, const uint32_t size) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "could not open %s\n", path);
+    return false;
+  }
+
+  bool read = true;
+  for (uint32_t k = 0U; k < size && read; k++) {
+    unsigned char bytes[4];
+    read = fread(bytes, 1U, sizeof(bytes), file) == sizeof(bytes);
+    const uint32_t bits = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8U) |
+                          ((uint32_t)bytes[2] << 16U) |
+                          ((uint32_t)bytes[3] << 24U);
+    memcpy(&values[k], &bits, sizeof(float));
+  }
+  read = read && fgetc(file) == EOF;
+  fclose(file);
+
+  if (!read) {
+    fprintf(stderr, "%s doesn't hold %u floats\n", path, size);
+  }
+
+  return read;
+}
+
+static bool write_floats(const char *path, const float *values,
+                         const uint32_t size) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    fprintf(stderr, "could not create %s\n", path);
+    return false;
+  }
+
+  bool written = true;
+  for (uint32_t k = 0U; k < size && written; k++) {
+    uint32_t bits = 0U;
+    memcpy(&bits, &values[k], sizeof(float));
+    const unsigned char bytes[4] = {
+        (unsigned char)(bits & 0xFFU), (unsigned char)((bits >> 8U) & 0xFFU),
+        (unsigned char)((bits >> 16U) & 0xFFU),
+        (unsigned char)((bits >> 24U) & 0xFFU)};
+    written = fwrite(bytes, 1U, sizeof(bytes), file) == sizeof(bytes);
+  }
+
+  return fclose(file) == 0 && written;
+}
+
+static double get_snr_db(const float *reference, const float *values,
+                         const uint32_t size) {
+  double signal_energy = 0.;
+  double error_energy = 0.;
+  for (uint32_t k = 0U; k < size; k++) {
+    const double error = (double)reference[k] - (double)values[k];
+    signal_energy += (double)reference[k] * (double)reference[k];
+    error_energy += error * error;
+  }
+
+  if (error_energy <= 0.) {
+    return MAXIMUM_REPORTED_SNR;
+  }
+  const double snr = 10. * log10(signal_energy / error_energy);
+
+  return snr < MAXIMUM_REPORTED_SNR ? snr : MAXIMUM_REPORTED_SNR;
+}
+
+// Compares the values of a stage with its golden, or stores them as the new
+// golden when generating
+static bool check_stage(const char *directory, const char *name,
+                        const char *stage, const char *transform,
+                        const float *values, const uint32_t size,
+                        const double minimum_snr_db, const bool generate) {
+  char path[MAXIMUM_PATH_LENGTH];
+  get_path(path, directory, name, stage);
+
+  if (generate) {
+    return write_floats(path, values, size);
+  }
+
+  const bool loaded = read_floats(path, golden, size);
+  const double snr_db = loaded ? get_snr_db(golden, values, size) : 0.;
+  const bool passed = loaded && snr_db >= minimum_snr_db;
+
+  printf("{\"case\": \"%s\", \"stage\": \"%s\", \"transform\": \"%s\", "
+         "\"snr_db\": %.1f, \"minimum_snr_db\": %.1f, \"passed\": %s}\n",
+         name, stage, transform, snr_db, minimum_snr_db,
+         passed ? "true" : "false");
+  fflush(stdout);
+
+  return passed;
+}
+
+static bool passthrough(SpectralProcessorHandle instance, float *fft_spectrum) {
+  (void)instance;
+  (void)fft_spectrum;
+  return true;
+}
+
+static bool process_range(SpectralBleachHandle instance, const uint32_t start,
+                          const uint32_t end) {
+  for (uint32_t k = start; k < end; k += BLOCK_SIZE) {
+    const uint32_t block = end - k < BLOCK_SIZE ? end - k : BLOCK_SIZE;
+    if (!specbleach_adaptive_process(instance, block, &input[k],
+                                     &output[k])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool run_case(const GoldenCase *golden_case, const char *directory,
+                     const bool generate) {
+  SpectralBleachHandle instance =
+      specbleach_adaptive_initialize_ex(&golden_case->options);
+  if (!instance) {
+    return false;
+  }
+
+  const SpectralBleachParameters parameters = {
+      .reduction_amount = 20.F,
+      .smoothing_factor = 50.F,
+      .whitening_factor = 30.F,
+      .noise_scaling_type = golden_case->noise_scaling_type,
+      .noise_rescale = 2.F,
+      .post_filter_threshold = -10.F,
+  };
+
+  const bool processed =
+      specbleach_adaptive_load_parameters(instance, parameters) &&
+      process_range(instance, 0U, NUMBER_OF_SAMPLES);
+  specbleach_adaptive_free(instance);
+
+  if (!processed) {
+    fprintf(stderr, "%s could not be processed\n", golden_case->name);
+    return false;
+  }
+
+  return check_stage(directory, golden_case->name, "output", "halfcomplex",
+                     output, NUMBER_OF_SAMPLES, golden_case->minimum_output_snr,
+                     generate);
+}
+
+// Internal STFT of the adaptive denoiser with the given transform. The
+// spectral processor reduces the spectra, else they pass through untouched
+static void run_stft(const FftTransformType transform_type, const bool reduce) {
+  StftProcessor *stft_processor = stft_processor_initialize(
+      SAMPLE_RATE, FRAME_SIZE, OVERLAP_FACTOR_SPEECH,
+      PADDING_CONFIGURATION_SPEECH, ZEROPADDING_AMOUNT_SPEECH,
+      INPUT_WINDOW_TYPE_SPEECH, OUTPUT_WINDOW_TYPE_SPEECH, false,
+      transform_type, ESTIMATE_PLANNER, 1U);
+
+  if (!reduce) {
+    stft_processor_run(stft_processor, NUMBER_OF_SAMPLES, input, output,
+                       &passthrough, NULL);
+    stft_processor_free(stft_processor);
+    return;
+  }
+
+  SpectralProcessorHandle denoiser = spectral_adaptive_denoiser_initialize(
+      SAMPLE_RATE, get_stft_fft_size(stft_processor), OVERLAP_FACTOR_SPEECH,
+      ESTIMATE_PLANNER, false, CONTINUOUS_MINIMUM_TRACKER, false);
+
+  load_adaptive_reduction_parameters(
+      denoiser, (AdaptiveDenoiserParameters){
+                    .reduction_amount = from_db_to_coefficient(-20.F),
+                    .noise_scaling_type = 0,
+                    .noise_rescale = from_db_to_coefficient(2.F),
+                    .smoothing_factor = remap_percentage_log_like_unity(0.5F),
+                    .whitening_factor = 0.3F,
+                    .post_filter_threshold = from_db_to_coefficient(-10.F),
+                });
+  stft_processor_run(stft_processor, NUMBER_OF_SAMPLES, input, output,
+                     &spectral_adaptive_denoiser_run, denoiser);
+
+  spectral_adaptive_denoiser_free(denoiser);
+  stft_processor_free(stft_processor);
+}
+
+// Goldens are generated with the halfcomplex transforms the adaptive denoiser
+// uses and both transforms are checked against them
+static bool check_internal_stages(const char *directory, const bool generate) {
+  bool passed = true;
+
+  for (uint32_t reduce = 0U; reduce <= 1U; reduce++) {
+    const char *stage =
+        reduce ? "spectral_adaptive_denoiser_run" : "stft_processor_run";
+    const double minimum_snr_db =
+        reduce ? MINIMUM_SPECTRAL_DENOISER_SNR : MINIMUM_STFT_SNR;
+
+    run_stft(HALFCOMPLEX_TRANSFORM, reduce);
+    passed &= check_stage(directory, "internal", stage, "halfcomplex", output,
+                          NUMBER_OF_SAMPLES, minimum_snr_db, generate);
+    if (generate) {
+      continue;
+    }
+
+    run_stft(REAL_TO_COMPLEX_TRANSFORM, reduce);
+    passed &= check_stage(directory, "internal", stage, "real_to_complex",
+                          output, NUMBER_OF_SAMPLES, minimum_snr_db, false);
+  }
+
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  const bool generate = argc > 2 && strcmp(argv[2], "generate") == 0;
+  if (argc < 2 || (argc > 2 && !generate)) {
+    fprintf(stderr,
+            "usage: %s <data directory>\n"
+            "       %s <data directory> generate\n",
+            argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *directory = argv[1];
+
+  const GoldenCase golden_cases[] = {
+      {"continuous_minimum",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .noise_tracker = SPECBLEACH_NOISE_TRACKER_CONTINUOUS_MINIMUM},
+       0, MINIMUM_OUTPUT_SNR},
+      {"minimum_statistics",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .noise_tracker = SPECBLEACH_NOISE_TRACKER_MINIMUM_STATISTICS},
+       1, MINIMUM_OUTPUT_SNR},
+      {"masking", {.sample_rate = SAMPLE_RATE, .frame_size = FRAME_SIZE}, 2,
+       MINIMUM_MASKING_OUTPUT_SNR},
+      {"band_processing",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .band_processing = true},
+       0, MINIMUM_OUTPUT_SNR},
+      {"low_latency",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .low_latency = true},
+       1, MINIMUM_OUTPUT_SNR},
+      {"approximate_math",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .approximate_math = true},
+       2, MINIMUM_MASKING_OUTPUT_SNR},
+      {"multiresolution",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .multiresolution = true},
+       0, MINIMUM_OUTPUT_SNR},
+      {"speech_band_only",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .speech_band_only = true},
+       0, MINIMUM_OUTPUT_SNR},
+  };
+
+  char path[MAXIMUM_PATH_LENGTH];
+  snprintf(path, sizeof(path), "%s/%s", directory, REFERENCE_INPUT);
+  if (!read_floats(path, input, NUMBER_OF_SAMPLES)) {
+    return EXIT_FAILURE;
+  }
+
+  if (generate) {
+    set_spectral_kernels(get_scalar_spectral_kernels());
+  }
+
+  bool passed = check_internal_stages(directory, generate);
+  for (size_t c = 0U; c < sizeof(golden_cases) / sizeof(golden_cases[0]);
+       c++) {
+    passed &= run_case(&golden_cases[c], directory, generate);
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,174 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Runs the adaptive denoiser through the public processing functions with
+ * every noise tracker and noise scaling type, on mono, threaded multichannel,
+ * low latency, band processing, multiresolution and speech band instances.
+ * The library is built with the real time audit, which aborts the test on any
+ * allocation or lock taken while processing. Parameters are loaded in between
+ * blocks, as a host would while audio runs.
+ */
+
+#include <specbleach_adenoiser.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLE_RATE 48000U
+#define FRAME_SIZE 20.F
+#define NUMBER_OF_SAMPLES 24000U
+#define BLOCK_SIZE 256U
+#define MAXIMUM_CHANNELS 2U
+#define NUMBER_OF_NOISE_TRACKERS 3
+#define NUMBER_OF_SCALING_TYPES 3
+
+typedef struct TestCase {
+  const char *name;
+  SpectralBleachInitOptions options;
+} TestCase;
+
+static float input[MAXIMUM_CHANNELS][NUMBER_OF_SAMPLES];
+static float output[MAXIMUM_CHANNELS][NUMBER_OF_SAMPLES];
+
+static void generate_signal(void) {
+  srand(1);
+  for (uint32_t c = 0U; c < MAXIMUM_CHANNELS; c++) {
+    for (uint32_t k = 0U; k < NUMBER_OF_SAMPLES; k++) {
+      const float noise = ((float)rand() / (float)RAND_MAX - 0.5F) * 0.1F;
+      const float tone =
+          k % 6000U < 2000U ? 0.3F * sinf(0.03F * (float)((c + 1U) * k)) : 0.F;
+      input[c][k] = noise + tone;
+    }
+  }
+}
+
+static bool process_range(SpectralBleachHandle instance,
+                          const uint32_t number_of_channels,
+                          const uint32_t start, const uint32_t end) {
+  for (uint32_t k = start; k < end; k += BLOCK_SIZE) {
+    const uint32_t block = end - k < BLOCK_SIZE ? end - k : BLOCK_SIZE;
+    const float *channel_input[MAXIMUM_CHANNELS];
+    float *channel_output[MAXIMUM_CHANNELS];
+    for (uint32_t c = 0U; c < number_of_channels; c++) {
+      channel_input[c] = &input[c][k];
+      channel_output[c] = &output[c][k];
+    }
+
+    const bool processed =
+        number_of_channels > 1U
+            ? specbleach_adaptive_process_multichannel(
+                  instance, number_of_channels, block, channel_input,
+                  channel_output)
+            : specbleach_adaptive_process(instance, block, channel_input[0],
+                                          channel_output[0]);
+    if (!processed) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool run_case(const TestCase *test_case,
+                     const SpectralBleachNoiseTracker noise_tracker,
+                     const int noise_scaling_type) {
+  SpectralBleachInitOptions options = test_case->options;
+  options.noise_tracker = noise_tracker;
+
+  SpectralBleachHandle instance = specbleach_adaptive_initialize_ex(&options);
+  if (!instance) {
+    return false;
+  }
+
+  const uint32_t number_of_channels =
+      options.number_of_channels > 0U ? options.number_of_channels : 1U;
+  SpectralBleachParameters parameters = {
+      .reduction_amount = 10.F,
+      .smoothing_factor = 50.F,
+      .whitening_factor = 30.F,
+      .noise_scaling_type = noise_scaling_type,
+      .noise_rescale = 2.F,
+      .post_filter_threshold = -10.F,
+  };
+
+  bool passed = specbleach_adaptive_load_parameters(instance, parameters) &&
+                process_range(instance, number_of_channels, 0U,
+                              NUMBER_OF_SAMPLES / 2U);
+
+  // New parameters are taken by the processing thread between blocks
+  parameters.reduction_amount = 20.F;
+  parameters.smoothing_factor = 0.F;
+  passed = passed &&
+           specbleach_adaptive_load_parameters(instance, parameters) &&
+           process_range(instance, number_of_channels, NUMBER_OF_SAMPLES / 2U,
+                         NUMBER_OF_SAMPLES);
+
+  specbleach_adaptive_free(instance);
+
+  return passed;
+}
+
+int main(void) {
+  const TestCase test_cases[] = {
+      {"mono", {.sample_rate = SAMPLE_RATE, .frame_size = FRAME_SIZE}},
+      {"threaded",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .number_of_channels = 2U,
+        .number_of_threads = 2U}},
+      {"low_latency",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .low_latency = true}},
+      {"band_processing",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .band_processing = true}},
+      {"multiresolution",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .multiresolution = true}},
+      {"speech_band_only",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .speech_band_only = true}},
+  };
+
+  generate_signal();
+
+  bool passed = true;
+  for (size_t c = 0U; c < sizeof(test_cases) / sizeof(test_cases[0]); c++) {
+    for (int tracker = 0; tracker < NUMBER_OF_NOISE_TRACKERS; tracker++) {
+      for (int scaling_type = 0; scaling_type < NUMBER_OF_SCALING_TYPES;
+           scaling_type++) {
+        const bool case_passed =
+            run_case(&test_cases[c], (SpectralBleachNoiseTracker)tracker,
+                     scaling_type);
+        printf("%s noise tracker %d scaling type %d: %s\n",
+               test_cases[c].name, tracker, scaling_type,
+               case_passed ? "ok" : "failed");
+        passed = passed && case_passed;
+      }
+    }
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,189 @@
+/*
+libspecbleach - A spectral processing library
+
+Copyright 2022 Luciano Dato <lucianodato@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Runs the denoiser through the public processing functions with every learn
+ * mode and noise scaling type, on mono, threaded multichannel, low latency,
+ * multiresolution and look ahead instances. The library is built with the
+ * real time audit, which aborts the test on any allocation or lock taken
+ * while processing. Profiles are learned, reduced, loaded and queued commands
+ * are applied in between blocks, as a host would while audio runs.
+ */
+
+#include <specbleach_denoiser.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLE_RATE 48000U
+#define FRAME_SIZE 20.F
+#define NUMBER_OF_SAMPLES 24000U
+#define BLOCK_SIZE 256U
+#define MAXIMUM_CHANNELS 2U
+#define NUMBER_OF_LEARN_MODES 5
+#define NUMBER_OF_SCALING_TYPES 3
+
+typedef struct TestCase {
+  const char *name;
+  SpectralBleachInitOptions options;
+} TestCase;
+
+static float input[MAXIMUM_CHANNELS][NUMBER_OF_SAMPLES];
+static float output[MAXIMUM_CHANNELS][NUMBER_OF_SAMPLES];
+
+static void generate_signal(void) {
+  srand(1);
+  for (uint32_t c = 0U; c < MAXIMUM_CHANNELS; c++) {
+    for (uint32_t k = 0U; k < NUMBER_OF_SAMPLES; k++) {
+      const float noise = ((float)rand() / (float)RAND_MAX - 0.5F) * 0.1F;
+      const float tone =
+          k % 6000U < 2000U ? 0.3F * sinf(0.03F * (float)((c + 1U) * k)) : 0.F;
+      input[c][k] = noise + tone;
+    }
+  }
+}
+
+static bool process_range(SpectralBleachHandle instance,
+                          const uint32_t number_of_channels,
+                          const uint32_t start, const uint32_t end) {
+  for (uint32_t k = start; k < end; k += BLOCK_SIZE) {
+    const uint32_t block = end - k < BLOCK_SIZE ? end - k : BLOCK_SIZE;
+    const float *channel_input[MAXIMUM_CHANNELS];
+    float *channel_output[MAXIMUM_CHANNELS];
+    for (uint32_t c = 0U; c < number_of_channels; c++) {
+      channel_input[c] = &input[c][k];
+      channel_output[c] = &output[c][k];
+    }
+
+    const bool processed =
+        number_of_channels > 1U
+            ? specbleach_process_multichannel(instance, number_of_channels,
+                                              block, channel_input,
+                                              channel_output)
+            : specbleach_process(instance, block, channel_input[0],
+                                 channel_output[0]);
+    if (!processed) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool run_case(const TestCase *test_case, const int learn_mode,
+                     const int noise_scaling_type) {
+  SpectralBleachHandle instance = specbleach_initialize_ex(&test_case->options);
+  if (!instance) {
+    return false;
+  }
+
+  const uint32_t number_of_channels =
+      test_case->options.number_of_channels > 0U
+          ? test_case->options.number_of_channels
+          : 1U;
+  SpectralBleachParameters parameters = {
+      .learn_noise = learn_mode,
+      .reduction_amount = 20.F,
+      .smoothing_factor = 50.F,
+      .transient_protection = true,
+      .whitening_factor = 30.F,
+      .noise_scaling_type = noise_scaling_type,
+      .noise_rescale = 2.F,
+      .post_filter_threshold = -10.F,
+  };
+
+  bool passed = specbleach_load_parameters(instance, parameters) &&
+                process_range(instance, number_of_channels, 0U,
+                              NUMBER_OF_SAMPLES / 4U);
+
+  parameters.learn_noise = 0;
+  passed = passed && specbleach_load_parameters(instance, parameters) &&
+           process_range(instance, number_of_channels, NUMBER_OF_SAMPLES / 4U,
+                         NUMBER_OF_SAMPLES / 2U);
+
+  // Loads and commands are taken by the processing thread between blocks
+  const uint32_t profile_size = specbleach_get_noise_profile_size(instance);
+  float *profile = (float *)calloc(profile_size, sizeof(float));
+  passed = passed && profile &&
+           specbleach_copy_noise_profile(instance, profile, profile_size,
+                                         NULL) &&
+           specbleach_load_noise_profile(instance, profile, profile_size, 10U);
+  free(profile);
+
+  SpectralBleachCommand command = {.type = SPECBLEACH_COMMAND_SET_LEARN_MODE};
+  command.payload.learn_noise = learn_mode;
+  passed = passed && specbleach_post_command(instance, &command) != 0U &&
+           process_range(instance, number_of_channels, NUMBER_OF_SAMPLES / 2U,
+                         3U * NUMBER_OF_SAMPLES / 4U);
+
+  command.type = SPECBLEACH_COMMAND_LOAD_PARAMETERS;
+  command.payload.parameters = parameters;
+  passed = passed && specbleach_post_command(instance, &command) != 0U &&
+           process_range(instance, number_of_channels,
+                         3U * NUMBER_OF_SAMPLES / 4U, NUMBER_OF_SAMPLES);
+
+  specbleach_free(instance);
+
+  return passed;
+}
+
+int main(void) {
+  const TestCase test_cases[] = {
+      {"mono", {.sample_rate = SAMPLE_RATE, .frame_size = FRAME_SIZE}},
+      {"threaded",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .number_of_channels = 2U,
+        .number_of_threads = 2U}},
+      {"low_latency",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .low_latency = true}},
+      {"multiresolution",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = 46.F,
+        .multiresolution = true}},
+      {"look_ahead",
+       {.sample_rate = SAMPLE_RATE,
+        .frame_size = FRAME_SIZE,
+        .transient_look_ahead = 20.F,
+        .gain_update_interval = 4U,
+        .skip_noise_frames = true}},
+  };
+
+  generate_signal();
+
+  bool passed = true;
+  for (size_t c = 0U; c < sizeof(test_cases) / sizeof(test_cases[0]); c++) {
+    for (int learn_mode = 1; learn_mode <= NUMBER_OF_LEARN_MODES;
+         learn_mode++) {
+      for (int scaling_type = 0; scaling_type < NUMBER_OF_SCALING_TYPES;
+           scaling_type++) {
+        const bool case_passed =
+            run_case(&test_cases[c], learn_mode, scaling_type);
+        printf("%s learn mode %d scaling type %d: %s\n", test_cases[c].name,
+               learn_mode, scaling_type, case_passed ? "ok" : "failed");
+        passed = passed && case_passed;
+      }
+    }
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}